@@ -0,0 +1,880 @@
+// Headless benchmark runner. Drives the core through the libretro API with no video, audio or input consumers,
+// running a fixed number of frames as fast as possible and reporting per-subsystem timings.
+#include "common/string_util.h"
+#include "common/timer.h"
+#include "core/bus.h"
+#include "core/cpu_code_cache.h"
+#include "core/gpu.h"
+#include "core/gpu_sw_backend.h"
+#include "core/profiling.h"
+#include "core/rewind_store.h"
+#include "core/settings.h"
+#include "core/system.h"
+#include "core/timing_event.h"
+#include "libretro/libretro_host_display.h"
+#include "libretro/libretro_settings_interface.h"
+#include "xxhash.h"
+#include <libretro.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace {
+struct BenchmarkOptions
+{
+  std::string path;
+  std::string system_directory = "system";
+  std::string save_directory = ".";
+  std::string capture_path;
+  std::string replay_capture_path;
+  std::vector<CPUExecutionMode> cpu_modes;
+  std::vector<std::pair<std::string, std::string>> variables;
+  u32 frames = 3600;
+  u32 warmup_frames = 0;
+  u32 replay_interval = 0;
+  u32 serialize_interval = 0;
+  u32 rewind_slots = 0;
+  u32 instances = 1;
+  bool state_hash = false;
+  bool frame_times = false;
+  bool compare_spans = false;
+};
+} // namespace
+
+static BenchmarkOptions s_options;
+static std::mutex s_output_mutex;
+
+// each instance thread drives its own console, so the frontend state is per-console too
+static CONSOLE_LOCAL u32 s_instance_index = 0;
+static CONSOLE_LOCAL std::string s_current_cpu_mode_value;
+static CONSOLE_LOCAL u32 s_video_frames = 0;
+static CONSOLE_LOCAL u32 s_duplicate_frames = 0;
+static CONSOLE_LOCAL retro_pixel_format s_pixel_format = RETRO_PIXEL_FORMAT_0RGB1555;
+static CONSOLE_LOCAL u64 s_last_frame_hash = 0;
+
+static bool GetVariable(const char* key, const char** value)
+{
+  static constexpr char prefix[] = "swanstation_";
+  if (std::strncmp(key, prefix, sizeof(prefix) - 1) != 0)
+    return false;
+
+  const std::string_view name(key + (sizeof(prefix) - 1));
+  if (name == "CPU_ExecutionMode")
+  {
+    *value = s_current_cpu_mode_value.c_str();
+    return true;
+  }
+
+  // user overrides take precedence over the benchmark defaults
+  for (const auto& [var_name, var_value] : s_options.variables)
+  {
+    if (name == var_name)
+    {
+      *value = var_value.c_str();
+      return true;
+    }
+  }
+
+  // software renderer on the emulation thread, so the profiling sections are accurate
+  static constexpr std::pair<const char*, const char*> defaults[] = {{"GPU_Renderer", "Software"},
+                                                                     {"GPU_UseThread", "false"},
+                                                                     {"CDROM_ReadThread", "false"},
+                                                                     {"MemoryCards_Card1Type", "NonPersistent"},
+                                                                     {"Main_RunaheadFrameCount", "0"},
+                                                                     {"Main_ApplyGameSettings", "false"},
+                                                                     {"Display_ShowOSDMessages", "false"},
+                                                                     {"Logging_LogLevel", "Warning"}};
+  for (const auto& [def_name, def_value] : defaults)
+  {
+    if (name == def_name)
+    {
+      *value = def_value;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static bool EnvironmentCallback(unsigned cmd, void* data)
+{
+  switch (cmd)
+  {
+    case RETRO_ENVIRONMENT_GET_VARIABLE:
+    {
+      retro_variable* var = static_cast<retro_variable*>(data);
+      return GetVariable(var->key, &var->value);
+    }
+
+    case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+      *static_cast<const char**>(data) = s_options.system_directory.c_str();
+      return true;
+
+    case RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY:
+      *static_cast<const char**>(data) = s_options.save_directory.c_str();
+      return true;
+
+    // unchanged frames are counted, and keep the hash of the last real one
+    case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+      *static_cast<bool*>(data) = true;
+      return true;
+
+    case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+      s_pixel_format = *static_cast<const retro_pixel_format*>(data);
+      return true;
+
+    case RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO:
+    case RETRO_ENVIRONMENT_SET_GEOMETRY:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+static void VideoRefreshCallback(const void* data, unsigned width, unsigned height, size_t pitch)
+{
+  s_video_frames++;
+  if (!data)
+  {
+    s_duplicate_frames++;
+    return;
+  }
+
+  // only the visible part of each row, the padding isn't guaranteed to be written
+  const size_t row_size = width * ((s_pixel_format == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2);
+  XXH64_state_t* state = XXH64_createState();
+  XXH64_reset(state, 0);
+  for (unsigned row = 0; row < height; row++)
+    XXH64_update(state, static_cast<const u8*>(data) + row * pitch, row_size);
+  s_last_frame_hash = XXH64_digest(state);
+  XXH64_freeState(state);
+}
+
+static void InputPollCallback() {}
+
+static int16_t InputStateCallback(unsigned port, unsigned device, unsigned index, unsigned id)
+{
+  return 0;
+}
+
+// for tuning GPU_UseThread: how often each side of the command FIFO waited on the other
+static void PrintThreadStatistics(const GPUBackend::ThreadStatistics& stats, double elapsed)
+{
+  std::printf("  GPU thread: %llu wakes, %llu sleeps, %.3f ms idle (%.1f%%)\n",
+              static_cast<unsigned long long>(stats.wakes), static_cast<unsigned long long>(stats.consumer_sleeps),
+              static_cast<double>(stats.consumer_idle_ns) / 1000000.0,
+              (static_cast<double>(stats.consumer_idle_ns) / (elapsed * 1000000000.0)) * 100.0);
+  std::printf("  GPU FIFO full: %llu stalls, %.3f ms\n", static_cast<unsigned long long>(stats.producer_stalls),
+              static_cast<double>(stats.producer_stall_ns) / 1000000.0);
+  std::printf("  GPU syncs: %llu, %.3f us average, %.3f us slowest\n", static_cast<unsigned long long>(stats.syncs),
+              (stats.syncs > 0) ? (static_cast<double>(stats.sync_wait_ns) / 1000.0 / stats.syncs) : 0.0,
+              static_cast<double>(stats.max_sync_wait_ns) / 1000.0);
+}
+
+static bool RunBenchmark(CPUExecutionMode mode)
+{
+  s_current_cpu_mode_value = Settings::GetCPUExecutionModeName(mode);
+  s_video_frames = 0;
+  s_duplicate_frames = 0;
+  s_last_frame_hash = 0;
+
+  retro_set_environment(EnvironmentCallback);
+  retro_set_video_refresh(VideoRefreshCallback);
+  retro_set_input_poll(InputPollCallback);
+  retro_set_input_state(InputStateCallback);
+
+  // no audio callbacks, which gives us a null audio stream
+  retro_set_audio_sample(nullptr);
+  retro_set_audio_sample_batch(nullptr);
+
+  retro_init();
+
+  retro_game_info game = {};
+  game.path = s_options.path.c_str();
+  if (!retro_load_game(&game))
+  {
+    std::fprintf(stderr, "Failed to boot '%s'.\n", s_options.path.c_str());
+    retro_deinit();
+    return false;
+  }
+
+  if (g_settings.cpu_execution_mode != mode)
+  {
+    std::fprintf(stderr, "CPU execution mode %s is not available, skipping.\n", Settings::GetCPUExecutionModeName(mode));
+    retro_unload_game();
+    retro_deinit();
+    return true;
+  }
+
+  for (u32 i = 0; i < s_options.warmup_frames; i++)
+    retro_run();
+
+  // runahead loads a state every frame, which the capture has no record of
+  const bool capturing = !s_options.capture_path.empty();
+  if (capturing && g_settings.runahead_frames > 0)
+  {
+    std::fprintf(stderr, "A command capture can't be written with runahead enabled.\n");
+    retro_unload_game();
+    retro_deinit();
+    return false;
+  }
+
+  if (capturing && !g_gpu->BeginCommandCapture(s_options.capture_path.c_str()))
+  {
+    std::fprintf(stderr, "Failed to start the command capture.\n");
+    retro_unload_game();
+    retro_deinit();
+    return false;
+  }
+
+  Profiling::Reset();
+  Profiling::SetEnabled(true);
+  CPU::CodeCache::ResetStatistics();
+  if (g_gpu->GetBackend())
+    g_gpu->GetBackend()->ResetThreadStatistics();
+
+  // round trips through the libretro serialization, like netplay does every frame
+  std::vector<u8> serialize_buffer;
+  if (s_options.serialize_interval > 0)
+    serialize_buffer.resize(retro_serialize_size());
+
+  u32 serialize_count = 0;
+  double serialize_time = 0.0;
+  double unserialize_time = 0.0;
+
+  // keeps a rewind history of every frame, as a frontend rewinding through the core's own store would
+  static constexpr u32 REWIND_KEYFRAME_INTERVAL = 16;
+  RewindStore rewind_store;
+  std::vector<u8> rewind_buffer;
+  double rewind_time = 0.0;
+  if (s_options.rewind_slots > 0)
+  {
+    rewind_buffer.resize(retro_serialize_size());
+    rewind_store.StartThread(s_options.rewind_slots, REWIND_KEYFRAME_INTERVAL);
+  }
+
+  // per-frame desync checksums, as netplay or replay validation would take them
+  System::StateHash state_hash = {};
+  double state_hash_time = 0.0;
+
+  const u32 start_frame_number = System::GetFrameNumber();
+  Common::Timer timer;
+  for (u32 i = 0; i < s_options.frames; i++)
+  {
+    // pretend the input changed, so runahead has to roll back and catch up
+    if (s_options.replay_interval > 0 && (i % s_options.replay_interval) == 0)
+      System::SetRunaheadReplayFlag();
+
+    if (s_options.serialize_interval > 0 && (i % s_options.serialize_interval) == 0)
+    {
+      Common::Timer serialize_timer;
+      if (!retro_serialize(serialize_buffer.data(), serialize_buffer.size()))
+      {
+        std::fprintf(stderr, "Failed to serialize state at frame %u.\n", i);
+        break;
+      }
+
+      serialize_time += serialize_timer.GetTimeSeconds();
+      serialize_timer.Reset();
+      if (!retro_unserialize(serialize_buffer.data(), serialize_buffer.size()))
+      {
+        std::fprintf(stderr, "Failed to unserialize state at frame %u.\n", i);
+        break;
+      }
+
+      unserialize_time += serialize_timer.GetTimeSeconds();
+      serialize_count++;
+    }
+
+    retro_run();
+
+    if (s_options.state_hash)
+    {
+      Common::Timer state_hash_timer;
+      state_hash = System::GetStateHash();
+      state_hash_time += state_hash_timer.GetTimeSeconds();
+    }
+
+    if (s_options.rewind_slots > 0)
+    {
+      Common::Timer rewind_timer;
+      if (!retro_serialize(rewind_buffer.data(), rewind_buffer.size()))
+      {
+        std::fprintf(stderr, "Failed to save rewind state at frame %u.\n", i);
+        break;
+      }
+
+      rewind_store.Push(rewind_buffer.data(), static_cast<u32>(rewind_buffer.size()), nullptr);
+      rewind_time += rewind_timer.GetTimeSeconds();
+    }
+  }
+
+  const double elapsed = timer.GetTimeSeconds();
+  Profiling::SetEnabled(false);
+
+  // anything which loads a state while capturing ends the capture early
+  const bool capture_complete = (!capturing || g_gpu->IsCapturingCommands());
+  if (capturing)
+    g_gpu->EndCommandCapture();
+
+  const u32 frames_run = System::GetFrameNumber() - start_frame_number;
+  const double fps = static_cast<double>(frames_run) / elapsed;
+  const double speed = (fps / System::GetThrottleFrequency()) * 100.0;
+
+  // keeps the reports of concurrent instances from interleaving
+  std::unique_lock<std::mutex> output_lock(s_output_mutex);
+  if (s_options.instances > 1)
+    std::printf("Instance %u, CPU execution mode: %s\n", s_instance_index, Settings::GetCPUExecutionModeDisplayName(mode));
+  else
+    std::printf("CPU execution mode: %s\n", Settings::GetCPUExecutionModeDisplayName(mode));
+  std::printf("  Frames: %u (%u presented, %u duplicates) in %.3f seconds\n", frames_run, s_video_frames,
+              s_duplicate_frames, elapsed);
+  std::printf("  FPS: %.2f (%.1f%% speed)\n", fps, speed);
+
+  for (u32 i = 0; i < static_cast<u32>(Profiling::Section::Count); i++)
+  {
+    const Profiling::Section section = static_cast<Profiling::Section>(i);
+    const double section_time = Profiling::GetSectionTimeSeconds(section);
+    std::printf("  %-24s %10.3f ms %6.2f%% %12llu calls\n", Profiling::GetSectionName(section), section_time * 1000.0,
+                (section_time / elapsed) * 100.0,
+                static_cast<unsigned long long>(Profiling::GetSectionCallCount(section)));
+  }
+
+  if (mode != CPUExecutionMode::Interpreter)
+  {
+    const CPU::CodeCache::Statistics& stats = CPU::CodeCache::GetStatistics();
+    std::printf("  Block lookups: %llu (%.2f probes each), %llu compiled\n",
+                static_cast<unsigned long long>(stats.block_lookups),
+                stats.block_lookups ? (static_cast<double>(stats.block_lookup_probes) / stats.block_lookups) : 0.0,
+                static_cast<unsigned long long>(stats.block_compiles));
+    std::printf("  Block allocations: %llu (%llu bytes), %llu slabs, %llu large\n",
+                static_cast<unsigned long long>(stats.block_allocations),
+                static_cast<unsigned long long>(stats.block_allocation_bytes),
+                static_cast<unsigned long long>(stats.block_slab_allocations),
+                static_cast<unsigned long long>(stats.block_large_allocations));
+    std::printf("  Idle loop skips: %llu (%llu cycles)\n", static_cast<unsigned long long>(stats.idle_loop_skips),
+                static_cast<unsigned long long>(stats.idle_loop_skipped_ticks));
+    std::printf("  Code invalidations: %llu (%llu writes next to code ignored)\n",
+                static_cast<unsigned long long>(stats.code_invalidations),
+                static_cast<unsigned long long>(stats.invalidations_avoided));
+    if (mode == CPUExecutionMode::Recompiler)
+    {
+      std::printf("  Host code: %llu bytes for %llu instructions (%.2f bytes each)\n",
+                  static_cast<unsigned long long>(stats.recompiled_host_bytes),
+                  static_cast<unsigned long long>(stats.recompiled_instructions),
+                  stats.recompiled_instructions ?
+                    (static_cast<double>(stats.recompiled_host_bytes) / stats.recompiled_instructions) :
+                    0.0);
+      std::printf("  Tiers: %llu blocks started interpreted (%llu executions), %llu promoted to host code\n",
+                  static_cast<unsigned long long>(stats.tier_cold_blocks),
+                  static_cast<unsigned long long>(stats.tier_cold_executions),
+                  static_cast<unsigned long long>(stats.tier_promotions));
+      std::printf("  Traces: %llu extended from profiles, %llu conditional branches with side exits\n",
+                  static_cast<unsigned long long>(stats.trace_extensions),
+                  static_cast<unsigned long long>(stats.trace_profiled_branches));
+      std::printf("  Code evictions: %llu (%llu blocks)\n", static_cast<unsigned long long>(stats.code_evictions),
+                  static_cast<unsigned long long>(stats.code_evicted_blocks));
+    }
+  }
+
+  if (s_options.rewind_slots > 0)
+  {
+    // the newest slot has to decode back to the last state pushed, through however many deltas it took
+    std::vector<u8> newest_state;
+    HostDisplayTexture* newest_texture;
+    const bool rewind_ok = rewind_store.GetNewest(&newest_state, &newest_texture) && newest_state == rewind_buffer;
+    const RewindStore::Statistics stats = rewind_store.GetStatistics();
+    rewind_store.StopThread();
+    std::printf("  Rewind: %u slots (%u keyframes), %llu bytes each (%.2f%% of a plain save state), %.3f ms per "
+                "save, newest slot %s\n",
+                stats.slot_count, stats.keyframe_count,
+                static_cast<unsigned long long>(stats.slot_count ? (stats.compressed_bytes / stats.slot_count) : 0),
+                stats.uncompressed_bytes ?
+                  ((static_cast<double>(stats.compressed_bytes) / stats.uncompressed_bytes) * 100.0) :
+                  0.0,
+                (rewind_time * 1000.0) / s_options.frames, rewind_ok ? "matches" : "DOES NOT MATCH");
+  }
+
+  const GPUBackend* gpu_backend = g_gpu->GetBackend();
+  if (gpu_backend && gpu_backend->IsUsingThread())
+    PrintThreadStatistics(gpu_backend->GetThreadStatistics(), elapsed);
+
+  if (serialize_count > 0)
+  {
+    std::printf("  Serialize: %u round trips of %zu bytes, %.3f ms to serialize, %.3f ms to unserialize\n",
+                serialize_count, serialize_buffer.size(), (serialize_time * 1000.0) / serialize_count,
+                (unserialize_time * 1000.0) / serialize_count);
+  }
+
+  if (s_options.state_hash)
+  {
+    std::printf("  State hash: %016llX, %.3f ms per frame\n", static_cast<unsigned long long>(state_hash.digest),
+                (state_hash_time * 1000.0) / s_options.frames);
+  }
+
+  // lets the results of different CPU modes be compared, for deterministic content
+  std::printf("  RAM hash: %016llX\n", static_cast<unsigned long long>(XXH64(Bus::g_ram, Bus::g_ram_size, 0)));
+  std::printf("  Last frame hash: %016llX\n", static_cast<unsigned long long>(s_last_frame_hash));
+
+  // what a replay of the capture should end up with
+  if (!capture_complete)
+  {
+    std::printf("  Command capture to '%s' was ended early by a state load\n", s_options.capture_path.c_str());
+  }
+  else if (capturing)
+  {
+    std::printf("  Captured GPU commands to '%s', VRAM hash: %016llX\n", s_options.capture_path.c_str(),
+                static_cast<unsigned long long>(
+                  XXH64(g_gpu->ReadBackVRAM(), VRAM_WIDTH * VRAM_HEIGHT * sizeof(u16), 0)));
+  }
+
+  std::fflush(stdout);
+  output_lock.unlock();
+
+  retro_unload_game();
+  retro_deinit();
+  return true;
+}
+
+static bool RunInstances(CPUExecutionMode mode)
+{
+#ifdef WITH_MULTI_INSTANCE
+  std::vector<std::thread> threads;
+  std::vector<u8> results(s_options.instances);
+  Common::Timer timer;
+  for (u32 i = 0; i < s_options.instances; i++)
+  {
+    threads.emplace_back([i, mode, &results]() {
+      s_instance_index = i;
+      results[i] = static_cast<u8>(RunBenchmark(mode));
+    });
+  }
+
+  for (std::thread& thread : threads)
+    thread.join();
+
+  std::printf("%u instances finished in %.3f seconds\n", s_options.instances, timer.GetTimeSeconds());
+  for (u32 i = 0; i < s_options.instances; i++)
+  {
+    if (!results[i])
+      return false;
+  }
+
+  return true;
+#else
+  std::fprintf(stderr, "Running several instances requires a build with ENABLE_MULTI_INSTANCE.\n");
+  return false;
+#endif
+}
+
+static std::unique_ptr<GPU> CreateReplayGPU(HostDisplay* display, const std::vector<u8>& state)
+{
+  // Captures from any renderer are drawn with the software one. Nothing runs the timing events, the command timing
+  // comes from the capture instead.
+  TimingEvents::Initialize();
+  std::unique_ptr<GPU> gpu = GPU::CreateSoftwareRenderer();
+  if (!gpu->Initialize(display) || !gpu->LoadCommandCaptureState(state))
+  {
+    std::fprintf(stderr, "Failed to initialize the software renderer.\n");
+    return {};
+  }
+
+  return gpu;
+}
+
+// the vector span shading has to match the scalar path bit for bit, so replay with each and compare every frame
+static bool CompareVectorSpans(HostDisplay* display, const std::vector<u8>& state,
+                               const std::vector<std::vector<u32>>& frames)
+{
+  std::vector<u64> frame_hashes[2];
+  for (u32 pass = 0; pass < 2; pass++)
+  {
+    std::unique_ptr<GPU> gpu = CreateReplayGPU(display, state);
+    if (!gpu)
+      return false;
+
+    static_cast<GPU_SW_Backend*>(gpu->GetBackend())->SetVectorSpansEnabled(pass == 0);
+    for (const std::vector<u32>& frame : frames)
+    {
+      gpu->ReplayCommandCaptureFrame(frame);
+      frame_hashes[pass].push_back(XXH64(gpu->ReadBackVRAM(), VRAM_WIDTH * VRAM_HEIGHT * sizeof(u16), 0));
+    }
+  }
+
+  std::printf("Vector span comparison: %s\n", s_options.replay_capture_path.c_str());
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    if (frame_hashes[0][i] != frame_hashes[1][i])
+    {
+      std::printf("  Frame %zu differs: VRAM hash %016llX with vector spans, %016llX without\n", i,
+                  static_cast<unsigned long long>(frame_hashes[0][i]),
+                  static_cast<unsigned long long>(frame_hashes[1][i]));
+      return false;
+    }
+  }
+
+  std::printf("  All %zu frames match, VRAM hash: %016llX\n", frames.size(),
+              static_cast<unsigned long long>(frame_hashes[0].back()));
+  return true;
+}
+
+// random polygons over random VRAM reach every combination of shading, texturing, blending and masking, so this
+// checks the vector spans on a new platform without a capture from a game
+static bool CompareSyntheticVectorSpans()
+{
+  static constexpr u32 NUM_BATCHES = 64;
+  static constexpr u32 POLYGONS_PER_BATCH = 256;
+  static constexpr s32 MAX_POLYGON_EXTENT = 192;
+
+  retro_set_environment(EnvironmentCallback);
+  LibretroSettingsInterface si;
+  g_settings.Load(si);
+
+  std::printf("Vector span comparison: %u batches of %u random polygons\n", NUM_BATCHES, POLYGONS_PER_BATCH);
+  if (!GPU_SW_Backend::HasVectorSpans())
+    std::printf("  This build has no vector span shading, both passes are scalar\n");
+
+  std::vector<u64> batch_hashes[2];
+  for (u32 pass = 0; pass < 2; pass++)
+  {
+    std::unique_ptr<GPU_SW_Backend> backend = std::make_unique<GPU_SW_Backend>();
+    if (!backend->Initialize(false))
+    {
+      std::fprintf(stderr, "Failed to initialize the software renderer.\n");
+      return false;
+    }
+
+    backend->SetVectorSpansEnabled(pass == 0);
+
+    // both passes draw the same things
+    std::mt19937 rng(0x5350414E);
+    const auto random = [&rng](s32 min, s32 max) { return std::uniform_int_distribution<s32>(min, max)(rng); };
+
+    u16* vram = backend->GetVRAM();
+    for (u32 i = 0; i < VRAM_WIDTH * VRAM_HEIGHT; i++)
+      vram[i] = Truncate16(rng());
+
+    for (u32 batch = 0; batch < NUM_BATCHES; batch++)
+    {
+      const u32 left = static_cast<u32>(random(0, VRAM_WIDTH / 2));
+      const u32 top = static_cast<u32>(random(0, VRAM_HEIGHT / 2));
+      GPUBackendSetDrawingAreaCommand* area_cmd = backend->NewSetDrawingAreaCommand();
+      area_cmd->params.bits = 0;
+      area_cmd->new_area = Common::Rectangle<u32>(left, top, static_cast<u32>(random(left, VRAM_WIDTH - 1)),
+                                                  static_cast<u32>(random(top, VRAM_HEIGHT - 1)));
+      backend->PushCommand(area_cmd);
+
+      for (u32 i = 0; i < POLYGONS_PER_BATCH; i++)
+      {
+        const bool quad = (random(0, 1) != 0);
+        GPUBackendDrawPolygonCommand* cmd = backend->NewDrawPolygonCommand(quad ? 4 : 3);
+        cmd->params.bits = Truncate8(rng() & 0x0Fu);
+        cmd->rc.bits = static_cast<u32>(rng()) & UINT32_C(0x1FFFFFFF);
+        cmd->rc.primitive = GPUPrimitive::Polygon;
+        cmd->rc.quad_polygon = quad;
+        cmd->draw_mode.bits = Truncate16(rng()) & GPUDrawModeReg::MASK;
+        cmd->palette.bits = Truncate16(rng()) & GPUTexturePaletteReg::MASK;
+
+        // the same masks SetTextureWindow() would build, or none most of the time
+        const u8 mask_x = (random(0, 3) == 0) ? Truncate8(random(0, 31)) : 0;
+        const u8 mask_y = (random(0, 3) == 0) ? Truncate8(random(0, 31)) : 0;
+        cmd->window.and_x = Truncate8(~(mask_x * 8));
+        cmd->window.and_y = Truncate8(~(mask_y * 8));
+        cmd->window.or_x = Truncate8((random(0, 31) & mask_x) * 8);
+        cmd->window.or_y = Truncate8((random(0, 31) & mask_y) * 8);
+
+        // wide enough for long spans, but never big enough for the GPU to cull
+        const s32 center_x = random(-64, VRAM_WIDTH + 64);
+        const s32 center_y = random(-64, VRAM_HEIGHT + 64);
+        for (u32 j = 0; j < cmd->num_vertices; j++)
+        {
+          cmd->vertices[j].Set(center_x + random(-MAX_POLYGON_EXTENT, MAX_POLYGON_EXTENT),
+                               center_y + random(-MAX_POLYGON_EXTENT, MAX_POLYGON_EXTENT),
+                               static_cast<u32>(rng()) & UINT32_C(0x00FFFFFF), Truncate16(rng()));
+        }
+
+        backend->PushCommand(cmd);
+      }
+
+      backend->Sync(true);
+      batch_hashes[pass].push_back(XXH64(vram, VRAM_WIDTH * VRAM_HEIGHT * sizeof(u16), 0));
+    }
+
+    backend->Shutdown();
+  }
+
+  for (u32 batch = 0; batch < NUM_BATCHES; batch++)
+  {
+    if (batch_hashes[0][batch] != batch_hashes[1][batch])
+    {
+      std::printf("  Batch %u differs: VRAM hash %016llX with vector spans, %016llX without\n", batch,
+                  static_cast<unsigned long long>(batch_hashes[0][batch]),
+                  static_cast<unsigned long long>(batch_hashes[1][batch]));
+      return false;
+    }
+  }
+
+  std::printf("  All %u batches match, VRAM hash: %016llX\n", NUM_BATCHES,
+              static_cast<unsigned long long>(batch_hashes[0].back()));
+  return true;
+}
+
+static bool RunCaptureReplay()
+{
+  // the renderer settings come through the environment callback, as they would for the core
+  retro_set_environment(EnvironmentCallback);
+  LibretroSettingsInterface si;
+  g_settings.Load(si);
+
+  std::vector<u8> state;
+  std::vector<std::vector<u32>> frames;
+  if (!GPU::LoadCommandCapture(s_options.replay_capture_path.c_str(), &state, &frames))
+  {
+    std::fprintf(stderr, "Failed to load command capture '%s'.\n", s_options.replay_capture_path.c_str());
+    return false;
+  }
+
+  LibretroHostDisplay display;
+  if (s_options.compare_spans)
+    return CompareVectorSpans(&display, state, frames);
+
+  std::unique_ptr<GPU> gpu = CreateReplayGPU(&display, state);
+  if (!gpu)
+    return false;
+
+  GPUBackend* backend = gpu->GetBackend();
+  backend->Sync(true);
+  backend->ResetThreadStatistics();
+
+  std::vector<double> frame_times;
+  frame_times.reserve(frames.size());
+  Common::Timer timer;
+  for (const std::vector<u32>& frame : frames)
+  {
+    Common::Timer frame_timer;
+    gpu->ReplayCommandCaptureFrame(frame);
+    backend->Sync(true);
+    frame_times.push_back(frame_timer.GetTimeSeconds());
+  }
+
+  const double elapsed = timer.GetTimeSeconds();
+  const u64 vram_hash = XXH64(gpu->ReadBackVRAM(), VRAM_WIDTH * VRAM_HEIGHT * sizeof(u16), 0);
+  const GPUBackend::ThreadStatistics thread_stats = backend->GetThreadStatistics();
+  const bool used_thread = backend->IsUsingThread();
+  gpu.reset();
+
+  std::printf("Command capture replay: %s\n", s_options.replay_capture_path.c_str());
+  std::printf("  Renderer threads: %u%s\n", g_settings.gpu_sw_rasterizer_threads,
+              g_settings.gpu_use_thread ? " (plus the GPU thread)" : "");
+  std::printf("  Frames: %zu in %.3f seconds\n", frame_times.size(), elapsed);
+  if (!frame_times.empty())
+  {
+    size_t slowest = 0;
+    double fastest_time = frame_times[0];
+    for (size_t i = 1; i < frame_times.size(); i++)
+    {
+      if (frame_times[i] > frame_times[slowest])
+        slowest = i;
+      fastest_time = std::min(fastest_time, frame_times[i]);
+    }
+
+    std::printf("  Frame time: %.3f ms average, %.3f ms fastest, %.3f ms slowest (frame %zu)\n",
+                (elapsed * 1000.0) / frame_times.size(), fastest_time * 1000.0, frame_times[slowest] * 1000.0,
+                slowest);
+  }
+
+  if (s_options.frame_times)
+  {
+    for (size_t i = 0; i < frame_times.size(); i++)
+      std::printf("  Frame %zu: %.3f ms\n", i, frame_times[i] * 1000.0);
+  }
+
+  if (used_thread)
+    PrintThreadStatistics(thread_stats, elapsed);
+
+  std::printf("  VRAM hash: %016llX\n", static_cast<unsigned long long>(vram_hash));
+  return true;
+}
+
+static void PrintUsage(const char* progname)
+{
+  std::fprintf(stderr,
+               "Usage: %s [options] <disc/exe/psf path>\n"
+               "       %s [options] -replaycapture <file>\n"
+               "       %s -comparespans\n"
+               "  -frames <count>          Number of frames to time (default 3600).\n"
+               "  -warmup <count>          Number of frames to run before timing (default 0).\n"
+               "  -cpu <mode>              CPU execution mode: Interpreter, CachedInterpreter, Recompiler.\n"
+               "                           Can be specified multiple times, defaults to all modes.\n"
+               "  -system <dir>            Directory containing BIOS images (default 'system').\n"
+               "  -save <dir>              Directory for memory cards (default '.').\n"
+               "  -replay <interval>       Forces a runahead replay every N frames (default 0, never).\n"
+               "  -serialize <interval>    Serializes and unserializes the state every N frames (default 0, never).\n"
+               "  -rewind <slots>          Keeps a compressed rewind history of every frame, this many deep.\n"
+               "  -statehash               Hashes the machine state after every frame.\n"
+               "  -instances <count>       Runs this many consoles concurrently on separate threads (default 1).\n"
+               "  -option <Section_Key=V>  Overrides a core option, e.g. CPU_Overclock=200.\n"
+               "  -capture <file>          Writes the GP0/GP1 and DMA writes of the timed frames to a file.\n"
+               "                           Can't be combined with runahead, -replay or -serialize.\n"
+               "  -replaycapture <file>    Replays the frames of a capture on the software renderer, without\n"
+               "                           emulating anything else, and reports the time taken by each.\n"
+               "                           Captures from the hardware renderers are replayed in software too.\n"
+               "  -frametimes              Lists the time of every replayed frame.\n"
+               "  -comparespans            Draws with vector and scalar span shading, and fails if VRAM differs.\n"
+               "                           Replays the capture given with -replaycapture, or without one, draws\n"
+               "                           random polygons and needs no game.\n",
+               progname, progname, progname);
+}
+
+static bool ParseCommandLine(int argc, char* argv[])
+{
+  for (int i = 1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+    const bool has_value = (i + 1) < argc;
+    if (std::strcmp(arg, "-frames") == 0 && has_value)
+    {
+      s_options.frames = StringUtil::FromChars<u32>(argv[++i]).value_or(0);
+    }
+    else if (std::strcmp(arg, "-warmup") == 0 && has_value)
+    {
+      s_options.warmup_frames = StringUtil::FromChars<u32>(argv[++i]).value_or(0);
+    }
+    else if (std::strcmp(arg, "-replay") == 0 && has_value)
+    {
+      s_options.replay_interval = StringUtil::FromChars<u32>(argv[++i]).value_or(0);
+    }
+    else if (std::strcmp(arg, "-serialize") == 0 && has_value)
+    {
+      s_options.serialize_interval = StringUtil::FromChars<u32>(argv[++i]).value_or(0);
+    }
+    else if (std::strcmp(arg, "-rewind") == 0 && has_value)
+    {
+      s_options.rewind_slots = StringUtil::FromChars<u32>(argv[++i]).value_or(0);
+    }
+    else if (std::strcmp(arg, "-instances") == 0 && has_value)
+    {
+      s_options.instances = StringUtil::FromChars<u32>(argv[++i]).value_or(0);
+    }
+    else if (std::strcmp(arg, "-statehash") == 0)
+    {
+      s_options.state_hash = true;
+    }
+    else if (std::strcmp(arg, "-capture") == 0 && has_value)
+    {
+      s_options.capture_path = argv[++i];
+    }
+    else if (std::strcmp(arg, "-replaycapture") == 0 && has_value)
+    {
+      s_options.replay_capture_path = argv[++i];
+    }
+    else if (std::strcmp(arg, "-frametimes") == 0)
+    {
+      s_options.frame_times = true;
+    }
+    else if (std::strcmp(arg, "-comparespans") == 0)
+    {
+      s_options.compare_spans = true;
+    }
+    else if (std::strcmp(arg, "-cpu") == 0 && has_value)
+    {
+      const std::optional<CPUExecutionMode> mode = Settings::ParseCPUExecutionMode(argv[++i]);
+      if (!mode.has_value())
+      {
+        std::fprintf(stderr, "Unknown CPU execution mode '%s'.\n", argv[i]);
+        return false;
+      }
+
+      s_options.cpu_modes.push_back(mode.value());
+    }
+    else if (std::strcmp(arg, "-system") == 0 && has_value)
+    {
+      s_options.system_directory = argv[++i];
+    }
+    else if (std::strcmp(arg, "-save") == 0 && has_value)
+    {
+      s_options.save_directory = argv[++i];
+    }
+    else if (std::strcmp(arg, "-option") == 0 && has_value)
+    {
+      const std::string_view option(argv[++i]);
+      const std::string_view::size_type pos = option.find('=');
+      if (pos == std::string_view::npos)
+      {
+        std::fprintf(stderr, "Malformed option '%s'.\n", argv[i]);
+        return false;
+      }
+
+      s_options.variables.emplace_back(option.substr(0, pos), option.substr(pos + 1));
+    }
+    else if (arg[0] != '-' && s_options.path.empty())
+    {
+      s_options.path = arg;
+    }
+    else
+    {
+      std::fprintf(stderr, "Unknown argument '%s'.\n", arg);
+      return false;
+    }
+  }
+
+  if (!s_options.replay_capture_path.empty() || (s_options.compare_spans && s_options.path.empty()))
+    return true;
+
+  if (s_options.path.empty() || s_options.frames == 0 || s_options.instances == 0)
+    return false;
+
+  if (!s_options.capture_path.empty() && s_options.instances > 1)
+  {
+    std::fprintf(stderr, "Only one instance can write a command capture.\n");
+    return false;
+  }
+
+  if (!s_options.capture_path.empty() && (s_options.replay_interval > 0 || s_options.serialize_interval > 0))
+  {
+    std::fprintf(stderr, "A command capture can't be written while states are being loaded.\n");
+    return false;
+  }
+
+  if (s_options.cpu_modes.empty())
+  {
+    for (u32 i = 0; i < static_cast<u32>(CPUExecutionMode::Count); i++)
+      s_options.cpu_modes.push_back(static_cast<CPUExecutionMode>(i));
+  }
+
+  return true;
+}
+
+int main(int argc, char* argv[])
+{
+  if (!ParseCommandLine(argc, argv))
+  {
+    PrintUsage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (!s_options.replay_capture_path.empty())
+    return RunCaptureReplay() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  if (s_options.compare_spans)
+    return CompareSyntheticVectorSpans() ? EXIT_SUCCESS : EXIT_FAILURE;
+
+  for (const CPUExecutionMode mode : s_options.cpu_modes)
+  {
+    if (!((s_options.instances > 1) ? RunInstances(mode) : RunBenchmark(mode)))
+      return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -133,6 +133,8 @@ public:
   void Resize(u32 new_size);
   void ResizeMemory(u32 new_size);
 
+  u8* GetMemoryPointer() const { return m_pMemory; }
+
   bool ReadByte(u8* pDestByte) override;
   u32 Read(void* pDestination, u32 ByteCount) override;
   bool Read2(void* pDestination, u32 ByteCount, u32* pNumberOfBytesRead) override;
@@ -65,6 +65,8 @@ bool JitCodeBuffer::Allocate(u32 size /* = 64 * 1024 * 1024 */, u32 far_code_siz
   m_far_code_size = far_code_size;
   m_far_code_used = 0;
 
+  ResetRegions();
+
   m_old_protection = 0;
   m_owns_buffer = true;
   return true;
@@ -119,12 +121,14 @@ bool JitCodeBuffer::Initialize(void* buffer, u32 size, u32 far_code_size /* = 0
   m_code_size = size - far_code_size - (guard_size * 2);
   m_code_used = 0;
 
-  m_far_code_ptr = static_cast<u8*>(m_code_ptr) + m_code_size;
+  // far code starts after the near code, which begins after the leading guard
+  m_far_code_ptr = static_cast<u8*>(m_code_ptr) + guard_size + m_code_size;
   m_free_far_code_ptr = m_far_code_ptr;
   m_far_code_size = far_code_size - guard_size;
   m_far_code_used = 0;
 
   m_guard_size = guard_size;
+  ResetRegions();
   m_owns_buffer = false;
   return true;
 }
@@ -158,6 +162,14 @@ void JitCodeBuffer::Destroy()
   m_free_far_code_ptr = nullptr;
   m_far_code_size = 0;
   m_far_code_used = 0;
+  m_code_region_end = nullptr;
+  m_far_code_region_end = nullptr;
+  m_code_regions_start = nullptr;
+  m_far_code_regions_start = nullptr;
+  m_code_region_size = 0;
+  m_far_code_region_size = 0;
+  m_region_count = 1;
+  m_current_region = 0;
   m_total_size = 0;
   m_guard_size = 0;
   m_old_protection = 0;
@@ -169,6 +181,8 @@ void JitCodeBuffer::ReserveCode(u32 size)
   m_code_reserve_size += size;
   m_free_code_ptr += size;
   m_code_size -= size;
+  m_code_regions_start = m_free_code_ptr;
+  m_code_region_size -= size;
 }
 
 void JitCodeBuffer::CommitCode(u32 length)
@@ -216,9 +230,54 @@ void JitCodeBuffer::Reset()
     FlushInstructionCache(m_free_far_code_ptr, m_far_code_size);
   }
 
+  ResetRegions();
+
   WriteProtect(true);
 }
 
+void JitCodeBuffer::ResetRegions()
+{
+  m_code_region_end = m_free_code_ptr + (m_code_size - m_code_used);
+  m_far_code_region_end = m_free_far_code_ptr + (m_far_code_size - m_far_code_used);
+  m_code_regions_start = m_free_code_ptr;
+  m_far_code_regions_start = m_free_far_code_ptr;
+  m_code_region_size = static_cast<u32>(m_code_region_end - m_code_regions_start);
+  m_far_code_region_size = static_cast<u32>(m_far_code_region_end - m_far_code_regions_start);
+  m_region_count = 1;
+  m_current_region = 0;
+}
+
+void JitCodeBuffer::SetRegionCount(u32 count)
+{
+  // keep the regions aligned, so the code in each one is laid out the same way
+  static constexpr u32 REGION_ALIGNMENT = 64;
+
+  m_code_regions_start = m_free_code_ptr;
+  m_far_code_regions_start = m_free_far_code_ptr;
+  m_code_region_size = ((static_cast<u32>(m_code_region_end - m_free_code_ptr) / count) & ~(REGION_ALIGNMENT - 1));
+  m_far_code_region_size =
+    ((static_cast<u32>(m_far_code_region_end - m_free_far_code_ptr) / count) & ~(REGION_ALIGNMENT - 1));
+  m_code_region_end = m_code_regions_start + m_code_region_size;
+  m_far_code_region_end = m_far_code_regions_start + m_far_code_region_size;
+  m_region_count = count;
+  m_current_region = 0;
+  m_code_used = 0;
+  m_far_code_used = 0;
+}
+
+u32 JitCodeBuffer::SwitchToNextRegion()
+{
+  m_current_region = (m_current_region + 1) % m_region_count;
+
+  m_free_code_ptr = m_code_regions_start + (m_current_region * m_code_region_size);
+  m_code_region_end = m_free_code_ptr + m_code_region_size;
+  m_free_far_code_ptr = m_far_code_regions_start + (m_current_region * m_far_code_region_size);
+  m_far_code_region_end = m_free_far_code_ptr + m_far_code_region_size;
+  m_code_used = 0;
+  m_far_code_used = 0;
+  return m_current_region;
+}
+
 void JitCodeBuffer::Align(u32 alignment, u8 padding_value)
 {
   const u32 num_padding_bytes =
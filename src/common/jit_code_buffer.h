@@ -20,14 +20,25 @@ public:
   ALWAYS_INLINE u32 GetTotalSize() const { return m_total_size; }
 
   ALWAYS_INLINE u8* GetFreeCodePointer() const { return m_free_code_ptr; }
-  ALWAYS_INLINE u32 GetFreeCodeSpace() const { return static_cast<u32>(m_code_size - m_code_used); }
+  ALWAYS_INLINE u32 GetFreeCodeSpace() const { return static_cast<u32>(m_code_region_end - m_free_code_ptr); }
   void ReserveCode(u32 size);
   void CommitCode(u32 length);
 
   ALWAYS_INLINE u8* GetFreeFarCodePointer() const { return m_free_far_code_ptr; }
-  ALWAYS_INLINE u32 GetFreeFarCodeSpace() const { return static_cast<u32>(m_far_code_size - m_far_code_used); }
+  ALWAYS_INLINE u32 GetFreeFarCodeSpace() const { return static_cast<u32>(m_far_code_region_end - m_free_far_code_ptr); }
   void CommitFarCode(u32 length);
 
+  /// Splits the remaining near and far code space into equally-sized regions, which are filled one at a time.
+  /// Code emitted before this call is left alone. Reset() goes back to a single region.
+  void SetRegionCount(u32 count);
+
+  /// Moves the free pointers to the start of the next region, wrapping around after the last one, and returns its
+  /// index. Anything which was previously emitted in that region will be overwritten.
+  u32 SwitchToNextRegion();
+
+  ALWAYS_INLINE u32 GetRegionCount() const { return m_region_count; }
+  ALWAYS_INLINE u32 GetCurrentRegion() const { return m_current_region; }
+
   /// Adjusts the free code pointer to the specified alignment, padding with bytes.
   /// Assumes alignment is a power-of-two.
   void Align(u32 alignment, u8 padding_value);
@@ -43,17 +54,28 @@ public:
 #endif
 
 private:
+  void ResetRegions();
+
   u8* m_code_ptr = nullptr;
   u8* m_free_code_ptr = nullptr;
   u32 m_code_size = 0;
   u32 m_code_reserve_size = 0;
-  u32 m_code_used = 0;
+  u32 m_code_used = 0; // in the current region, like m_far_code_used
 
   u8* m_far_code_ptr = nullptr;
   u8* m_free_far_code_ptr = nullptr;
   u32 m_far_code_size = 0;
   u32 m_far_code_used = 0;
 
+  u8* m_code_region_end = nullptr;
+  u8* m_far_code_region_end = nullptr;
+  u8* m_code_regions_start = nullptr;
+  u8* m_far_code_regions_start = nullptr;
+  u32 m_code_region_size = 0;
+  u32 m_far_code_region_size = 0;
+  u32 m_region_count = 1;
+  u32 m_current_region = 0;
+
   u32 m_total_size = 0;
   u32 m_guard_size = 0;
   u32 m_old_protection = 0;
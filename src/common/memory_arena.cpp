@@ -1,6 +1,7 @@
 #include "memory_arena.h"
 #include "common/log.h"
 #include "common/string_util.h"
+#include <atomic>
 Log_SetChannel(Common::MemoryArena);
 
 #if defined(_WIN32)
@@ -112,7 +113,12 @@ static std::string GetFileMappingName()
 #error Unknown platform.
 #endif
 
-  const std::string ret(StringUtil::StdStringFromFormat("swanstation_%u_%p", pid, ((void*)&GetFileMappingName)));
+  // Several arenas can exist at once when a process runs more than one console, so number them.
+  static std::atomic_uint s_arena_counter{0};
+  const unsigned index = s_arena_counter.fetch_add(1, std::memory_order_relaxed);
+
+  const std::string ret(
+    StringUtil::StdStringFromFormat("swanstation_%u_%p_%u", pid, ((void*)&GetFileMappingName), index));
 
   Log_InfoPrintf("File mapping name: %s", ret.c_str());
   return ret;
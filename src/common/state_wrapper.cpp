@@ -10,19 +10,24 @@ StateWrapper::StateWrapper(ByteStream* stream, Mode mode, u32 version)
 {
 }
 
+StateWrapper::StateWrapper(void* buffer, u32 size, Mode mode, u32 version)
+  : m_buffer(static_cast<u8*>(buffer)), m_buffer_size(size), m_mode(mode), m_version(version)
+{
+}
+
 StateWrapper::~StateWrapper() = default;
 
 void StateWrapper::DoBytes(void* data, size_t length)
 {
   if (m_mode == Mode::Read)
   {
-    if (m_error || (m_error |= !m_stream->Read2(data, static_cast<u32>(length))) == true)
+    if (m_error || (m_error |= !ReadData(data, static_cast<u32>(length))) == true)
       std::memset(data, 0, length);
   }
   else
   {
     if (!m_error)
-      m_error |= !m_stream->Write2(data, static_cast<u32>(length));
+      m_error |= !WriteData(data, static_cast<u32>(length));
   }
 }
 
@@ -32,14 +37,14 @@ void StateWrapper::Do(bool* value_ptr)
   {
     u8 value = 0;
     if (!m_error)
-      m_error |= !m_stream->ReadByte(&value);
+      m_error |= !ReadData(&value, sizeof(value));
     *value_ptr = (value != 0);
   }
   else
   {
     u8 value = static_cast<u8>(*value_ptr);
     if (!m_error)
-      m_error |= !m_stream->WriteByte(value);
+      m_error |= !WriteData(&value, sizeof(value));
   }
 }
 
@@ -65,6 +70,10 @@ void StateWrapper::Do(String* value_ptr)
 
 bool StateWrapper::DoMarker(const char* marker)
 {
+  // flat buffers are used for states which are saved every frame, so they don't carry markers
+  if (!m_stream)
+    return !m_error;
+
   SmallString file_value(marker);
   Do(&file_value);
   if (m_error)
@@ -21,6 +21,10 @@ public:
   };
 
   StateWrapper(ByteStream* stream, Mode mode, u32 version);
+
+  /// Serializes to or from a flat, preallocated buffer, without markers. Writing with a null buffer only counts bytes.
+  StateWrapper(void* buffer, u32 size, Mode mode, u32 version);
+
   StateWrapper(const StateWrapper&) = delete;
   ~StateWrapper();
 
@@ -30,6 +34,7 @@ public:
   Mode GetMode() const { return m_mode; }
   void SetMode(Mode mode) { m_mode = mode; }
   u32 GetVersion() const { return m_version; }
+  u32 GetBufferPosition() const { return m_buffer_position; }
 
   /// Overload for integral or floating-point types. Writes bytes as-is.
   template<typename T, std::enable_if_t<std::is_integral_v<T> || std::is_floating_point_v<T>, int> = 0>
@@ -37,13 +42,13 @@ public:
   {
     if (m_mode == Mode::Read)
     {
-      if (m_error || (m_error |= !m_stream->Read2(value_ptr, sizeof(T))) == true)
+      if (m_error || (m_error |= !ReadData(value_ptr, sizeof(T))) == true)
         *value_ptr = static_cast<T>(0);
     }
     else
     {
       if (!m_error)
-        m_error |= !m_stream->Write2(value_ptr, sizeof(T));
+        m_error |= !WriteData(value_ptr, sizeof(T));
     }
   }
 
@@ -55,7 +60,7 @@ public:
     if (m_mode == Mode::Read)
     {
       TType temp;
-      if (m_error || (m_error |= !m_stream->Read2(&temp, sizeof(TType))) == true)
+      if (m_error || (m_error |= !ReadData(&temp, sizeof(TType))) == true)
         temp = static_cast<TType>(0);
 
       *value_ptr = static_cast<T>(temp);
@@ -65,7 +70,7 @@ public:
       TType temp;
       std::memcpy(&temp, value_ptr, sizeof(TType));
       if (!m_error)
-        m_error |= !m_stream->Write2(&temp, sizeof(TType));
+        m_error |= !WriteData(&temp, sizeof(TType));
     }
   }
 
@@ -75,25 +80,44 @@ public:
   {
     if (m_mode == Mode::Read)
     {
-      if (m_error || (m_error |= !m_stream->Read2(value_ptr, sizeof(T))) == true)
+      if (m_error || (m_error |= !ReadData(value_ptr, sizeof(T))) == true)
         std::memset(value_ptr, 0, sizeof(*value_ptr));
     }
     else
     {
       if (!m_error)
-        m_error |= !m_stream->Write2(value_ptr, sizeof(T));
+        m_error |= !WriteData(value_ptr, sizeof(T));
     }
   }
 
   template<typename T>
   void DoArray(T* values, size_t count)
   {
-    for (size_t i = 0; i < count; i++)
-      Do(&values[i]);
+    // integral and floating-point values are written as-is, so the whole array can go through in one call
+    if constexpr ((std::is_integral_v<T> && !std::is_same_v<T, bool>) || std::is_floating_point_v<T>)
+    {
+      DoBytes(values, sizeof(T) * count);
+    }
+    else
+    {
+      for (size_t i = 0; i < count; i++)
+        Do(&values[i]);
+    }
   }
 
   void DoBytes(void* data, size_t length);
 
+  /// When reading a flat buffer, returns the next length bytes without copying them. Otherwise returns null.
+  const u8* ReadInPlace(u32 length)
+  {
+    if (m_stream || m_mode != Mode::Read || m_error || length > (m_buffer_size - m_buffer_position))
+      return nullptr;
+
+    const u8* data = m_buffer + m_buffer_position;
+    m_buffer_position += length;
+    return data;
+  }
+
   void Do(bool* value_ptr);
   void Do(std::string* value_ptr);
   void Do(String* value_ptr);
@@ -181,7 +205,40 @@ public:
   }
 
 private:
-  ByteStream* m_stream;
+  ALWAYS_INLINE bool ReadData(void* data, u32 length)
+  {
+    if (m_stream)
+      return m_stream->Read2(data, length);
+
+    if (length > (m_buffer_size - m_buffer_position))
+      return false;
+
+    std::memcpy(data, m_buffer + m_buffer_position, length);
+    m_buffer_position += length;
+    return true;
+  }
+
+  ALWAYS_INLINE bool WriteData(const void* data, u32 length)
+  {
+    if (m_stream)
+      return m_stream->Write2(data, length);
+
+    if (m_buffer)
+    {
+      if (length > (m_buffer_size - m_buffer_position))
+        return false;
+
+      std::memcpy(m_buffer + m_buffer_position, data, length);
+    }
+
+    m_buffer_position += length;
+    return true;
+  }
+
+  ByteStream* m_stream = nullptr;
+  u8* m_buffer = nullptr;
+  u32 m_buffer_size = 0;
+  u32 m_buffer_position = 0;
   Mode m_mode;
   u32 m_version;
   bool m_error = false;
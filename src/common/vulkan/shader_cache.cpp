@@ -428,9 +428,13 @@ std::optional<ShaderCompiler::SPIRVCodeVector> ShaderCache::GetShaderSPV(ShaderC
                                                                          std::string_view shader_code)
 {
   const auto key = GetCacheKey(type, shader_code);
+  std::unique_lock<std::mutex> lock(m_mutex);
   auto iter = m_index.find(key);
   if (iter == m_index.end())
+  {
+    lock.unlock();
     return CompileAndAddShaderSPV(key, shader_code);
+  }
 
   SPIRVCodeVector spv(iter->second.blob_size);
   if (std::fseek(m_blob_file, iter->second.file_offset, SEEK_SET) != 0 ||
@@ -480,6 +484,11 @@ std::optional<ShaderCompiler::SPIRVCodeVector> ShaderCache::CompileAndAddShaderS
   if (!spv.has_value())
     return {};
 
+  // Another thread may have compiled the same shader in the meantime.
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_index.find(key) != m_index.end())
+    return spv;
+
   if (!m_blob_file || std::fseek(m_blob_file, 0, SEEK_END) != 0)
     return spv;
 
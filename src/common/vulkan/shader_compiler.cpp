@@ -7,9 +7,11 @@
 #include "../log.h"
 #include "../string_util.h"
 #include "util.h"
+#include <atomic>
 #include <cstring>
 #include <fstream>
 #include <memory>
+#include <mutex>
 Log_SetChannel(Vulkan::ShaderCompiler);
 
 // glslang includes
@@ -21,8 +23,10 @@ namespace Vulkan::ShaderCompiler {
 // Registers itself for cleanup via atexit
 bool InitializeGlslang();
 
-static unsigned s_next_bad_shader_id = 1;
+static std::atomic<unsigned> s_next_bad_shader_id{1};
 
+// shaders can be compiled on several pipeline compile threads at once
+static std::mutex s_glslang_mutex;
 static bool glslang_initialized = false;
 
 static std::optional<SPIRVCodeVector> CompileShaderToSPV(EShLanguage stage, const char* stage_filename,
@@ -119,6 +123,7 @@ static std::optional<SPIRVCodeVector> CompileShaderToSPV(EShLanguage stage, cons
 
 bool InitializeGlslang()
 {
+  std::unique_lock<std::mutex> lock(s_glslang_mutex);
   if (glslang_initialized)
     return true;
 
@@ -131,6 +136,7 @@ bool InitializeGlslang()
 
 void DeinitializeGlslang()
 {
+  std::unique_lock<std::mutex> lock(s_glslang_mutex);
   if (!glslang_initialized)
     return;
 
@@ -2,6 +2,7 @@
 #include "cdrom.h"
 #include "common/align.h"
 #include "common/make_array.h"
+#include "common/platform.h"
 #include "common/state_wrapper.h"
 #include "cpu_code_cache.h"
 #include "cpu_core.h"
@@ -12,6 +13,7 @@
 #include "interrupt_controller.h"
 #include "mdec.h"
 #include "pad.h"
+#include "paged_hash.h"
 #include "sio.h"
 #include "spu.h"
 #include "timers.h"
@@ -73,37 +75,44 @@ union MEMCTRL
   };
 };
 
-std::bitset<RAM_8MB_CODE_PAGE_COUNT> m_ram_code_bits{};
-u32 m_ram_code_page_count = 0;
-u8* g_ram = nullptr; // 2MB RAM
-u32 g_ram_size = 0;
-u32 g_ram_mask = 0;
-u8 g_bios[BIOS_SIZE]{}; // 512K BIOS ROM
+CONSOLE_LOCAL std::bitset<RAM_8MB_CODE_PAGE_COUNT> m_ram_code_bits{};
+CONSOLE_LOCAL std::array<u64, RAM_8MB_CODE_PAGE_COUNT> m_ram_code_subpage_bits{};
+CONSOLE_LOCAL u32 m_ram_code_page_count = 0;
+CONSOLE_LOCAL u8* g_ram = nullptr; // 2MB RAM
+CONSOLE_LOCAL u32 g_ram_size = 0;
+CONSOLE_LOCAL u32 g_ram_mask = 0;
+CONSOLE_LOCAL u8 g_bios[BIOS_SIZE]{}; // 512K BIOS ROM
 
-static std::array<TickCount, 3> m_exp1_access_time = {};
-static std::array<TickCount, 3> m_exp2_access_time = {};
-static std::array<TickCount, 3> m_bios_access_time = {};
-static std::array<TickCount, 3> m_cdrom_access_time = {};
-static std::array<TickCount, 3> m_spu_access_time = {};
+static CONSOLE_LOCAL std::array<TickCount, 3> m_exp1_access_time = {};
+static CONSOLE_LOCAL std::array<TickCount, 3> m_exp2_access_time = {};
+static CONSOLE_LOCAL std::array<TickCount, 3> m_bios_access_time = {};
+static CONSOLE_LOCAL std::array<TickCount, 3> m_cdrom_access_time = {};
+static CONSOLE_LOCAL std::array<TickCount, 3> m_spu_access_time = {};
 
-static std::vector<u8> m_exp1_rom;
+static CONSOLE_LOCAL std::vector<u8> m_exp1_rom;
 
-static MEMCTRL m_MEMCTRL = {};
-static u32 m_ram_size_reg = 0;
+// Memory states are read into here first, so only the pages which differ have to be written back.
+static CONSOLE_LOCAL std::vector<u8> m_ram_restore_buffer;
+static CONSOLE_LOCAL PageWriteTracker m_ram_writes{HOST_PAGE_SIZE};
+static CONSOLE_LOCAL bool m_ram_write_tracking = false;
+static CONSOLE_LOCAL PagedHash m_ram_hash;
 
-static std::string m_tty_line_buffer;
+static CONSOLE_LOCAL MEMCTRL m_MEMCTRL = {};
+static CONSOLE_LOCAL u32 m_ram_size_reg = 0;
 
-static Common::MemoryArena m_memory_arena;
+static CONSOLE_LOCAL std::string m_tty_line_buffer;
 
-static CPUFastmemMode m_fastmem_mode = CPUFastmemMode::Disabled;
+static CONSOLE_LOCAL Common::MemoryArena m_memory_arena;
+
+static CONSOLE_LOCAL CPUFastmemMode m_fastmem_mode = CPUFastmemMode::Disabled;
 
 #ifdef WITH_MMAP_FASTMEM
-static u8* m_fastmem_base = nullptr;
-static std::vector<Common::MemoryArena::View> m_fastmem_ram_views;
-static std::vector<Common::MemoryArena::View> m_fastmem_reserved_views;
+static CONSOLE_LOCAL u8* m_fastmem_base = nullptr;
+static CONSOLE_LOCAL std::vector<Common::MemoryArena::View> m_fastmem_ram_views;
+static CONSOLE_LOCAL std::vector<Common::MemoryArena::View> m_fastmem_reserved_views;
 #endif
 
-static u8** m_fastmem_lut = nullptr;
+static CONSOLE_LOCAL u8** m_fastmem_lut = nullptr;
 static constexpr auto m_fastmem_ram_mirrors =
   make_array(0x00000000u, 0x00200000u, 0x00400000u, 0x00600000u, 0x80000000u, 0x80200000u, 0x80400000u, 0x80600000u,
              0xA0000000u, 0xA0200000u, 0xA0400000u, 0xA0600000u);
@@ -114,6 +123,10 @@ static void RecalculateMemoryTimings();
 static bool AllocateMemory(bool enable_8mb_ram);
 static void ReleaseMemory();
 
+static void RestoreRAMPages(StateWrapper& sw);
+static void RestoreRAMPage(u32 page_index, const u8* restore_data);
+static PageWriteTracker& GetRAMWrites();
+
 static void SetCodePageFastmemProtection(u32 page_index, bool writable);
 
 #define FIXUP_HALFWORD_OFFSET(size, offset) ((size >= MemoryAccessSize::HalfWord) ? (offset) : ((offset) & ~1u))
@@ -154,11 +167,14 @@ void Shutdown()
   m_fastmem_mode = CPUFastmemMode::Disabled;
 
   ReleaseMemory();
+  m_ram_restore_buffer = {};
+  m_ram_write_tracking = false;
 }
 
 void Reset()
 {
   std::memset(g_ram, 0, g_ram_size);
+  m_ram_writes.MarkAllDirty();
   m_MEMCTRL.exp1_base = 0x1F000000;
   m_MEMCTRL.exp2_base = 0x1F802000;
   m_MEMCTRL.exp1_delay_size.bits = 0x0013243F;
@@ -170,13 +186,15 @@ void Reset()
   m_MEMCTRL.common_delay.bits = 0x00031125;
   m_ram_size_reg = UINT32_C(0x00000B88);
   m_ram_code_bits = {};
+  m_ram_code_subpage_bits = {};
   RecalculateMemoryTimings();
 }
 
-bool DoState(StateWrapper& sw)
+bool DoState(StateWrapper& sw, bool is_memory_state, bool keep_code_cache)
 {
   u32 ram_size = g_ram_size;
   sw.DoEx(&ram_size, 52, static_cast<u32>(RAM_2MB_SIZE));
+  bool ram_reallocated = false;
   if (ram_size != g_ram_size)
   {
     const bool using_8mb_ram = (ram_size == RAM_8MB_SIZE);
@@ -186,6 +204,7 @@ bool DoState(StateWrapper& sw)
 
     UpdateFastmemViews(m_fastmem_mode);
     CPU::UpdateFastmemBase();
+    ram_reallocated = true;
   }
 
   sw.Do(&m_exp1_access_time);
@@ -193,14 +212,179 @@ bool DoState(StateWrapper& sw)
   sw.Do(&m_bios_access_time);
   sw.Do(&m_cdrom_access_time);
   sw.Do(&m_spu_access_time);
-  sw.DoBytes(g_ram, g_ram_size);
-  sw.DoBytes(g_bios, BIOS_SIZE);
+
+  // memory states keep RAM in a snapshot, which only copies the pages written since it was last saved
+  if (is_memory_state)
+  {
+    if (keep_code_cache && ram_reallocated)
+      CPU::CodeCache::InvalidateAll();
+  }
+  else if (keep_code_cache && sw.IsReading() && !ram_reallocated)
+  {
+    RestoreRAMPages(sw);
+  }
+  else
+  {
+    if (keep_code_cache && ram_reallocated)
+      CPU::CodeCache::InvalidateAll();
+
+    sw.DoBytes(g_ram, g_ram_size);
+    if (sw.IsReading())
+      m_ram_writes.MarkAllDirty();
+  }
+
+  // the BIOS can't change while the system is running, so memory states don't need it
+  if (!is_memory_state)
+  {
+    if (keep_code_cache && sw.IsReading())
+    {
+      const u8* restore_data = sw.ReadInPlace(BIOS_SIZE);
+      if (!restore_data)
+      {
+        m_ram_restore_buffer.resize(std::max<size_t>(m_ram_restore_buffer.size(), BIOS_SIZE));
+        sw.DoBytes(m_ram_restore_buffer.data(), BIOS_SIZE);
+        restore_data = m_ram_restore_buffer.data();
+      }
+
+      if (!sw.HasError() && std::memcmp(g_bios, restore_data, BIOS_SIZE) != 0)
+      {
+        std::memcpy(g_bios, restore_data, BIOS_SIZE);
+        CPU::CodeCache::InvalidateAll();
+      }
+    }
+    else
+    {
+      sw.DoBytes(g_bios, BIOS_SIZE);
+    }
+  }
+
   sw.DoArray(m_MEMCTRL.regs, countof(m_MEMCTRL.regs));
   sw.Do(&m_ram_size_reg);
   sw.Do(&m_tty_line_buffer);
   return !sw.HasError();
 }
 
+void RestoreRAMPages(StateWrapper& sw)
+{
+  // flat states can be compared in place, streams have to be copied out first
+  const u8* restore_data = sw.ReadInPlace(g_ram_size);
+  if (!restore_data)
+  {
+    m_ram_restore_buffer.resize(g_ram_size);
+    sw.DoBytes(m_ram_restore_buffer.data(), g_ram_size);
+    restore_data = m_ram_restore_buffer.data();
+  }
+
+  if (sw.HasError())
+    return;
+
+  // Between runahead frames most of RAM is unchanged. Leaving those pages alone means the blocks compiled from them
+  // stay valid, instead of having to throw away the whole code cache.
+  for (u32 offset = 0; offset < g_ram_size; offset += HOST_PAGE_SIZE)
+    RestoreRAMPage(offset / HOST_PAGE_SIZE, &restore_data[offset]);
+}
+
+void RestoreRAMPage(u32 page_index, const u8* restore_data)
+{
+  u8* page_ptr = &g_ram[page_index * HOST_PAGE_SIZE];
+  if (std::memcmp(page_ptr, restore_data, HOST_PAGE_SIZE) == 0)
+    return;
+
+  m_ram_writes.MarkPageDirty(page_index);
+  if (!m_ram_code_bits[page_index])
+  {
+    std::memcpy(page_ptr, restore_data, HOST_PAGE_SIZE);
+    return;
+  }
+
+  // Only throw away the blocks in subpages which actually changed. This is a rollback rather than the game writing
+  // to its own code, so it mustn't count towards disabling linking for the blocks.
+  for (u32 subpage_offset = 0; subpage_offset < HOST_PAGE_SIZE; subpage_offset += RAM_CODE_SUBPAGE_SIZE)
+  {
+    u8* ram_ptr = page_ptr + subpage_offset;
+    const u8* restore_ptr = restore_data + subpage_offset;
+    if (std::memcmp(ram_ptr, restore_ptr, RAM_CODE_SUBPAGE_SIZE) == 0)
+      continue;
+
+    std::memcpy(ram_ptr, restore_ptr, RAM_CODE_SUBPAGE_SIZE);
+    if (m_ram_code_bits[page_index])
+      CPU::CodeCache::InvalidateBlocksInPageRange(page_index, subpage_offset, RAM_CODE_SUBPAGE_SIZE, false);
+  }
+}
+
+PageWriteTracker& GetRAMWrites()
+{
+  // Fastmem stores only mark the pages they write when tracking is on, and only in the x64 recompiler. Otherwise every
+  // page has to be assumed written.
+  const bool fastmem_stores = (g_settings.IsUsingFastmem() && g_settings.cpu_fastmem_rewrite);
+#ifdef CPU_X64
+  if (fastmem_stores && !m_ram_write_tracking)
+#else
+  if (fastmem_stores)
+#endif
+    m_ram_writes.MarkAllDirty();
+
+  return m_ram_writes;
+}
+
+void MarkRAMWritten(PhysicalMemoryAddress address, u32 size)
+{
+  address &= g_ram_mask;
+  const u32 size_before_wrap = std::min(size, g_ram_size - address);
+  m_ram_writes.MarkDirty(address, size_before_wrap);
+  if (size_before_wrap < size)
+    m_ram_writes.MarkDirty(0, size - size_before_wrap);
+}
+
+u8* GetRAMWritePages()
+{
+  return m_ram_writes.GetDirtyPages();
+}
+
+bool IsRAMWriteTrackingEnabled()
+{
+  return m_ram_write_tracking;
+}
+
+void SetRAMWriteTrackingEnabled(bool enabled)
+{
+  if (m_ram_write_tracking == enabled)
+    return;
+
+  // the code compiled before didn't mark anything
+  m_ram_write_tracking = enabled;
+  m_ram_writes.MarkAllDirty();
+  CPU::CodeCache::Flush();
+}
+
+u64 GetRAMHash()
+{
+  return m_ram_hash.Update(g_ram, GetRAMWrites());
+}
+
+void SaveRAMSnapshot(PageWriteTracker::Snapshot* snapshot)
+{
+  GetRAMWrites().SaveSnapshot(g_ram, snapshot);
+}
+
+bool RestoreRAMSnapshot(const PageWriteTracker::Snapshot& snapshot)
+{
+  PageWriteTracker& writes = GetRAMWrites();
+  if (snapshot.data.size() != g_ram_size || snapshot.generation == 0)
+    return false;
+
+  writes.Advance();
+
+  const u32 num_pages = writes.GetPageCount();
+  for (u32 page = 0; page < num_pages; page++)
+  {
+    if (writes.WasWrittenSince(page, snapshot.generation))
+      RestoreRAMPage(page, &snapshot.data[page * HOST_PAGE_SIZE]);
+  }
+
+  return true;
+}
+
 void SetExpansionROM(std::vector<u8> data)
 {
   m_exp1_rom = std::move(data);
@@ -272,6 +456,7 @@ bool AllocateMemory(bool enable_8mb_ram)
 
   g_ram_mask = ram_mask;
   g_ram_size = ram_size;
+  m_ram_writes.Resize(ram_size, RAM_8MB_SIZE);
   m_ram_code_page_count = enable_8mb_ram ? RAM_8MB_CODE_PAGE_COUNT : RAM_2MB_CODE_PAGE_COUNT;
   return true;
 }
@@ -471,6 +656,7 @@ void ClearRAMCodePage(u32 index)
 
   // unprotect fastmem pages
   m_ram_code_bits[index] = false;
+  m_ram_code_subpage_bits[index] = 0;
   SetCodePageFastmemProtection(index, true);
 }
 
@@ -502,6 +688,7 @@ void SetCodePageFastmemProtection(u32 page_index, bool writable)
 void ClearRAMCodePageFlags()
 {
   m_ram_code_bits.reset();
+  m_ram_code_subpage_bits.fill(0);
 
 #ifdef WITH_MMAP_FASTMEM
   if (m_fastmem_mode == CPUFastmemMode::MMap)
@@ -680,6 +867,7 @@ ALWAYS_INLINE static TickCount DoRAMAccess(u32 offset, u32& value)
   else
   {
     const u32 page_index = offset / HOST_PAGE_SIZE;
+    constexpr u32 access_size = 1u << static_cast<u32>(size);
     if constexpr (skip_redundant_writes)
     {
       if constexpr (size == MemoryAccessSize::Byte)
@@ -687,8 +875,9 @@ ALWAYS_INLINE static TickCount DoRAMAccess(u32 offset, u32& value)
         if (g_ram[offset] != Truncate8(value))
         {
           g_ram[offset] = Truncate8(value);
+          m_ram_writes.MarkPageDirty(page_index);
           if (m_ram_code_bits[page_index])
-            CPU::CodeCache::InvalidateBlocksWithPageIndex(page_index);
+            CPU::CodeCache::InvalidateBlocksInPageRange(page_index, offset & HOST_PAGE_OFFSET_MASK, access_size);
         }
       }
       else if constexpr (size == MemoryAccessSize::HalfWord)
@@ -699,8 +888,9 @@ ALWAYS_INLINE static TickCount DoRAMAccess(u32 offset, u32& value)
         if (old_value != new_value)
         {
           std::memcpy(&g_ram[offset], &new_value, sizeof(u16));
+          m_ram_writes.MarkPageDirty(page_index);
           if (m_ram_code_bits[page_index])
-            CPU::CodeCache::InvalidateBlocksWithPageIndex(page_index);
+            CPU::CodeCache::InvalidateBlocksInPageRange(page_index, offset & HOST_PAGE_OFFSET_MASK, access_size);
         }
       }
       else if constexpr (size == MemoryAccessSize::Word)
@@ -710,15 +900,17 @@ ALWAYS_INLINE static TickCount DoRAMAccess(u32 offset, u32& value)
         if (old_value != value)
         {
           std::memcpy(&g_ram[offset], &value, sizeof(u32));
+          m_ram_writes.MarkPageDirty(page_index);
           if (m_ram_code_bits[page_index])
-            CPU::CodeCache::InvalidateBlocksWithPageIndex(page_index);
+            CPU::CodeCache::InvalidateBlocksInPageRange(page_index, offset & HOST_PAGE_OFFSET_MASK, access_size);
         }
       }
     }
     else
     {
+      m_ram_writes.MarkPageDirty(page_index);
       if (m_ram_code_bits[page_index])
-        CPU::CodeCache::InvalidateBlocksWithPageIndex(page_index);
+        CPU::CodeCache::InvalidateBlocksInPageRange(page_index, offset & HOST_PAGE_OFFSET_MASK, access_size);
 
       if constexpr (size == MemoryAccessSize::Byte)
       {
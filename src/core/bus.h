@@ -1,6 +1,7 @@
 #pragma once
 #include "common/bitfield.h"
 #include "common/memory_arena.h"
+#include "page_write_tracker.h"
 #include "types.h"
 #include <array>
 #include <bitset>
@@ -55,7 +56,7 @@ inline constexpr u32 RAM_2MB_CODE_PAGE_COUNT = (RAM_2MB_SIZE + (HOST_PAGE_SIZE +
 bool Initialize();
 void Shutdown();
 void Reset();
-bool DoState(StateWrapper& sw);
+bool DoState(StateWrapper& sw, bool is_memory_state, bool keep_code_cache);
 
 u8* GetFastmemBase();
 void UpdateFastmemViews(CPUFastmemMode mode);
@@ -64,11 +65,15 @@ bool CanUseFastmemForAddress(VirtualMemoryAddress address);
 void SetExpansionROM(std::vector<u8> data);
 void SetBIOS(const std::vector<u8>& image);
 
-extern std::bitset<RAM_8MB_CODE_PAGE_COUNT> m_ram_code_bits;
-extern u8* g_ram;            // 2MB-8MB RAM
-extern u32 g_ram_size;       // Active size of RAM.
-extern u32 g_ram_mask;       // Active address bits for RAM.
-extern u8 g_bios[BIOS_SIZE]; // 512K BIOS ROM
+/// Code is also tracked within each page at this granularity, so writes to data next to code don't invalidate it.
+inline constexpr u32 RAM_CODE_SUBPAGE_SIZE = HOST_PAGE_SIZE / 64;
+
+extern CONSOLE_LOCAL std::bitset<RAM_8MB_CODE_PAGE_COUNT> m_ram_code_bits;
+extern CONSOLE_LOCAL std::array<u64, RAM_8MB_CODE_PAGE_COUNT> m_ram_code_subpage_bits;
+extern CONSOLE_LOCAL u8* g_ram;            // 2MB-8MB RAM
+extern CONSOLE_LOCAL u32 g_ram_size;       // Active size of RAM.
+extern CONSOLE_LOCAL u32 g_ram_mask;       // Active address bits for RAM.
+extern CONSOLE_LOCAL u8 g_bios[BIOS_SIZE]; // 512K BIOS ROM
 
 /// Returns true if the address specified is writable (RAM).
 ALWAYS_INLINE static bool IsRAMAddress(PhysicalMemoryAddress address)
@@ -82,6 +87,14 @@ ALWAYS_INLINE static u32 GetRAMCodePageIndex(PhysicalMemoryAddress address)
   return (address & g_ram_mask) / HOST_PAGE_SIZE;
 }
 
+/// Returns the mask of code subpages covering a range of bytes, which must not cross a page boundary.
+ALWAYS_INLINE static u64 GetRAMCodeSubpageMask(u32 offset_in_page, u32 size)
+{
+  const u32 first = offset_in_page / RAM_CODE_SUBPAGE_SIZE;
+  const u32 last = (offset_in_page + size - 1) / RAM_CODE_SUBPAGE_SIZE;
+  return (UINT64_C(0xFFFFFFFFFFFFFFFF) >> (63 - last)) & (UINT64_C(0xFFFFFFFFFFFFFFFF) << first);
+}
+
 /// Returns true if the specified page contains code.
 bool IsRAMCodePage(u32 index);
 
@@ -94,6 +107,29 @@ void ClearRAMCodePage(u32 index);
 /// Clears all code bits for RAM regions.
 void ClearRAMCodePageFlags();
 
+/// Marks RAM which was written without going through the CPU, wrapping around the end of RAM.
+void MarkRAMWritten(PhysicalMemoryAddress address, u32 size);
+
+/// Returns the byte for each RAM page which is set when the page is written, indexed by the address within the 8MB
+/// mirror region. The x64 recompiler sets these after fastmem stores.
+u8* GetRAMWritePages();
+
+/// Only memory states need the recompiler to mark the pages its fastmem stores write, and it costs a few instructions
+/// for every store. While it's off, every page counts as written. Changing it flushes the code cache.
+bool IsRAMWriteTrackingEnabled();
+void SetRAMWriteTrackingEnabled(bool enabled);
+
+/// Returns a digest of RAM which only hashes the pages written since the last call again. Without write tracking,
+/// fastmem stores don't mark pages, so all of RAM gets hashed.
+u64 GetRAMHash();
+
+/// Copies the RAM pages which were written since the snapshot was last saved into it.
+void SaveRAMSnapshot(PageWriteTracker::Snapshot* snapshot);
+
+/// Restores the RAM pages which were written since the snapshot was saved, only invalidating the code in subpages
+/// which change. Returns false if the snapshot doesn't match the size of RAM.
+bool RestoreRAMSnapshot(const PageWriteTracker::Snapshot& snapshot);
+
 /// Returns the number of cycles stolen by DMA RAM access.
 ALWAYS_INLINE TickCount GetDMARAMTickCount(u32 word_count)
 {
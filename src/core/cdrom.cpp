@@ -65,7 +65,7 @@ static CommandInfo s_command_info[255] = {
   {"Unknown", 0},    {"Unknown", 0},   {nullptr, 0} // Unknown
 };
 
-CDROM g_cdrom;
+CONSOLE_LOCAL CDROM g_cdrom;
 
 CDROM::CDROM() = default;
 
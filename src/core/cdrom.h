@@ -377,4 +377,4 @@ private:
   HeapFIFOQueue<u32, AUDIO_FIFO_SIZE> m_audio_fifo;
 };
 
-extern CDROM g_cdrom;
+extern CONSOLE_LOCAL CDROM g_cdrom;
@@ -14,7 +14,7 @@
 #include <sstream>
 #include <type_traits>
 Log_SetChannel(Cheats);
-static std::array<u32, 256> cht_register; // Used for D7 ,51 & 52 cheat types
+static CONSOLE_LOCAL std::array<u32, 256> cht_register; // Used for D7 ,51 & 52 cheat types
 
 using KeyValuePairVector = std::vector<std::pair<std::string, std::string>>;
 
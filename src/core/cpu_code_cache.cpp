@@ -1,11 +1,20 @@
 #include "cpu_code_cache.h"
 #include "bus.h"
+#include "common/bitutils.h"
+#include "common/file_system.h"
 #include "common/log.h"
 #include "cpu_core.h"
 #include "cpu_core_private.h"
+#include "profiling.h"
 #include "settings.h"
 #include "system.h"
 #include "timing_event.h"
+#include "xxhash.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
 Log_SetChannel(CPU::CodeCache);
 
 #ifdef WITH_RECOMPILER
@@ -21,10 +30,45 @@ static constexpr u32 RECOMPILE_FRAMES_TO_FALL_BACK_TO_INTERPRETER = 100;
 static constexpr u32 RECOMPILE_COUNT_TO_FALL_BACK_TO_INTERPRETER = 20;
 static constexpr u32 INVALIDATE_THRESHOLD_TO_DISABLE_LINKING = 10;
 
+// With tiered compilation, blocks run this many times in the cached interpreter before they're recompiled.
+static constexpr u32 TIERED_COMPILATION_THRESHOLD = 16;
+
+// Limits for superblocks formed by following unconditional jumps, and profiled conditional branches.
+static constexpr u32 MAX_TRACE_BRANCHES = 4;
+static constexpr u32 MAX_TRACE_INSTRUCTIONS = 256;
+
+// A trace only follows a conditional branch which was seen this many times while cold, and went the same way in at
+// least 7 of every 8 of them. Side exits return through the dispatcher or a link, so they shouldn't be common.
+// Branches are only profiled in the cold tier, so without tiered compilation traces stop at conditional branches.
+static constexpr u32 TRACE_BRANCH_MIN_SAMPLES = 8;
+
+// Longest loop which is considered for idle loop skipping.
+static constexpr u32 MAX_IDLE_LOOP_INSTRUCTIONS = 16;
+
+// Persistent cache file layout, all values are little-endian u32 unless noted:
+//   header: magic, version, block count
+//   block:  key, instruction count, code hash (u64), prediction count, successor count,
+//           {branch pc, target} per prediction, successor keys
+// The instructions are decoded again from memory when precompiling, only the trace predictions can't be.
+static constexpr u32 PERSISTENT_CACHE_MAGIC = 0x43435353; // SSCC
+static constexpr u32 PERSISTENT_CACHE_VERSION = 2;
+static constexpr u32 PERSISTENT_CACHE_MAX_SUCCESSORS = 8;
+
+// Blocks can't span more than the largest RAM configuration, which bounds the instruction count of a cached block.
+static constexpr u32 PERSISTENT_CACHE_MAX_INSTRUCTIONS = Bus::RAM_8MB_SIZE / sizeof(u32);
+
+// Precompile budget per frame, so a large cache doesn't stall the first frames.
+static constexpr u32 PERSISTENT_CACHE_COMPILES_PER_FRAME = 64;
+static constexpr u32 PERSISTENT_CACHE_CHECKS_PER_FRAME = 1024;
+
+// Bit 1 of a key is never set, so this can't collide with a real block.
+static constexpr u32 PERSISTENT_CACHE_REMOVED_KEY = 0xFFFFFFFFu;
+
 #ifdef WITH_RECOMPILER
 
 // Currently remapping the code buffer doesn't work in macOS or Haiku.
-#if !defined(__HAIKU__) && !defined(__APPLE__)
+// Multi-instance builds allocate a buffer per console instead.
+#if !defined(__HAIKU__) && !defined(__APPLE__) && !defined(WITH_MULTI_INSTANCE)
 #define USE_STATIC_CODE_BUFFER 1
 #endif
 
@@ -38,18 +82,22 @@ static constexpr u32 RECOMPILER_FAR_CODE_CACHE_SIZE = 16 * 1024 * 1024;
 #endif
 #define CODE_WRITE_FAULT_THRESHOLD_FOR_SLOWMEM 10
 
+// The code buffer is split into generations which are filled in turn. When the newest is full, the blocks in the
+// oldest are thrown away and it's reused, instead of flushing the whole cache.
+static constexpr u32 RECOMPILER_CODE_GENERATIONS = 4;
+
 #ifdef USE_STATIC_CODE_BUFFER
 static constexpr u32 RECOMPILER_GUARD_SIZE = 4096;
 alignas(Recompiler::CODE_STORAGE_ALIGNMENT) static u8
   s_code_storage[RECOMPILER_CODE_CACHE_SIZE + RECOMPILER_FAR_CODE_CACHE_SIZE];
 #endif
 
-static JitCodeBuffer s_code_buffer;
-static FastMapTable s_fast_map[FAST_MAP_TABLE_COUNT];
-static std::unique_ptr<CodeBlock::HostCodePointer[]> s_fast_map_pointers;
+static CONSOLE_LOCAL JitCodeBuffer s_code_buffer;
+static CONSOLE_LOCAL FastMapTable s_fast_map[FAST_MAP_TABLE_COUNT];
+static CONSOLE_LOCAL std::unique_ptr<CodeBlock::HostCodePointer[]> s_fast_map_pointers;
 
-DispatcherFunction s_asm_dispatcher;
-SingleBlockDispatcherFunction s_single_block_asm_dispatcher;
+CONSOLE_LOCAL DispatcherFunction s_asm_dispatcher;
+CONSOLE_LOCAL SingleBlockDispatcherFunction s_single_block_asm_dispatcher;
 
 static FastMapTable DecodeFastMapPointer(u32 slot, FastMapTable ptr)
 {
@@ -79,6 +127,13 @@ static void CompileDispatcher();
 static void FastCompileBlockFunction();
 static void InvalidCodeFunction();
 
+/// Returns the function the dispatcher should call for the block. Blocks which haven't been recompiled yet go
+/// through the lookup, which runs them in the cached interpreter.
+static CodeBlock::HostCodePointer GetBlockEntryPoint(const CodeBlock* block)
+{
+  return block->host_code ? block->host_code : FastCompileBlockFunction;
+}
+
 static constexpr u32 GetTableCount(u32 start, u32 end)
 {
   return ((end >> FAST_MAP_TABLE_SHIFT) - (start >> FAST_MAP_TABLE_SHIFT)) + 1;
@@ -177,8 +232,77 @@ static void SetFastMap(u32 pc, CodeBlock::HostCodePointer function)
 
 #endif
 
-using BlockMap = std::unordered_map<u32, CodeBlock*>;
-using HostCodeMap = std::map<CodeBlock::HostCodePointer, CodeBlock*>;
+// Slab allocator for blocks and their arrays. Requests are rounded up to a power-of-two size class, and freed memory
+// goes onto a free list for that class. Slabs are released wholesale when the cache is flushed.
+static constexpr u32 BLOCK_SLAB_SIZE = 256 * 1024;
+static constexpr u32 BLOCK_SLAB_MIN_CLASS_SHIFT = 4;
+static constexpr u32 BLOCK_SLAB_MAX_CLASS_SHIFT = 14;
+static constexpr u32 BLOCK_SLAB_CLASS_COUNT = BLOCK_SLAB_MAX_CLASS_SHIFT - BLOCK_SLAB_MIN_CLASS_SHIFT + 1;
+
+struct BlockSlabFreeNode
+{
+  BlockSlabFreeNode* next;
+};
+
+static CONSOLE_LOCAL std::vector<u8*> s_block_slabs;
+static CONSOLE_LOCAL u8* s_block_slab_current = nullptr;
+static CONSOLE_LOCAL u32 s_block_slab_remaining = 0;
+static CONSOLE_LOCAL u32 s_block_slab_live_allocations = 0;
+static CONSOLE_LOCAL std::array<BlockSlabFreeNode*, BLOCK_SLAB_CLASS_COUNT> s_block_slab_free_lists = {};
+
+static CodeBlock* AllocateBlock(CodeBlockKey key);
+static void FreeBlock(CodeBlock* block);
+static void ReleaseBlockSlabs();
+
+/// Open-addressing hash table of blocks keyed by CodeBlockKey::bits, using linear probing.
+/// A null block means the key couldn't be compiled and should be interpreted.
+class BlockMap
+{
+public:
+  /// Returns a pointer to the block slot for the key, or null if the key isn't present.
+  CodeBlock** Find(u32 key);
+
+  /// Inserts the key if it is not already present.
+  void Insert(u32 key, CodeBlock* block);
+
+  void Remove(u32 key);
+  void Clear();
+
+  template<typename T>
+  void ForEach(const T& callback) const
+  {
+    for (const Entry& entry : m_entries)
+    {
+      if (entry.key != EMPTY_KEY && entry.key != REMOVED_KEY)
+        callback(entry.block);
+    }
+  }
+
+private:
+  // Bit 1 of a key is never set, so these can't collide with a real block.
+  static constexpr u32 EMPTY_KEY = 0xFFFFFFFFu;
+  static constexpr u32 REMOVED_KEY = 0xFFFFFFFEu;
+  static constexpr u32 INITIAL_SIZE = 4096;
+
+  struct Entry
+  {
+    u32 key;
+    CodeBlock* block;
+  };
+
+  ALWAYS_INLINE u32 GetHomeSlot(u32 key) const { return (key * 0x9E3779B1u) >> m_hash_shift; }
+
+  void Resize(u32 new_size);
+
+  std::vector<Entry> m_entries;
+  u32 m_mask = 0;
+  u32 m_hash_shift = 32;
+  u32 m_count = 0;
+  u32 m_used = 0;
+};
+
+using HostCodeMap = std::map<CodeBlock::HostCodePointer, CodeBlock*, std::less<CodeBlock::HostCodePointer>,
+                             CodeBlockAllocator<std::pair<const CodeBlock::HostCodePointer, CodeBlock*>>>;
 
 /// Returns the block key for the current execution state.
 static CodeBlockKey GetNextBlockKey();
@@ -191,6 +315,17 @@ static CodeBlock* LookupBlock(CodeBlockKey key, bool allow_flush);
 static bool RevalidateBlock(CodeBlock* block, bool allow_flush);
 
 static bool CompileBlock(CodeBlock* block, bool allow_flush);
+
+/// Decodes the instructions of the block from memory and works out where its trace goes, without compiling it.
+static bool AnalyzeBlock(CodeBlock* block);
+static bool CanContinueTrace(const CodeBlock* block, const CodeBlockInstruction& cbi, u32 trace_branches,
+                             u32 profile_pc, u32* trace_target);
+static bool PredictTraceBranch(const CodeBlock* block, const CodeBlockInstruction& cbi, u32 profile_pc,
+                               u32* trace_target);
+static bool IsIdleLoop(const CodeBlock* block);
+static bool TrySkipIdleLoop(const CodeBlock* block);
+static bool CompileBlockHostCode(CodeBlock* block, bool allow_flush);
+static bool HasHostCodeSpace(size_t instruction_count);
 static void RemoveReferencesToBlock(CodeBlock* block);
 static void AddBlockToPageMap(CodeBlock* block);
 static void RemoveBlockFromPageMap(CodeBlock* block);
@@ -203,15 +338,70 @@ static void UnlinkBlock(CodeBlock* block);
 
 static void ClearState();
 
-static BlockMap s_blocks;
-static std::array<std::vector<CodeBlock*>, Bus::RAM_8MB_CODE_PAGE_COUNT> m_ram_block_map;
+static CONSOLE_LOCAL BlockMap s_blocks;
+static CONSOLE_LOCAL Statistics s_statistics = {};
+static CONSOLE_LOCAL std::array<std::vector<CodeBlock*>, Bus::RAM_8MB_CODE_PAGE_COUNT> m_ram_block_map;
+
+struct PersistentTracePrediction
+{
+  u32 branch_pc;
+  u32 target;
+};
+
+/// What the last session knew about a block. The code hash covers the pc and bits of every instruction, so the block
+/// is only precompiled if decoding it again ends up with the same code and trace.
+struct PersistentBlock
+{
+  u32 instruction_count = 0;
+  u64 code_hash = 0;
+  std::vector<PersistentTracePrediction> trace_predictions;
+  std::vector<u32> successors;
+};
+
+using PersistentBlockMap = std::unordered_map<u32, PersistentBlock>;
+
+static void RecordPersistentBlock(const CodeBlock* block);
+static void RecordPersistentBlockLinks();
+static void PersistentCacheLoadThread(std::string filename, PersistentBlockMap* blocks, std::vector<u32>* order,
+                                      std::atomic_bool* done);
+static void FinishPersistentCacheLoad();
+static u64 GetBlockCodeHash(const CodeBlock* block);
+
+/// All blocks known for the running game, written back on shutdown.
+static CONSOLE_LOCAL PersistentBlockMap s_persistent_blocks;
+
+/// Keys of loaded blocks which haven't been compiled yet, hottest first.
+static CONSOLE_LOCAL std::vector<u32> s_persistent_pending_blocks;
+static CONSOLE_LOCAL u32 s_persistent_pending_position = 0;
+
+static CONSOLE_LOCAL std::string s_persistent_cache_filename;
+static CONSOLE_LOCAL std::thread s_persistent_load_thread;
+static CONSOLE_LOCAL std::atomic_bool s_persistent_load_done{false};
+static CONSOLE_LOCAL PersistentBlockMap s_persistent_loaded_blocks;
+static CONSOLE_LOCAL std::vector<u32> s_persistent_loaded_order;
+
+/// Conditional branches in the trace of a block being precompiled go where they went last session, as it has no profile.
+static CONSOLE_LOCAL const PersistentBlock* s_persistent_trace_source = nullptr;
 
 #ifdef WITH_RECOMPILER
-static HostCodeMap s_host_code_map;
+static CONSOLE_LOCAL HostCodeMap s_host_code_map;
 
 static void AddBlockToHostCodeMap(CodeBlock* block);
 static void RemoveBlockFromHostCodeMap(CodeBlock* block);
 
+/// Recompiles a block which has been interpreted often enough, with tiered compilation.
+/// Returns false if the block couldn't be compiled, in which case it may no longer exist.
+static bool PromoteBlock(CodeBlock* block);
+static bool RetraceBlock(CodeBlock* block);
+static void InterpretColdBlock(CodeBlock* block);
+
+/// Frees the blocks in the oldest generation of the code buffer, and starts compiling into it.
+/// Must not be called while any block's code could be on the stack.
+static void EvictOldestCodeGeneration();
+
+/// Makes room for a block in the code buffer, evicting old code, or flushing everything if that's not enough.
+static void MakeHostCodeSpace(size_t instruction_count);
+
 static bool InitializeFastmem();
 static void ShutdownFastmem();
 static Common::PageFaultHandler::HandlerResult LUTPageFaultHandler(void* exception_pc, void* fault_address,
@@ -247,19 +437,25 @@ void Initialize()
 
 void ClearState()
 {
+  RecordPersistentBlockLinks();
+
   Bus::ClearRAMCodePageFlags();
   for (auto& it : m_ram_block_map)
     it.clear();
 
-  for (const auto& it : s_blocks)
-    delete it.second;
+  s_blocks.ForEach([](CodeBlock* block) {
+    if (block)
+      FreeBlock(block);
+  });
 
-  s_blocks.clear();
+  s_blocks.Clear();
 #ifdef WITH_RECOMPILER
   s_host_code_map.clear();
   s_code_buffer.Reset();
   ResetFastMap();
 #endif
+
+  ReleaseBlockSlabs();
 }
 
 void Shutdown()
@@ -315,6 +511,10 @@ static void ExecuteImpl()
       next_block_key = GetNextBlockKey();
       if (next_block_key.bits == block->key.bits)
       {
+        // nothing will change until the next event if it's waiting in a loop
+        if (block->is_idle_loop && !block->invalidated && TrySkipIdleLoop(block))
+          break;
+
         // we can jump straight to it if there's no pending interrupts
         // ensure it's not a self-modifying block
         if (!block->invalidated || RevalidateBlock(block, true))
@@ -391,6 +591,9 @@ void CompileDispatcher()
   }
 
   s_code_buffer.WriteProtect(true);
+
+  // the dispatchers stay put, only block code is evicted
+  s_code_buffer.SetRegionCount(RECOMPILER_CODE_GENERATIONS);
 }
 
 FastMapTable* GetFastMapPointer()
@@ -447,6 +650,239 @@ void Flush()
 #endif
 }
 
+const Statistics& GetStatistics()
+{
+  return s_statistics;
+}
+
+void ResetStatistics()
+{
+  s_statistics = {};
+}
+
+static u32 GetBlockSlabSizeClass(size_t size)
+{
+  if (size <= (size_t(1) << BLOCK_SLAB_MIN_CLASS_SHIFT))
+    return 0;
+
+  return (32u - CountLeadingZeros(static_cast<u32>(size - 1))) - BLOCK_SLAB_MIN_CLASS_SHIFT;
+}
+
+void* AllocateBlockMemory(size_t size)
+{
+  s_statistics.block_allocations++;
+  s_statistics.block_allocation_bytes += size;
+
+  if (size > (size_t(1) << BLOCK_SLAB_MAX_CLASS_SHIFT))
+  {
+    s_statistics.block_large_allocations++;
+    void* ptr = std::malloc(size);
+    if (!ptr)
+    {
+      Log_ErrorPrintf("Failed to allocate %zu bytes of code block memory", size);
+      std::abort();
+    }
+
+    return ptr;
+  }
+
+  s_block_slab_live_allocations++;
+
+  const u32 size_class = GetBlockSlabSizeClass(size);
+  BlockSlabFreeNode*& free_list = s_block_slab_free_lists[size_class];
+  if (free_list)
+  {
+    BlockSlabFreeNode* node = free_list;
+    free_list = node->next;
+    return node;
+  }
+
+  const u32 class_size = 1u << (size_class + BLOCK_SLAB_MIN_CLASS_SHIFT);
+  if (s_block_slab_remaining < class_size)
+  {
+    // The tail of the previous slab can be up to the largest class size. Class sizes are powers of two, so it splits
+    // into one free chunk per set bit rather than being wasted.
+    for (u32 i = BLOCK_SLAB_CLASS_COUNT; i > 0; i--)
+    {
+      const u32 tail_class_size = 1u << (i - 1 + BLOCK_SLAB_MIN_CLASS_SHIFT);
+      if (!(s_block_slab_remaining & tail_class_size))
+        continue;
+
+      BlockSlabFreeNode* node = reinterpret_cast<BlockSlabFreeNode*>(s_block_slab_current);
+      node->next = s_block_slab_free_lists[i - 1];
+      s_block_slab_free_lists[i - 1] = node;
+      s_block_slab_current += tail_class_size;
+    }
+
+    s_block_slab_current = static_cast<u8*>(std::malloc(BLOCK_SLAB_SIZE));
+    if (!s_block_slab_current)
+    {
+      Log_ErrorPrintf("Failed to allocate code block slab");
+      std::abort();
+    }
+
+    s_block_slabs.push_back(s_block_slab_current);
+    s_block_slab_remaining = BLOCK_SLAB_SIZE;
+    s_statistics.block_slab_allocations++;
+  }
+
+  void* ptr = s_block_slab_current;
+  s_block_slab_current += class_size;
+  s_block_slab_remaining -= class_size;
+  return ptr;
+}
+
+void FreeBlockMemory(void* ptr, size_t size)
+{
+  if (size > (size_t(1) << BLOCK_SLAB_MAX_CLASS_SHIFT))
+  {
+    std::free(ptr);
+    return;
+  }
+
+  BlockSlabFreeNode* node = static_cast<BlockSlabFreeNode*>(ptr);
+  BlockSlabFreeNode*& free_list = s_block_slab_free_lists[GetBlockSlabSizeClass(size)];
+  node->next = free_list;
+  free_list = node;
+  s_block_slab_live_allocations--;
+}
+
+void ReleaseBlockSlabs()
+{
+  // A block which is being compiled when the cache gets flushed still lives in the slabs.
+  // Keep them around in that case, they'll get released on the next flush instead.
+  if (s_block_slab_live_allocations > 0)
+    return;
+
+  for (u8* slab : s_block_slabs)
+    std::free(slab);
+  s_block_slabs.clear();
+  s_block_slab_current = nullptr;
+  s_block_slab_remaining = 0;
+  s_block_slab_free_lists.fill(nullptr);
+}
+
+CodeBlock* AllocateBlock(CodeBlockKey key)
+{
+  return new (AllocateBlockMemory(sizeof(CodeBlock))) CodeBlock(key);
+}
+
+void FreeBlock(CodeBlock* block)
+{
+  block->~CodeBlock();
+  FreeBlockMemory(block, sizeof(CodeBlock));
+}
+
+CodeBlock** BlockMap::Find(u32 key)
+{
+  s_statistics.block_lookups++;
+  if (m_count == 0)
+    return nullptr;
+
+  for (u32 slot = GetHomeSlot(key);; slot = (slot + 1) & m_mask)
+  {
+    s_statistics.block_lookup_probes++;
+
+    Entry& entry = m_entries[slot];
+    if (entry.key == key)
+      return &entry.block;
+    else if (entry.key == EMPTY_KEY)
+      return nullptr;
+  }
+}
+
+void BlockMap::Insert(u32 key, CodeBlock* block)
+{
+  // keep at least a quarter of the slots empty so probe sequences stay short
+  if ((m_used + 1) * 4 > static_cast<u32>(m_entries.size()) * 3)
+  {
+    const u32 size = static_cast<u32>(m_entries.size());
+    Resize((size == 0) ? INITIAL_SIZE : (((m_count + 1) * 2 > size) ? (size * 2) : size));
+  }
+
+  u32 insert_slot = UINT32_C(0xFFFFFFFF);
+  for (u32 slot = GetHomeSlot(key);; slot = (slot + 1) & m_mask)
+  {
+    Entry& entry = m_entries[slot];
+    if (entry.key == key)
+    {
+      return;
+    }
+    else if (entry.key == REMOVED_KEY)
+    {
+      if (insert_slot == UINT32_C(0xFFFFFFFF))
+        insert_slot = slot;
+    }
+    else if (entry.key == EMPTY_KEY)
+    {
+      if (insert_slot == UINT32_C(0xFFFFFFFF))
+      {
+        insert_slot = slot;
+        m_used++;
+      }
+
+      break;
+    }
+  }
+
+  m_entries[insert_slot] = Entry{key, block};
+  m_count++;
+}
+
+void BlockMap::Remove(u32 key)
+{
+  if (m_count == 0)
+    return;
+
+  for (u32 slot = GetHomeSlot(key);; slot = (slot + 1) & m_mask)
+  {
+    Entry& entry = m_entries[slot];
+    if (entry.key == key)
+    {
+      entry.key = REMOVED_KEY;
+      entry.block = nullptr;
+      m_count--;
+      return;
+    }
+    else if (entry.key == EMPTY_KEY)
+    {
+      return;
+    }
+  }
+}
+
+void BlockMap::Clear()
+{
+  // keep the storage, a flushed cache will fill back up to the same size
+  std::fill(m_entries.begin(), m_entries.end(), Entry{EMPTY_KEY, nullptr});
+  m_count = 0;
+  m_used = 0;
+}
+
+void BlockMap::Resize(u32 new_size)
+{
+  std::vector<Entry> old_entries(new_size, Entry{EMPTY_KEY, nullptr});
+  m_entries.swap(old_entries);
+  m_mask = new_size - 1;
+  m_hash_shift = 32 - CountTrailingZeros(new_size);
+  m_count = 0;
+  m_used = 0;
+
+  for (const Entry& entry : old_entries)
+  {
+    if (entry.key == EMPTY_KEY || entry.key == REMOVED_KEY)
+      continue;
+
+    u32 slot = GetHomeSlot(entry.key);
+    while (m_entries[slot].key != EMPTY_KEY)
+      slot = (slot + 1) & m_mask;
+
+    m_entries[slot] = entry;
+    m_count++;
+    m_used++;
+  }
+}
+
 CodeBlockKey GetNextBlockKey()
 {
   CodeBlockKey key = {};
@@ -459,17 +895,17 @@ CodeBlockKey GetNextBlockKey()
 static void FallbackExistingBlockToInterpreter(CodeBlock* block)
 {
   // Replace with null so we don't try to compile it again.
-  s_blocks.emplace(block->key.bits, nullptr);
-  delete block;
+  s_blocks.Insert(block->key.bits, nullptr);
+  FreeBlock(block);
 }
 
 CodeBlock* LookupBlock(CodeBlockKey key, bool allow_flush)
 {
-  BlockMap::iterator iter = s_blocks.find(key.bits);
-  if (iter != s_blocks.end())
+  CodeBlock** slot = s_blocks.Find(key.bits);
+  if (slot)
   {
     // ensure it hasn't been invalidated
-    CodeBlock* existing_block = iter->second;
+    CodeBlock* existing_block = *slot;
     if (!existing_block || !existing_block->invalidated)
       return existing_block;
 
@@ -480,28 +916,31 @@ CodeBlock* LookupBlock(CodeBlockKey key, bool allow_flush)
       return nullptr;
   }
 
-  CodeBlock* block = new CodeBlock(key);
+  s_statistics.block_compiles++;
+
+  CodeBlock* block = AllocateBlock(key);
   block->recompile_frame_number = System::GetFrameNumber();
 
   if (CompileBlock(block, allow_flush))
   {
     // add it to the page map if it's in ram
     AddBlockToPageMap(block);
+    RecordPersistentBlock(block);
 
 #ifdef WITH_RECOMPILER
-    SetFastMap(block->GetPC(), block->host_code);
+    SetFastMap(block->GetPC(), GetBlockEntryPoint(block));
     AddBlockToHostCodeMap(block);
 #endif
   }
   else
   {
     Log_ErrorPrintf("Failed to compile block at PC=0x%08X", key.GetPC());
-    delete block;
+    FreeBlock(block);
     block = nullptr;
   }
 
   if (block || allow_flush)
-    s_blocks.emplace(key.bits, block);
+    s_blocks.Insert(key.bits, block);
 
   return block;
 }
@@ -520,7 +959,7 @@ bool RevalidateBlock(CodeBlock* block, bool allow_flush)
   block->invalidated = false;
   AddBlockToPageMap(block);
 #ifdef WITH_RECOMPILER
-  SetFastMap(block->GetPC(), block->host_code);
+  SetFastMap(block->GetPC(), GetBlockEntryPoint(block));
 #endif
   return true;
 
@@ -562,10 +1001,11 @@ recompile:
   }
 
   AddBlockToPageMap(block);
+  RecordPersistentBlock(block);
 
 #ifdef WITH_RECOMPILER
   // re-add to page map again
-  SetFastMap(block->GetPC(), block->host_code);
+  SetFastMap(block->GetPC(), GetBlockEntryPoint(block));
   AddBlockToHostCodeMap(block);
 #endif
 
@@ -573,11 +1013,16 @@ recompile:
   block->invalidated = false;
 
   // re-insert into the block map since we removed it earlier.
-  s_blocks.emplace(block->key.bits, block);
+  s_blocks.Insert(block->key.bits, block);
   return true;
 }
 
 bool CompileBlock(CodeBlock* block, bool allow_flush)
+{
+  return AnalyzeBlock(block) && CompileBlockHostCode(block, allow_flush);
+}
+
+bool AnalyzeBlock(CodeBlock* block)
 {
   u32 pc = block->GetPC();
   bool is_branch_delay_slot = false;
@@ -587,8 +1032,14 @@ bool CompileBlock(CodeBlock* block, bool allow_flush)
   block->uncached_fetch_ticks = 0;
   block->contains_double_branches = false;
   block->contains_loadstore_instructions = false;
+  block->contains_trace_branches = false;
 
   u32 last_cache_line = ICACHE_LINES;
+  u32 trace_branches = 0;
+  u32 trace_target = 0;
+
+  // conditional branches are predicted from the profile of the block which starts where the trace last went
+  u32 profile_pc = pc;
 
   for (;;)
   {
@@ -605,7 +1056,7 @@ bool CompileBlock(CodeBlock* block, bool allow_flush)
     cbi.is_load_instruction = IsMemoryLoadInstruction(cbi.instruction);
     cbi.is_store_instruction = IsMemoryStoreInstruction(cbi.instruction);
     cbi.has_load_delay = InstructionHasLoadDelay(cbi.instruction);
-    cbi.can_trap = CanInstructionTrap(cbi.instruction, InUserMode());
+    cbi.can_trap = CanInstructionTrap(cbi.instruction, block->key.user_mode);
     cbi.is_direct_branch_instruction = IsDirectBranchInstruction(cbi.instruction);
 
     if (g_settings.cpu_recompiler_icache)
@@ -640,6 +1091,17 @@ bool CompileBlock(CodeBlock* block, bool allow_flush)
 
       // change the pc for the second branch's delay slot, it comes from the first branch
       pc = GetDirectBranchTarget(prev_cbi.instruction, prev_cbi.pc);
+
+      // branch delay slot of the branch delay slot ends the block, so don't continue the trace
+      block->instructions.back().is_trace_branch = false;
+    }
+    else if (!is_branch_delay_slot && cbi.is_branch_instruction &&
+             CanContinueTrace(block, cbi, trace_branches, profile_pc, &trace_target))
+    {
+      cbi.is_trace_branch = true;
+      trace_branches++;
+      if (IsConditionalTraceBranch(cbi))
+        profile_pc = trace_target;
     }
 
     // instruction is decoded now
@@ -648,7 +1110,16 @@ bool CompileBlock(CodeBlock* block, bool allow_flush)
     // if we're in a branch delay slot, the block is now done
     // except if this is a branch in a branch delay slot, then we grab the one after that, and so on...
     if (is_branch_delay_slot && !cbi.is_branch_instruction)
-      break;
+    {
+      // unless the trace follows the branch, in which case we keep going from where it usually goes as a superblock
+      if (!block->instructions[block->instructions.size() - 2].is_trace_branch)
+        break;
+
+      pc = trace_target;
+      is_branch_delay_slot = false;
+      is_load_delay_slot = cbi.has_load_delay;
+      continue;
+    }
 
     // if this is a branch, we grab the next instruction (delay slot), and then exit
     is_branch_delay_slot = cbi.is_branch_instruction;
@@ -661,91 +1132,603 @@ bool CompileBlock(CodeBlock* block, bool allow_flush)
       break;
   }
 
-  if (!block->instructions.empty())
-    block->instructions.back().is_last_instruction = true;
-  else
+  if (block->instructions.empty())
     return false;
 
-#ifdef WITH_RECOMPILER
-  if (g_settings.IsUsingRecompiler())
+  // if we couldn't read the trace target, the block ends at the jump instead
+  const size_t instruction_count = block->instructions.size();
+  for (size_t i = (instruction_count > 2) ? (instruction_count - 2) : 0; i < instruction_count; i++)
+    block->instructions[i].is_trace_branch = false;
+
+  block->contains_trace_branches = std::any_of(block->instructions.begin(), block->instructions.end(),
+                                               [](const CodeBlockInstruction& cbi) { return cbi.is_trace_branch; });
+
+  block->instructions.back().is_last_instruction = true;
+  block->is_idle_loop = IsIdleLoop(block);
+  return true;
+}
+
+/// Returns true for direct branches which always go to the same place, j/jal/b.
+static bool IsAlwaysTakenBranch(const Instruction inst)
+{
+  switch (inst.op)
   {
-    // Ensure we're not going to run out of space while compiling this block.
-    if (s_code_buffer.GetFreeCodeSpace() <
-          (block->instructions.size() * Recompiler::MAX_NEAR_HOST_BYTES_PER_INSTRUCTION) ||
-        s_code_buffer.GetFreeFarCodeSpace() <
-          (block->instructions.size() * Recompiler::MAX_FAR_HOST_BYTES_PER_INSTRUCTION))
-    {
-      if (allow_flush)
-      {
-        Log_WarningPrintf("Out of code space, flushing all blocks.");
-        Flush();
-      }
-      else
-      {
-        Log_ErrorPrintf("Out of code space and cannot flush while compiling %08X.", block->GetPC());
-        return false;
-      }
-    }
+    case InstructionOp::j:
+    case InstructionOp::jal:
+      return true;
 
-    s_code_buffer.WriteProtect(false);
-    Recompiler::CodeGenerator codegen(&s_code_buffer);
-    const bool compile_result = codegen.CompileBlock(block, &block->host_code, &block->host_code_size);
-    s_code_buffer.WriteProtect(true);
+    case InstructionOp::beq:
+      return (inst.i.rs == Reg::zero && inst.i.rt == Reg::zero);
 
-    if (!compile_result)
-    {
-      Log_ErrorPrintf("Failed to compile host code for block at 0x%08X", block->key.GetPC());
+    case InstructionOp::b:
+      return (inst.i.rs == Reg::zero && (static_cast<u8>(inst.i.rt.GetValue()) & u8(1)) != 0);
+
+    default:
       return false;
-    }
   }
-#endif
-
-  return true;
 }
 
-#ifdef WITH_RECOMPILER
+bool IsConditionalTraceBranch(const CodeBlockInstruction& cbi)
+{
+  return (cbi.is_trace_branch && !IsAlwaysTakenBranch(cbi.instruction));
+}
 
-void FastCompileBlockFunction()
+bool CanContinueTrace(const CodeBlock* block, const CodeBlockInstruction& cbi, u32 trace_branches, u32 profile_pc,
+                      u32* trace_target)
 {
-  CodeBlock* block = LookupBlock(GetNextBlockKey(), true);
-  if (block)
+  if (!g_settings.cpu_code_cache_traces || g_settings.cpu_recompiler_icache || trace_branches >= MAX_TRACE_BRANCHES ||
+      block->instructions.size() >= MAX_TRACE_INSTRUCTIONS)
   {
-    s_single_block_asm_dispatcher(block->host_code);
-    return;
+    return false;
   }
 
-  if (g_settings.gpu_pgxp_enable)
+  // jumps which always go to the same place, or conditional branches which nearly always go the same way
+  const Instruction inst = cbi.instruction;
+  u32 target;
+  switch (inst.op)
   {
-    if (g_settings.gpu_pgxp_cpu)
-      InterpretUncachedBlock<PGXPMode::CPU>();
-    else
-      InterpretUncachedBlock<PGXPMode::Memory>();
+    case InstructionOp::j:
+    case InstructionOp::jal:
+    case InstructionOp::beq:
+    case InstructionOp::bne:
+    case InstructionOp::blez:
+    case InstructionOp::bgtz:
+    {
+      if (IsAlwaysTakenBranch(inst))
+        target = GetDirectBranchTarget(inst, cbi.pc);
+      else if (!PredictTraceBranch(block, cbi, profile_pc, &target))
+        return false;
+    }
+    break;
+
+    case InstructionOp::b:
+    {
+      // bltzal/bgezal link even when the branch isn't taken, leave those to the end of the block
+      if ((static_cast<u8>(inst.i.rt.GetValue()) & u8(0x1E)) == u8(0x10))
+        return false;
+
+      if (IsAlwaysTakenBranch(inst))
+        target = GetDirectBranchTarget(inst, cbi.pc);
+      else if (!PredictTraceBranch(block, cbi, profile_pc, &target))
+        return false;
+    }
+    break;
+
+    default:
+      return false;
   }
-  else
+
+  // the page tracking assumes the whole block is either in RAM or not
+  const bool target_in_ram = ((target & PHYSICAL_MEMORY_ADDRESS_MASK) < 0x200000);
+  if (target_in_ram != block->IsInRAM())
+    return false;
+
+  // loops have to go back through the dispatcher, otherwise we'd never check the downcount
+  if (target == cbi.pc)
+    return false;
+  for (const CodeBlockInstruction& other : block->instructions)
   {
-    InterpretUncachedBlock<PGXPMode::Disabled>();
+    if (other.pc == target)
+      return false;
   }
+
+  *trace_target = target;
+  return true;
 }
 
-void InvalidCodeFunction()
+bool PredictTraceBranch(const CodeBlock* block, const CodeBlockInstruction& cbi, u32 profile_pc, u32* trace_target)
 {
-  Log_ErrorPrintf("Trying to execute invalid code at 0x%08X", g_state.regs.pc);
-  if (g_settings.gpu_pgxp_enable)
+  if (s_persistent_trace_source)
   {
-    if (g_settings.gpu_pgxp_cpu)
-      InterpretUncachedBlock<PGXPMode::CPU>();
-    else
-      InterpretUncachedBlock<PGXPMode::Memory>();
+    for (const PersistentTracePrediction& prediction : s_persistent_trace_source->trace_predictions)
+    {
+      if (prediction.branch_pc != cbi.pc)
+        continue;
+
+      // the cache file could say anything, so only go where the branch can
+      if (prediction.target != GetDirectBranchTarget(cbi.instruction, cbi.pc) && prediction.target != (cbi.pc + 8))
+        return false;
+
+      *trace_target = prediction.target;
+      return true;
+    }
+
+    return false;
   }
-  else
+
+  // the first conditional branch ends the block being compiled, later ones end the blocks the trace runs into
+  const CodeBlock* profile = block;
+  if (profile_pc != block->GetPC())
   {
-    InterpretUncachedBlock<PGXPMode::Disabled>();
+    CodeBlockKey key = block->key;
+    key.SetPC(profile_pc);
+    CodeBlock** slot = s_blocks.Find(key.bits);
+    if (!slot || !*slot)
+      return false;
+
+    profile = *slot;
   }
-}
 
-#endif
+  const u32 count = profile->exit_branch_count;
+  if (profile->exit_branch_pc != cbi.pc || count < TRACE_BRANCH_MIN_SAMPLES)
+    return false;
 
-static void InvalidateBlock(CodeBlock* block, bool allow_frame_invalidation)
+  const u32 taken = profile->exit_branch_taken_count;
+  if ((taken * 8) >= (count * 7))
+    *trace_target = GetDirectBranchTarget(cbi.instruction, cbi.pc);
+  else if (((count - taken) * 8) >= (count * 7))
+    *trace_target = cbi.pc + 8;
+  else
+    return false;
+
+  return true;
+}
+
+/// Gets the registers read and written by an instruction which is allowed in an idle loop.
+/// Returns false for anything with side effects, or state we don't track (e.g. HI/LO, coprocessors).
+static bool GetIdleLoopInstructionRegisters(const Instruction inst, u32* reads, u32* writes)
+{
+  const u32 rs = 1u << static_cast<u8>(inst.r.rs.GetValue());
+  const u32 rt = 1u << static_cast<u8>(inst.r.rt.GetValue());
+  const u32 rd = 1u << static_cast<u8>(inst.r.rd.GetValue());
+  switch (inst.op)
+  {
+    case InstructionOp::funct:
+    {
+      switch (inst.r.funct)
+      {
+        case InstructionFunct::sll:
+        case InstructionFunct::srl:
+        case InstructionFunct::sra:
+          *reads = rt;
+          *writes = rd;
+          return true;
+
+        case InstructionFunct::sllv:
+        case InstructionFunct::srlv:
+        case InstructionFunct::srav:
+        case InstructionFunct::add:
+        case InstructionFunct::addu:
+        case InstructionFunct::sub:
+        case InstructionFunct::subu:
+        case InstructionFunct::and_:
+        case InstructionFunct::or_:
+        case InstructionFunct::xor_:
+        case InstructionFunct::nor:
+        case InstructionFunct::slt:
+        case InstructionFunct::sltu:
+          *reads = rs | rt;
+          *writes = rd;
+          return true;
+
+        default:
+          return false;
+      }
+    }
+
+    case InstructionOp::b:
+    {
+      // no linking variants
+      if ((static_cast<u8>(inst.i.rt.GetValue()) & u8(0x1E)) == u8(0x10))
+        return false;
+
+      *reads = rs;
+      *writes = 0;
+      return true;
+    }
+
+    case InstructionOp::j:
+      *reads = 0;
+      *writes = 0;
+      return true;
+
+    case InstructionOp::beq:
+    case InstructionOp::bne:
+      *reads = rs | rt;
+      *writes = 0;
+      return true;
+
+    case InstructionOp::blez:
+    case InstructionOp::bgtz:
+      *reads = rs;
+      *writes = 0;
+      return true;
+
+    case InstructionOp::addi:
+    case InstructionOp::addiu:
+    case InstructionOp::slti:
+    case InstructionOp::sltiu:
+    case InstructionOp::andi:
+    case InstructionOp::ori:
+    case InstructionOp::xori:
+    case InstructionOp::lb:
+    case InstructionOp::lh:
+    case InstructionOp::lw:
+    case InstructionOp::lbu:
+    case InstructionOp::lhu:
+      *reads = rs;
+      *writes = rt;
+      return true;
+
+    case InstructionOp::lui:
+      *reads = 0;
+      *writes = rt;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+bool IsIdleLoop(const CodeBlock* block)
+{
+  // A loop can be skipped if it branches back to itself, doesn't write anything except registers, and each iteration
+  // computes the same values. The last part means any register written in the loop is written before it's read, so
+  // no state carries over between iterations, and the only input is memory.
+  const size_t count = block->instructions.size();
+  if (!g_settings.cpu_idle_loop_skipping || count < 2 || count > MAX_IDLE_LOOP_INSTRUCTIONS)
+    return false;
+
+  const CodeBlockInstruction& branch = block->instructions[count - 2];
+  if (!branch.is_direct_branch_instruction || GetDirectBranchTarget(branch.instruction, branch.pc) != block->GetPC())
+    return false;
+
+  std::array<u32, MAX_IDLE_LOOP_INSTRUCTIONS> reads;
+  std::array<u32, MAX_IDLE_LOOP_INSTRUCTIONS> writes;
+  u32 written = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    const CodeBlockInstruction& cbi = block->instructions[i];
+    if ((cbi.is_branch_delay_slot && cbi.is_branch_instruction) || IsConditionalTraceBranch(cbi) ||
+        !GetIdleLoopInstructionRegisters(cbi.instruction, &reads[i], &writes[i]))
+    {
+      return false;
+    }
+
+    // writes to $zero don't do anything
+    writes[i] &= ~1u;
+    written |= writes[i];
+  }
+
+  u32 defined = 0;
+  u32 pending_load = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    const CodeBlockInstruction& cbi = block->instructions[i];
+    if ((reads[i] & written & ~defined) != 0)
+      return false;
+
+    if (cbi.is_load_instruction)
+    {
+      // the address is checked at runtime from the register values at the end of the loop,
+      // so the base register can't change after the load
+      for (size_t j = i; j < count; j++)
+      {
+        if (writes[j] & reads[i])
+          return false;
+      }
+    }
+
+    // loaded values aren't visible until after the load delay slot
+    defined |= pending_load;
+    pending_load = cbi.has_load_delay ? writes[i] : 0;
+    if (!cbi.has_load_delay)
+      defined |= writes[i];
+  }
+
+  return true;
+}
+
+bool TrySkipIdleLoop(const CodeBlock* block)
+{
+  // RAM and the scratchpad are only changed by the CPU, or DMA which is driven by events. The same goes for the
+  // interrupt controller registers. Anything else, e.g. timers, can change as time passes, so keep running those.
+  for (const CodeBlockInstruction& cbi : block->instructions)
+  {
+    if (!cbi.is_load_instruction)
+      continue;
+
+    const VirtualMemoryAddress address = GetLoadStoreEffectiveAddress(cbi.instruction, &g_state.regs).value_or(0);
+    const Segment segment = GetSegmentForAddress(address);
+    const PhysicalMemoryAddress paddr = VirtualAddressToPhysical(address);
+    if (segment == Segment::KSEG2)
+      return false;
+    else if (Bus::IsRAMAddress(paddr))
+      continue;
+    else if (segment != Segment::KSEG1 && (paddr & DCACHE_LOCATION_MASK) == DCACHE_LOCATION)
+      continue;
+    else if (paddr >= Bus::INTERRUPT_CONTROLLER_BASE && paddr < (Bus::INTERRUPT_CONTROLLER_BASE + 8))
+      continue;
+    else
+      return false;
+  }
+
+  if (g_state.pending_ticks < g_state.downcount)
+  {
+    s_statistics.idle_loop_skips++;
+    s_statistics.idle_loop_skipped_ticks += static_cast<u64>(g_state.downcount - g_state.pending_ticks);
+    g_state.pending_ticks = g_state.downcount;
+  }
+
+  return true;
+}
+
+bool HasHostCodeSpace(size_t instruction_count)
+{
+#ifdef WITH_RECOMPILER
+  return (s_code_buffer.GetFreeCodeSpace() >= (instruction_count * Recompiler::MAX_NEAR_HOST_BYTES_PER_INSTRUCTION) &&
+          s_code_buffer.GetFreeFarCodeSpace() >= (instruction_count * Recompiler::MAX_FAR_HOST_BYTES_PER_INSTRUCTION));
+#else
+  return true;
+#endif
+}
+
+bool CompileBlockHostCode(CodeBlock* block, bool allow_flush)
+{
+  Profiling::ScopedSection profile_section(Profiling::Section::CodeCompile);
+
+#ifdef WITH_RECOMPILER
+  if (g_settings.IsUsingRecompiler())
+  {
+    // new code starts out in the cached interpreter, and only gets recompiled once it's shown to be hot
+    if (g_settings.cpu_recompiler_tiered_compilation && block->execution_count < TIERED_COMPILATION_THRESHOLD)
+    {
+      block->host_code = nullptr;
+      block->host_code_size = 0;
+      CompileThreadedCode(block);
+      s_statistics.tier_cold_blocks++;
+      return true;
+    }
+
+    // Ensure we're not going to run out of space while compiling this block.
+    if (!HasHostCodeSpace(block->instructions.size()))
+    {
+      if (allow_flush)
+      {
+        MakeHostCodeSpace(block->instructions.size());
+      }
+      else
+      {
+        Log_ErrorPrintf("Out of code space and cannot flush while compiling %08X.", block->GetPC());
+        return false;
+      }
+    }
+
+    s_code_buffer.WriteProtect(false);
+    Recompiler::CodeGenerator codegen(&s_code_buffer);
+    const bool compile_result = codegen.CompileBlock(block, &block->host_code, &block->host_code_size);
+    s_code_buffer.WriteProtect(true);
+
+    if (!compile_result)
+    {
+      Log_ErrorPrintf("Failed to compile host code for block at 0x%08X", block->key.GetPC());
+      return false;
+    }
+
+    // the threaded code isn't needed once there's host code
+    CodeBlockVector<ThreadedInstruction>().swap(block->threaded_code);
+    block->host_code_generation = s_code_buffer.GetCurrentRegion();
+
+    s_statistics.recompiled_instructions += block->instructions.size();
+    s_statistics.trace_profiled_branches +=
+      std::count_if(block->instructions.begin(), block->instructions.end(), IsConditionalTraceBranch);
+    s_statistics.recompiled_host_bytes += block->host_code_size;
+    return true;
+  }
+#endif
+
+  CompileThreadedCode(block);
+  return true;
+}
+
+#ifdef WITH_RECOMPILER
+
+void EvictOldestCodeGeneration()
+{
+  const u32 generation = s_code_buffer.SwitchToNextRegion();
+
+  // removing blocks while iterating the table would skip entries
+  std::vector<CodeBlock*> evicted_blocks;
+  s_blocks.ForEach([generation, &evicted_blocks](CodeBlock* block) {
+    if (block && block->host_code && block->host_code_generation == generation)
+      evicted_blocks.push_back(block);
+  });
+
+  for (CodeBlock* block : evicted_blocks)
+  {
+    // invalidated blocks are still in the host code map, RemoveReferencesToBlock() only removes valid ones
+    const bool invalidated = block->invalidated;
+    RemoveReferencesToBlock(block);
+    if (invalidated)
+      RemoveBlockFromHostCodeMap(block);
+
+    FreeBlock(block);
+  }
+
+  Log_InfoPrintf("Evicted %zu blocks from code generation %u", evicted_blocks.size(), generation);
+  s_statistics.code_evictions++;
+  s_statistics.code_evicted_blocks += evicted_blocks.size();
+}
+
+void MakeHostCodeSpace(size_t instruction_count)
+{
+  EvictOldestCodeGeneration();
+  if (!HasHostCodeSpace(instruction_count))
+  {
+    Log_WarningPrintf("Out of code space, flushing all blocks.");
+    Flush();
+  }
+}
+
+bool PromoteBlock(CodeBlock* block)
+{
+  // now that we know which way the block usually leaves, the trace can carry on through its last branch
+  const size_t count = block->instructions.size();
+  u32 trace_target;
+  const bool retrace = (count >= 2 && g_settings.cpu_code_cache_traces && !g_settings.cpu_recompiler_icache &&
+                        PredictTraceBranch(block, block->instructions[count - 2], block->GetPC(), &trace_target));
+  const size_t max_instruction_count = retrace ? (count + MAX_TRACE_INSTRUCTIONS) : count;
+
+  if (!HasHostCodeSpace(max_instruction_count))
+  {
+    // cold blocks don't have any code in the buffer, so eviction can't touch this one
+    EvictOldestCodeGeneration();
+
+    // but a flush would free it, so leave it for the dispatcher to look up again
+    if (!HasHostCodeSpace(max_instruction_count))
+    {
+      Log_WarningPrintf("Out of code space, flushing all blocks.");
+      Flush();
+      return false;
+    }
+  }
+
+  if (retrace ? !RetraceBlock(block) : !CompileBlockHostCode(block, false))
+  {
+    RemoveReferencesToBlock(block);
+    FallbackExistingBlockToInterpreter(block);
+    return false;
+  }
+
+  s_statistics.tier_promotions++;
+  SetFastMap(block->GetPC(), block->host_code);
+  AddBlockToHostCodeMap(block);
+  return true;
+}
+
+bool RetraceBlock(CodeBlock* block)
+{
+  // the trace can cover different pages, so the block has to be decoded again
+  RemoveBlockFromPageMap(block);
+  block->instructions.clear();
+  const bool result = CompileBlock(block, false);
+  AddBlockToPageMap(block);
+  if (!result)
+    return false;
+
+  RecordPersistentBlock(block);
+  s_statistics.trace_extensions++;
+  return true;
+}
+
+void InterpretColdBlock(CodeBlock* block)
+{
+  s_statistics.tier_cold_executions++;
+
+  if (g_settings.cpu_recompiler_icache)
+    CheckAndUpdateICacheTags(block->icache_line_count, block->uncached_fetch_ticks);
+
+  if (g_settings.gpu_pgxp_enable)
+  {
+    if (g_settings.gpu_pgxp_cpu)
+      InterpretCachedBlock<PGXPMode::CPU>(*block);
+    else
+      InterpretCachedBlock<PGXPMode::Memory>(*block);
+  }
+  else
+  {
+    InterpretCachedBlock<PGXPMode::Disabled>(*block);
+  }
+
+  // profile the exit branch for traces, exceptions and side exits leave somewhere else and aren't counted
+  const size_t count = block->instructions.size();
+  if (!g_settings.cpu_code_cache_traces || count < 2)
+    return;
+
+  const CodeBlockInstruction& branch = block->instructions[count - 2];
+  if (!branch.is_direct_branch_instruction || IsAlwaysTakenBranch(branch.instruction))
+    return;
+
+  const bool taken = (g_state.regs.pc == GetDirectBranchTarget(branch.instruction, branch.pc));
+  if (!taken && g_state.regs.pc != (branch.pc + 8))
+    return;
+
+  if (block->exit_branch_pc != branch.pc)
+  {
+    block->exit_branch_pc = branch.pc;
+    block->exit_branch_count = 0;
+    block->exit_branch_taken_count = 0;
+  }
+
+  block->exit_branch_count++;
+  block->exit_branch_taken_count += BoolToUInt32(taken);
+}
+
+void FastCompileBlockFunction()
+{
+  CodeBlock* block = LookupBlock(GetNextBlockKey(), true);
+  if (block)
+  {
+    if (!block->host_code)
+    {
+      // still cold, keep interpreting it until it crosses the threshold
+      if (++block->execution_count < TIERED_COMPILATION_THRESHOLD && g_settings.cpu_recompiler_tiered_compilation)
+      {
+        InterpretColdBlock(block);
+        return;
+      }
+
+      // the dispatcher will look it up again if it had to be thrown away
+      if (!PromoteBlock(block))
+        return;
+    }
+
+    s_single_block_asm_dispatcher(block->host_code);
+    return;
+  }
+
+  if (g_settings.gpu_pgxp_enable)
+  {
+    if (g_settings.gpu_pgxp_cpu)
+      InterpretUncachedBlock<PGXPMode::CPU>();
+    else
+      InterpretUncachedBlock<PGXPMode::Memory>();
+  }
+  else
+  {
+    InterpretUncachedBlock<PGXPMode::Disabled>();
+  }
+}
+
+void InvalidCodeFunction()
+{
+  Log_ErrorPrintf("Trying to execute invalid code at 0x%08X", g_state.regs.pc);
+  if (g_settings.gpu_pgxp_enable)
+  {
+    if (g_settings.gpu_pgxp_cpu)
+      InterpretUncachedBlock<PGXPMode::CPU>();
+    else
+      InterpretUncachedBlock<PGXPMode::Memory>();
+  }
+  else
+  {
+    InterpretUncachedBlock<PGXPMode::Disabled>();
+  }
+}
+
+#endif
+
+static void InvalidateBlock(CodeBlock* block, bool allow_frame_invalidation)
 {
   // Invalidate forces the block to be checked again.
   block->invalidated = true;
@@ -780,23 +1763,90 @@ static void InvalidateBlock(CodeBlock* block, bool allow_frame_invalidation)
 
 void InvalidateBlocksWithPageIndex(u32 page_index)
 {
-  auto& blocks = m_ram_block_map[page_index];
+  // Blocks will be re-added next execution. Take them out of the other pages they span too, so that invalidated
+  // blocks are never in the page map.
+  std::vector<CodeBlock*> blocks = std::move(m_ram_block_map[page_index]);
+  m_ram_block_map[page_index].clear();
+  Bus::ClearRAMCodePage(page_index);
+
   for (CodeBlock* block : blocks)
+  {
+    RemoveBlockFromPageMap(block);
     InvalidateBlock(block, true);
+  }
+}
 
-  // Block will be re-added next execution.
-  blocks.clear();
-  Bus::ClearRAMCodePage(page_index);
+static bool BlockOverlapsPageRange(const CodeBlock* block, u32 page_index, u32 start_offset, u32 end_offset)
+{
+  for (const CodeBlockInstruction& cbi : block->instructions)
+  {
+    const u32 address = cbi.pc & PHYSICAL_MEMORY_ADDRESS_MASK;
+    const u32 offset = address & HOST_PAGE_OFFSET_MASK;
+    if ((address / HOST_PAGE_SIZE) == page_index && offset < end_offset && (offset + sizeof(u32)) > start_offset)
+      return true;
+  }
+
+  return false;
 }
 
-void InvalidateAll()
+static void UpdatePageCodeSubpages(u32 page_index)
+{
+  u64 bits = 0;
+  for (const CodeBlock* block : m_ram_block_map[page_index])
+  {
+    for (const CodeBlockInstruction& cbi : block->instructions)
+    {
+      const u32 address = cbi.pc & PHYSICAL_MEMORY_ADDRESS_MASK;
+      if ((address / HOST_PAGE_SIZE) == page_index)
+        bits |= Bus::GetRAMCodeSubpageMask(address & HOST_PAGE_OFFSET_MASK, sizeof(u32));
+    }
+  }
+
+  Bus::m_ram_code_subpage_bits[page_index] = bits;
+}
+
+void InvalidateBlocksInPageRange(u32 page_index, u32 offset_in_page, u32 size, bool allow_frame_invalidation)
 {
-  for (auto& it : s_blocks)
+  if (!(Bus::m_ram_code_subpage_bits[page_index] & Bus::GetRAMCodeSubpageMask(offset_in_page, size)))
+  {
+    // data sitting next to code
+    s_statistics.invalidations_avoided++;
+    return;
+  }
+
+  const u32 end_offset = offset_in_page + size;
+  std::vector<CodeBlock*> overlapping_blocks;
+  for (CodeBlock* block : m_ram_block_map[page_index])
+  {
+    if (BlockOverlapsPageRange(block, page_index, offset_in_page, end_offset))
+      overlapping_blocks.push_back(block);
+  }
+
+  if (overlapping_blocks.empty())
   {
-    CodeBlock* block = it.second;
+    s_statistics.invalidations_avoided++;
+    return;
+  }
+
+  for (CodeBlock* block : overlapping_blocks)
+  {
+    RemoveBlockFromPageMap(block);
+    InvalidateBlock(block, allow_frame_invalidation);
+  }
+
+  // the page is unflagged when its last block goes, otherwise narrow down what's left
+  if (Bus::IsRAMCodePage(page_index))
+    UpdatePageCodeSubpages(page_index);
+
+  s_statistics.code_invalidations++;
+}
+
+void InvalidateAll()
+{
+  s_blocks.ForEach([](CodeBlock* block) {
     if (block && !block->invalidated)
       InvalidateBlock(block, false);
-  }
+  });
 
   Bus::ClearRAMCodePageFlags();
   for (auto& it : m_ram_block_map)
@@ -805,8 +1855,6 @@ void InvalidateAll()
 
 void RemoveReferencesToBlock(CodeBlock* block)
 {
-  BlockMap::iterator iter = s_blocks.find(block->key.GetPC());
-
 #ifdef WITH_RECOMPILER
   SetFastMap(block->GetPC(), FastCompileBlockFunction);
 #endif
@@ -821,7 +1869,46 @@ void RemoveReferencesToBlock(CodeBlock* block)
     RemoveBlockFromHostCodeMap(block);
 #endif
 
-  s_blocks.erase(iter);
+  s_blocks.Remove(block->key.bits);
+}
+
+template<typename T>
+static void EnumerateBlockPages(const CodeBlock* block, const T& callback)
+{
+  if (!block->contains_trace_branches)
+  {
+    const u32 start_page = block->GetStartPageIndex();
+    const u32 end_page = block->GetEndPageIndex();
+    for (u32 page = start_page; page <= end_page; page++)
+      callback(page);
+
+    return;
+  }
+
+  // superblocks are made of several ranges of memory, which can share pages
+  std::array<std::pair<u32, u32>, MAX_TRACE_BRANCHES + 1> ranges;
+  u32 num_ranges = 0;
+  const size_t instruction_count = block->instructions.size();
+  size_t range_start = 0;
+  for (size_t i = 1; i <= instruction_count; i++)
+  {
+    if (i != instruction_count && (i < 2 || !block->instructions[i - 2].is_trace_branch))
+      continue;
+
+    const u32 start_page = (block->instructions[range_start].pc & PHYSICAL_MEMORY_ADDRESS_MASK) / HOST_PAGE_SIZE;
+    const u32 end_page = (block->instructions[i - 1].pc & PHYSICAL_MEMORY_ADDRESS_MASK) / HOST_PAGE_SIZE;
+    for (u32 page = start_page; page <= end_page; page++)
+    {
+      if (std::none_of(ranges.begin(), ranges.begin() + num_ranges,
+                       [page](const auto& range) { return (page >= range.first && page <= range.second); }))
+      {
+        callback(page);
+      }
+    }
+
+    ranges[num_ranges++] = std::make_pair(start_page, end_page);
+    range_start = i;
+  }
 }
 
 void AddBlockToPageMap(CodeBlock* block)
@@ -829,12 +1916,16 @@ void AddBlockToPageMap(CodeBlock* block)
   if (!block->IsInRAM())
     return;
 
-  const u32 start_page = block->GetStartPageIndex();
-  const u32 end_page = block->GetEndPageIndex();
-  for (u32 page = start_page; page <= end_page; page++)
-  {
+  EnumerateBlockPages(block, [block](u32 page) {
     m_ram_block_map[page].push_back(block);
     Bus::SetRAMCodePage(page);
+  });
+
+  for (const CodeBlockInstruction& cbi : block->instructions)
+  {
+    const u32 address = cbi.pc & PHYSICAL_MEMORY_ADDRESS_MASK;
+    Bus::m_ram_code_subpage_bits[address / HOST_PAGE_SIZE] |=
+      Bus::GetRAMCodeSubpageMask(address & HOST_PAGE_OFFSET_MASK, sizeof(u32));
   }
 }
 
@@ -843,14 +1934,18 @@ void RemoveBlockFromPageMap(CodeBlock* block)
   if (!block->IsInRAM())
     return;
 
-  const u32 start_page = block->GetStartPageIndex();
-  const u32 end_page = block->GetEndPageIndex();
-  for (u32 page = start_page; page <= end_page; page++)
-  {
+  EnumerateBlockPages(block, [block](u32 page) {
     auto& page_blocks = m_ram_block_map[page];
     auto page_block_iter = std::find(page_blocks.begin(), page_blocks.end(), block);
+    if (page_block_iter == page_blocks.end())
+      return;
+
     page_blocks.erase(page_block_iter);
-  }
+
+    // stop tracking writes once nothing is left, the subpage bits can be stale until then
+    if (page_blocks.empty())
+      Bus::ClearRAMCodePage(page);
+  });
 }
 
 void LinkBlock(CodeBlock* from, CodeBlock* to, void* host_pc, void* host_resolve_pc, u32 host_pc_size)
@@ -924,11 +2019,364 @@ void UnlinkBlock(CodeBlock* block)
 #endif
 }
 
+u64 GetBlockCodeHash(const CodeBlock* block)
+{
+  u64 hash = 0;
+  for (const CodeBlockInstruction& cbi : block->instructions)
+  {
+    const u32 words[2] = {cbi.pc, cbi.instruction.bits};
+    hash = XXH3_64bits_withSeed(words, sizeof(words), hash);
+  }
+
+  return hash;
+}
+
+void RecordPersistentBlock(const CodeBlock* block)
+{
+  if (s_persistent_cache_filename.empty())
+    return;
+
+  PersistentBlock& pb = s_persistent_blocks[block->key.bits];
+  pb.instruction_count = static_cast<u32>(block->instructions.size());
+  pb.code_hash = GetBlockCodeHash(block);
+
+  // the trace carries on after the delay slot, at wherever the branch was predicted to go
+  pb.trace_predictions.clear();
+  for (size_t i = 0; i < block->instructions.size(); i++)
+  {
+    const CodeBlockInstruction& cbi = block->instructions[i];
+    if (IsConditionalTraceBranch(cbi))
+      pb.trace_predictions.push_back({cbi.pc, block->instructions[i + 2].pc});
+  }
+}
+
+void RecordPersistentBlockLinks()
+{
+  if (s_persistent_cache_filename.empty())
+    return;
+
+  s_blocks.ForEach([](const CodeBlock* block) {
+    if (!block || block->link_successors.empty())
+      return;
+
+    auto pb_iter = s_persistent_blocks.find(block->key.bits);
+    if (pb_iter == s_persistent_blocks.end())
+      return;
+
+    std::vector<u32>& successors = pb_iter->second.successors;
+    for (const CodeBlock::LinkInfo& li : block->link_successors)
+    {
+      if (successors.size() >= PERSISTENT_CACHE_MAX_SUCCESSORS)
+        break;
+
+      if (std::find(successors.begin(), successors.end(), li.block->key.bits) == successors.end())
+        successors.push_back(li.block->key.bits);
+    }
+  });
+}
+
+static bool ParsePersistentCache(const std::vector<u8>& data, PersistentBlockMap* blocks, std::vector<u32>* order)
+{
+  const u8* ptr = data.data();
+  size_t remaining = data.size();
+  auto read_u32 = [&ptr, &remaining](u32* value) {
+    if (remaining < sizeof(u32))
+      return false;
+
+    std::memcpy(value, ptr, sizeof(u32));
+    ptr += sizeof(u32);
+    remaining -= sizeof(u32);
+    return true;
+  };
+
+  u32 magic, version, block_count;
+  if (!read_u32(&magic) || magic != PERSISTENT_CACHE_MAGIC || !read_u32(&version) ||
+      version != PERSISTENT_CACHE_VERSION || !read_u32(&block_count))
+  {
+    return false;
+  }
+
+  std::unordered_map<u32, u32> predecessor_counts;
+  for (u32 i = 0; i < block_count; i++)
+  {
+    u32 key, instruction_count, code_hash_low, code_hash_high, prediction_count, successor_count;
+    if (!read_u32(&key) || !read_u32(&instruction_count) || !read_u32(&code_hash_low) ||
+        !read_u32(&code_hash_high) || !read_u32(&prediction_count) || !read_u32(&successor_count) ||
+        key == PERSISTENT_CACHE_REMOVED_KEY || instruction_count == 0 ||
+        instruction_count > PERSISTENT_CACHE_MAX_INSTRUCTIONS || prediction_count > MAX_TRACE_BRANCHES ||
+        successor_count > PERSISTENT_CACHE_MAX_SUCCESSORS)
+    {
+      return false;
+    }
+
+    PersistentBlock pb;
+    pb.instruction_count = instruction_count;
+    pb.code_hash = (static_cast<u64>(code_hash_high) << 32) | code_hash_low;
+    pb.trace_predictions.resize(prediction_count);
+    for (PersistentTracePrediction& prediction : pb.trace_predictions)
+    {
+      if (!read_u32(&prediction.branch_pc) || !read_u32(&prediction.target))
+        return false;
+    }
+
+    pb.successors.resize(successor_count);
+    for (u32& successor : pb.successors)
+    {
+      if (!read_u32(&successor))
+        return false;
+
+      predecessor_counts[successor]++;
+    }
+
+    if (blocks->emplace(key, std::move(pb)).second)
+      order->push_back(key);
+  }
+
+  // Blocks which many others branch to are loop heads and shared routines, so compile them first.
+  std::stable_sort(order->begin(), order->end(),
+                   [&predecessor_counts](u32 lhs, u32 rhs) {
+                     const auto lhs_iter = predecessor_counts.find(lhs);
+                     const auto rhs_iter = predecessor_counts.find(rhs);
+                     const u32 lhs_count = (lhs_iter != predecessor_counts.end()) ? lhs_iter->second : 0;
+                     const u32 rhs_count = (rhs_iter != predecessor_counts.end()) ? rhs_iter->second : 0;
+                     return lhs_count > rhs_count;
+                   });
+
+  return true;
+}
+
+// Runs on its own thread, so it only touches what it's given rather than the console's statics.
+void PersistentCacheLoadThread(std::string filename, PersistentBlockMap* blocks, std::vector<u32>* order,
+                               std::atomic_bool* done)
+{
+  blocks->clear();
+  order->clear();
+
+  std::optional<std::vector<u8>> data = FileSystem::ReadBinaryFile(filename.c_str());
+  if (!data.has_value())
+  {
+    Log_InfoPrintf("No persistent code cache found at '%s'", filename.c_str());
+  }
+  else if (!ParsePersistentCache(data.value(), blocks, order))
+  {
+    Log_WarningPrintf("Persistent code cache '%s' is invalid, ignoring", filename.c_str());
+    blocks->clear();
+    order->clear();
+  }
+  else
+  {
+    Log_InfoPrintf("Loaded %zu blocks from persistent code cache '%s'", order->size(), filename.c_str());
+  }
+
+  done->store(true);
+}
+
+void FinishPersistentCacheLoad()
+{
+  if (!s_persistent_load_thread.joinable())
+    return;
+
+  s_persistent_load_thread.join();
+
+  // Anything already compiled this session takes priority over the loaded copy.
+  for (auto& it : s_persistent_loaded_blocks)
+    s_persistent_blocks.emplace(it.first, std::move(it.second));
+
+  s_persistent_pending_blocks = std::move(s_persistent_loaded_order);
+  s_persistent_pending_position = 0;
+  s_persistent_loaded_blocks.clear();
+  s_persistent_loaded_order.clear();
+}
+
+void LoadPersistentCache(std::string filename)
+{
+  FinishPersistentCacheLoad();
+  s_persistent_blocks.clear();
+  s_persistent_pending_blocks.clear();
+  s_persistent_pending_position = 0;
+
+  s_persistent_cache_filename = std::move(filename);
+  if (s_persistent_cache_filename.empty())
+    return;
+
+  s_persistent_load_done.store(false);
+  s_persistent_load_thread = std::thread(PersistentCacheLoadThread, s_persistent_cache_filename,
+                                         &s_persistent_loaded_blocks, &s_persistent_loaded_order, &s_persistent_load_done);
+}
+
+void SavePersistentCache()
+{
+  if (s_persistent_cache_filename.empty())
+    return;
+
+  FinishPersistentCacheLoad();
+  RecordPersistentBlockLinks();
+
+  std::vector<u8> data;
+  auto write_u32 = [&data](u32 value) {
+    const size_t pos = data.size();
+    data.resize(pos + sizeof(value));
+    std::memcpy(&data[pos], &value, sizeof(value));
+  };
+
+  write_u32(PERSISTENT_CACHE_MAGIC);
+  write_u32(PERSISTENT_CACHE_VERSION);
+  write_u32(static_cast<u32>(s_persistent_blocks.size()));
+  for (const auto& it : s_persistent_blocks)
+  {
+    const PersistentBlock& pb = it.second;
+    write_u32(it.first);
+    write_u32(pb.instruction_count);
+    write_u32(static_cast<u32>(pb.code_hash));
+    write_u32(static_cast<u32>(pb.code_hash >> 32));
+    write_u32(static_cast<u32>(pb.trace_predictions.size()));
+    write_u32(static_cast<u32>(pb.successors.size()));
+    for (const PersistentTracePrediction& prediction : pb.trace_predictions)
+    {
+      write_u32(prediction.branch_pc);
+      write_u32(prediction.target);
+    }
+    for (const u32 successor : pb.successors)
+      write_u32(successor);
+  }
+
+  if (FileSystem::WriteBinaryFile(s_persistent_cache_filename.c_str(), data.data(), data.size()))
+  {
+    Log_InfoPrintf("Wrote %zu blocks to persistent code cache '%s'", s_persistent_blocks.size(),
+                   s_persistent_cache_filename.c_str());
+  }
+  else
+  {
+    Log_ErrorPrintf("Failed to write persistent code cache '%s'", s_persistent_cache_filename.c_str());
+  }
+
+  s_persistent_blocks.clear();
+  s_persistent_pending_blocks.clear();
+  s_persistent_pending_position = 0;
+  s_persistent_cache_filename.clear();
+}
+
+enum class PrecompileResult
+{
+  Compiled,
+  Skipped,
+  NotInMemory,
+  OutOfSpace
+};
+
+static PrecompileResult PrecompilePersistentBlock(u32 key_bits)
+{
+  if (s_blocks.Find(key_bits))
+    return PrecompileResult::Skipped;
+
+  const auto pb_iter = s_persistent_blocks.find(key_bits);
+  if (pb_iter == s_persistent_blocks.end())
+    return PrecompileResult::Skipped;
+
+  // superblocks don't work with icache emulation, let them get recompiled normally
+  const PersistentBlock& pb = pb_iter->second;
+  if (!pb.trace_predictions.empty() && (!g_settings.cpu_code_cache_traces || g_settings.cpu_recompiler_icache))
+    return PrecompileResult::Skipped;
+
+  if (g_settings.IsUsingRecompiler() && !HasHostCodeSpace(pb.instruction_count))
+    return PrecompileResult::OutOfSpace;
+
+  CodeBlockKey key;
+  key.bits = key_bits;
+
+  CodeBlock* block = AllocateBlock(key);
+  block->recompile_frame_number = System::GetFrameNumber();
+
+  // these ran in a previous session, so we're compiling them ahead of time rather than waiting for them to get hot
+  block->execution_count = TIERED_COMPILATION_THRESHOLD;
+
+  // nothing from the file is trusted except where the trace went, the rest is decoded from memory as it would be
+  s_persistent_trace_source = &pb;
+  const bool analyzed = AnalyzeBlock(block);
+  s_persistent_trace_source = nullptr;
+
+  // the game may not have loaded the code yet
+  if (!analyzed || block->instructions.size() != pb.instruction_count || GetBlockCodeHash(block) != pb.code_hash)
+  {
+    FreeBlock(block);
+    return PrecompileResult::NotInMemory;
+  }
+
+  if (!CompileBlockHostCode(block, false))
+  {
+    FreeBlock(block);
+    return PrecompileResult::Skipped;
+  }
+
+  AddBlockToPageMap(block);
+
+#ifdef WITH_RECOMPILER
+  SetFastMap(block->GetPC(), GetBlockEntryPoint(block));
+  AddBlockToHostCodeMap(block);
+#endif
+
+  s_blocks.Insert(key_bits, block);
+  return PrecompileResult::Compiled;
+}
+
+void PrecompilePersistentBlocks()
+{
+  if (s_persistent_load_thread.joinable())
+  {
+    if (!s_persistent_load_done.load())
+      return;
+
+    FinishPersistentCacheLoad();
+  }
+
+  if (s_persistent_pending_blocks.empty() || !g_settings.IsUsingCodeCache())
+    return;
+
+  u32 compiles = 0;
+  u32 checks = 0;
+  while (compiles < PERSISTENT_CACHE_COMPILES_PER_FRAME && checks < PERSISTENT_CACHE_CHECKS_PER_FRAME)
+  {
+    if (s_persistent_pending_position >= s_persistent_pending_blocks.size())
+    {
+      // Drop the blocks we've dealt with, and start checking the remainder again next frame.
+      s_persistent_pending_blocks.erase(std::remove(s_persistent_pending_blocks.begin(),
+                                                    s_persistent_pending_blocks.end(), PERSISTENT_CACHE_REMOVED_KEY),
+                                        s_persistent_pending_blocks.end());
+      s_persistent_pending_position = 0;
+      break;
+    }
+
+    u32& key_bits = s_persistent_pending_blocks[s_persistent_pending_position++];
+    checks++;
+
+    switch (PrecompilePersistentBlock(key_bits))
+    {
+      case PrecompileResult::Compiled:
+        compiles++;
+        key_bits = PERSISTENT_CACHE_REMOVED_KEY;
+        break;
+
+      case PrecompileResult::Skipped:
+        key_bits = PERSISTENT_CACHE_REMOVED_KEY;
+        break;
+
+      case PrecompileResult::NotInMemory:
+        break;
+
+      case PrecompileResult::OutOfSpace:
+        Log_WarningPrintf("Out of code space, stopping persistent cache precompilation.");
+        s_persistent_pending_blocks.clear();
+        s_persistent_pending_position = 0;
+        return;
+    }
+  }
+}
+
 #ifdef WITH_RECOMPILER
 
 void AddBlockToHostCodeMap(CodeBlock* block)
 {
-  if (!g_settings.IsUsingRecompiler())
+  if (!g_settings.IsUsingRecompiler() || !block->host_code)
     return;
 
   s_host_code_map.emplace(block->host_code, block);
@@ -936,7 +2384,7 @@ void AddBlockToHostCodeMap(CodeBlock* block)
 
 void RemoveBlockFromHostCodeMap(CodeBlock* block)
 {
-  if (!g_settings.IsUsingRecompiler())
+  if (!g_settings.IsUsingRecompiler() || !block->host_code)
     return;
 
   HostCodeMap::iterator hc_iter = s_host_code_map.find(block->host_code);
@@ -1008,7 +2456,14 @@ Common::PageFaultHandler::HandlerResult MMapPageFaultHandler(void* exception_pc,
       {
         // this is probably a code page, since we aren't going to fault due to requiring fastmem on RAM.
         const u32 code_page_index = Bus::GetRAMCodePageIndex(fastmem_address);
-        if (Bus::IsRAMCodePage(code_page_index))
+        const u64 write_subpages =
+          Bus::GetRAMCodeSubpageMask((fastmem_address & ~3u) & HOST_PAGE_OFFSET_MASK, sizeof(u32));
+        if (Bus::IsRAMCodePage(code_page_index) && !(Bus::m_ram_code_subpage_bits[code_page_index] & write_subpages))
+        {
+          // the store hit data next to code, send it through slowmem which doesn't invalidate for that
+          s_statistics.invalidations_avoided++;
+        }
+        else if (Bus::IsRAMCodePage(code_page_index))
         {
           if (++lbi.fault_count < CODE_WRITE_FAULT_THRESHOLD_FOR_SLOWMEM)
           {
@@ -1105,6 +2560,10 @@ void CPU::Recompiler::Thunks::ResolveBranch(CodeBlock* block, void* host_pc, voi
     CodeGenerator::BackpatchReturn(host_pc, host_pc_size);
     s_code_buffer.WriteProtect(true);
   }
+  else if (!successor_block->host_code)
+  {
+    // the successor is still in the cached interpreter, keep coming back here until it's been recompiled
+  }
   else
   {
     // link blocks!
@@ -1112,4 +2571,9 @@ void CPU::Recompiler::Thunks::ResolveBranch(CodeBlock* block, void* host_pc, voi
   }
 }
 
+void CPU::Recompiler::Thunks::SkipIdleLoop(const CodeBlock* block)
+{
+  CPU::CodeCache::TrySkipIdleLoop(block);
+}
+
 #endif // WITH_RECOMPILER
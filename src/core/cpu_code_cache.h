@@ -4,9 +4,11 @@
 #include "common/jit_code_buffer.h"
 #include "common/page_fault_handler.h"
 #include "cpu_types.h"
+#include <algorithm>
 #include <array>
 #include <map>
 #include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
@@ -42,6 +44,44 @@ union CodeBlockKey
   ALWAYS_INLINE bool operator<(const CodeBlockKey& rhs) const { return bits < rhs.bits; }
 };
 
+namespace CodeCache {
+
+/// Allocates storage for blocks and their arrays from the code cache's slab allocator.
+/// The slabs themselves are only returned to the system when the cache is flushed.
+void* AllocateBlockMemory(size_t size);
+void FreeBlockMemory(void* ptr, size_t size);
+
+} // namespace CodeCache
+
+template<typename T>
+struct CodeBlockAllocator
+{
+  using value_type = T;
+
+  CodeBlockAllocator() = default;
+  template<typename U>
+  CodeBlockAllocator(const CodeBlockAllocator<U>&)
+  {
+  }
+
+  T* allocate(size_t n) { return static_cast<T*>(CodeCache::AllocateBlockMemory(n * sizeof(T))); }
+  void deallocate(T* p, size_t n) { CodeCache::FreeBlockMemory(p, n * sizeof(T)); }
+
+  template<typename U>
+  bool operator==(const CodeBlockAllocator<U>&) const
+  {
+    return true;
+  }
+  template<typename U>
+  bool operator!=(const CodeBlockAllocator<U>&) const
+  {
+    return false;
+  }
+};
+
+template<typename T>
+using CodeBlockVector = std::vector<T, CodeBlockAllocator<T>>;
+
 struct CodeBlockInstruction
 {
   Instruction instruction;
@@ -57,6 +97,25 @@ struct CodeBlockInstruction
   bool is_last_instruction : 1;
   bool has_load_delay : 1;
   bool can_trap : 1;
+  bool is_trace_branch : 1;
+};
+
+/// An instruction pre-decoded for the cached interpreter. The operands are extracted when the block is compiled, and
+/// the handler is specialised for the instruction and PGXP mode, so execution never goes through the decoder.
+struct ThreadedInstruction
+{
+  using Handler = void (*)(const ThreadedInstruction& ti);
+
+  Handler handler;
+  u32 bits;
+  u32 pc;
+  u32 imm; ///< Immediate after extension, or the shifted branch offset/jump target.
+  Reg rs;
+  Reg rt;
+  Reg rd;
+  u8 shamt;
+  bool is_branch_delay_slot;
+  bool check_trace_pc; ///< Follows a trace's conditional branch, which may have gone the other way.
 };
 
 struct CodeBlock
@@ -77,19 +136,25 @@ struct CodeBlock
   u32 host_code_size = 0;
   HostCodePointer host_code = nullptr;
 
-  std::vector<CodeBlockInstruction> instructions;
-  std::vector<LinkInfo> link_predecessors;
-  std::vector<LinkInfo> link_successors;
+  CodeBlockVector<CodeBlockInstruction> instructions;
+  CodeBlockVector<ThreadedInstruction> threaded_code;
+  CodeBlockVector<LinkInfo> link_predecessors;
+  CodeBlockVector<LinkInfo> link_successors;
 
   TickCount uncached_fetch_ticks = 0;
   u32 icache_line_count = 0;
 
 #ifdef WITH_RECOMPILER
-  std::vector<Recompiler::LoadStoreBackpatchInfo> loadstore_backpatch_info;
+  CodeBlockVector<Recompiler::LoadStoreBackpatchInfo> loadstore_backpatch_info;
+
+  /// Region of the code buffer which holds the host code, blocks are evicted a generation at a time.
+  u32 host_code_generation = 0;
 #endif
 
   bool contains_loadstore_instructions = false;
   bool contains_double_branches = false;
+  bool contains_trace_branches = false;
+  bool is_idle_loop = false;
   bool invalidated = false;
   bool can_link = true;
 
@@ -97,6 +162,16 @@ struct CodeBlock
   u32 recompile_count = 0;
   u32 invalidate_frame_number = 0;
 
+  /// Times the block has run in the cached interpreter while waiting to be recompiled, with tiered compilation.
+  /// Kept across recompiles, so hot code which modifies itself doesn't start from cold again.
+  u32 execution_count = 0;
+
+  /// Which way the conditional branch ending the block went while it was cold. Traces follow the usual direction
+  /// through it once the block, or a block leading into it, is recompiled.
+  u32 exit_branch_pc = 0;
+  u32 exit_branch_count = 0;
+  u32 exit_branch_taken_count = 0;
+
   u32 GetPC() const { return key.GetPC(); }
   u32 GetSizeInBytes() const { return static_cast<u32>(instructions.size()) * sizeof(Instruction); }
   u32 GetStartPageIndex() const { return (key.GetPCPhysicalAddress() / HOST_PAGE_SIZE); }
@@ -128,6 +203,34 @@ FastMapTable* GetFastMapPointer();
 void ExecuteRecompiler();
 #endif
 
+struct Statistics
+{
+  u64 block_lookups;           ///< Block table searches.
+  u64 block_lookup_probes;     ///< Table slots examined by those searches.
+  u64 block_compiles;          ///< Lookups which missed and created a new block.
+  u64 block_allocations;       ///< Allocations of blocks and their arrays.
+  u64 block_allocation_bytes;  ///< Bytes requested by those allocations.
+  u64 block_slab_allocations;  ///< Slabs taken from the system heap.
+  u64 block_large_allocations; ///< Allocations too large for a slab, served by the heap.
+  u64 idle_loop_skips;         ///< Times an idle loop fast-forwarded to the next event.
+  u64 idle_loop_skipped_ticks; ///< Emulated cycles which weren't executed because of that.
+  u64 recompiled_instructions; ///< Guest instructions compiled to host code.
+  u64 recompiled_host_bytes;   ///< Near host code generated for those instructions.
+  u64 tier_cold_blocks;        ///< Blocks which started out in the cached interpreter, with tiered compilation.
+  u64 tier_cold_executions;    ///< Executions of those blocks before they were recompiled.
+  u64 tier_promotions;         ///< Cold blocks which crossed the threshold and were recompiled.
+  u64 trace_extensions;        ///< Promoted blocks whose trace was extended through a profiled branch.
+  u64 trace_profiled_branches; ///< Conditional branches compiled into traces, each with a side exit.
+  u64 code_evictions;          ///< Times the oldest generation of the code buffer was reused.
+  u64 code_evicted_blocks;     ///< Blocks thrown away by those evictions.
+  u64 code_invalidations;      ///< Writes to code which invalidated blocks.
+  u64 invalidations_avoided;   ///< Writes to pages with code which didn't touch any of it.
+};
+
+/// Returns counters for the block table and slab allocator since the last reset.
+const Statistics& GetStatistics();
+void ResetStatistics();
+
 /// Flushes the code cache, forcing all blocks to be recompiled.
 void Flush();
 
@@ -137,24 +240,50 @@ void Reinitialize();
 /// Invalidates all blocks which are in the range of the specified code page.
 void InvalidateBlocksWithPageIndex(u32 page_index);
 
+/// Invalidates the blocks with code in a range of bytes, which must not cross a code page boundary.
+/// Memory state restores pass allow_frame_invalidation=false, so they don't count as self-modifying code.
+void InvalidateBlocksInPageRange(u32 page_index, u32 offset_in_page, u32 size, bool allow_frame_invalidation = true);
+
 /// Invalidates all blocks in the cache.
 void InvalidateAll();
 
+/// Begins loading the persistent block list for the running game on a background thread.
+void LoadPersistentCache(std::string filename);
+
+/// Writes the blocks seen this session, merged with the previously-loaded list, back to the persistent cache.
+void SavePersistentCache();
+
+/// Compiles a bounded number of blocks from the persistent cache which match the current contents of memory.
+void PrecompilePersistentBlocks();
+
+/// Returns true if a trace continues through the branch in only one direction, and has to leave when it goes the
+/// other way.
+bool IsConditionalTraceBranch(const CodeBlockInstruction& cbi);
+
+/// Builds the pre-decoded handlers used by InterpretCachedBlock, for the current PGXP mode.
+void CompileThreadedCode(CodeBlock* block);
+
 template<PGXPMode pgxp_mode>
 void InterpretCachedBlock(const CodeBlock& block);
 
 template<PGXPMode pgxp_mode>
 void InterpretUncachedBlock();
 
-/// Invalidates any code pages which overlap the specified range.
+/// Invalidates any blocks which overlap the specified range.
 ALWAYS_INLINE void InvalidateCodePages(PhysicalMemoryAddress address, u32 word_count)
 {
+  const u32 end_address = address + word_count * sizeof(u32);
   const u32 start_page = address / HOST_PAGE_SIZE;
-  const u32 end_page = (address + word_count * sizeof(u32) - sizeof(u32)) / HOST_PAGE_SIZE;
+  const u32 end_page = (end_address - sizeof(u32)) / HOST_PAGE_SIZE;
   for (u32 page = start_page; page <= end_page; page++)
   {
-    if (Bus::m_ram_code_bits[page])
-      CPU::CodeCache::InvalidateBlocksWithPageIndex(page);
+    if (!Bus::m_ram_code_bits[page])
+      continue;
+
+    const u32 page_start = page * HOST_PAGE_SIZE;
+    const u32 range_start = std::max(address, page_start);
+    const u32 range_end = std::min(end_address, page_start + static_cast<u32>(HOST_PAGE_SIZE));
+    CPU::CodeCache::InvalidateBlocksInPageRange(page, range_start - page_start, range_end - range_start);
   }
 }
 
@@ -18,11 +18,11 @@ static void UpdateLoadDelay();
 static void Branch(u32 target);
 static void FlushPipeline();
 
-State g_state;
-bool g_using_interpreter = false;
+CONSOLE_LOCAL State g_state;
+CONSOLE_LOCAL bool g_using_interpreter = false;
 
 static constexpr u32 INVALID_BREAKPOINT_PC = UINT32_C(0xFFFFFFFF);
-static u32 s_last_breakpoint_check_pc = INVALID_BREAKPOINT_PC;
+static CONSOLE_LOCAL u32 s_last_breakpoint_check_pc = INVALID_BREAKPOINT_PC;
 
 void Initialize(void)
 {
@@ -125,6 +125,8 @@ void UpdateFastmemBase()
     g_state.fastmem_base = nullptr;
   else
     g_state.fastmem_base = Bus::GetFastmemBase();
+
+  g_state.ram_write_pages = Bus::GetRAMWritePages();
 }
 
 ALWAYS_INLINE_RELEASE void SetPC(u32 new_pc)
@@ -1532,20 +1534,628 @@ void ExecuteDebug()
 
 namespace CodeCache {
 
+// Handlers for the cached interpreter's threaded code. These mirror the cases of ExecuteInstruction(), but take the
+// operands from the pre-decoded instruction. Anything uncommon goes through ThreadedFallback instead.
+
+static void ThreadedNop(const ThreadedInstruction& ti) {}
+
+template<PGXPMode pgxp_mode>
+static void ThreadedFallback(const ThreadedInstruction& ti)
+{
+  // current_instruction has already been set up by the dispatch loop
+  ExecuteInstruction<pgxp_mode, false>();
+}
+
+template<PGXPMode pgxp_mode, InstructionFunct funct>
+static void ThreadedALU(const ThreadedInstruction& ti)
+{
+  const u32 rs = ReadReg(ti.rs);
+  const u32 rt = ReadReg(ti.rt);
+  u32 new_value;
+
+  if constexpr (funct == InstructionFunct::sll)
+  {
+    new_value = rt << ti.shamt;
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_SLL(ti.bits, rt);
+  }
+  else if constexpr (funct == InstructionFunct::srl)
+  {
+    new_value = rt >> ti.shamt;
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_SRL(ti.bits, rt);
+  }
+  else if constexpr (funct == InstructionFunct::sra)
+  {
+    new_value = static_cast<u32>(static_cast<s32>(rt) >> ti.shamt);
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_SRA(ti.bits, rt);
+  }
+  else if constexpr (funct == InstructionFunct::sllv)
+  {
+    new_value = rt << (rs & UINT32_C(0x1F));
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_SLLV(ti.bits, rt, rs & UINT32_C(0x1F));
+  }
+  else if constexpr (funct == InstructionFunct::srlv)
+  {
+    new_value = rt >> (rs & UINT32_C(0x1F));
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_SRLV(ti.bits, rt, rs & UINT32_C(0x1F));
+  }
+  else if constexpr (funct == InstructionFunct::srav)
+  {
+    new_value = static_cast<u32>(static_cast<s32>(rt) >> (rs & UINT32_C(0x1F)));
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_SRAV(ti.bits, rt, rs & UINT32_C(0x1F));
+  }
+  else if constexpr (funct == InstructionFunct::and_)
+  {
+    new_value = rs & rt;
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_AND_(ti.bits, rs, rt);
+  }
+  else if constexpr (funct == InstructionFunct::or_)
+  {
+    new_value = rs | rt;
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_OR_(ti.bits, rs, rt);
+  }
+  else if constexpr (funct == InstructionFunct::xor_)
+  {
+    new_value = rs ^ rt;
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_XOR_(ti.bits, rs, rt);
+  }
+  else if constexpr (funct == InstructionFunct::nor)
+  {
+    new_value = ~(rs | rt);
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_NOR(ti.bits, rs, rt);
+  }
+  else if constexpr (funct == InstructionFunct::add || funct == InstructionFunct::addu)
+  {
+    new_value = rs + rt;
+    if constexpr (funct == InstructionFunct::add)
+    {
+      if (AddOverflow(rs, rt, new_value))
+      {
+        RaiseException(Exception::Ov);
+        return;
+      }
+    }
+
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_ADD(ti.bits, rs, rt);
+    else if constexpr (pgxp_mode >= PGXPMode::Memory)
+    {
+      if (rt == 0)
+        PGXP::CPU_MOVE((static_cast<u32>(ti.rd) << 8) | static_cast<u32>(ti.rs), rs);
+    }
+  }
+  else if constexpr (funct == InstructionFunct::sub || funct == InstructionFunct::subu)
+  {
+    new_value = rs - rt;
+    if constexpr (funct == InstructionFunct::sub)
+    {
+      if (SubOverflow(rs, rt, new_value))
+      {
+        RaiseException(Exception::Ov);
+        return;
+      }
+    }
+
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_SUB(ti.bits, rs, rt);
+  }
+  else if constexpr (funct == InstructionFunct::slt)
+  {
+    new_value = BoolToUInt32(static_cast<s32>(rs) < static_cast<s32>(rt));
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_SLT(ti.bits, rs, rt);
+  }
+  else if constexpr (funct == InstructionFunct::sltu)
+  {
+    new_value = BoolToUInt32(rs < rt);
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_SLTU(ti.bits, rs, rt);
+  }
+  else if constexpr (funct == InstructionFunct::mfhi)
+  {
+    new_value = g_state.regs.hi;
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_MFHI(ti.bits, new_value);
+  }
+  else if constexpr (funct == InstructionFunct::mflo)
+  {
+    new_value = g_state.regs.lo;
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_MFLO(ti.bits, new_value);
+  }
+  else
+  {
+    static_assert(funct == InstructionFunct::sll, "unhandled funct");
+  }
+
+  WriteReg(ti.rd, new_value);
+}
+
+template<PGXPMode pgxp_mode, InstructionFunct funct>
+static void ThreadedMultDiv(const ThreadedInstruction& ti)
+{
+  const u32 rs = ReadReg(ti.rs);
+  const u32 rt = ReadReg(ti.rt);
+
+  if constexpr (funct == InstructionFunct::mthi)
+  {
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_MTHI(ti.bits, rs);
+
+    g_state.regs.hi = rs;
+  }
+  else if constexpr (funct == InstructionFunct::mtlo)
+  {
+    if constexpr (pgxp_mode == PGXPMode::CPU)
+      PGXP::CPU_MTLO(ti.bits, rs);
+
+    g_state.regs.lo = rs;
+  }
+  else if constexpr (funct == InstructionFunct::mult)
+  {
+    const u64 result = static_cast<u64>(static_cast<s64>(SignExtend64(rs)) * static_cast<s64>(SignExtend64(rt)));
+    g_state.regs.hi = Truncate32(result >> 32);
+    g_state.regs.lo = Truncate32(result);
+
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_MULT(ti.bits, rs, rt);
+  }
+  else if constexpr (funct == InstructionFunct::multu)
+  {
+    const u64 result = ZeroExtend64(rs) * ZeroExtend64(rt);
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_MULTU(ti.bits, rs, rt);
+
+    g_state.regs.hi = Truncate32(result >> 32);
+    g_state.regs.lo = Truncate32(result);
+  }
+  else if constexpr (funct == InstructionFunct::div)
+  {
+    const s32 num = static_cast<s32>(rs);
+    const s32 denom = static_cast<s32>(rt);
+    if (denom == 0)
+    {
+      // divide by zero
+      g_state.regs.lo = (num >= 0) ? UINT32_C(0xFFFFFFFF) : UINT32_C(1);
+      g_state.regs.hi = static_cast<u32>(num);
+    }
+    else if (static_cast<u32>(num) == UINT32_C(0x80000000) && denom == -1)
+    {
+      // unrepresentable
+      g_state.regs.lo = UINT32_C(0x80000000);
+      g_state.regs.hi = 0;
+    }
+    else
+    {
+      g_state.regs.lo = static_cast<u32>(num / denom);
+      g_state.regs.hi = static_cast<u32>(num % denom);
+    }
+
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_DIV(ti.bits, num, denom);
+  }
+  else if constexpr (funct == InstructionFunct::divu)
+  {
+    if (rt == 0)
+    {
+      // divide by zero
+      g_state.regs.lo = UINT32_C(0xFFFFFFFF);
+      g_state.regs.hi = rs;
+    }
+    else
+    {
+      g_state.regs.lo = rs / rt;
+      g_state.regs.hi = rs % rt;
+    }
+
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_DIVU(ti.bits, rs, rt);
+  }
+  else
+  {
+    static_assert(funct == InstructionFunct::mthi, "unhandled funct");
+  }
+}
+
+template<PGXPMode pgxp_mode, InstructionOp op>
+static void ThreadedImmediate(const ThreadedInstruction& ti)
+{
+  const u32 rs = ReadReg(ti.rs);
+  u32 new_value;
+
+  if constexpr (op == InstructionOp::lui)
+  {
+    new_value = ti.imm;
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_LUI(ti.bits);
+  }
+  else if constexpr (op == InstructionOp::andi)
+  {
+    new_value = rs & ti.imm;
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_ANDI(ti.bits, rs);
+  }
+  else if constexpr (op == InstructionOp::ori)
+  {
+    new_value = rs | ti.imm;
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_ORI(ti.bits, rs);
+  }
+  else if constexpr (op == InstructionOp::xori)
+  {
+    new_value = rs ^ ti.imm;
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_XORI(ti.bits, rs);
+  }
+  else if constexpr (op == InstructionOp::addi || op == InstructionOp::addiu)
+  {
+    new_value = rs + ti.imm;
+    if constexpr (op == InstructionOp::addi)
+    {
+      if (AddOverflow(rs, ti.imm, new_value))
+      {
+        RaiseException(Exception::Ov);
+        return;
+      }
+    }
+
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_ADDI(ti.bits, rs);
+    else if constexpr (pgxp_mode >= PGXPMode::Memory)
+    {
+      if (ti.imm == 0)
+        PGXP::CPU_MOVE((static_cast<u32>(ti.rt) << 8) | static_cast<u32>(ti.rs), rs);
+    }
+  }
+  else if constexpr (op == InstructionOp::slti)
+  {
+    new_value = BoolToUInt32(static_cast<s32>(rs) < static_cast<s32>(ti.imm));
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_SLTI(ti.bits, rs);
+  }
+  else if constexpr (op == InstructionOp::sltiu)
+  {
+    new_value = BoolToUInt32(rs < ti.imm);
+    if constexpr (pgxp_mode >= PGXPMode::CPU)
+      PGXP::CPU_SLTIU(ti.bits, rs);
+  }
+  else
+  {
+    static_assert(op == InstructionOp::lui, "unhandled op");
+  }
+
+  WriteReg(ti.rt, new_value);
+}
+
+template<PGXPMode pgxp_mode, InstructionOp op>
+static void ThreadedLoad(const ThreadedInstruction& ti)
+{
+  const VirtualMemoryAddress addr = ReadReg(ti.rs) + ti.imm;
+  u32 value;
+
+  if constexpr (op == InstructionOp::lb || op == InstructionOp::lbu)
+  {
+    u8 byte_value;
+    if (!ReadMemoryByte(addr, &byte_value))
+      return;
+
+    value = (op == InstructionOp::lb) ? SignExtend32(byte_value) : ZeroExtend32(byte_value);
+    WriteRegDelayed(ti.rt, value);
+
+    if constexpr (pgxp_mode >= PGXPMode::Memory)
+      PGXP::CPU_LBx(ti.bits, value, addr);
+  }
+  else if constexpr (op == InstructionOp::lh || op == InstructionOp::lhu)
+  {
+    u16 halfword_value;
+    if (!ReadMemoryHalfWord(addr, &halfword_value))
+      return;
+
+    value = (op == InstructionOp::lh) ? SignExtend32(halfword_value) : ZeroExtend32(halfword_value);
+    WriteRegDelayed(ti.rt, value);
+
+    if constexpr (pgxp_mode >= PGXPMode::Memory)
+      PGXP::CPU_LHx(ti.bits, value, addr);
+  }
+  else if constexpr (op == InstructionOp::lw)
+  {
+    if (!ReadMemoryWord(addr, &value))
+      return;
+
+    WriteRegDelayed(ti.rt, value);
+
+    if constexpr (pgxp_mode >= PGXPMode::Memory)
+      PGXP::CPU_LW(ti.bits, value, addr);
+  }
+  else
+  {
+    static_assert(op == InstructionOp::lw, "unhandled op");
+  }
+}
+
+template<PGXPMode pgxp_mode, InstructionOp op>
+static void ThreadedStore(const ThreadedInstruction& ti)
+{
+  const VirtualMemoryAddress addr = ReadReg(ti.rs) + ti.imm;
+  const u32 value = ReadReg(ti.rt);
+
+  if constexpr (op == InstructionOp::sb)
+  {
+    WriteMemoryByte(addr, value);
+    if constexpr (pgxp_mode >= PGXPMode::Memory)
+      PGXP::CPU_SB(ti.bits, Truncate8(value), addr);
+  }
+  else if constexpr (op == InstructionOp::sh)
+  {
+    WriteMemoryHalfWord(addr, value);
+    if constexpr (pgxp_mode >= PGXPMode::Memory)
+      PGXP::CPU_SH(ti.bits, Truncate16(value), addr);
+  }
+  else if constexpr (op == InstructionOp::sw)
+  {
+    WriteMemoryWord(addr, value);
+    if constexpr (pgxp_mode >= PGXPMode::Memory)
+      PGXP::CPU_SW(ti.bits, value, addr);
+  }
+  else
+  {
+    static_assert(op == InstructionOp::sw, "unhandled op");
+  }
+}
+
+template<InstructionOp op>
+static void ThreadedBranch(const ThreadedInstruction& ti)
+{
+  g_state.next_instruction_is_branch_delay_slot = true;
+
+  if constexpr (op == InstructionOp::j || op == InstructionOp::jal)
+  {
+    if constexpr (op == InstructionOp::jal)
+      WriteReg(Reg::ra, g_state.regs.npc);
+
+    Branch((g_state.regs.pc & UINT32_C(0xF0000000)) | ti.imm);
+    return;
+  }
+  else
+  {
+    bool branch;
+    if constexpr (op == InstructionOp::beq)
+    {
+      branch = (ReadReg(ti.rs) == ReadReg(ti.rt));
+    }
+    else if constexpr (op == InstructionOp::bne)
+    {
+      branch = (ReadReg(ti.rs) != ReadReg(ti.rt));
+    }
+    else if constexpr (op == InstructionOp::bgtz)
+    {
+      branch = (static_cast<s32>(ReadReg(ti.rs)) > 0);
+    }
+    else if constexpr (op == InstructionOp::blez)
+    {
+      branch = (static_cast<s32>(ReadReg(ti.rs)) <= 0);
+    }
+    else if constexpr (op == InstructionOp::b)
+    {
+      // bgez is the inverse of bltz, so simply do ltz and xor the result
+      const u8 rt = static_cast<u8>(ti.rt);
+      const bool bgez = ConvertToBoolUnchecked(rt & u8(1));
+      branch = (static_cast<s32>(ReadReg(ti.rs)) < 0) ^ bgez;
+
+      // register is still linked even if the branch isn't taken
+      if ((rt & u8(0x1E)) == u8(0x10))
+        WriteReg(Reg::ra, g_state.regs.npc);
+    }
+    else
+    {
+      static_assert(op == InstructionOp::beq, "unhandled op");
+    }
+
+    if (branch)
+      Branch(g_state.regs.pc + ti.imm);
+  }
+}
+
+template<bool link>
+static void ThreadedJumpRegister(const ThreadedInstruction& ti)
+{
+  g_state.next_instruction_is_branch_delay_slot = true;
+  const u32 target = ReadReg(ti.rs);
+  if constexpr (link)
+    WriteReg(ti.rd, g_state.regs.npc);
+
+  Branch(target);
+}
+
+template<PGXPMode pgxp_mode>
+static ThreadedInstruction::Handler GetThreadedHandler(const Instruction inst, u32* imm)
+{
+  if (inst.bits == 0)
+    return &ThreadedNop;
+
+  // results written to $zero are thrown away, as long as nothing else can observe the instruction
+  const bool discarded = (pgxp_mode == PGXPMode::Disabled && inst.r.rd == Reg::zero);
+
+  switch (inst.op)
+  {
+    case InstructionOp::funct:
+    {
+#define ALU_HANDLER(funct)                                                                                             \
+  case InstructionFunct::funct:                                                                                        \
+    return discarded ? &ThreadedNop : &ThreadedALU<pgxp_mode, InstructionFunct::funct>;
+
+      switch (inst.r.funct)
+      {
+        ALU_HANDLER(sll)
+        ALU_HANDLER(srl)
+        ALU_HANDLER(sra)
+        ALU_HANDLER(sllv)
+        ALU_HANDLER(srlv)
+        ALU_HANDLER(srav)
+        ALU_HANDLER(and_)
+        ALU_HANDLER(or_)
+        ALU_HANDLER(xor_)
+        ALU_HANDLER(nor)
+        ALU_HANDLER(addu)
+        ALU_HANDLER(subu)
+        ALU_HANDLER(slt)
+        ALU_HANDLER(sltu)
+        ALU_HANDLER(mfhi)
+        ALU_HANDLER(mflo)
+
+#undef ALU_HANDLER
+
+        case InstructionFunct::add:
+          return &ThreadedALU<pgxp_mode, InstructionFunct::add>;
+        case InstructionFunct::sub:
+          return &ThreadedALU<pgxp_mode, InstructionFunct::sub>;
+        case InstructionFunct::mthi:
+          return &ThreadedMultDiv<pgxp_mode, InstructionFunct::mthi>;
+        case InstructionFunct::mtlo:
+          return &ThreadedMultDiv<pgxp_mode, InstructionFunct::mtlo>;
+        case InstructionFunct::mult:
+          return &ThreadedMultDiv<pgxp_mode, InstructionFunct::mult>;
+        case InstructionFunct::multu:
+          return &ThreadedMultDiv<pgxp_mode, InstructionFunct::multu>;
+        case InstructionFunct::div:
+          return &ThreadedMultDiv<pgxp_mode, InstructionFunct::div>;
+        case InstructionFunct::divu:
+          return &ThreadedMultDiv<pgxp_mode, InstructionFunct::divu>;
+        case InstructionFunct::jr:
+          return &ThreadedJumpRegister<false>;
+        case InstructionFunct::jalr:
+          return &ThreadedJumpRegister<true>;
+        default:
+          return &ThreadedFallback<pgxp_mode>;
+      }
+    }
+
+    case InstructionOp::lui:
+      *imm = inst.i.imm_zext32() << 16;
+      return &ThreadedImmediate<pgxp_mode, InstructionOp::lui>;
+
+#define IMMEDIATE_HANDLER(op, extend)                                                                                  \
+  case InstructionOp::op:                                                                                              \
+    *imm = inst.i.extend();                                                                                            \
+    return &ThreadedImmediate<pgxp_mode, InstructionOp::op>;
+
+      IMMEDIATE_HANDLER(andi, imm_zext32)
+      IMMEDIATE_HANDLER(ori, imm_zext32)
+      IMMEDIATE_HANDLER(xori, imm_zext32)
+      IMMEDIATE_HANDLER(addi, imm_sext32)
+      IMMEDIATE_HANDLER(addiu, imm_sext32)
+      IMMEDIATE_HANDLER(slti, imm_sext32)
+      IMMEDIATE_HANDLER(sltiu, imm_sext32)
+
+#undef IMMEDIATE_HANDLER
+
+#define MEMORY_HANDLER(op, handler)                                                                                    \
+  case InstructionOp::op:                                                                                              \
+    *imm = inst.i.imm_sext32();                                                                                        \
+    return &handler<pgxp_mode, InstructionOp::op>;
+
+      MEMORY_HANDLER(lb, ThreadedLoad)
+      MEMORY_HANDLER(lbu, ThreadedLoad)
+      MEMORY_HANDLER(lh, ThreadedLoad)
+      MEMORY_HANDLER(lhu, ThreadedLoad)
+      MEMORY_HANDLER(lw, ThreadedLoad)
+      MEMORY_HANDLER(sb, ThreadedStore)
+      MEMORY_HANDLER(sh, ThreadedStore)
+      MEMORY_HANDLER(sw, ThreadedStore)
+
+#undef MEMORY_HANDLER
+
+    case InstructionOp::j:
+      *imm = inst.j.target << 2;
+      return &ThreadedBranch<InstructionOp::j>;
+    case InstructionOp::jal:
+      *imm = inst.j.target << 2;
+      return &ThreadedBranch<InstructionOp::jal>;
+
+#define BRANCH_HANDLER(op)                                                                                             \
+  case InstructionOp::op:                                                                                              \
+    *imm = inst.i.imm_sext32() << 2;                                                                                   \
+    return &ThreadedBranch<InstructionOp::op>;
+
+      BRANCH_HANDLER(beq)
+      BRANCH_HANDLER(bne)
+      BRANCH_HANDLER(bgtz)
+      BRANCH_HANDLER(blez)
+      BRANCH_HANDLER(b)
+
+#undef BRANCH_HANDLER
+
+    default:
+      return &ThreadedFallback<pgxp_mode>;
+  }
+}
+
+void CompileThreadedCode(CodeBlock* block)
+{
+  const PGXPMode pgxp_mode = g_settings.GetPGXPMode();
+
+  block->threaded_code.clear();
+  block->threaded_code.reserve(block->instructions.size());
+  for (size_t i = 0; i < block->instructions.size(); i++)
+  {
+    const CodeBlockInstruction& cbi = block->instructions[i];
+    const Instruction inst = cbi.instruction;
+
+    ThreadedInstruction ti = {};
+    ti.bits = inst.bits;
+    ti.pc = cbi.pc;
+    ti.rs = inst.r.rs;
+    ti.rt = inst.r.rt;
+    ti.rd = inst.r.rd;
+    ti.shamt = static_cast<u8>(inst.r.shamt.GetValue());
+    ti.is_branch_delay_slot = cbi.is_branch_delay_slot;
+    ti.check_trace_pc = (i >= 2 && IsConditionalTraceBranch(block->instructions[i - 2]));
+
+    switch (pgxp_mode)
+    {
+      case PGXPMode::CPU:
+        ti.handler = GetThreadedHandler<PGXPMode::CPU>(inst, &ti.imm);
+        break;
+      case PGXPMode::Memory:
+        ti.handler = GetThreadedHandler<PGXPMode::Memory>(inst, &ti.imm);
+        break;
+      default:
+        ti.handler = GetThreadedHandler<PGXPMode::Disabled>(inst, &ti.imm);
+        break;
+    }
+
+    block->threaded_code.push_back(ti);
+  }
+}
+
 template<PGXPMode pgxp_mode>
 void InterpretCachedBlock(const CodeBlock& block)
 {
   // set up the state so we've already fetched the instruction
   g_state.regs.npc = block.GetPC() + 4;
 
-  for (const CodeBlockInstruction& cbi : block.instructions)
+  // the handlers were chosen for the PGXP mode when the block was compiled, changing it flushes the cache
+  for (const ThreadedInstruction& ti : block.threaded_code)
   {
+    // leave the trace if the branch went the other way, the pc is already set for the dispatcher
+    if (ti.check_trace_pc && g_state.regs.pc != ti.pc)
+      break;
+
     g_state.pending_ticks++;
 
     // now executing the instruction we previously fetched
-    g_state.current_instruction.bits = cbi.instruction.bits;
-    g_state.current_instruction_pc = cbi.pc;
-    g_state.current_instruction_in_branch_delay_slot = cbi.is_branch_delay_slot;
+    g_state.current_instruction.bits = ti.bits;
+    g_state.current_instruction_pc = ti.pc;
+    g_state.current_instruction_in_branch_delay_slot = ti.is_branch_delay_slot;
     g_state.current_instruction_was_branch_taken = g_state.branch_was_taken;
     g_state.branch_was_taken = false;
     g_state.exception_raised = false;
@@ -1555,7 +2165,7 @@ void InterpretCachedBlock(const CodeBlock& block)
     g_state.regs.npc += 4;
 
     // execute the instruction we previously fetched
-    ExecuteInstruction<pgxp_mode, false>();
+    ti.handler(ti);
 
     // next load delay
     UpdateLoadDelay();
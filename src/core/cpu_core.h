@@ -72,6 +72,9 @@ struct State
 
   u8* fastmem_base = nullptr;
 
+  // byte per RAM page, which fastmem stores set
+  u8* ram_write_pages = nullptr;
+
   // data cache (used as scratchpad)
   std::array<u8, DCACHE_SIZE> dcache = {};
   std::array<u32, ICACHE_LINES> icache_tags = {};
@@ -81,8 +84,8 @@ struct State
   static constexpr u32 GTERegisterOffset(u32 index) { return offsetof(State, gte_regs.r32) + (sizeof(u32) * index); }
 };
 
-extern State g_state;
-extern bool g_using_interpreter;
+extern CONSOLE_LOCAL State g_state;
+extern CONSOLE_LOCAL bool g_using_interpreter;
 
 void Initialize();
 void Shutdown();
@@ -27,6 +27,8 @@ bool CodeGenerator::CompileBlock(CodeBlock* block, CodeBlock::HostCodePointer* o
   m_fastmem_load_base_in_register = false;
   m_fastmem_store_base_in_register = false;
 
+  m_ir.Build(block);
+
   EmitBeginBlock(true);
   BlockPrologue();
 
@@ -62,13 +64,18 @@ bool CodeGenerator::CompileBlock(CodeBlock* block, CodeBlock::HostCodePointer* o
 
 bool CodeGenerator::CompileInstruction(const CodeBlockInstruction& cbi)
 {
-  if (IsNopInstruction(cbi.instruction))
+  const IR::Instruction& ir = GetIRInstruction(cbi);
+  if (ir.is_dead || IsNopInstruction(cbi.instruction))
   {
     InstructionPrologue(cbi, 1);
     InstructionEpilogue(cbi);
     return true;
   }
 
+  // values which were lost from the cache (e.g. flushed for a call) can still be folded
+  for (u32 i = 0; i < ir.constant_input_count; i++)
+    m_register_cache.AssumeGuestRegisterConstant(ir.constant_input_regs[i], ir.constant_input_values[i]);
+
   bool result;
   switch (cbi.instruction.op)
   {
@@ -931,7 +938,10 @@ void CodeGenerator::BlockPrologue()
 
   EmitStoreCPUStructField(offsetof(State, exception_raised), Value::FromConstantU8(0));
 
-  if (m_block->uncached_fetch_ticks > 0 || m_block->icache_line_count > 0)
+  // uncached fetches always cost the same, so they're merged with the block's cycle update
+  if (GetSegmentForAddress(m_pc) >= Segment::KSEG1)
+    m_delayed_cycles_add += m_block->uncached_fetch_ticks;
+  else if (m_block->icache_line_count > 0)
     EmitICacheCheckAndUpdate();
 
   // we don't know the state of the last block, so assume load delays might be in progress
@@ -943,7 +953,7 @@ void CodeGenerator::BlockPrologue()
   m_gte_busy_cycles_dirty = true;
 }
 
-void CodeGenerator::BlockEpilogue()
+void CodeGenerator::BlockEpilogue(bool add_pending_cycles /* = true */)
 {
 #if defined(_DEBUG) && defined(CPU_X64)
   m_emit->nop();
@@ -953,7 +963,8 @@ void CodeGenerator::BlockEpilogue()
   if (m_register_cache.HasLoadDelay())
     m_register_cache.WriteLoadDelayToCPU(true);
 
-  AddPendingCycles(true);
+  if (add_pending_cycles)
+    AddPendingCycles(true);
 }
 
 void CodeGenerator::InstructionPrologue(const CodeBlockInstruction& cbi, TickCount cycles,
@@ -1034,6 +1045,58 @@ void CodeGenerator::TruncateBlockAtCurrentInstruction()
   WriteNewPC(CalculatePC(), true);
 }
 
+void CodeGenerator::EmitTraceSideExit(u32 exit_pc)
+{
+  // leave the same way the end of a block does, the rest of the trace carries on with the register cache as it was
+  m_register_cache.PushState();
+
+  m_register_cache.FlushAllGuestRegisters(true, true);
+  if (m_register_cache.HasLoadDelay())
+    m_register_cache.WriteLoadDelayToCPU(true);
+
+  WriteNewPC(Value::FromConstantU32(exit_pc), false);
+
+  // the trace adds the cycles so far itself when it keeps going, so they aren't committed here
+  LabelType return_to_dispatcher;
+  {
+    Value pending_ticks = m_register_cache.AllocateScratch(RegSize_32);
+    Value downcount = m_register_cache.AllocateScratch(RegSize_32);
+    AddPendingCycles(false);
+    EmitLoadCPUStructField(pending_ticks.GetHostRegister(), RegSize_32, offsetof(State, pending_ticks));
+    EmitLoadCPUStructField(downcount.GetHostRegister(), RegSize_32, offsetof(State, downcount));
+    EmitConditionalBranch(Condition::GreaterEqual, false, pending_ticks.GetHostRegister(), downcount,
+                          &return_to_dispatcher);
+  }
+
+  if (g_settings.cpu_recompiler_block_linking)
+  {
+    m_register_cache.PushState();
+
+    EmitEndBlock(true, false);
+
+    const void* jump_pointer = GetCurrentCodePointer();
+    const void* resolve_pointer = GetCurrentFarCodePointer();
+    EmitBranch(resolve_pointer);
+    const u32 jump_size =
+      static_cast<u32>(static_cast<const char*>(GetCurrentCodePointer()) - static_cast<const char*>(jump_pointer));
+    SwitchToFarCode();
+
+    EmitBeginBlock(true);
+    EmitFunctionCall(nullptr, &CPU::Recompiler::Thunks::ResolveBranch, Value::FromConstantPtr(m_block),
+                     Value::FromConstantPtr(jump_pointer), Value::FromConstantPtr(resolve_pointer),
+                     Value::FromConstantU32(jump_size));
+    EmitEndBlock(true, true);
+
+    SwitchToNearCode();
+    m_register_cache.PopState();
+  }
+
+  EmitBindLabel(&return_to_dispatcher);
+  EmitEndBlock(true, true);
+
+  m_register_cache.PopState();
+}
+
 void CodeGenerator::AddPendingCycles(bool commit)
 {
   if (m_delayed_cycles_add == 0 && m_gte_done_cycle <= m_delayed_cycles_add)
@@ -1069,6 +1132,29 @@ void CodeGenerator::AddPendingCycles(bool commit)
   }
 }
 
+void CodeGenerator::AddPendingCyclesAndLoad(const Value& pending_ticks)
+{
+  // saves reading back pending_ticks after updating it in memory
+  EmitLoadCPUStructField(pending_ticks.GetHostRegister(), RegSize_32, offsetof(State, pending_ticks));
+
+  if (m_gte_done_cycle > m_delayed_cycles_add)
+  {
+    Value temp = m_register_cache.AllocateScratch(RegSize_32);
+    EmitAdd(temp.GetHostRegister(), pending_ticks.GetHostRegister(), Value::FromConstantU32(m_gte_done_cycle), false);
+    EmitStoreCPUStructField(offsetof(State, gte_completion_tick), temp);
+  }
+
+  if (m_delayed_cycles_add > 0)
+  {
+    EmitAdd(pending_ticks.GetHostRegister(), pending_ticks.GetHostRegister(),
+            Value::FromConstantU32(m_delayed_cycles_add), false);
+    EmitStoreCPUStructField(offsetof(State, pending_ticks), pending_ticks);
+  }
+
+  m_gte_done_cycle = std::max<TickCount>(m_gte_done_cycle - m_delayed_cycles_add, 0);
+  m_delayed_cycles_add = 0;
+}
+
 void CodeGenerator::AddGTETicks(TickCount ticks)
 {
   m_gte_done_cycle = m_delayed_cycles_add + ticks;
@@ -1439,7 +1525,10 @@ bool CodeGenerator::Compile_Load(const CodeBlockInstruction& cbi)
       break;
   }
 
-  m_register_cache.WriteGuestRegisterDelayed(cbi.instruction.i.rt, std::move(result));
+  if (GetIRInstruction(cbi).load_delay_resolved)
+    m_register_cache.WriteGuestRegister(cbi.instruction.i.rt, std::move(result));
+  else
+    m_register_cache.WriteGuestRegisterDelayed(cbi.instruction.i.rt, std::move(result));
   SpeculativeWriteReg(cbi.instruction.i.rt, value_spec);
 
   InstructionEpilogue(cbi);
@@ -1543,22 +1632,12 @@ bool CodeGenerator::Compile_Store(const CodeBlockInstruction& cbi)
 
   InstructionEpilogue(cbi);
 
-  if (address_spec)
+  // the IR treats this store as a barrier unless it knows the address misses the block, so nothing is stale after it
+  if (address_spec && IR::IsAddressInBlock(m_block, *address_spec))
   {
-    const CPU::Segment seg = GetSegmentForAddress(*address_spec);
-    if (seg == Segment::KUSEG || seg == Segment::KSEG0 || seg == Segment::KSEG1)
-    {
-      const PhysicalMemoryAddress phys_addr = VirtualAddressToPhysical(*address_spec);
-      const PhysicalMemoryAddress block_start = VirtualAddressToPhysical(m_block->GetPC());
-      const PhysicalMemoryAddress block_end = VirtualAddressToPhysical(
-        m_block->GetPC() + static_cast<u32>(m_block->instructions.size()) * sizeof(Instruction));
-      if (phys_addr >= block_start && phys_addr < block_end)
-      {
-        Log_WarningPrintf("Instruction %08X speculatively writes to %08X inside block %08X-%08X. Truncating block.",
-                          cbi.pc, phys_addr, block_start, block_end);
-        TruncateBlockAtCurrentInstruction();
-      }
-    }
+    Log_WarningPrintf("Instruction %08X speculatively writes to %08X inside block %08X. Truncating block.", cbi.pc,
+                      *address_spec, m_block->GetPC());
+    TruncateBlockAtCurrentInstruction();
   }
 
   return true;
@@ -2154,7 +2233,7 @@ bool CodeGenerator::Compile_Branch(const CodeBlockInstruction& cbi)
 
     // compute return address, which is also set as the new pc when the branch isn't taken
     Value next_pc = CalculatePC(4);
-    if (condition != Condition::Always)
+    if (condition != Condition::Always && !cbi.is_trace_branch)
     {
       next_pc = m_register_cache.AllocateScratch(RegSize_32);
       EmitCopyValue(next_pc.GetHostRegister(), CalculatePC(4));
@@ -2164,7 +2243,8 @@ bool CodeGenerator::Compile_Branch(const CodeBlockInstruction& cbi)
     LabelType branch_taken, branch_not_taken;
     if (condition != Condition::Always)
     {
-      if (!can_link_block)
+      // traces test the condition after the delay slot as well, to leave if it didn't go the usual way
+      if (!can_link_block && !cbi.is_trace_branch)
       {
         // condition is inverted because we want the case for skipping it
         if (lhs.IsValid() && rhs.IsValid())
@@ -2260,6 +2340,54 @@ bool CodeGenerator::Compile_Branch(const CodeBlockInstruction& cbi)
       m_register_cache.PopState();
     }
 
+    if (cbi.is_trace_branch && condition != Condition::Always)
+    {
+      // superblock, the way the branch usually went follows the delay slot, the other way is a side exit
+      const u32 target = (m_current_instruction + 2)->pc;
+      const bool trace_taken = (target == static_cast<u32>(branch_target.constant_value));
+      const u32 exit_pc = trace_taken ? (cbi.pc + 8) : static_cast<u32>(branch_target.constant_value);
+      InstructionEpilogue(cbi);
+
+      m_pc = target - 4;
+      m_pc_valid = true;
+      m_current_instruction++;
+      if (!CompileInstruction(*m_current_instruction))
+        return false;
+
+      LabelType stay_on_trace;
+      if (trace_taken)
+        EmitBranchIfBitSet(take_branch.GetHostRegister(), take_branch.size, 0, &stay_on_trace);
+      else
+        EmitBranchIfBitClear(take_branch.GetHostRegister(), take_branch.size, 0, &stay_on_trace);
+      take_branch.ReleaseAndClear();
+
+      EmitTraceSideExit(exit_pc);
+      EmitBindLabel(&stay_on_trace);
+
+      m_pc = target;
+      m_pc_valid = true;
+      return true;
+    }
+
+    if (cbi.is_trace_branch)
+    {
+      // superblock, the code at the target follows the delay slot, so keep going without exiting
+      const u32 target = static_cast<u32>(branch_target.constant_value);
+      WriteNewPC(branch_target, false);
+      InstructionEpilogue(cbi);
+
+      // the delay slot sees the target as the next pc
+      m_pc = target - 4;
+      m_pc_valid = true;
+      m_current_instruction++;
+      if (!CompileInstruction(*m_current_instruction))
+        return false;
+
+      m_pc = target;
+      m_pc_valid = true;
+      return true;
+    }
+
     if (can_link_block)
     {
       // if it's an in-block branch, compile the delay slot now
@@ -2270,24 +2398,35 @@ bool CodeGenerator::Compile_Branch(const CodeBlockInstruction& cbi)
         return false;
 
       // flush all regs since we're at the end of the block now
-      BlockEpilogue();
+      BlockEpilogue(false);
       m_block_linked = true;
 
-      // check downcount
+      // check downcount, adding the block's cycles on the way
       Value pending_ticks = m_register_cache.AllocateScratch(RegSize_32);
       Value downcount = m_register_cache.AllocateScratch(RegSize_32);
-      EmitLoadCPUStructField(pending_ticks.GetHostRegister(), RegSize_32, offsetof(State, pending_ticks));
+      AddPendingCyclesAndLoad(pending_ticks);
       EmitLoadCPUStructField(downcount.GetHostRegister(), RegSize_32, offsetof(State, downcount));
 
       // pending < downcount
       LabelType return_to_dispatcher;
 
+      // if it's waiting in an idle loop, nothing will change until the next event, so skip ahead to it
+      const bool is_idle_loop =
+        m_block->is_idle_loop && static_cast<u32>(branch_target.constant_value) == m_block->GetPC();
+      auto SkipIdleLoop = [this, &pending_ticks]() {
+        EmitFunctionCall(nullptr, &CPU::Recompiler::Thunks::SkipIdleLoop, Value::FromConstantPtr(m_block));
+        EmitLoadCPUStructField(pending_ticks.GetHostRegister(), RegSize_32, offsetof(State, pending_ticks));
+      };
+
       if (condition != Condition::Always)
       {
         EmitBranchIfBitClear(take_branch.GetHostRegister(), take_branch.size, 0, &branch_not_taken);
         m_register_cache.PushState();
         {
           WriteNewPC(branch_target, false);
+          if (is_idle_loop)
+            SkipIdleLoop();
+
           EmitConditionalBranch(Condition::GreaterEqual, false, pending_ticks.GetHostRegister(), downcount,
                                 &return_to_dispatcher);
 
@@ -2322,6 +2461,8 @@ bool CodeGenerator::Compile_Branch(const CodeBlockInstruction& cbi)
       else
       {
         WriteNewPC(branch_target, true);
+        if (is_idle_loop)
+          SkipIdleLoop();
       }
 
       EmitConditionalBranch(Condition::GreaterEqual, false, pending_ticks.GetHostRegister(), downcount,
@@ -2960,12 +3101,16 @@ bool CodeGenerator::Compile_cop2(const CodeBlockInstruction& cbi)
     TickCount func_ticks;
     GTE::InstructionImpl func = GTE::GetInstructionImpl(cbi.instruction.bits, &func_ticks);
 
-    // forward everything to the GTE.
     StallUntilGTEComplete();
     InstructionPrologue(cbi, 1);
 
-    Value instruction_bits = Value::FromConstantU32(cbi.instruction.bits & GTE::Instruction::REQUIRED_BITS_MASK);
-    EmitFunctionCall(nullptr, func, instruction_bits);
+    // simple commands can be done inline, otherwise forward everything to the GTE.
+    if (!EmitInlineGTECommand(cbi, !IsGTEFlagOverwrittenBeforeRead()))
+    {
+      Value instruction_bits = Value::FromConstantU32(cbi.instruction.bits & GTE::Instruction::REQUIRED_BITS_MASK);
+      EmitFunctionCall(nullptr, func, instruction_bits);
+    }
+
     AddGTETicks(func_ticks);
 
     InstructionEpilogue(cbi);
@@ -2973,6 +3118,56 @@ bool CodeGenerator::Compile_cop2(const CodeBlockInstruction& cbi)
   }
 }
 
+bool CodeGenerator::IsGTEFlagOverwrittenBeforeRead() const
+{
+  // any exception could end up in a handler which reads FLAG
+  if (g_settings.cpu_recompiler_memory_exceptions)
+    return false;
+
+  for (const CodeBlockInstruction* cbi = m_current_instruction + 1; cbi != m_block_end; cbi++)
+  {
+    // the trace may have left through a side exit, and the block it went to could read FLAG
+    if (GetIRInstruction(cbi[-1]).is_side_exit)
+      return false;
+
+    const Instruction inst = cbi->instruction;
+    switch (inst.op)
+    {
+      case InstructionOp::cop2:
+      {
+        // every command starts by clearing FLAG
+        if (!inst.cop.IsCommonInstruction())
+          return true;
+
+        if (static_cast<u32>(inst.r.rd.GetValue()) == 31 && inst.cop.CommonOp() == CopCommonInstruction::cfcn)
+          return false;
+        else if (static_cast<u32>(inst.r.rd.GetValue()) == 31 && inst.cop.CommonOp() == CopCommonInstruction::ctcn)
+          return true;
+      }
+      break;
+
+      // stores can truncate the block if they hit it, and cop0 can dispatch interrupts
+      case InstructionOp::sb:
+      case InstructionOp::sh:
+      case InstructionOp::sw:
+      case InstructionOp::swl:
+      case InstructionOp::swr:
+      case InstructionOp::cop0:
+        return false;
+
+      default:
+      {
+        if (cbi->can_trap)
+          return false;
+      }
+      break;
+    }
+  }
+
+  // might be read after the block
+  return false;
+}
+
 void CodeGenerator::InitSpeculativeRegs()
 {
   for (u8 i = 0; i < static_cast<u8>(Reg::count); i++)
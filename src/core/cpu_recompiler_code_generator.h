@@ -7,6 +7,7 @@
 #include "common/jit_code_buffer.h"
 
 #include "cpu_code_cache.h"
+#include "cpu_recompiler_ir.h"
 #include "cpu_recompiler_register_cache.h"
 #include "cpu_recompiler_thunks.h"
 #include "cpu_recompiler_types.h"
@@ -74,6 +75,7 @@ public:
   void EmitCancelInterpreterLoadDelayForReg(Reg reg);
   void EmitICacheCheckAndUpdate();
   void EmitStallUntilGTEComplete();
+  bool EmitInlineGTECommand(const CodeBlockInstruction& cbi, bool update_flag);
   void EmitLoadCPUStructField(HostReg host_reg, RegSize size, u32 offset);
   void EmitStoreCPUStructField(u32 offset, const Value& value);
   void EmitAddCPUStructField(u32 offset, const Value& value);
@@ -199,11 +201,13 @@ private:
   //////////////////////////////////////////////////////////////////////////
   // branch target, memory address, etc
   void BlockPrologue();
-  void BlockEpilogue();
+  void BlockEpilogue(bool add_pending_cycles = true);
   void InstructionPrologue(const CodeBlockInstruction& cbi, TickCount cycles, bool force_sync = false);
   void InstructionEpilogue(const CodeBlockInstruction& cbi);
   void TruncateBlockAtCurrentInstruction();
+  void EmitTraceSideExit(u32 exit_pc);
   void AddPendingCycles(bool commit);
+  void AddPendingCyclesAndLoad(const Value& pending_ticks);
   void AddGTETicks(TickCount ticks);
   void StallUntilGTEComplete();
 
@@ -213,10 +217,16 @@ private:
 
   Value DoGTERegisterRead(u32 index);
   void DoGTERegisterWrite(u32 index, const Value& value);
+  bool IsGTEFlagOverwrittenBeforeRead() const;
 
   //////////////////////////////////////////////////////////////////////////
   // Instruction Code Generators
   //////////////////////////////////////////////////////////////////////////
+  const IR::Instruction& GetIRInstruction(const CodeBlockInstruction& cbi) const
+  {
+    return m_ir.GetInstruction(static_cast<u32>(&cbi - m_block_start));
+  }
+
   bool CompileInstruction(const CodeBlockInstruction& cbi);
   bool Compile_Fallback(const CodeBlockInstruction& cbi);
   bool Compile_Nop(const CodeBlockInstruction& cbi);
@@ -243,6 +253,7 @@ private:
   const CodeBlockInstruction* m_block_start = nullptr;
   const CodeBlockInstruction* m_block_end = nullptr;
   const CodeBlockInstruction* m_current_instruction = nullptr;
+  IR::Block m_ir;
   RegisterCache m_register_cache;
   CodeEmitter m_near_emitter;
   CodeEmitter m_far_emitter;
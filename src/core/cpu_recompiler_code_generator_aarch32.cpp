@@ -23,7 +23,7 @@ constexpr u32 FUNCTION_STACK_SIZE =
   FUNCTION_CALLEE_SAVED_SPACE_RESERVE + FUNCTION_CALLER_SAVED_SPACE_RESERVE + FUNCTION_CALL_SHADOW_SPACE;
 
 // PC we return to after the end of the block
-static void* s_dispatcher_return_address;
+static CONSOLE_LOCAL void* s_dispatcher_return_address;
 
 static s32 GetPCDisplacement(const void* current, const void* target)
 {
@@ -1672,6 +1672,11 @@ void CodeGenerator::EmitStallUntilGTEComplete()
   m_emit->str(GetHostReg32(RARG1), a32::MemOperand(GetCPUPtrReg(), offsetof(State, pending_ticks)));
 }
 
+bool CodeGenerator::EmitInlineGTECommand(const CodeBlockInstruction& cbi, bool update_flag)
+{
+  return false;
+}
+
 void CodeGenerator::EmitBranch(const void* address, bool allow_scratch)
 {
   const s32 displacement = GetPCDisplacement(GetCurrentCodePointer(), address);
@@ -1951,11 +1956,10 @@ CodeCache::DispatcherFunction CodeGenerator::CompileDispatcher()
   m_emit->Bind(&no_interrupt);
 
   // TimingEvents::UpdateCPUDowncount:
-  // r0 <- head event->downcount
+  // r0 <- next event downcount
   // downcount <- r0
-  EmitLoadGlobalAddress(0, TimingEvents::GetHeadEventPtr());
+  EmitLoadGlobalAddress(0, TimingEvents::GetNextEventDowncountPtr());
   m_emit->ldr(a32::r0, a32::MemOperand(a32::r0));
-  m_emit->ldr(a32::r0, a32::MemOperand(a32::r0, offsetof(TimingEvent, m_downcount)));
   m_emit->str(a32::r0, a32::MemOperand(GetHostReg32(RCPUPTR), offsetof(State, downcount)));
 
   // main dispatch loop
@@ -1991,9 +1995,8 @@ CodeCache::DispatcherFunction CodeGenerator::CompileDispatcher()
 
   // check events then for frame done
   m_emit->ldr(a32::r0, a32::MemOperand(GetHostReg32(RCPUPTR), offsetof(State, pending_ticks)));
-  EmitLoadGlobalAddress(1, TimingEvents::GetHeadEventPtr());
+  EmitLoadGlobalAddress(1, TimingEvents::GetNextEventDowncountPtr());
   m_emit->ldr(a32::r1, a32::MemOperand(a32::r1));
-  m_emit->ldr(a32::r1, a32::MemOperand(a32::r1, offsetof(TimingEvent, m_downcount)));
   m_emit->cmp(a32::r0, a32::r1);
   m_emit->b(a32::lt, &frame_done_loop);
   EmitCall(reinterpret_cast<const void*>(&TimingEvents::RunEvents));
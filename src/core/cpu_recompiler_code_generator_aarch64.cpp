@@ -24,7 +24,7 @@ constexpr u64 FUNCTION_STACK_SIZE =
   FUNCTION_CALLEE_SAVED_SPACE_RESERVE + FUNCTION_CALLER_SAVED_SPACE_RESERVE + FUNCTION_CALL_SHADOW_SPACE;
 
 // PC we return to after the end of the block
-static void* s_dispatcher_return_address;
+static CONSOLE_LOCAL void* s_dispatcher_return_address;
 
 static s64 GetPCDisplacement(const void* current, const void* target)
 {
@@ -1844,6 +1844,11 @@ void CodeGenerator::EmitStallUntilGTEComplete()
   m_emit->str(GetHostReg32(RARG1), a64::MemOperand(GetCPUPtrReg(), offsetof(State, pending_ticks)));
 }
 
+bool CodeGenerator::EmitInlineGTECommand(const CodeBlockInstruction& cbi, bool update_flag)
+{
+  return false;
+}
+
 void CodeGenerator::EmitBranch(const void* address, bool allow_scratch)
 {
   const s64 jump_distance =
@@ -2138,11 +2143,10 @@ CodeCache::DispatcherFunction CodeGenerator::CompileDispatcher()
   m_emit->Bind(&no_interrupt);
 
   // TimingEvents::UpdateCPUDowncount:
-  // x8 <- head event->downcount
-  // downcount <- x8
-  EmitLoadGlobalAddress(8, TimingEvents::GetHeadEventPtr());
-  m_emit->ldr(a64::x8, a64::MemOperand(a64::x8));
-  m_emit->ldr(a64::w8, a64::MemOperand(a64::x8, offsetof(TimingEvent, m_downcount)));
+  // w8 <- next event downcount
+  // downcount <- w8
+  EmitLoadGlobalAddress(8, TimingEvents::GetNextEventDowncountPtr());
+  m_emit->ldr(a64::w8, a64::MemOperand(a64::x8));
   m_emit->str(a64::w8, a64::MemOperand(GetHostReg64(RCPUPTR), offsetof(State, downcount)));
 
   // main dispatch loop
@@ -2179,9 +2183,8 @@ CodeCache::DispatcherFunction CodeGenerator::CompileDispatcher()
 
   // check events then for frame done
   m_emit->ldr(a64::w8, a64::MemOperand(GetHostReg64(RCPUPTR), offsetof(State, pending_ticks)));
-  EmitLoadGlobalAddress(9, TimingEvents::GetHeadEventPtr());
-  m_emit->ldr(a64::x9, a64::MemOperand(a64::x9));
-  m_emit->ldr(a64::w9, a64::MemOperand(a64::x9, offsetof(TimingEvent, m_downcount)));
+  EmitLoadGlobalAddress(9, TimingEvents::GetNextEventDowncountPtr());
+  m_emit->ldr(a64::w9, a64::MemOperand(a64::x9));
   m_emit->cmp(a64::w8, a64::w9);
   m_emit->b(&frame_done_loop, a64::lt);
   EmitCall(reinterpret_cast<const void*>(&TimingEvents::RunEvents));
@@ -3,6 +3,7 @@
 #include "cpu_core_private.h"
 #include "cpu_recompiler_code_generator.h"
 #include "cpu_recompiler_thunks.h"
+#include "gte.h"
 #include "settings.h"
 #include "timing_event.h"
 
@@ -2151,6 +2152,24 @@ void CodeGenerator::EmitStoreGuestMemoryFastmem(const CodeBlockInstruction& cbi,
     }
   }
 
+  // Mark the page as written for memory states. This is part of the backpatched code, because the store only gets
+  // here if it hit RAM, and the slowmem path marks the page itself.
+  if (Bus::IsRAMWriteTrackingEnabled())
+  {
+    m_emit->mov(GetHostReg64(RARG2), m_emit->qword[GetCPUPtrReg() + offsetof(State, ram_write_pages)]);
+    if (address.IsConstant())
+    {
+      m_emit->mov(m_emit->byte[GetHostReg64(RARG2) + ((address.constant_value & Bus::RAM_8MB_MASK) >> 12)], 1);
+    }
+    else
+    {
+      m_emit->mov(GetHostReg32(RARG1), GetHostReg32(address.host_reg));
+      m_emit->and_(GetHostReg32(RARG1), Bus::RAM_8MB_MASK);
+      m_emit->shr(GetHostReg32(RARG1), 12);
+      m_emit->mov(m_emit->byte[GetHostReg64(RARG2) + GetHostReg64(RARG1)], 1);
+    }
+  }
+
   // insert nops, we need at least 5 bytes for a relative jump
   const u32 fastmem_size =
     static_cast<u32>(static_cast<u8*>(GetCurrentNearCodePointer()) - static_cast<u8*>(bpi.host_pc));
@@ -2486,23 +2505,21 @@ void CodeGenerator::EmitFlushInterpreterLoadDelay()
   auto load_delay_value = m_emit->dword[GetCPUPtrReg() + offsetof(State, load_delay_value)];
   auto reg_ptr = m_emit->dword[GetCPUPtrReg() + offsetof(State, regs.r[0]) + GetHostReg64(reg.host_reg) * 4];
 
-  Xbyak::Label skip_flush;
-
-  // reg = load_delay_reg
-  m_emit->movzx(GetHostReg32(reg.host_reg), load_delay_reg);
-
-  // if load_delay_reg == Reg::count goto skip_flush
-  m_emit->cmp(GetHostReg32(reg.host_reg), static_cast<u8>(Reg::count));
-  m_emit->je(skip_flush);
+  // if load_delay_reg != Reg::count goto flush. it's rare for a block to leave a load in flight, so keep it out of line
+  m_emit->cmp(load_delay_reg, static_cast<u8>(Reg::count));
+  m_emit->jne(GetCurrentFarCodePointer());
+  SwitchToFarCode();
 
   // r[reg] = load_delay_value
+  m_emit->movzx(GetHostReg32(reg.host_reg), load_delay_reg);
   m_emit->mov(GetHostReg32(value), load_delay_value);
   m_emit->mov(reg_ptr, GetHostReg32(value));
 
   // load_delay_reg = Reg::count
   m_emit->mov(load_delay_reg, static_cast<u8>(Reg::count));
 
-  m_emit->L(skip_flush);
+  m_emit->jmp(GetCurrentNearCodePointer());
+  SwitchToNearCode();
 }
 
 void CodeGenerator::EmitMoveNextInterpreterLoadDelay()
@@ -2587,6 +2604,401 @@ void CodeGenerator::EmitStallUntilGTEComplete()
   m_emit->mov(m_emit->dword[GetCPUPtrReg() + offsetof(State, pending_ticks)], GetHostReg32(RRETURN));
 }
 
+bool CodeGenerator::EmitInlineGTECommand(const CodeBlockInstruction& cbi, bool update_flag)
+{
+  // The projection and fixed-point commands are done inline, the lighting and colour ones go through the interpreter.
+  // 64-bit intermediates are needed to get the MAC overflow flags exact.
+  const GTE::Instruction inst{cbi.instruction.bits & GTE::Instruction::REQUIRED_BITS_MASK};
+  const u32 command = inst.command;
+  if (command != 0x01 && command != 0x06 && command != 0x12 && command != 0x28 && command != 0x2D &&
+      command != 0x2E && command != 0x30)
+  {
+    return false;
+  }
+  if (command == 0x06 && g_settings.gpu_pgxp_enable)
+    return false;
+
+  // PGXP and the widescreen hack both change what RTPS/RTPT do
+  if ((command == 0x01 || command == 0x30) && (g_settings.gpu_pgxp_enable || g_settings.gpu_widescreen_hack))
+    return false;
+
+  // the garbage matrix and the FC translation vector have hardware bugs, leave those to the interpreter
+  if (command == 0x12 && (inst.mvmva_multiply_matrix == 3 || inst.mvmva_translation_vector == 2))
+    return false;
+
+  const Xbyak::Reg64 cpu = GetCPUPtrReg();
+  const Xbyak::Reg64 acc = GetHostReg64(RRETURN);
+  const Xbyak::Reg64 temp1 = GetHostReg64(RARG1);
+  const Xbyak::Reg64 temp2 = GetHostReg64(RARG2);
+  const Xbyak::Reg32 flag = GetHostReg32(RARG3);
+  auto reg_ptr = [&cpu](u32 index, u32 byte_offset = 0) {
+    return cpu + (State::GTERegisterOffset(index) + byte_offset);
+  };
+
+  if (update_flag)
+    m_emit->xor_(flag, flag);
+
+  // flags for a MAC0 result outside of s32
+  auto check_mac0 = [&](const Xbyak::Reg64& value, const Xbyak::Reg64& scratch) {
+    if (!update_flag)
+      return;
+
+    Xbyak::Label underflow, in_range;
+    m_emit->movsxd(scratch, value.cvt32());
+    m_emit->cmp(scratch, value);
+    m_emit->je(in_range);
+    m_emit->test(value, value);
+    m_emit->js(underflow);
+    m_emit->or_(flag, (UINT32_C(1) << 31) | (UINT32_C(1) << 16));
+    m_emit->jmp(in_range);
+    m_emit->L(underflow);
+    m_emit->or_(flag, (UINT32_C(1) << 31) | (UINT32_C(1) << 15));
+    m_emit->L(in_range);
+  };
+
+  // MAC0 = acc
+  auto set_mac0 = [&]() {
+    m_emit->mov(m_emit->dword[reg_ptr(24)], acc.cvt32());
+    check_mac0(acc, temp1);
+  };
+
+  // MAC1-3 are 44-bit accumulators, which are checked and sign-extended after each addition like the hardware
+  auto check_mac = [&](u32 i, bool sign_extend) {
+    if (update_flag)
+    {
+      Xbyak::Label in_range;
+      m_emit->mov(temp1, acc);
+      m_emit->sar(temp1, 43);
+      m_emit->inc(temp1);
+      m_emit->cmp(temp1, 1);
+      m_emit->jbe(in_range);
+      m_emit->mov(temp1.cvt32(), (UINT32_C(1) << 31) | (UINT32_C(1) << (30 - i)));
+      m_emit->mov(temp2.cvt32(), (UINT32_C(1) << 31) | (UINT32_C(1) << (27 - i)));
+      m_emit->test(acc, acc);
+      m_emit->cmovs(temp1.cvt32(), temp2.cvt32());
+      m_emit->or_(flag, temp1.cvt32());
+      m_emit->L(in_range);
+    }
+
+    if (sign_extend)
+    {
+      m_emit->shl(acc, 20);
+      m_emit->sar(acc, 20);
+    }
+  };
+
+  // value = clamp(value, min_value, max_value), flag_bits are set when it saturates
+  auto saturate = [&](const Xbyak::Reg32& value, s32 min_value, s32 max_value, u32 flag_bits) {
+    Xbyak::Label not_above, saturated, in_range;
+    m_emit->cmp(value, max_value);
+    m_emit->jle(not_above);
+    m_emit->mov(value, max_value);
+    m_emit->jmp(saturated);
+    m_emit->L(not_above);
+    m_emit->cmp(value, min_value);
+    m_emit->jge(in_range);
+    m_emit->mov(value, min_value);
+    m_emit->L(saturated);
+    if (update_flag && flag_bits != 0)
+      m_emit->or_(flag, flag_bits);
+    m_emit->L(in_range);
+  };
+
+  // IR3 saturation doesn't count as an error
+  auto ir_flag_bits = [](u32 i) {
+    return (i == 2) ? (UINT32_C(1) << 22) : ((UINT32_C(1) << 31) | (UINT32_C(1) << (24 - i)));
+  };
+
+  switch (command)
+  {
+    case 0x06: // NCLIP
+    {
+      // MAC0 = SX0*SY1 + SX1*SY2 + SX2*SY0 - SX0*SY2 - SX1*SY0 - SX2*SY1
+      static constexpr u8 terms[6][3] = {{0, 1, 0}, {1, 2, 0}, {2, 0, 0}, {0, 2, 1}, {1, 0, 1}, {2, 1, 1}};
+      for (u32 i = 0; i < 6; i++)
+      {
+        m_emit->movsx(temp1, m_emit->word[reg_ptr(12 + terms[i][0], 0)]);
+        m_emit->movsx(temp2, m_emit->word[reg_ptr(12 + terms[i][1], sizeof(s16))]);
+        m_emit->imul(temp1, temp2);
+        if (i == 0)
+          m_emit->mov(acc, temp1);
+        else if (terms[i][2])
+          m_emit->sub(acc, temp1);
+        else
+          m_emit->add(acc, temp1);
+      }
+
+      set_mac0();
+    }
+    break;
+
+    case 0x2D: // AVSZ3
+    case 0x2E: // AVSZ4
+    {
+      const bool avsz4 = (command == 0x2E);
+      m_emit->movzx(acc.cvt32(), m_emit->word[reg_ptr(17)]);
+      for (u32 i = 18; i <= 19; i++)
+      {
+        m_emit->movzx(temp1.cvt32(), m_emit->word[reg_ptr(i)]);
+        m_emit->add(acc.cvt32(), temp1.cvt32());
+      }
+      if (avsz4)
+      {
+        m_emit->movzx(temp1.cvt32(), m_emit->word[reg_ptr(16)]);
+        m_emit->add(acc.cvt32(), temp1.cvt32());
+      }
+
+      m_emit->movsx(temp1, m_emit->word[reg_ptr(avsz4 ? 62 : 61)]);
+      m_emit->imul(acc, temp1);
+      set_mac0();
+
+      // OTZ = clamp(MAC0 >> 12, 0, 0xFFFF), the unsigned compare catches both directions
+      Xbyak::Label otz_in_range;
+      m_emit->mov(temp2, acc);
+      m_emit->sar(temp2, 12);
+      m_emit->cmp(temp2, 0xFFFF);
+      m_emit->jbe(otz_in_range);
+      if (update_flag)
+        m_emit->or_(flag, (UINT32_C(1) << 31) | (UINT32_C(1) << 18));
+      m_emit->mov(temp1.cvt32(), 0xFFFF);
+      m_emit->test(temp2, temp2);
+      m_emit->mov(temp2.cvt32(), 0);
+      m_emit->cmovns(temp2.cvt32(), temp1.cvt32());
+      m_emit->L(otz_in_range);
+      m_emit->mov(m_emit->dword[reg_ptr(7)], temp2.cvt32());
+    }
+    break;
+
+    case 0x12: // MVMVA
+    {
+      // RT, LLM, LCM and V0, V1, V2 are packed s16 arrays, IR1-3 are sign-extended to a register each
+      static constexpr u32 matrix_regs[3] = {32, 40, 48};
+      static constexpr u32 translation_regs[2] = {37, 45};
+      const u32 matrix_reg = matrix_regs[inst.mvmva_multiply_matrix];
+      const u32 vector = inst.mvmva_multiply_vector;
+      const bool has_translation = (inst.mvmva_translation_vector != 3);
+      auto vector_ptr = [&](u32 j) {
+        return (vector == 3) ? reg_ptr(9 + j) : reg_ptr(vector * 2, j * sizeof(s16));
+      };
+
+      // the vector can be IR1-3, so all of MAC1-3 are done before any IR is written
+      for (u32 i = 0; i < 3; i++)
+      {
+        if (has_translation)
+        {
+          m_emit->movsxd(acc, m_emit->dword[reg_ptr(translation_regs[inst.mvmva_translation_vector] + i)]);
+          m_emit->shl(acc, 12);
+        }
+
+        for (u32 j = 0; j < 3; j++)
+        {
+          m_emit->movsx(temp1, m_emit->word[reg_ptr(matrix_reg, (i * 3 + j) * sizeof(s16))]);
+          m_emit->movsx(temp2, m_emit->word[vector_ptr(j)]);
+          m_emit->imul(temp1, temp2);
+          if (j == 0 && !has_translation)
+            m_emit->mov(acc, temp1);
+          else
+            m_emit->add(acc, temp1);
+
+          // without the translation, the first product can't overflow
+          if (j > 0 || has_translation)
+            check_mac(i, j < 2);
+        }
+
+        if (inst.sf)
+          m_emit->sar(acc, 12);
+        m_emit->mov(m_emit->dword[reg_ptr(25 + i)], acc.cvt32());
+      }
+
+      // IR = clamp(MAC, lm ? 0 : -0x8000, 0x7FFF)
+      for (u32 i = 0; i < 3; i++)
+      {
+        m_emit->mov(acc.cvt32(), m_emit->dword[reg_ptr(25 + i)]);
+        saturate(acc.cvt32(), inst.lm ? 0 : -0x8000, 0x7FFF, ir_flag_bits(i));
+        m_emit->mov(m_emit->dword[reg_ptr(9 + i)], acc.cvt32());
+      }
+    }
+    break;
+
+    case 0x01: // RTPS
+    case 0x30: // RTPT
+    {
+      // the divider needs cl for its shift counts, rcx is RARG1 or RARG4 depending on the ABI
+      const Xbyak::Reg64 temp3 = GetHostReg64(RARG4);
+      const Xbyak::Reg64 shift_count = m_emit->rcx;
+      const Xbyak::Reg64 table = (temp1.getIdx() == shift_count.getIdx()) ? temp3 : temp1;
+
+      const u32 num_vertices = (command == 0x30) ? 3 : 1;
+      for (u32 v = 0; v < num_vertices; v++)
+      {
+        // MAC1-3 = (TR * 1000h + RT * V) SAR (sf * 12)
+        for (u32 i = 0; i < 3; i++)
+        {
+          m_emit->movsxd(acc, m_emit->dword[reg_ptr(37 + i)]);
+          m_emit->shl(acc, 12);
+          for (u32 j = 0; j < 3; j++)
+          {
+            m_emit->movsx(temp1, m_emit->word[reg_ptr(32, (i * 3 + j) * sizeof(s16))]);
+            m_emit->movsx(temp2, m_emit->word[reg_ptr(v * 2, j * sizeof(s16))]);
+            m_emit->imul(temp1, temp2);
+            m_emit->add(acc, temp1);
+            check_mac(i, j < 2);
+          }
+
+          // SZ3 and the IR3 flag come from MAC3 SAR 12 whatever sf is
+          if (i == 2)
+          {
+            m_emit->mov(temp3, acc);
+            m_emit->sar(temp3, 12);
+          }
+
+          if (inst.sf)
+            m_emit->sar(acc, 12);
+          m_emit->mov(m_emit->dword[reg_ptr(25 + i)], acc.cvt32());
+        }
+
+        // IR3 saturates like the others, but its flag is for MAC3 SAR 12 against -8000h..7FFFh, ignoring lm
+        for (u32 i = 0; i < 3; i++)
+        {
+          m_emit->mov(acc.cvt32(), m_emit->dword[reg_ptr(25 + i)]);
+          saturate(acc.cvt32(), inst.lm ? 0 : -0x8000, 0x7FFF, (i == 2) ? 0 : ir_flag_bits(i));
+          m_emit->mov(m_emit->dword[reg_ptr(9 + i)], acc.cvt32());
+        }
+        if (update_flag)
+        {
+          Xbyak::Label ir3_in_range;
+          m_emit->lea(temp1.cvt32(), m_emit->ptr[temp3 + 0x8000]);
+          m_emit->cmp(temp1.cvt32(), 0xFFFF);
+          m_emit->jbe(ir3_in_range);
+          m_emit->or_(flag, ir_flag_bits(2));
+          m_emit->L(ir3_in_range);
+        }
+
+        // push clamp(MAC3 SAR 12, 0, 0xFFFF) onto the SZ FIFO
+        saturate(temp3.cvt32(), 0, 0xFFFF, (UINT32_C(1) << 31) | (UINT32_C(1) << 18));
+        for (u32 i = 16; i < 19; i++)
+        {
+          m_emit->mov(temp1.cvt32(), m_emit->dword[reg_ptr(i + 1)]);
+          m_emit->mov(m_emit->dword[reg_ptr(i)], temp1.cvt32());
+        }
+        m_emit->mov(m_emit->dword[reg_ptr(19)], temp3.cvt32());
+
+        // acc = H * 20000h / SZ3 through the UNR reciprocal, exactly as UNRDivide() in the interpreter
+        Xbyak::Label divide, divided;
+        m_emit->movzx(acc.cvt32(), m_emit->word[reg_ptr(58)]);
+        m_emit->mov(temp2.cvt32(), temp3.cvt32());
+        m_emit->add(temp3.cvt32(), temp3.cvt32());
+        m_emit->cmp(temp3.cvt32(), acc.cvt32());
+        m_emit->ja(divide);
+        if (update_flag)
+          m_emit->or_(flag, (UINT32_C(1) << 31) | (UINT32_C(1) << 17));
+        m_emit->mov(acc.cvt32(), 0x1FFFF);
+        m_emit->jmp(divided);
+
+        // SZ3 isn't zero here, shift both sides until bit 15 of it is set
+        m_emit->L(divide);
+        m_emit->bsr(shift_count.cvt32(), temp2.cvt32());
+        m_emit->xor_(shift_count.cvt32(), 15);
+        m_emit->shl(acc.cvt32(), shift_count.cvt8());
+        m_emit->shl(temp2.cvt32(), shift_count.cvt8());
+
+        // x = 0x101 + table[((divisor & 0x7FFF) + 0x40) >> 7]
+        m_emit->mov(shift_count.cvt32(), temp2.cvt32());
+        m_emit->and_(shift_count.cvt32(), 0x7FFF);
+        m_emit->add(shift_count.cvt32(), 0x40);
+        m_emit->shr(shift_count.cvt32(), 7);
+        m_emit->mov(table, reinterpret_cast<size_t>(GTE::g_unr_table));
+        m_emit->movzx(shift_count.cvt32(), m_emit->byte[table + shift_count]);
+        m_emit->add(shift_count.cvt32(), 0x101);
+
+        // d = ((divisor * -x) + 0x80) >> 8, reciprocal = ((x * (0x20000 + d)) + 0x80) >> 8
+        m_emit->mov(table.cvt32(), shift_count.cvt32());
+        m_emit->neg(table.cvt32());
+        m_emit->imul(table.cvt32(), temp2.cvt32());
+        m_emit->add(table.cvt32(), 0x80);
+        m_emit->sar(table.cvt32(), 8);
+        m_emit->add(table.cvt32(), 0x20000);
+        m_emit->imul(table.cvt32(), shift_count.cvt32());
+        m_emit->add(table.cvt32(), 0x80);
+        m_emit->sar(table.cvt32(), 8);
+
+        // acc = min(((H * reciprocal) + 0x8000) >> 16, 0x1FFFF), without the overflow flag
+        m_emit->imul(acc, table);
+        m_emit->add(acc, 0x8000);
+        m_emit->shr(acc, 16);
+        m_emit->mov(shift_count.cvt32(), 0x1FFFF);
+        m_emit->cmp(acc.cvt32(), shift_count.cvt32());
+        m_emit->cmova(acc.cvt32(), shift_count.cvt32());
+        m_emit->L(divided);
+
+        // SX2 = (acc * IR1 + OFX) SAR 16, SY2 = (acc * IR2 + OFY) SAR 16, pushed onto the SXY FIFO
+        for (u32 i = 0; i < 2; i++)
+        {
+          const Xbyak::Reg64 screen = (i == 0) ? temp2 : temp1;
+          m_emit->movsx(screen, m_emit->word[reg_ptr(9 + i)]);
+          m_emit->imul(screen, acc);
+          m_emit->movsxd(temp3, m_emit->dword[reg_ptr(56 + i)]);
+          m_emit->add(screen, temp3);
+          check_mac0(screen, temp3);
+          m_emit->sar(screen, 16);
+          saturate(screen.cvt32(), -0x400, 0x3FF, (UINT32_C(1) << 31) | (UINT32_C(1) << (14 - i)));
+        }
+        m_emit->movzx(temp2.cvt32(), temp2.cvt16());
+        m_emit->shl(temp1.cvt32(), 16);
+        m_emit->or_(temp2.cvt32(), temp1.cvt32());
+        for (u32 i = 12; i < 14; i++)
+        {
+          m_emit->mov(temp1.cvt32(), m_emit->dword[reg_ptr(i + 1)]);
+          m_emit->mov(m_emit->dword[reg_ptr(i)], temp1.cvt32());
+        }
+        m_emit->mov(m_emit->dword[reg_ptr(14)], temp2.cvt32());
+
+        // depth cueing for the last vertex, MAC0 = acc * DQA + DQB, IR0 = clamp(MAC0 SAR 12, 0, 0x1000)
+        if (v == (num_vertices - 1))
+        {
+          m_emit->movsx(temp2, m_emit->word[reg_ptr(59)]);
+          m_emit->imul(temp2, acc);
+          m_emit->movsxd(temp1, m_emit->dword[reg_ptr(60)]);
+          m_emit->add(temp2, temp1);
+          m_emit->mov(m_emit->dword[reg_ptr(24)], temp2.cvt32());
+          check_mac0(temp2, temp1);
+          m_emit->sar(temp2, 12);
+          saturate(temp2.cvt32(), 0, 0x1000, UINT32_C(1) << 12);
+          m_emit->mov(m_emit->dword[reg_ptr(8)], temp2.cvt32());
+        }
+      }
+    }
+    break;
+
+    case 0x28: // SQR
+    {
+      // squares can't be negative, or overflow the 32-bit multiply, so only the upper IR limit applies
+      for (u32 i = 0; i < 3; i++)
+      {
+        Xbyak::Label ir_in_range;
+        m_emit->movsx(acc.cvt32(), m_emit->word[reg_ptr(9 + i)]);
+        m_emit->imul(acc.cvt32(), acc.cvt32());
+        if (inst.sf)
+          m_emit->sar(acc.cvt32(), 12);
+        m_emit->mov(m_emit->dword[reg_ptr(25 + i)], acc.cvt32());
+        m_emit->cmp(acc.cvt32(), 0x7FFF);
+        m_emit->jle(ir_in_range);
+        m_emit->mov(acc.cvt32(), 0x7FFF);
+        if (update_flag)
+          m_emit->or_(flag, (i == 2) ? (UINT32_C(1) << 22) : ((UINT32_C(1) << 31) | (UINT32_C(1) << (24 - i))));
+        m_emit->L(ir_in_range);
+        m_emit->mov(m_emit->dword[reg_ptr(9 + i)], acc.cvt32());
+      }
+    }
+    break;
+  }
+
+  if (update_flag)
+    m_emit->mov(m_emit->dword[reg_ptr(63)], flag);
+
+  return true;
+}
+
 void CodeGenerator::EmitBranch(const void* address, bool allow_scratch)
 {
   const s64 jump_distance =
@@ -2928,11 +3340,10 @@ CodeCache::DispatcherFunction CodeGenerator::CompileDispatcher()
   m_emit->L(no_interrupt);
 
   // TimingEvents::UpdateCPUDowncount:
-  // eax <- head event->downcount
+  // eax <- next event downcount
   // downcount <- eax
-  EmitLoadGlobalAddress(Xbyak::Operand::RAX, TimingEvents::GetHeadEventPtr());
-  m_emit->mov(m_emit->rax, m_emit->qword[m_emit->rax]);
-  m_emit->mov(m_emit->eax, m_emit->dword[m_emit->rax + offsetof(TimingEvent, m_downcount)]);
+  EmitLoadGlobalAddress(Xbyak::Operand::RAX, TimingEvents::GetNextEventDowncountPtr());
+  m_emit->mov(m_emit->eax, m_emit->dword[m_emit->rax]);
   m_emit->mov(m_emit->dword[m_emit->rbp + offsetof(State, downcount)], m_emit->eax);
 
   // main dispatch loop
@@ -2967,9 +3378,8 @@ CodeCache::DispatcherFunction CodeGenerator::CompileDispatcher()
   m_emit->L(downcount_hit);
 
   // check events then for frame done
-  EmitLoadGlobalAddress(Xbyak::Operand::RAX, TimingEvents::GetHeadEventPtr());
-  m_emit->mov(m_emit->rax, m_emit->qword[m_emit->rax]);
-  m_emit->mov(m_emit->eax, m_emit->dword[m_emit->rax + offsetof(TimingEvent, m_downcount)]);
+  EmitLoadGlobalAddress(Xbyak::Operand::RAX, TimingEvents::GetNextEventDowncountPtr());
+  m_emit->mov(m_emit->eax, m_emit->dword[m_emit->rax]);
   m_emit->cmp(m_emit->eax, m_emit->dword[m_emit->rbp + offsetof(State, pending_ticks)]);
   m_emit->jg(frame_done_loop);
   EmitCall(reinterpret_cast<const void*>(&TimingEvents::RunEvents));
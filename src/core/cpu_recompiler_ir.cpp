@@ -0,0 +1,519 @@
+#include "cpu_recompiler_ir.h"
+#include "common/bitutils.h"
+#include "cpu_code_cache.h"
+#include "cpu_core_private.h"
+#include "settings.h"
+#include <algorithm>
+#include <initializer_list>
+#include <optional>
+
+namespace CPU::Recompiler::IR {
+
+static constexpr u32 ALL_REGISTERS = UINT32_C(0xFFFFFFFF);
+
+static constexpr u32 RegMask(Reg reg)
+{
+  // writes to the zero register are discarded, and reads of it are always constant
+  return (reg == Reg::zero) ? 0 : (UINT32_C(1) << static_cast<u8>(reg));
+}
+
+static void DecodeRegisters(const CodeBlockInstruction& cbi, Instruction* out)
+{
+  const CPU::Instruction inst = cbi.instruction;
+  const u32 rs = RegMask(inst.r.rs);
+  const u32 rt = RegMask(inst.r.rt);
+  const u32 rd = RegMask(inst.r.rd);
+  const bool memory_exceptions = g_settings.cpu_recompiler_memory_exceptions;
+
+  out->reads = 0;
+  out->writes = 0;
+  out->delayed_writes = 0;
+  out->is_barrier = cbi.can_trap;
+  out->is_pure = false;
+
+  switch (inst.op)
+  {
+    case InstructionOp::funct:
+    {
+      switch (inst.r.funct)
+      {
+        case InstructionFunct::sll:
+        case InstructionFunct::srl:
+        case InstructionFunct::sra:
+          out->reads = rt;
+          out->writes = rd;
+          out->is_pure = true;
+          return;
+
+        case InstructionFunct::sllv:
+        case InstructionFunct::srlv:
+        case InstructionFunct::srav:
+        case InstructionFunct::addu:
+        case InstructionFunct::subu:
+        case InstructionFunct::and_:
+        case InstructionFunct::or_:
+        case InstructionFunct::xor_:
+        case InstructionFunct::nor:
+        case InstructionFunct::slt:
+        case InstructionFunct::sltu:
+          out->reads = rs | rt;
+          out->writes = rd;
+          out->is_pure = true;
+          return;
+
+        case InstructionFunct::add:
+        case InstructionFunct::sub:
+          out->reads = rs | rt;
+          out->writes = rd;
+          return;
+
+        case InstructionFunct::mfhi:
+        case InstructionFunct::mflo:
+          out->writes = rd;
+          out->is_pure = true;
+          return;
+
+        case InstructionFunct::mthi:
+        case InstructionFunct::mtlo:
+          out->reads = rs;
+          return;
+
+        case InstructionFunct::mult:
+        case InstructionFunct::multu:
+        case InstructionFunct::div:
+        case InstructionFunct::divu:
+          out->reads = rs | rt;
+          return;
+
+        case InstructionFunct::jr:
+          out->reads = rs;
+          out->is_barrier = memory_exceptions;
+          return;
+
+        case InstructionFunct::jalr:
+          out->reads = rs;
+          out->writes = rd;
+          out->is_barrier = memory_exceptions;
+          return;
+
+        case InstructionFunct::syscall:
+        case InstructionFunct::break_:
+          return;
+
+        default:
+          break;
+      }
+    }
+    break;
+
+    case InstructionOp::lui:
+      out->writes = rt;
+      out->is_pure = true;
+      return;
+
+    case InstructionOp::addiu:
+    case InstructionOp::slti:
+    case InstructionOp::sltiu:
+    case InstructionOp::andi:
+    case InstructionOp::ori:
+    case InstructionOp::xori:
+      out->reads = rs;
+      out->writes = rt;
+      out->is_pure = true;
+      return;
+
+    case InstructionOp::addi:
+      out->reads = rs;
+      out->writes = rt;
+      return;
+
+    case InstructionOp::j:
+      return;
+
+    case InstructionOp::jal:
+      out->writes = RegMask(Reg::ra);
+      return;
+
+    case InstructionOp::b:
+    {
+      // bltzal/bgezal link even when the branch isn't taken
+      out->reads = rs;
+      if ((static_cast<u8>(inst.i.rt.GetValue()) & u8(0x1E)) == u8(0x10))
+        out->writes = RegMask(Reg::ra);
+      return;
+    }
+
+    case InstructionOp::beq:
+    case InstructionOp::bne:
+      out->reads = rs | rt;
+      return;
+
+    case InstructionOp::blez:
+    case InstructionOp::bgtz:
+      out->reads = rs;
+      return;
+
+    case InstructionOp::lb:
+    case InstructionOp::lbu:
+    case InstructionOp::lh:
+    case InstructionOp::lhu:
+    case InstructionOp::lw:
+      out->reads = rs;
+      out->delayed_writes = rt;
+      out->is_barrier = memory_exceptions;
+      return;
+
+    case InstructionOp::lwl:
+    case InstructionOp::lwr:
+      // merges with the existing (or load delayed) value of rt
+      out->reads = rs | rt;
+      out->delayed_writes = rt;
+      out->is_barrier = memory_exceptions;
+      return;
+
+    case InstructionOp::sb:
+    case InstructionOp::sh:
+    case InstructionOp::sw:
+    case InstructionOp::swl:
+    case InstructionOp::swr:
+      out->reads = rs | rt;
+      out->is_barrier = memory_exceptions;
+      return;
+
+    case InstructionOp::lwc2:
+    case InstructionOp::swc2:
+      out->reads = rs;
+      out->is_barrier |= memory_exceptions;
+      return;
+
+    case InstructionOp::cop0:
+    case InstructionOp::cop2:
+    {
+      if (inst.cop.IsCommonInstruction())
+      {
+        switch (inst.cop.CommonOp())
+        {
+          case CopCommonInstruction::mfcn:
+          case CopCommonInstruction::cfcn:
+            out->delayed_writes = rt;
+            break;
+
+          case CopCommonInstruction::mtcn:
+          case CopCommonInstruction::ctcn:
+            out->reads = rt;
+            break;
+
+          default:
+            break;
+        }
+      }
+
+      // cop0 writes can change the interrupt state, which is checked with everything flushed
+      if (inst.op == InstructionOp::cop0)
+        out->is_barrier = true;
+
+      return;
+    }
+
+    default:
+      break;
+  }
+
+  // anything we don't know about goes through the interpreter, which can see everything
+  out->reads = ALL_REGISTERS;
+  out->writes = ALL_REGISTERS & ~UINT32_C(1);
+  out->is_barrier = true;
+}
+
+/// Computes the value written by an instruction, if it only depends on the values in rs/rt.
+static bool EvaluateConstant(const CodeBlockInstruction& cbi, u32 rs, u32 rt, u32* result)
+{
+  const CPU::Instruction inst = cbi.instruction;
+  switch (inst.op)
+  {
+    case InstructionOp::funct:
+    {
+      switch (inst.r.funct)
+      {
+        case InstructionFunct::sll:
+          *result = rt << inst.r.shamt;
+          return true;
+        case InstructionFunct::srl:
+          *result = rt >> inst.r.shamt;
+          return true;
+        case InstructionFunct::sra:
+          *result = static_cast<u32>(static_cast<s32>(rt) >> inst.r.shamt);
+          return true;
+        case InstructionFunct::sllv:
+          *result = rt << (rs & 31);
+          return true;
+        case InstructionFunct::srlv:
+          *result = rt >> (rs & 31);
+          return true;
+        case InstructionFunct::srav:
+          *result = static_cast<u32>(static_cast<s32>(rt) >> (rs & 31));
+          return true;
+        case InstructionFunct::addu:
+          *result = rs + rt;
+          return true;
+        case InstructionFunct::subu:
+          *result = rs - rt;
+          return true;
+        case InstructionFunct::and_:
+          *result = rs & rt;
+          return true;
+        case InstructionFunct::or_:
+          *result = rs | rt;
+          return true;
+        case InstructionFunct::xor_:
+          *result = rs ^ rt;
+          return true;
+        case InstructionFunct::nor:
+          *result = ~(rs | rt);
+          return true;
+        case InstructionFunct::slt:
+          *result = BoolToUInt32(static_cast<s32>(rs) < static_cast<s32>(rt));
+          return true;
+        case InstructionFunct::sltu:
+          *result = BoolToUInt32(rs < rt);
+          return true;
+
+        case InstructionFunct::add:
+        {
+          // overflow raises an exception and leaves the register unchanged, which ends the block anyway
+          *result = rs + rt;
+          return (((*result ^ rs) & (*result ^ rt)) & UINT32_C(0x80000000)) == 0;
+        }
+
+        case InstructionFunct::sub:
+        {
+          *result = rs - rt;
+          return (((*result ^ rs) & (rs ^ rt)) & UINT32_C(0x80000000)) == 0;
+        }
+
+        case InstructionFunct::jalr:
+          *result = cbi.pc + 8;
+          return true;
+
+        default:
+          return false;
+      }
+    }
+
+    case InstructionOp::lui:
+      *result = inst.i.imm_zext32() << 16;
+      return true;
+
+    case InstructionOp::addiu:
+      *result = rs + inst.i.imm_sext32();
+      return true;
+
+    case InstructionOp::addi:
+    {
+      const u32 imm = inst.i.imm_sext32();
+      *result = rs + imm;
+      return (((*result ^ rs) & (*result ^ imm)) & UINT32_C(0x80000000)) == 0;
+    }
+
+    case InstructionOp::slti:
+      *result = BoolToUInt32(static_cast<s32>(rs) < static_cast<s32>(inst.i.imm_sext32()));
+      return true;
+
+    case InstructionOp::sltiu:
+      *result = BoolToUInt32(rs < inst.i.imm_sext32());
+      return true;
+
+    case InstructionOp::andi:
+      *result = rs & inst.i.imm_zext32();
+      return true;
+
+    case InstructionOp::ori:
+      *result = rs | inst.i.imm_zext32();
+      return true;
+
+    case InstructionOp::xori:
+      *result = rs ^ inst.i.imm_zext32();
+      return true;
+
+    case InstructionOp::jal:
+    case InstructionOp::b:
+      *result = cbi.pc + 8;
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+bool IsAddressInBlock(const CodeBlock* block, VirtualMemoryAddress address)
+{
+  const Segment seg = GetSegmentForAddress(address);
+  if (seg != Segment::KUSEG && seg != Segment::KSEG0 && seg != Segment::KSEG1)
+    return false;
+
+  // superblocks aren't contiguous, so check the instructions themselves
+  const PhysicalMemoryAddress phys_addr = VirtualAddressToPhysical(address);
+  if (block->contains_trace_branches)
+  {
+    return std::any_of(block->instructions.begin(), block->instructions.end(),
+                       [phys_addr](const CodeBlockInstruction& cbi) {
+                         return (VirtualAddressToPhysical(cbi.pc) == (phys_addr & ~3u));
+                       });
+  }
+
+  const PhysicalMemoryAddress block_start = VirtualAddressToPhysical(block->GetPC());
+  const PhysicalMemoryAddress block_end =
+    VirtualAddressToPhysical(block->GetPC() + static_cast<u32>(block->instructions.size()) * sizeof(u32));
+  return (phys_addr >= block_start && phys_addr < block_end);
+}
+
+void Block::Build(const CodeBlock* block)
+{
+  DecodeInstructions(block);
+  PropagateConstants(block);
+  MarkStoreBarriers(block);
+  EliminateDeadWrites();
+  ResolveLoadDelays(block);
+}
+
+void Block::DecodeInstructions(const CodeBlock* block)
+{
+  m_instructions.resize(block->instructions.size());
+  for (u32 i = 0; i < static_cast<u32>(block->instructions.size()); i++)
+  {
+    Instruction& ir = m_instructions[i];
+    DecodeRegisters(block->instructions[i], &ir);
+    ir.is_side_exit = (i > 0 && CodeCache::IsConditionalTraceBranch(block->instructions[i - 1]));
+    ir.constant_input_count = 0;
+    ir.is_dead = false;
+    ir.load_delay_resolved = false;
+  }
+}
+
+void Block::EliminateDeadWrites()
+{
+  // PGXP tracks values through every ALU instruction, so nothing can be skipped.
+  if (g_settings.gpu_pgxp_enable)
+    return;
+
+  // Backwards liveness. Everything is live at the end of the block, and at any point where the register file can be
+  // seen from outside the block. Load delayed writes don't kill the old value, since it's visible to the delay slot.
+  u32 live = ALL_REGISTERS;
+  for (u32 i = static_cast<u32>(m_instructions.size()); i > 0;)
+  {
+    Instruction& ir = m_instructions[--i];
+    if (ir.is_side_exit)
+      live = ALL_REGISTERS;
+
+    if (ir.is_pure && (ir.writes & live) == 0)
+    {
+      // nothing reads the result, so it doesn't read its inputs either
+      ir.is_dead = true;
+      continue;
+    }
+
+    live = (live & ~ir.writes) | ir.reads;
+    if (ir.is_barrier)
+      live = ALL_REGISTERS;
+  }
+}
+
+void Block::PropagateConstants(const CodeBlock* block)
+{
+  std::array<u32, 32> values = {};
+  u32 known = RegMask(Reg::zero);
+
+  for (u32 i = 0; i < static_cast<u32>(m_instructions.size()); i++)
+  {
+    Instruction& ir = m_instructions[i];
+    const CodeBlockInstruction& cbi = block->instructions[i];
+    const Reg rs = cbi.instruction.r.rs;
+    const Reg rt = cbi.instruction.r.rt;
+
+    if (ir.reads != ALL_REGISTERS)
+    {
+      for (const Reg reg : {rs, rt})
+      {
+        if ((ir.reads & known & RegMask(reg)) == 0 ||
+            (ir.constant_input_count > 0 && ir.constant_input_regs[0] == reg))
+        {
+          continue;
+        }
+
+        ir.constant_input_regs[ir.constant_input_count] = reg;
+        ir.constant_input_values[ir.constant_input_count] = values[static_cast<u8>(reg)];
+        ir.constant_input_count++;
+      }
+    }
+
+    const bool inputs_known = (ir.reads & ~known) == 0;
+    known &= ~(ir.writes | ir.delayed_writes);
+
+    u32 result;
+    if (ir.writes != 0 && ir.reads != ALL_REGISTERS && inputs_known &&
+        EvaluateConstant(cbi, values[static_cast<u8>(rs)], values[static_cast<u8>(rt)], &result))
+    {
+      const u32 dest = CountTrailingZeros(ir.writes);
+      values[dest] = result;
+      known |= ir.writes;
+    }
+  }
+}
+
+void Block::MarkStoreBarriers(const CodeBlock* block)
+{
+  // A store into the block itself truncates it, and the registers have to be up to date at the new end. Unless the
+  // address is known to miss the block, dead write elimination can't look past the store.
+  for (u32 i = 0; i < static_cast<u32>(m_instructions.size()); i++)
+  {
+    Instruction& ir = m_instructions[i];
+    const CPU::Instruction inst = block->instructions[i].instruction;
+    if (inst.op != InstructionOp::sb && inst.op != InstructionOp::sh && inst.op != InstructionOp::sw)
+      continue;
+
+    const Reg rs = inst.i.rs;
+    std::optional<u32> base;
+    if (rs == Reg::zero)
+      base = 0;
+    for (u32 j = 0; j < ir.constant_input_count; j++)
+    {
+      if (ir.constant_input_regs[j] == rs)
+        base = ir.constant_input_values[j];
+    }
+
+    if (!base.has_value() || IsAddressInBlock(block, *base + inst.i.imm_sext32()))
+      ir.is_barrier = true;
+  }
+}
+
+void Block::ResolveLoadDelays(const CodeBlock* block)
+{
+  // The last instruction's load delay extends into the next block, so it has to go through the CPU state. The same
+  // goes for the delay slot of a trace's conditional branch, since it could be the last instruction before a side exit.
+  for (u32 i = 0; (i + 1) < static_cast<u32>(m_instructions.size()); i++)
+  {
+    Instruction& ir = m_instructions[i];
+    if (ir.is_side_exit)
+      continue;
+
+    switch (block->instructions[i].instruction.op)
+    {
+      case InstructionOp::lb:
+      case InstructionOp::lbu:
+      case InstructionOp::lh:
+      case InstructionOp::lhu:
+      case InstructionOp::lw:
+        break;
+
+      default:
+        continue;
+    }
+
+    // If the delay slot doesn't read the old value, and doesn't start another load to the same register (which would
+    // cancel this one), then writing it now is indistinguishable. Exception exits flush the delayed value as well.
+    const Instruction& next = m_instructions[i + 1];
+    ir.load_delay_resolved = ((next.reads | next.delayed_writes) & ir.delayed_writes) == 0;
+  }
+}
+
+} // namespace CPU::Recompiler::IR
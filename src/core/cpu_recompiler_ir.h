@@ -0,0 +1,52 @@
+#pragma once
+#include "cpu_types.h"
+#include <array>
+#include <vector>
+
+namespace CPU {
+struct CodeBlock;
+}
+
+namespace CPU::Recompiler::IR {
+
+/// Returns true if a store to the address would modify one of the block's instructions, which truncates the block.
+bool IsAddressInBlock(const CodeBlock* block, VirtualMemoryAddress address);
+
+/// Per-instruction information computed over the whole block before any host code is generated.
+struct Instruction
+{
+  u32 reads;          ///< Guest GPRs read by the instruction, as a mask of (1 << reg).
+  u32 writes;         ///< Guest GPRs written when the instruction completes.
+  u32 delayed_writes; ///< Guest GPRs written after the load delay slot.
+
+  /// Guest GPRs read by the instruction whose values are known at compile time.
+  u32 constant_input_count;
+  std::array<Reg, 2> constant_input_regs;
+  std::array<u32, 2> constant_input_values;
+
+  bool is_barrier;          ///< Guest registers may be observed, e.g. by an exception exit or the interpreter.
+  bool is_side_exit;        ///< The trace may leave after the instruction, so its results are observed too.
+  bool is_pure;             ///< Has no side effects other than writing the destination register.
+  bool is_dead;             ///< The result is overwritten before it is read, so no code is needed.
+  bool load_delay_resolved; ///< The loaded value can be written immediately, the next instruction can't tell.
+};
+
+/// Block-wide analysis between the code cache's decoding and code generation, shared by all host back ends.
+class Block
+{
+public:
+  void Build(const CodeBlock* block);
+
+  const Instruction& GetInstruction(u32 index) const { return m_instructions[index]; }
+
+private:
+  void DecodeInstructions(const CodeBlock* block);
+  void EliminateDeadWrites();
+  void PropagateConstants(const CodeBlock* block);
+  void MarkStoreBarriers(const CodeBlock* block);
+  void ResolveLoadDelays(const CodeBlock* block);
+
+  std::vector<Instruction> m_instructions;
+};
+
+} // namespace CPU::Recompiler::IR
@@ -552,6 +552,19 @@ Value RegisterCache::ReadGuestRegisterToScratch(Reg guest_reg)
   return Value::FromScratch(this, host_reg, RegSize_32);
 }
 
+void RegisterCache::AssumeGuestRegisterConstant(Reg guest_reg, u32 value)
+{
+  // a pending load delay would replace the value before it's read
+  if (guest_reg == Reg::zero || m_state.load_delay_register == guest_reg)
+    return;
+
+  Value& cache_value = m_state.guest_reg_state[static_cast<u8>(guest_reg)];
+  if (cache_value.IsValid())
+    return;
+
+  cache_value = Value::FromConstantU32(value);
+}
+
 Value RegisterCache::WriteGuestRegister(Reg guest_reg, Value&& value)
 {
   // ignore writes to register zero
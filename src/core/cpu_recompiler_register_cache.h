@@ -311,6 +311,9 @@ public:
   /// from some other write.
   Value ReadGuestRegisterToScratch(Reg guest_reg);
 
+  /// Records a value known at compile time for an uncached guest register. It matches memory, so isn't written back.
+  void AssumeGuestRegisterConstant(Reg guest_reg, u32 value);
+
   /// Creates a copy of value, and stores it to guest_reg.
   Value WriteGuestRegister(Reg guest_reg, Value&& value);
 
@@ -17,7 +17,7 @@ static u32 GetAddressMask()
   return Bus::g_ram_mask & 0xFFFFFFFCu;
 }
 
-DMA g_dma;
+CONSOLE_LOCAL DMA g_dma;
 
 DMA::DMA() = default;
 
@@ -496,10 +496,16 @@ TickCount DMA::TransferDeviceToMemory(Channel channel, u32 address, u32 incremen
 
     const u32 terminator = UINT32_C(0xFFFFFF);
     std::memcpy(&ram_pointer[address], &terminator, sizeof(terminator));
+    Bus::MarkRAMWritten(address, word_count * sizeof(u32));
     CPU::CodeCache::InvalidateCodePages(address, word_count);
     return Bus::GetDMARAMTickCount(word_count);
   }
 
+  // the lowest address written, transfers can go downwards
+  const u32 start_address =
+    (static_cast<s32>(increment) < 0) ? ((address + increment * (word_count - 1)) & mask) : address;
+  Bus::MarkRAMWritten(start_address, word_count * sizeof(u32));
+
   u32* dest_pointer = reinterpret_cast<u32*>(&Bus::g_ram[address]);
   if (static_cast<s32>(increment) < 0 || ((address + (increment * word_count)) & mask) <= address)
   {
@@ -190,4 +190,4 @@ private:
   } m_DICR = {};
 };
 
-extern DMA g_dma;
+extern CONSOLE_LOCAL DMA g_dma;
@@ -1,18 +1,23 @@
 #include "gpu.h"
+#include "common/byte_stream.h"
+#include "common/file_system.h"
 #include "common/heap_array.h"
+#include "common/log.h"
 #include "common/state_wrapper.h"
 #include "common/string_util.h"
 #include "dma.h"
 #include "host_display.h"
 #include "host_interface.h"
 #include "interrupt_controller.h"
+#include "save_state_version.h"
 #include "settings.h"
 #include "stb_image_write.h"
 #include "system.h"
 #include "timers.h"
 #include <cmath>
+Log_SetChannel(GPU);
 
-std::unique_ptr<GPU> g_gpu;
+CONSOLE_LOCAL std::unique_ptr<GPU> g_gpu;
 
 const GPU::GP0CommandHandlerTable GPU::s_GP0_command_handler_table = GPU::GenerateGP0CommandHandlerTable();
 
@@ -36,6 +41,7 @@ bool GPU::Initialize(HostDisplay* host_display)
   m_fifo_size = g_settings.gpu_fifo_size;
   m_max_run_ahead = g_settings.gpu_max_run_ahead;
   m_console_is_pal = System::IsPALRegion();
+  m_vram_writes.Resize(VRAM_WIDTH * VRAM_HEIGHT * sizeof(u16));
   UpdateCRTCConfig();
   return true;
 }
@@ -81,6 +87,8 @@ void GPU::Reset(bool clear_vram)
   m_crtc_state.in_vblank = false;
   m_crtc_state.interlaced_field = 0;
   m_crtc_state.interlaced_display_field = 0;
+  if (clear_vram)
+    m_vram_writes.MarkAllDirty();
   SoftReset();
   UpdateDisplay();
 }
@@ -137,6 +145,13 @@ bool GPU::DoState(StateWrapper& sw, HostDisplayTexture** host_texture, bool upda
 {
   if (sw.IsReading())
   {
+    // a replay of the capture would carry on from the state before the load
+    if (m_capture_file)
+    {
+      Log_ErrorPrintf("Loading a state, ending the command capture");
+      EndCommandCapture();
+    }
+
     // perform a reset to discard all pending draws/fb state
     Reset(host_texture == nullptr);
   }
@@ -260,6 +275,13 @@ bool GPU::DoState(StateWrapper& sw, HostDisplayTexture** host_texture, bool upda
   return !sw.HasError();
 }
 
+void GPU::SaveVRAMSnapshot(PageWriteTracker::Snapshot* snapshot) {}
+
+bool GPU::RestoreVRAMSnapshot(const PageWriteTracker::Snapshot& snapshot)
+{
+  return true;
+}
+
 void GPU::ResetGraphicsAPIState() {}
 
 void GPU::RestoreGraphicsAPIState() {}
@@ -334,6 +356,10 @@ u32 GPU::ReadRegister(u32 offset)
   switch (offset)
   {
     case 0x00:
+      // reads move a VRAM to CPU transfer along, so the replay has to do them too
+      if (m_capture_file && m_blitter_state == BlitterState::ReadingVRAM)
+        WriteCaptureRecord(CaptureRecord::ReadGPUREAD, 1);
+
       return ReadGPUREAD();
 
     case 0x04:
@@ -360,12 +386,18 @@ void GPU::WriteRegister(u32 offset, u32 value)
   switch (offset)
   {
     case 0x00:
+      if (m_capture_file)
+        WriteCaptureRecord(CaptureRecord::GP0Write, value);
+
       m_fifo.Push(value);
       ExecuteCommands();
       UpdateCommandTickEvent();
       return;
 
     case 0x04:
+      if (m_capture_file)
+        WriteCaptureRecord(CaptureRecord::GP1Write, value);
+
       WriteGP1(value);
       return;
 
@@ -382,12 +414,18 @@ void GPU::DMARead(u32* words, u32 word_count)
     return;
   }
 
+  if (m_capture_file && m_blitter_state == BlitterState::ReadingVRAM)
+    WriteCaptureRecord(CaptureRecord::ReadGPUREAD, word_count);
+
   for (u32 i = 0; i < word_count; i++)
     words[i] = ReadGPUREAD();
 }
 
 void GPU::EndDMAWrite()
 {
+  if (m_capture_file)
+    WriteCaptureDMAWrites();
+
   m_fifo_pushed = true;
   if (!m_syncing)
   {
@@ -854,9 +892,12 @@ void GPU::CRTCTickEvent(TickCount ticks)
       {
         g_interrupt_controller.InterruptRequest(InterruptController::IRQ::VBLANK);
 
-        // flush any pending draws and "scan out" the image
+        // flush any pending draws and "scan out" the image, unless it's a runahead frame nobody will see
         FlushRender();
-        UpdateDisplay();
+        if (m_capture_file)
+          WriteCaptureRecord(CaptureRecord::FrameEnd, 0);
+        if (!System::IsFrameHidden())
+          UpdateDisplay();
         System::FrameDone();
 
         // switch fields early. this is needed so we draw to the correct one.
@@ -889,6 +930,7 @@ void GPU::CRTCTickEvent(TickCount ticks)
   }
 
   // alternating even line bit in 240-line mode
+  const u8 old_active_line_lsb = m_crtc_state.active_line_lsb;
   if (m_GPUSTAT.InInterleaved480iMode())
   {
     m_crtc_state.active_line_lsb =
@@ -902,12 +944,25 @@ void GPU::CRTCTickEvent(TickCount ticks)
     m_GPUSTAT.display_line_lsb = ConvertToBoolUnchecked((m_crtc_state.regs.Y + m_crtc_state.current_scanline) & u32(1));
   }
 
+  // interlaced rendering skips the lines of the active field, so the replay has to know which one it is
+  if (m_capture_file && m_crtc_state.active_line_lsb != old_active_line_lsb)
+    WriteCaptureRecord(CaptureRecord::ActiveLineLSB, m_crtc_state.active_line_lsb);
+
   UpdateCRTCTickEvent();
 }
 
 void GPU::CommandTickEvent(TickCount ticks)
 {
-  m_pending_command_ticks -= SystemTicksToGPUTicks(ticks);
+  const TickCount gpu_ticks = SystemTicksToGPUTicks(ticks);
+  if (m_capture_file)
+    WriteCaptureRecord(CaptureRecord::CommandTicks, static_cast<u32>(gpu_ticks));
+
+  ExecuteCommandTicks(gpu_ticks);
+}
+
+void GPU::ExecuteCommandTicks(TickCount gpu_ticks)
+{
+  m_pending_command_ticks -= gpu_ticks;
   m_command_tick_event->Deactivate();
 
   // we can be syncing if this came from a DMA write. recursively executing commands would be bad.
@@ -1221,6 +1276,49 @@ void GPU::UpdateDisplay() {}
 
 void GPU::ReadVRAM(u32 x, u32 y, u32 width, u32 height) {}
 
+u64 GPU::GetVRAMHash()
+{
+  // only read back the rows which changed, that's a download from the host GPU for the hardware renderers
+  u32 dirty_start, dirty_end;
+  m_vram_writes.Advance();
+  if (m_vram_writes.GetRangeWrittenSince(m_vram_hash.GetGeneration(), &dirty_start, &dirty_end))
+  {
+    constexpr u32 row_size = VRAM_WIDTH * sizeof(u16);
+    const u32 start_row = dirty_start / row_size;
+    const u32 end_row = std::min((dirty_end + row_size - 1) / row_size, VRAM_HEIGHT);
+    FlushRender();
+    ReadVRAM(0, start_row, VRAM_WIDTH, end_row - start_row);
+  }
+
+  return m_vram_hash.Update(m_vram_ptr, m_vram_writes);
+}
+
+const u16* GPU::ReadBackVRAM()
+{
+  FlushRender();
+  ReadVRAM(0, 0, VRAM_WIDTH, VRAM_HEIGHT);
+  return m_vram_ptr;
+}
+
+void GPU::MarkVRAMRowsDirty(u32 y, u32 height)
+{
+  constexpr u32 row_size = VRAM_WIDTH * sizeof(u16);
+  y %= VRAM_HEIGHT;
+  height = std::min(height, VRAM_HEIGHT);
+
+  const u32 rows_before_wrap = std::min(height, VRAM_HEIGHT - y);
+  m_vram_writes.MarkDirty(y * row_size, rows_before_wrap * row_size);
+  if (rows_before_wrap < height)
+    m_vram_writes.MarkDirty(0, (height - rows_before_wrap) * row_size);
+}
+
+void GPU::MarkDrawingAreaDirty()
+{
+  // the bottom of the drawing area is inclusive
+  if (m_drawing_area.bottom >= m_drawing_area.top)
+    MarkVRAMRowsDirty(m_drawing_area.top, m_drawing_area.bottom - m_drawing_area.top + 1);
+}
+
 void GPU::FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color)
 {
   const u16 color16 = VRAMRGBA8888ToRGBA5551(color);
@@ -1381,6 +1479,231 @@ void GPU::DispatchRenderCommand() {}
 
 void GPU::FlushRender() {}
 
+GPUBackend* GPU::GetBackend()
+{
+  return nullptr;
+}
+
+// A capture is a header and the GPU state, followed by pairs of record type and value. DMA writes are a record with the
+// word count, followed by that many address/value pairs. The state is a regular save state, so captures only replay in
+// builds which can still load states of that version.
+static constexpr u32 COMMAND_CAPTURE_MAGIC = 0x50434753; // SGCP
+static constexpr u32 COMMAND_CAPTURE_VERSION = 2;
+
+bool GPU::BeginCommandCapture(const char* filename)
+{
+  EndCommandCapture();
+
+  // reads back VRAM from the hardware renderers
+  std::unique_ptr<GrowableMemoryByteStream> state_stream = ByteStream_CreateGrowableMemoryStream();
+  StateWrapper sw(state_stream.get(), StateWrapper::Mode::Write, SAVE_STATE_VERSION);
+  RestoreGraphicsAPIState();
+  const bool state_valid = DoState(sw, nullptr, false);
+  ResetGraphicsAPIState();
+  if (!state_valid)
+  {
+    Log_ErrorPrintf("Failed to save GPU state for command capture");
+    return false;
+  }
+
+  m_capture_file = FileSystem::OpenCFile(filename, "wb");
+  if (!m_capture_file)
+  {
+    Log_ErrorPrintf("Failed to open '%s' for command capture", filename);
+    return false;
+  }
+
+  const u32 header[4] = {COMMAND_CAPTURE_MAGIC, COMMAND_CAPTURE_VERSION, SAVE_STATE_VERSION,
+                         static_cast<u32>(state_stream->GetSize())};
+  if (std::fwrite(header, sizeof(header), 1, m_capture_file) != 1 ||
+      std::fwrite(state_stream->GetMemoryPointer(), header[3], 1, m_capture_file) != 1)
+  {
+    Log_ErrorPrintf("Failed to write command capture header to '%s'", filename);
+    EndCommandCapture();
+    return false;
+  }
+
+  Log_InfoPrintf("Capturing GPU commands to '%s'", filename);
+  return true;
+}
+
+void GPU::EndCommandCapture()
+{
+  if (!m_capture_file)
+    return;
+
+  std::fclose(m_capture_file);
+  m_capture_file = nullptr;
+  m_capture_dma_words.clear();
+}
+
+void GPU::WriteCaptureRecord(CaptureRecord record, u32 value)
+{
+  const u32 words[2] = {static_cast<u32>(record), value};
+  if (std::fwrite(words, sizeof(words), 1, m_capture_file) == 1)
+    return;
+
+  Log_ErrorPrintf("Failed to write command capture, stopping");
+  EndCommandCapture();
+}
+
+void GPU::WriteCaptureDMAWrites()
+{
+  if (m_capture_dma_words.empty())
+    return;
+
+  WriteCaptureRecord(CaptureRecord::DMAWrite, static_cast<u32>(m_capture_dma_words.size() / 2));
+  if (m_capture_file &&
+      std::fwrite(m_capture_dma_words.data(), sizeof(u32) * m_capture_dma_words.size(), 1, m_capture_file) != 1)
+  {
+    Log_ErrorPrintf("Failed to write command capture, stopping");
+    EndCommandCapture();
+  }
+
+  m_capture_dma_words.clear();
+}
+
+bool GPU::LoadCommandCapture(const char* filename, std::vector<u8>* state, std::vector<std::vector<u32>>* frames)
+{
+  auto fp = FileSystem::OpenManagedCFile(filename, "rb");
+  if (!fp)
+  {
+    Log_ErrorPrintf("Failed to open command capture '%s'", filename);
+    return false;
+  }
+
+  u32 header[4];
+  if (std::fread(header, sizeof(header), 1, fp.get()) != 1 || header[0] != COMMAND_CAPTURE_MAGIC ||
+      header[1] != COMMAND_CAPTURE_VERSION)
+  {
+    Log_ErrorPrintf("'%s' is not a version %u command capture", filename, COMMAND_CAPTURE_VERSION);
+    return false;
+  }
+
+  if (header[2] < SAVE_STATE_MINIMUM_VERSION || header[2] > SAVE_STATE_VERSION)
+  {
+    Log_ErrorPrintf("Command capture '%s' has an unsupported state version %u", filename, header[2]);
+    return false;
+  }
+
+  // the version goes in front, for LoadCommandCaptureState()
+  state->resize(sizeof(u32) + header[3]);
+  std::memcpy(state->data(), &header[2], sizeof(u32));
+  if (header[3] == 0 || std::fread(state->data() + sizeof(u32), header[3], 1, fp.get()) != 1)
+  {
+    Log_ErrorPrintf("Command capture '%s' is truncated", filename);
+    return false;
+  }
+
+  frames->clear();
+  frames->emplace_back();
+
+  u32 words[2];
+  while (std::fread(words, sizeof(words), 1, fp.get()) == 1)
+  {
+    const CaptureRecord record = static_cast<CaptureRecord>(words[0]);
+    if (record > CaptureRecord::FrameEnd ||
+        (record == CaptureRecord::DMAWrite && (words[1] == 0 || words[1] > MAX_FIFO_SIZE)))
+    {
+      Log_ErrorPrintf("Corrupted record in '%s' (type %u, value %u)", filename, words[0], words[1]);
+      return false;
+    }
+
+    if (record == CaptureRecord::FrameEnd)
+    {
+      frames->emplace_back();
+      continue;
+    }
+
+    std::vector<u32>& frame = frames->back();
+    frame.insert(frame.end(), std::begin(words), std::end(words));
+    if (record == CaptureRecord::DMAWrite)
+    {
+      const size_t offset = frame.size();
+      frame.resize(offset + words[1] * 2);
+      if (std::fread(&frame[offset], sizeof(u32) * words[1] * 2, 1, fp.get()) != 1)
+      {
+        Log_ErrorPrintf("Command capture '%s' is truncated", filename);
+        return false;
+      }
+    }
+  }
+
+  // nothing was written after the last boundary
+  if (frames->back().empty())
+    frames->pop_back();
+
+  if (frames->empty())
+  {
+    Log_ErrorPrintf("Command capture '%s' has no frames", filename);
+    return false;
+  }
+
+  return true;
+}
+
+bool GPU::LoadCommandCaptureState(const std::vector<u8>& state)
+{
+  u32 version;
+  std::memcpy(&version, state.data(), sizeof(version));
+
+  std::unique_ptr<ReadOnlyMemoryByteStream> state_stream = ByteStream_CreateReadOnlyMemoryStream(
+    state.data() + sizeof(version), static_cast<u32>(state.size() - sizeof(version)));
+  StateWrapper sw(state_stream.get(), StateWrapper::Mode::Read, version);
+  RestoreGraphicsAPIState();
+  const bool result = DoState(sw, nullptr, false);
+  ResetGraphicsAPIState();
+  return result;
+}
+
+void GPU::ReplayCommandCaptureFrame(const std::vector<u32>& records)
+{
+  for (size_t i = 0; i < records.size(); i += 2)
+  {
+    const u32 value = records[i + 1];
+    switch (static_cast<CaptureRecord>(records[i]))
+    {
+      case CaptureRecord::GP0Write:
+        WriteRegister(0x00, value);
+        break;
+
+      case CaptureRecord::GP1Write:
+        WriteRegister(0x04, value);
+        break;
+
+      case CaptureRecord::DMAWrite:
+      {
+        for (u32 j = 0; j < value; j++)
+          DMAWrite(records[i + 2 + j * 2], records[i + 3 + j * 2]);
+        EndDMAWrite();
+        i += value * 2;
+      }
+      break;
+
+      case CaptureRecord::ReadGPUREAD:
+      {
+        for (u32 j = 0; j < value; j++)
+          ReadGPUREAD();
+      }
+      break;
+
+      // nothing else is running, so the command timing only comes from the capture
+      case CaptureRecord::CommandTicks:
+        ExecuteCommandTicks(static_cast<TickCount>(value));
+        break;
+
+      case CaptureRecord::ActiveLineLSB:
+        m_crtc_state.active_line_lsb = Truncate8(value);
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  FlushRender();
+}
+
 void GPU::SetDrawMode(u16 value)
 {
   GPUDrawModeReg new_mode_reg{static_cast<u16>(value & GPUDrawModeReg::MASK)};
@@ -3,16 +3,19 @@
 #include "common/fifo_queue.h"
 #include "common/rectangle.h"
 #include "gpu_types.h"
+#include "paged_hash.h"
 #include "timers.h"
 #include "types.h"
 #include <algorithm>
 #include <array>
+#include <cstdio>
 #include <deque>
 #include <memory>
 #include <vector>
 
 class StateWrapper;
 
+class GPUBackend;
 class HostDisplay;
 class HostDisplayTexture;
 
@@ -60,6 +63,11 @@ public:
   virtual void Reset(bool clear_vram);
   virtual bool DoState(StateWrapper& sw, HostDisplayTexture** save_to_texture, bool update_display);
 
+  /// Memory states of the software renderer keep VRAM in a snapshot, which only copies the rows written since it was
+  /// last saved. The hardware renderers copy VRAM to the host texture in DoState() instead, and ignore these.
+  virtual void SaveVRAMSnapshot(PageWriteTracker::Snapshot* snapshot);
+  virtual bool RestoreVRAMSnapshot(const PageWriteTracker::Snapshot& snapshot);
+
   // Graphics API state reset/restore - call when drawing the UI etc.
   virtual void ResetGraphicsAPIState();
   virtual void RestoreGraphicsAPIState();
@@ -78,6 +86,8 @@ public:
   ALWAYS_INLINE void DMAWrite(u32 address, u32 value)
   {
     m_fifo.Push((ZeroExtend64(address) << 32) | ZeroExtend64(value));
+    if (m_capture_file)
+      m_capture_dma_words.insert(m_capture_dma_words.end(), {address, value});
   }
   void EndDMAWrite();
 
@@ -141,6 +151,31 @@ public:
   // Returns the video clock frequency.
   TickCount GetCRTCFrequency() const;
 
+  /// Returns a digest of VRAM. Only the rows drawn to since the last call are read back and hashed again.
+  u64 GetVRAMHash();
+
+  /// Reads all of VRAM back from the renderer, and returns it.
+  const u16* ReadBackVRAM();
+
+  /// Writes the GPU state, then every GP0/GP1 and DMA write from now on, to a file. The frames of the capture can be
+  /// replayed without emulating the rest of the console. Loading a state ends the capture, as nothing records it.
+  bool BeginCommandCapture(const char* filename);
+  void EndCommandCapture();
+  ALWAYS_INLINE bool IsCapturingCommands() const { return (m_capture_file != nullptr); }
+
+  /// Reads a capture, split at the frame boundaries. The records are only meaningful to ReplayCommandCaptureFrame().
+  static bool LoadCommandCapture(const char* filename, std::vector<u8>* state,
+                                 std::vector<std::vector<u32>>* frames);
+
+  /// Puts the GPU back to the state it was in when a capture started.
+  bool LoadCommandCaptureState(const std::vector<u8>& state);
+
+  /// Replays the register and DMA writes of one captured frame, then flushes the renderer.
+  void ReplayCommandCaptureFrame(const std::vector<u32>& records);
+
+  /// Returns the renderer which runs on the GPU thread, if there is one.
+  virtual GPUBackend* GetBackend();
+
 protected:
   TickCount CRTCTicksToSystemTicks(TickCount crtc_ticks, TickCount fractional_ticks) const;
   TickCount SystemTicksToCRTCTicks(TickCount sysclk_ticks, TickCount* fractional_ticks) const;
@@ -198,6 +233,10 @@ protected:
   u32 ReadGPUREAD();
   void FinishVRAMWrite();
 
+  /// Marks rows of VRAM as changed for GetVRAMHash(), wrapping around the bottom.
+  void MarkVRAMRowsDirty(u32 y, u32 height);
+  void MarkDrawingAreaDirty();
+
   /// Returns the number of vertices in the buffered poly-line.
   ALWAYS_INLINE u32 GetPolyLineVertexCount() const
   {
@@ -229,6 +268,21 @@ protected:
   void WriteGP1(u32 value);
   void EndCommand();
   void ExecuteCommands();
+  void ExecuteCommandTicks(TickCount gpu_ticks);
+
+  enum class CaptureRecord : u32
+  {
+    GP0Write,
+    GP1Write,
+    DMAWrite,
+    ReadGPUREAD,
+    CommandTicks,
+    ActiveLineLSB,
+    FrameEnd
+  };
+
+  void WriteCaptureRecord(CaptureRecord record, u32 value);
+  void WriteCaptureDMAWrites();
 
   // Rendering in the backend
   virtual void ReadVRAM(u32 x, u32 y, u32 width, u32 height);
@@ -506,6 +560,14 @@ protected:
   TickCount m_max_run_ahead = 128;
   u32 m_fifo_size = 128;
 
+  std::FILE* m_capture_file = nullptr;
+  std::vector<u32> m_capture_dma_words;
+
+  // VRAM writes are tracked in bands of this many rows.
+  static constexpr u32 VRAM_HASH_BAND_ROWS = 16;
+  PageWriteTracker m_vram_writes{VRAM_WIDTH * VRAM_HASH_BAND_ROWS * sizeof(u16)};
+  PagedHash m_vram_hash;
+
 private:
   using GP0CommandHandler = bool (GPU::*)();
   using GP0CommandHandlerTable = std::array<GP0CommandHandler, 256>;
@@ -534,4 +596,4 @@ private:
   static const GP0CommandHandlerTable s_GP0_command_handler_table;
 };
 
-extern std::unique_ptr<GPU> g_gpu;
+extern CONSOLE_LOCAL std::unique_ptr<GPU> g_gpu;
@@ -1,10 +1,36 @@
 #include "gpu_backend.h"
 #include "common/align.h"
+#include "common/platform.h"
 #include "common/state_wrapper.h"
 #include "common/timer.h"
+#include "profiling.h"
 #include "settings.h"
+#include <algorithm>
 
-std::unique_ptr<GPUBackend> g_gpu_backend;
+#if defined(CPU_X64)
+#include <emmintrin.h>
+#elif defined(CPU_AARCH64) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+CONSOLE_LOCAL std::unique_ptr<GPUBackend> g_gpu_backend;
+
+/// Tells the core we are busy-waiting, so it can give way to the other hyperthread.
+static ALWAYS_INLINE void SpinPause()
+{
+#if defined(CPU_X64)
+  _mm_pause();
+#elif defined(CPU_AARCH64) && defined(_MSC_VER)
+  __yield();
+#elif defined(CPU_AARCH64)
+  __asm__ __volatile__("yield");
+#endif
+}
+
+static ALWAYS_INLINE u64 GetElapsedNanoseconds(Common::Timer::Value start_time)
+{
+  return static_cast<u64>(Common::Timer::ConvertValueToNanoseconds(Common::Timer::GetValue() - start_time));
+}
 
 GPUBackend::GPUBackend() = default;
 
@@ -104,11 +130,19 @@ void* GPUBackend::AllocateCommand(GPUBackendCommandType command, u32 size)
     if (read_ptr > write_ptr)
     {
       u32 available_size = read_ptr - write_ptr;
-      while (available_size < (size + sizeof(GPUBackendCommandType)))
+      if (available_size < (size + sizeof(GPUBackendCommandType)))
       {
-        WakeGPUThread();
-        read_ptr = m_command_fifo_read_ptr.load();
-        available_size = (read_ptr > write_ptr) ? (read_ptr - write_ptr) : (COMMAND_QUEUE_SIZE - write_ptr);
+        const Common::Timer::Value start_time = Common::Timer::GetValue();
+        do
+        {
+          WakeGPUThread();
+          SpinPause();
+          read_ptr = m_command_fifo_read_ptr.load();
+          available_size = (read_ptr > write_ptr) ? (read_ptr - write_ptr) : (COMMAND_QUEUE_SIZE - write_ptr);
+        } while (available_size < (size + sizeof(GPUBackendCommandType)));
+
+        m_thread_stats.producer_stalls++;
+        m_thread_stats.producer_stall_ns += GetElapsedNanoseconds(start_time);
       }
     }
     else
@@ -146,24 +180,97 @@ void GPUBackend::PushCommand(GPUBackendCommand* cmd)
   {
     // single-thread mode
     if (cmd->type != GPUBackendCommandType::Sync)
+    {
+      Profiling::ScopedSection profile_section(Profiling::Section::GPUBackend);
       HandleCommand(cmd);
+    }
   }
   else
   {
-    const u32 new_write_ptr = m_command_fifo_write_ptr.fetch_add(cmd->size) + cmd->size;
-    UNREFERENCED_VARIABLE(new_write_ptr);
-    if (GetPendingCommandSize() >= THRESHOLD_TO_WAKE_GPU)
-      WakeGPUThread();
+    // The store has to be sequentially consistent with the sleeping check, see WaitForCommands().
+    m_command_fifo_write_ptr.fetch_add(cmd->size);
+    if (m_gpu_thread_sleeping.load())
+      WakeGPUThreadForBatch();
   }
 }
 
 void GPUBackend::WakeGPUThread()
 {
+  m_wake_pending_since = 0;
+  if (!m_gpu_thread_sleeping.load())
+    return;
+
+  // Clearing the flag stops later commands from notifying again before the thread gets going. It is only called with
+  // commands pending or the loop done, so the thread won't go straight back to sleep.
   std::unique_lock<std::mutex> lock(m_sync_mutex);
   if (!m_gpu_thread_sleeping.load())
     return;
 
+  m_gpu_thread_sleeping.store(false);
   m_wake_gpu_thread_cv.notify_one();
+  m_thread_stats.wakes++;
+}
+
+void GPUBackend::WakeGPUThreadForBatch()
+{
+  // Waking the thread costs more than most commands take to draw, so let a few of them pile up first.
+  const Common::Timer::Value current_time = Common::Timer::GetValue();
+  if (m_wake_pending_since == 0)
+    m_wake_pending_since = current_time;
+
+  if (GetPendingCommandSize() < WAKE_BATCH_SIZE &&
+      Common::Timer::ConvertValueToNanoseconds(current_time - m_wake_pending_since) < WAKE_DELAY_NS)
+  {
+    return;
+  }
+
+  WakeGPUThread();
+}
+
+void GPUBackend::EndCommandBurst()
+{
+  // The deadline is only checked on the next push, which may not come until the frame ends.
+  if (m_wake_pending_since != 0)
+    WakeGPUThread();
+}
+
+bool GPUBackend::WaitForCommands(bool allow_sleep)
+{
+  const Common::Timer::Value start_time = Common::Timer::GetValue();
+
+  // Commands usually arrive in bursts, and spinning is much cheaper than sleeping between them. The spin grows while
+  // it keeps catching commands, and shrinks back when it doesn't, so an idle thread doesn't burn a core.
+  if (!allow_sleep)
+  {
+    for (u32 i = 1;; i++)
+    {
+      SpinPause();
+      if (m_command_fifo_write_ptr.load() != m_command_fifo_read_ptr.load(std::memory_order_relaxed))
+      {
+        m_spin_time_ns = std::min(m_spin_time_ns * 2.0, MAX_SPIN_TIME_NS);
+        m_consumer_idle_ns.fetch_add(GetElapsedNanoseconds(start_time), std::memory_order_relaxed);
+        return true;
+      }
+
+      if ((i % 64) == 0 && (m_gpu_loop_done.load() || GetElapsedNanoseconds(start_time) >= m_spin_time_ns))
+        break;
+    }
+
+    m_spin_time_ns = std::max(m_spin_time_ns * 0.5, MIN_SPIN_TIME_NS);
+  }
+
+  // The flag is set before checking for commands, and the CPU thread stores the write pointer before checking the
+  // flag, so one of the two always sees the other.
+  {
+    std::unique_lock<std::mutex> lock(m_sync_mutex);
+    m_gpu_thread_sleeping.store(true);
+    m_wake_gpu_thread_cv.wait(lock, [this]() { return m_gpu_loop_done.load() || GetPendingCommandSize() > 0; });
+    m_gpu_thread_sleeping.store(false);
+  }
+
+  m_consumer_sleeps.fetch_add(1, std::memory_order_relaxed);
+  m_consumer_idle_ns.fetch_add(GetElapsedNanoseconds(start_time), std::memory_order_relaxed);
+  return !m_gpu_loop_done.load();
 }
 
 void GPUBackend::StartGPUThread()
@@ -187,47 +294,86 @@ void GPUBackend::StopGPUThread()
 void GPUBackend::Sync(bool allow_sleep)
 {
   if (!m_use_gpu_thread)
+  {
+    FlushRender();
     return;
+  }
 
   GPUBackendSyncCommand* cmd =
     static_cast<GPUBackendSyncCommand*>(AllocateCommand(GPUBackendCommandType::Sync, sizeof(GPUBackendSyncCommand)));
   cmd->allow_sleep = allow_sleep;
+
+  const Common::Timer::Value start_time = Common::Timer::GetValue();
+  const u32 sync_index = ++m_syncs_requested;
   PushCommand(cmd);
   WakeGPUThread();
 
-  m_sync_event.Wait();
-  m_sync_event.Reset();
+  // Most syncs only have a few commands to wait for, so spin before sleeping.
+  for (u32 i = 1; m_syncs_completed.load() != sync_index; i++)
+  {
+    SpinPause();
+    if ((i % 64) == 0 && GetElapsedNanoseconds(start_time) >= SYNC_SPIN_TIME_NS)
+    {
+      std::unique_lock<std::mutex> lock(m_sync_mutex);
+      m_sync_waiting.store(true);
+      m_sync_cv.wait(lock, [this, sync_index]() { return m_syncs_completed.load() == sync_index; });
+      m_sync_waiting.store(false);
+      break;
+    }
+  }
+
+  const u64 wait_time = GetElapsedNanoseconds(start_time);
+  m_thread_stats.syncs++;
+  m_thread_stats.sync_wait_ns += wait_time;
+  m_thread_stats.max_sync_wait_ns = std::max(m_thread_stats.max_sync_wait_ns, wait_time);
+}
+
+void GPUBackend::SignalSyncCompleted()
+{
+  // Same ordering as the sleeping flag, see WaitForCommands().
+  m_syncs_completed.fetch_add(1);
+  if (!m_sync_waiting.load())
+    return;
+
+  std::unique_lock<std::mutex> lock(m_sync_mutex);
+  m_sync_cv.notify_one();
+}
+
+GPUBackend::ThreadStatistics GPUBackend::GetThreadStatistics() const
+{
+  ThreadStatistics stats = m_thread_stats;
+  stats.consumer_sleeps = m_consumer_sleeps.load(std::memory_order_relaxed);
+  stats.consumer_idle_ns = m_consumer_idle_ns.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void GPUBackend::ResetThreadStatistics()
+{
+  m_thread_stats = {};
+  m_consumer_sleeps.store(0, std::memory_order_relaxed);
+  m_consumer_idle_ns.store(0, std::memory_order_relaxed);
 }
 
 void GPUBackend::RunGPULoop()
 {
-  static constexpr double SPIN_TIME_NS = 1 * 1000000;
-  Common::Timer::Value last_command_time = 0;
+  bool allow_sleep = false;
 
   for (;;)
   {
     u32 write_ptr = m_command_fifo_write_ptr.load();
-    u32 read_ptr = m_command_fifo_read_ptr.load();
+    u32 read_ptr = m_command_fifo_read_ptr.load(std::memory_order_relaxed);
     if (read_ptr == write_ptr)
     {
-      const Common::Timer::Value current_time = Common::Timer::GetValue();
-      if (Common::Timer::ConvertValueToNanoseconds(current_time - last_command_time) < SPIN_TIME_NS)
-        continue;
-
-      std::unique_lock<std::mutex> lock(m_sync_mutex);
-      m_gpu_thread_sleeping.store(true);
-      m_wake_gpu_thread_cv.wait(lock, [this]() { return m_gpu_loop_done.load() || GetPendingCommandSize() > 0; });
-      m_gpu_thread_sleeping.store(false);
+      if (!WaitForCommands(allow_sleep))
+        break;
 
-      if (!m_gpu_loop_done.load())
-        continue;
-      break;
+      continue;
     }
 
     if (write_ptr < read_ptr)
       write_ptr = COMMAND_QUEUE_SIZE;
 
-    bool allow_sleep = false;
+    allow_sleep = false;
     while (read_ptr < write_ptr)
     {
       const GPUBackendCommand* cmd = reinterpret_cast<const GPUBackendCommand*>(&m_command_fifo_data[read_ptr]);
@@ -244,7 +390,8 @@ void GPUBackend::RunGPULoop()
 
         case GPUBackendCommandType::Sync:
         {
-          m_sync_event.Signal();
+          FlushRender();
+          SignalSyncCompleted();
           allow_sleep = static_cast<const GPUBackendSyncCommand*>(cmd)->allow_sleep;
         }
         break;
@@ -255,7 +402,6 @@ void GPUBackend::RunGPULoop()
       }
     }
 
-    last_command_time = allow_sleep ? 0 : Common::Timer::GetValue();
     m_command_fifo_read_ptr.store(read_ptr);
   }
 }
@@ -1,6 +1,6 @@
 #pragma once
-#include "common/event.h"
 #include "common/heap_array.h"
+#include "common/timer.h"
 #include "gpu_types.h"
 #include <atomic>
 #include <condition_variable>
@@ -16,6 +16,19 @@
 class GPUBackend
 {
 public:
+  /// Counters for the handoff between the CPU and GPU threads, since the last reset.
+  struct ThreadStatistics
+  {
+    u64 producer_stalls;  ///< Commands which had to wait for space in the FIFO.
+    u64 producer_stall_ns;
+    u64 wakes;            ///< Times the GPU thread was woken from a sleep.
+    u64 consumer_sleeps;  ///< Times the GPU thread ran out of commands and went to sleep.
+    u64 consumer_idle_ns; ///< Time the GPU thread spent spinning or sleeping without commands.
+    u64 syncs;            ///< Sync() calls which waited for the GPU thread.
+    u64 sync_wait_ns;
+    u64 max_sync_wait_ns;
+  };
+
   GPUBackend();
   virtual ~GPUBackend();
 
@@ -37,13 +50,23 @@ public:
   void PushCommand(GPUBackendCommand* cmd);
   void Sync(bool allow_sleep);
 
+  /// Wakes the GPU thread if commands were left waiting for a batch to fill, since no more are coming for now.
+  void EndCommandBurst();
+
   /// Processes all pending GPU commands.
   void RunGPULoop();
 
+  ALWAYS_INLINE bool IsUsingThread() const { return m_use_gpu_thread; }
+  ThreadStatistics GetThreadStatistics() const;
+  void ResetThreadStatistics();
+
 protected:
   void* AllocateCommand(GPUBackendCommandType command, u32 size);
   u32 GetPendingCommandSize() const;
   void WakeGPUThread();
+  void WakeGPUThreadForBatch();
+  bool WaitForCommands(bool allow_sleep);
+  void SignalSyncCompleted();
   void StartGPUThread();
   void StopGPUThread();
 
@@ -55,6 +78,7 @@ protected:
   virtual void DrawPolygon(const GPUBackendDrawPolygonCommand* cmd) = 0;
   virtual void DrawRectangle(const GPUBackendDrawRectangleCommand* cmd) = 0;
   virtual void DrawLine(const GPUBackendDrawLineCommand* cmd) = 0;
+  /// Draws anything which has been batched up, before VRAM is accessed some other way.
   virtual void FlushRender() = 0;
 
   void HandleCommand(const GPUBackendCommand* cmd);
@@ -63,16 +87,37 @@ protected:
 
   Common::Rectangle<u32> m_drawing_area{};
 
-  Common::Event m_sync_event;
   std::atomic_bool m_gpu_thread_sleeping{false};
   std::atomic_bool m_gpu_loop_done{false};
+  std::atomic_bool m_sync_waiting{false};
   std::thread m_gpu_thread;
   bool m_use_gpu_thread = false;
 
   std::mutex m_sync_mutex;
   std::condition_variable m_wake_gpu_thread_cv;
+  std::condition_variable m_sync_cv;
+
+  /// A sleeping GPU thread is woken once this many bytes are pending, the oldest of them has waited this long, or the
+  /// burst of commands which queued them ends.
+  static constexpr u32 COMMAND_QUEUE_SIZE = 4 * 1024 * 1024, WAKE_BATCH_SIZE = 16 * 1024;
+  static constexpr double WAKE_DELAY_NS = 100 * 1000;
+
+  /// The GPU thread spins for between these times waiting for commands before it sleeps.
+  static constexpr double MIN_SPIN_TIME_NS = 10 * 1000, MAX_SPIN_TIME_NS = 1000 * 1000;
+
+  /// Sync() spins for this long waiting for the GPU thread before it sleeps.
+  static constexpr double SYNC_SPIN_TIME_NS = 50 * 1000;
+
+  // Only touched by the CPU thread.
+  Common::Timer::Value m_wake_pending_since = 0;
+  u32 m_syncs_requested = 0;
+  ThreadStatistics m_thread_stats = {};
 
-  static constexpr u32 COMMAND_QUEUE_SIZE = 4 * 1024 * 1024, THRESHOLD_TO_WAKE_GPU = 256;
+  // Only touched by the GPU thread, apart from the counters.
+  double m_spin_time_ns = MIN_SPIN_TIME_NS;
+  alignas(64) std::atomic<u32> m_syncs_completed{0};
+  std::atomic<u64> m_consumer_sleeps{0};
+  std::atomic<u64> m_consumer_idle_ns{0};
 
   HeapArray<u8, COMMAND_QUEUE_SIZE> m_command_fifo_data;
   alignas(64) std::atomic<u32> m_command_fifo_read_ptr{0};
@@ -1,5 +1,6 @@
 #include "common/string_util.h"
 #include "gpu.h"
+#include "gpu_backend.h"
 #include "interrupt_controller.h"
 #include "system.h"
 #include "texture_replacements.h"
@@ -82,6 +83,7 @@ void GPU::ExecuteCommands()
             // drop terminator
             m_fifo.RemoveOne();
             DispatchRenderCommand();
+            MarkDrawingAreaDirty();
             m_blit_buffer.clear();
             EndCommand();
             continue;
@@ -98,6 +100,10 @@ void GPU::ExecuteCommands()
       break;
   }
 
+  // the CPU is done feeding the GPU for now, so don't leave a partial batch queued until the next command
+  if (GPUBackend* backend = GetBackend())
+    backend->EndCommandBurst();
+
   UpdateGPUIdle();
   m_syncing = false;
 }
@@ -320,6 +326,7 @@ bool GPU::HandleRenderPolygonCommand()
   m_fifo.RemoveOne();
 
   DispatchRenderCommand();
+  MarkDrawingAreaDirty();
   EndCommand();
   return true;
 }
@@ -345,6 +352,7 @@ bool GPU::HandleRenderRectangleCommand()
   m_fifo.RemoveOne();
 
   DispatchRenderCommand();
+  MarkDrawingAreaDirty();
   EndCommand();
   return true;
 }
@@ -362,6 +370,7 @@ bool GPU::HandleRenderLineCommand()
   m_fifo.RemoveOne();
 
   DispatchRenderCommand();
+  MarkDrawingAreaDirty();
   EndCommand();
   return true;
 }
@@ -411,7 +420,10 @@ bool GPU::HandleFillRectangleCommand()
   const u32 height = (FifoPop() >> 16) & VRAM_HEIGHT_MASK;
 
   if (width > 0 && height > 0)
+  {
     FillVRAM(dst_x, dst_y, width, height, color);
+    MarkVRAMRowsDirty(dst_y, height);
+  }
 
   AddCommandTicks(46 + ((width / 8) + 9) * height);
   EndCommand();
@@ -482,6 +494,7 @@ void GPU::FinishVRAMWrite()
     }
   }
 
+  MarkVRAMRowsDirty(m_vram_transfer.y, m_vram_transfer.height);
   m_blit_buffer.clear();
   m_vram_transfer = {};
   m_blitter_state = BlitterState::Idle;
@@ -527,6 +540,7 @@ bool GPU::HandleCopyRectangleVRAMToVRAMCommand()
   {
     FlushRender();
     CopyVRAM(src_x, src_y, dst_x, dst_y, width, height);
+    MarkVRAMRowsDirty(dst_y, height);
   }
 
   AddCommandTicks(width * height * 2);
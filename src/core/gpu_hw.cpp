@@ -120,6 +120,7 @@ bool GPU_HW::DoState(StateWrapper& sw, HostDisplayTexture** host_texture, bool u
   if (sw.IsReading())
   {
     m_batch_current_vertex_ptr = m_batch_start_vertex_ptr;
+    m_vram_writes.MarkAllDirty();
     SetFullVRAMDirtyRectangle();
     ResetBatchVertexDepth();
   }
@@ -664,41 +664,15 @@ void FilteredSampleFromVRAM(uint4 texpage, float2 coords, float4 uv_limits,
   }
 }
 
-std::string GPU_HW_ShaderGen::GenerateBatchFragmentShader(GPU_HW::BatchRenderMode transparency,
-                                                          GPUTextureMode texture_mode, bool dithering, bool interlacing)
+bool GPU_HW_ShaderGen::UsingDualSourceBlend(GPU_HW::BatchRenderMode transparency) const
 {
-  const GPUTextureMode actual_texture_mode = texture_mode & ~GPUTextureMode::RawTextureBit;
-  const bool raw_texture = (texture_mode & GPUTextureMode::RawTextureBit) == GPUTextureMode::RawTextureBit;
-  const bool textured = (texture_mode != GPUTextureMode::Disabled);
-  const bool use_dual_source =
-    m_supports_dual_source_blend && ((transparency != GPU_HW::BatchRenderMode::TransparencyDisabled &&
-                                      transparency != GPU_HW::BatchRenderMode::OnlyOpaque) ||
-                                     m_texture_filter != GPUTextureFilter::Nearest);
-
-  std::stringstream ss;
-  WriteHeader(ss);
-  DefineMacro(ss, "TRANSPARENCY", transparency != GPU_HW::BatchRenderMode::TransparencyDisabled);
-  DefineMacro(ss, "TRANSPARENCY_ONLY_OPAQUE", transparency == GPU_HW::BatchRenderMode::OnlyOpaque);
-  DefineMacro(ss, "TRANSPARENCY_ONLY_TRANSPARENT", transparency == GPU_HW::BatchRenderMode::OnlyTransparent);
-  DefineMacro(ss, "TEXTURED", textured);
-  DefineMacro(ss, "PALETTE",
-              actual_texture_mode == GPUTextureMode::Palette4Bit || actual_texture_mode == GPUTextureMode::Palette8Bit);
-  DefineMacro(ss, "PALETTE_4_BIT", actual_texture_mode == GPUTextureMode::Palette4Bit);
-  DefineMacro(ss, "PALETTE_8_BIT", actual_texture_mode == GPUTextureMode::Palette8Bit);
-  DefineMacro(ss, "RAW_TEXTURE", raw_texture);
-  DefineMacro(ss, "DITHERING", dithering);
-  DefineMacro(ss, "DITHERING_SCALED", m_scaled_dithering);
-  DefineMacro(ss, "INTERLACING", interlacing);
-  DefineMacro(ss, "TRUE_COLOR", m_true_color);
-  DefineMacro(ss, "TEXTURE_FILTERING", m_texture_filter != GPUTextureFilter::Nearest);
-  DefineMacro(ss, "UV_LIMITS", m_uv_limits);
-  DefineMacro(ss, "USE_DUAL_SOURCE", use_dual_source);
-  DefineMacro(ss, "PGXP_DEPTH", m_pgxp_depth);
-
-  WriteCommonFunctions(ss);
-  WriteBatchUniformBuffer(ss);
-  DeclareTexture(ss, "samp0", 0);
+  return m_supports_dual_source_blend && ((transparency != GPU_HW::BatchRenderMode::TransparencyDisabled &&
+                                           transparency != GPU_HW::BatchRenderMode::OnlyOpaque) ||
+                                          m_texture_filter != GPUTextureFilter::Nearest);
+}
 
+void GPU_HW_ShaderGen::WriteBatchDithering(std::stringstream& ss)
+{
   if (m_glsl)
     ss << "CONSTANT int[16] s_dither_values = int[16]( ";
   else
@@ -730,9 +704,12 @@ uint3 ApplyDithering(uint2 coord, uint3 icol)
     return uint3(clamp(int3(icol) + int3(offset, offset, offset), 0, 255));
   #endif
 }
+)";
+}
 
-#if TEXTURED
-CONSTANT float4 TRANSPARENT_PIXEL_COLOR = float4(0.0, 0.0, 0.0, 0.0);
+void GPU_HW_ShaderGen::WriteBatchTextureWindow(std::stringstream& ss)
+{
+  ss << R"(CONSTANT float4 TRANSPARENT_PIXEL_COLOR = float4(0.0, 0.0, 0.0, 0.0);
 
 uint2 ApplyTextureWindow(uint2 coords)
 {
@@ -754,7 +731,159 @@ uint2 FloatToIntegerCoords(float2 coords)
   // Floor them otherwise, as it currently breaks when upscaling as the vertex offset is not applied.
   return uint2((RESOLUTION_SCALE == 1u) ? roundEven(coords) : floor(coords));
 }
+)";
+}
+
+void GPU_HW_ShaderGen::WriteBatchFragmentEntryPoint(std::stringstream& ss, bool textured, bool use_dual_source)
+{
+  if (textured)
+  {
+    if (m_texture_filter != GPUTextureFilter::Nearest)
+      WriteBatchTextureFilter(ss, m_texture_filter);
+
+    if (m_uv_limits)
+    {
+      DeclareFragmentEntryPoint(ss, 1, 1,
+                                {{"nointerpolation", "uint4 v_texpage"}, {"nointerpolation", "float4 v_uv_limits"}},
+                                true, use_dual_source ? 2 : 1, !m_pgxp_depth, UsingMSAA(), UsingPerSampleShading(),
+                                false, m_disable_color_perspective);
+    }
+    else
+    {
+      DeclareFragmentEntryPoint(ss, 1, 1, {{"nointerpolation", "uint4 v_texpage"}}, true, use_dual_source ? 2 : 1,
+                                !m_pgxp_depth, UsingMSAA(), UsingPerSampleShading(), false,
+                                m_disable_color_perspective);
+    }
+  }
+  else
+  {
+    DeclareFragmentEntryPoint(ss, 1, 0, {}, true, use_dual_source ? 2 : 1, !m_pgxp_depth, UsingMSAA(),
+                              UsingPerSampleShading(), false, m_disable_color_perspective);
+  }
+}
+
+void GPU_HW_ShaderGen::WriteBatchFragmentOutput(std::stringstream& ss)
+{
+  ss << R"(
+  // Premultiply alpha so we don't need to use a colour output for it.
+  float premultiply_alpha = ialpha;
+  #if TRANSPARENCY
+    premultiply_alpha = ialpha * (semitransparent ? u_src_alpha_factor : 1.0);
+  #endif
 
+  float3 color;
+  #if !TRUE_COLOR
+    // We want to apply the alpha before the truncation to 16-bit, otherwise we'll be passing a 32-bit precision color
+    // into the blend unit, which can cause a small amount of error to accumulate.
+    color = floor(float3(icolor) * premultiply_alpha) / float3(31.0, 31.0, 31.0);
+  #else
+    // True color is actually simpler here since we want to preserve the precision.
+    color = (float3(icolor) * premultiply_alpha) / float3(255.0, 255.0, 255.0);
+  #endif
+
+  #if TRANSPARENCY && TEXTURED
+    // Apply semitransparency. If not a semitransparent texel, destination alpha is ignored.
+    if (semitransparent)
+    {
+      #if USE_DUAL_SOURCE
+        o_col0 = float4(color, oalpha);
+        o_col1 = float4(0.0, 0.0, 0.0, u_dst_alpha_factor / ialpha);
+      #else
+        o_col0 = float4(color, oalpha);
+      #endif
+
+      #if !PGXP_DEPTH
+        o_depth = oalpha * v_pos.z;
+      #endif
+
+      #if TRANSPARENCY_ONLY_OPAQUE
+        discard;
+      #endif
+    }
+    else
+    {
+      #if USE_DUAL_SOURCE
+        o_col0 = float4(color, oalpha);
+        o_col1 = float4(0.0, 0.0, 0.0, 1.0 - ialpha);
+      #else
+        o_col0 = float4(color, oalpha);
+      #endif
+
+      #if !PGXP_DEPTH
+        o_depth = oalpha * v_pos.z;
+      #endif
+
+      #if TRANSPARENCY_ONLY_TRANSPARENT
+        discard;
+      #endif
+    }
+  #elif TRANSPARENCY
+    // We shouldn't be rendering opaque geometry only when untextured, so no need to test/discard here.
+    #if USE_DUAL_SOURCE
+      o_col0 = float4(color, oalpha);
+      o_col1 = float4(0.0, 0.0, 0.0, u_dst_alpha_factor / ialpha);
+    #else
+      o_col0 = float4(color, oalpha);
+    #endif
+
+    #if !PGXP_DEPTH
+      o_depth = oalpha * v_pos.z;
+    #endif
+  #else
+    // Non-transparency won't enable blending so we can write the mask here regardless.
+    o_col0 = float4(color, oalpha);
+
+    #if USE_DUAL_SOURCE
+      o_col1 = float4(0.0, 0.0, 0.0, 1.0 - ialpha);
+    #endif
+
+    #if !PGXP_DEPTH
+      o_depth = oalpha * v_pos.z;
+    #endif
+  #endif
+}
+)";
+}
+
+std::string GPU_HW_ShaderGen::GenerateBatchFragmentShader(GPU_HW::BatchRenderMode transparency,
+                                                          GPUTextureMode texture_mode, bool dithering, bool interlacing)
+{
+  const GPUTextureMode actual_texture_mode = texture_mode & ~GPUTextureMode::RawTextureBit;
+  const bool raw_texture = (texture_mode & GPUTextureMode::RawTextureBit) == GPUTextureMode::RawTextureBit;
+  const bool textured = (texture_mode != GPUTextureMode::Disabled);
+  const bool use_dual_source = UsingDualSourceBlend(transparency);
+
+  std::stringstream ss;
+  WriteHeader(ss);
+  DefineMacro(ss, "TRANSPARENCY", transparency != GPU_HW::BatchRenderMode::TransparencyDisabled);
+  DefineMacro(ss, "TRANSPARENCY_ONLY_OPAQUE", transparency == GPU_HW::BatchRenderMode::OnlyOpaque);
+  DefineMacro(ss, "TRANSPARENCY_ONLY_TRANSPARENT", transparency == GPU_HW::BatchRenderMode::OnlyTransparent);
+  DefineMacro(ss, "TEXTURED", textured);
+  DefineMacro(ss, "PALETTE",
+              actual_texture_mode == GPUTextureMode::Palette4Bit || actual_texture_mode == GPUTextureMode::Palette8Bit);
+  DefineMacro(ss, "PALETTE_4_BIT", actual_texture_mode == GPUTextureMode::Palette4Bit);
+  DefineMacro(ss, "PALETTE_8_BIT", actual_texture_mode == GPUTextureMode::Palette8Bit);
+  DefineMacro(ss, "RAW_TEXTURE", raw_texture);
+  DefineMacro(ss, "DITHERING", dithering);
+  DefineMacro(ss, "DITHERING_SCALED", m_scaled_dithering);
+  DefineMacro(ss, "INTERLACING", interlacing);
+  DefineMacro(ss, "TRUE_COLOR", m_true_color);
+  DefineMacro(ss, "TEXTURE_FILTERING", m_texture_filter != GPUTextureFilter::Nearest);
+  DefineMacro(ss, "UV_LIMITS", m_uv_limits);
+  DefineMacro(ss, "USE_DUAL_SOURCE", use_dual_source);
+  DefineMacro(ss, "PGXP_DEPTH", m_pgxp_depth);
+
+  WriteCommonFunctions(ss);
+  WriteBatchUniformBuffer(ss);
+  DeclareTexture(ss, "samp0", 0);
+  WriteBatchDithering(ss);
+
+  ss << R"(
+#if TEXTURED
+)";
+  WriteBatchTextureWindow(ss);
+
+  ss << R"(
 float4 SampleFromVRAM(uint4 texpage, float2 coords)
 {
   #if PALETTE
@@ -796,30 +925,7 @@ float4 SampleFromVRAM(uint4 texpage, float2 coords)
 #endif
 )";
 
-  if (textured)
-  {
-    if (m_texture_filter != GPUTextureFilter::Nearest)
-      WriteBatchTextureFilter(ss, m_texture_filter);
-
-    if (m_uv_limits)
-    {
-      DeclareFragmentEntryPoint(ss, 1, 1,
-                                {{"nointerpolation", "uint4 v_texpage"}, {"nointerpolation", "float4 v_uv_limits"}},
-                                true, use_dual_source ? 2 : 1, !m_pgxp_depth, UsingMSAA(), UsingPerSampleShading(),
-                                false, m_disable_color_perspective);
-    }
-    else
-    {
-      DeclareFragmentEntryPoint(ss, 1, 1, {{"nointerpolation", "uint4 v_texpage"}}, true, use_dual_source ? 2 : 1,
-                                !m_pgxp_depth, UsingMSAA(), UsingPerSampleShading(), false,
-                                m_disable_color_perspective);
-    }
-  }
-  else
-  {
-    DeclareFragmentEntryPoint(ss, 1, 0, {}, true, use_dual_source ? 2 : 1, !m_pgxp_depth, UsingMSAA(),
-                              UsingPerSampleShading(), false, m_disable_color_perspective);
-  }
+  WriteBatchFragmentEntryPoint(ss, textured, use_dual_source);
 
   ss << R"(
 {
@@ -915,86 +1021,181 @@ float4 SampleFromVRAM(uint4 texpage, float2 coords)
     // However, the mask bit is cleared if set mask bit is false.
     oalpha = float(u_set_mask_while_drawing);
   #endif
+)";
 
-  // Premultiply alpha so we don't need to use a colour output for it.
-  float premultiply_alpha = ialpha;
-  #if TRANSPARENCY
-    premultiply_alpha = ialpha * (semitransparent ? u_src_alpha_factor : 1.0);
-  #endif
+  WriteBatchFragmentOutput(ss);
+  return ss.str();
+}
 
-  float3 color;
-  #if !TRUE_COLOR
-    // We want to apply the alpha before the truncation to 16-bit, otherwise we'll be passing a 32-bit precision color
-    // into the blend unit, which can cause a small amount of error to accumulate.
-    color = floor(float3(icolor) * premultiply_alpha) / float3(31.0, 31.0, 31.0);
-  #else
-    // True color is actually simpler here since we want to preserve the precision.
-    color = (float3(icolor) * premultiply_alpha) / float3(255.0, 255.0, 255.0);
-  #endif
+std::string GPU_HW_ShaderGen::GenerateBatchUberFragmentShader(GPU_HW::BatchRenderMode transparency, bool textured)
+{
+  const bool use_dual_source = UsingDualSourceBlend(transparency);
 
-  #if TRANSPARENCY && TEXTURED
-    // Apply semitransparency. If not a semitransparent texel, destination alpha is ignored.
-    if (semitransparent)
-    {
-      #if USE_DUAL_SOURCE
-        o_col0 = float4(color, oalpha);
-        o_col1 = float4(0.0, 0.0, 0.0, u_dst_alpha_factor / ialpha);
-      #else
-        o_col0 = float4(color, oalpha);
-      #endif
+  std::stringstream ss;
+  WriteHeader(ss);
+  DefineMacro(ss, "TRANSPARENCY", transparency != GPU_HW::BatchRenderMode::TransparencyDisabled);
+  DefineMacro(ss, "TRANSPARENCY_ONLY_OPAQUE", transparency == GPU_HW::BatchRenderMode::OnlyOpaque);
+  DefineMacro(ss, "TRANSPARENCY_ONLY_TRANSPARENT", transparency == GPU_HW::BatchRenderMode::OnlyTransparent);
+  DefineMacro(ss, "TEXTURED", textured);
+  DefineMacro(ss, "DITHERING_SCALED", m_scaled_dithering);
+  DefineMacro(ss, "TRUE_COLOR", m_true_color);
+  DefineMacro(ss, "TEXTURE_FILTERING", m_texture_filter != GPUTextureFilter::Nearest);
+  DefineMacro(ss, "UV_LIMITS", m_uv_limits);
+  DefineMacro(ss, "USE_DUAL_SOURCE", use_dual_source);
+  DefineMacro(ss, "PGXP_DEPTH", m_pgxp_depth);
 
-      #if !PGXP_DEPTH
-        o_depth = oalpha * v_pos.z;
-      #endif
+  WriteCommonFunctions(ss);
+  WriteBatchUniformBuffer(ss);
+  DeclareUniformBuffer(ss, {"uint u_uber_flags"}, true);
+  DeclareTexture(ss, "samp0", 0);
+  WriteBatchDithering(ss);
 
-      #if TRANSPARENCY_ONLY_OPAQUE
-        discard;
-      #endif
-    }
+  ss << "CONSTANT uint UBER_DITHERING_BIT = " << UBER_DITHERING_BIT << "u;\n";
+  ss << "CONSTANT uint UBER_INTERLACING_BIT = " << UBER_INTERLACING_BIT << "u;\n";
+  ss << R"(
+// The low bits of the flags are the GPUTextureMode.
+bool UberPalette() { return (u_uber_flags & 2u) == 0u; }
+bool UberPalette4Bit() { return (u_uber_flags & 3u) == 0u; }
+bool UberRawTexture() { return (u_uber_flags & 4u) != 0u; }
+bool UberDithering() { return (u_uber_flags & UBER_DITHERING_BIT) != 0u; }
+bool UberInterlacing() { return (u_uber_flags & UBER_INTERLACING_BIT) != 0u; }
+
+#if TEXTURED
+)";
+  WriteBatchTextureWindow(ss);
+
+  ss << R"(
+float4 SampleFromVRAM(uint4 texpage, float2 coords)
+{
+  if (UberPalette())
+  {
+    bool palette_4_bit = UberPalette4Bit();
+    uint2 icoord = ApplyTextureWindow(FloatToIntegerCoords(coords));
+    uint2 index_coord = icoord;
+    index_coord.x /= palette_4_bit ? 4u : 2u;
+
+    // fixup coords
+    uint2 vicoord = uint2(texpage.x + index_coord.x * RESOLUTION_SCALE, fixYCoord(texpage.y + index_coord.y * RESOLUTION_SCALE));
+
+    // load colour/palette
+    float4 texel = SAMPLE_TEXTURE(samp0, float2(vicoord) * RCP_VRAM_SIZE);
+    uint vram_value = RGBA8ToRGBA5551(texel);
+
+    // apply palette
+    uint palette_index;
+    if (palette_4_bit)
+      palette_index = (vram_value >> ((icoord.x & 3u) * 4u)) & 0x0Fu;
     else
-    {
-      #if USE_DUAL_SOURCE
-        o_col0 = float4(color, oalpha);
-        o_col1 = float4(0.0, 0.0, 0.0, 1.0 - ialpha);
-      #else
-        o_col0 = float4(color, oalpha);
-      #endif
+      palette_index = (vram_value >> ((icoord.x & 1u) * 8u)) & 0xFFu;
 
-      #if !PGXP_DEPTH
-        o_depth = oalpha * v_pos.z;
-      #endif
+    // sample palette
+    uint2 palette_icoord = uint2(texpage.z + (palette_index * RESOLUTION_SCALE), fixYCoord(texpage.w));
+    return SAMPLE_TEXTURE(samp0, float2(palette_icoord) * RCP_VRAM_SIZE);
+  }
+  else
+  {
+    // Direct texturing. Render-to-texture effects. Use upscaled coordinates.
+    uint2 icoord = ApplyUpscaledTextureWindow(FloatToIntegerCoords(coords));
+    uint2 direct_icoord = uint2(texpage.x + icoord.x, fixYCoord(texpage.y + icoord.y));
+    return SAMPLE_TEXTURE(samp0, float2(direct_icoord) * RCP_VRAM_SIZE);
+  }
+}
 
-      #if TRANSPARENCY_ONLY_TRANSPARENT
+#endif
+)";
+
+  WriteBatchFragmentEntryPoint(ss, textured, use_dual_source);
+
+  ss << R"(
+{
+  uint3 vertcol = uint3(v_col0.rgb * float3(255.0, 255.0, 255.0));
+
+  bool semitransparent;
+  uint3 icolor;
+  float ialpha;
+  float oalpha;
+
+  if (UberInterlacing() && (fixYCoord(uint(v_pos.y)) & 1u) == u_interlaced_displayed_field)
+    discard;
+
+  #if TEXTURED
+    bool palette = UberPalette();
+    float2 coords = v_tex0;
+    if (palette)
+      coords /= float2(RESOLUTION_SCALE, RESOLUTION_SCALE);
+
+    #if UV_LIMITS
+      float4 uv_limits = v_uv_limits;
+      if (!palette)
+      {
+        uv_limits *= float(RESOLUTION_SCALE);
+        uv_limits.zw += float(RESOLUTION_SCALE - 1u);
+      }
+    #endif
+
+    float4 texcol;
+    #if TEXTURE_FILTERING
+      FilteredSampleFromVRAM(v_texpage, coords, uv_limits, texcol, ialpha);
+      if (ialpha < 0.5)
         discard;
-      #endif
-    }
-  #elif TRANSPARENCY
-    // We shouldn't be rendering opaque geometry only when untextured, so no need to test/discard here.
-    #if USE_DUAL_SOURCE
-      o_col0 = float4(color, oalpha);
-      o_col1 = float4(0.0, 0.0, 0.0, u_dst_alpha_factor / ialpha);
     #else
-      o_col0 = float4(color, oalpha);
+      #if UV_LIMITS
+        texcol = SampleFromVRAM(v_texpage, clamp(coords, uv_limits.xy, uv_limits.zw));
+      #else
+        texcol = SampleFromVRAM(v_texpage, coords);
+      #endif
+      if (VECTOR_EQ(texcol, TRANSPARENT_PIXEL_COLOR))
+        discard;
+
+      ialpha = 1.0;
     #endif
 
-    #if !PGXP_DEPTH
-      o_depth = oalpha * v_pos.z;
+    semitransparent = (texcol.a >= 0.5);
+
+    #if !TRUE_COLOR
+      icolor = uint3(texcol.rgb * float3(255.0, 255.0, 255.0)) >> 3;
+      if (!UberRawTexture())
+      {
+        icolor = (icolor * vertcol) >> 4;
+        if (UberDithering())
+          icolor = ApplyDithering(uint2(v_pos.xy), icolor);
+        else
+          icolor = min(icolor >> 3, uint3(31u, 31u, 31u));
+      }
+    #else
+      icolor = uint3(texcol.rgb * float3(255.0, 255.0, 255.0));
+      if (!UberRawTexture())
+      {
+        icolor = (icolor * vertcol) >> 7;
+        if (UberDithering())
+          icolor = ApplyDithering(uint2(v_pos.xy), icolor);
+        else
+          icolor = min(icolor, uint3(255u, 255u, 255u));
+      }
     #endif
+
+    oalpha = float(u_set_mask_while_drawing ? 1 : int(semitransparent));
   #else
-    // Non-transparency won't enable blending so we can write the mask here regardless.
-    o_col0 = float4(color, oalpha);
+    semitransparent = true;
+    icolor = vertcol;
+    ialpha = 1.0;
 
-    #if USE_DUAL_SOURCE
-      o_col1 = float4(0.0, 0.0, 0.0, 1.0 - ialpha);
-    #endif
+    if (UberDithering())
+    {
+      icolor = ApplyDithering(uint2(v_pos.xy), icolor);
+    }
+    else
+    {
+      #if !TRUE_COLOR
+        icolor >>= 3;
+      #endif
+    }
 
-    #if !PGXP_DEPTH
-      o_depth = oalpha * v_pos.z;
-    #endif
+    oalpha = float(u_set_mask_while_drawing);
   #endif
-}
 )";
 
+  WriteBatchFragmentOutput(ss);
   return ss.str();
 }
 
@@ -5,6 +5,9 @@
 class GPU_HW_ShaderGen : public ShaderGen
 {
 public:
+  static constexpr u32 UBER_DITHERING_BIT = 1u << 4;
+  static constexpr u32 UBER_INTERLACING_BIT = 1u << 5;
+
   GPU_HW_ShaderGen(HostDisplay::RenderAPI render_api, u32 resolution_scale, u32 multisamples, bool per_sample_shading,
                    bool true_color, bool scaled_dithering, GPUTextureFilter texture_filtering, bool uv_limits,
                    bool pgxp_depth, bool disable_color_perspective, bool supports_dual_source_blend);
@@ -13,6 +16,11 @@ public:
   std::string GenerateBatchVertexShader(bool textured);
   std::string GenerateBatchFragmentShader(GPU_HW::BatchRenderMode transparency, GPUTextureMode texture_mode,
                                           bool dithering, bool interlacing);
+
+  /// Covers every texture mode, dithering and interlacing permutation, chosen at draw time by the u_uber_flags push
+  /// constant: the GPUTextureMode in the low bits, plus UBER_DITHERING_BIT and UBER_INTERLACING_BIT. Vulkan only.
+  std::string GenerateBatchUberFragmentShader(GPU_HW::BatchRenderMode transparency, bool textured);
+
   std::string GenerateDisplayFragmentShader(bool depth_24bit, GPU_HW::InterlacedRenderMode interlace_mode,
                                             bool smooth_chroma);
   std::string GenerateVRAMReadFragmentShader();
@@ -30,9 +38,15 @@ private:
   ALWAYS_INLINE bool UsingMSAA() const { return m_multisamples > 1; }
   ALWAYS_INLINE bool UsingPerSampleShading() const { return m_multisamples > 1 && m_per_sample_shading; }
 
+  bool UsingDualSourceBlend(GPU_HW::BatchRenderMode transparency) const;
+
   void WriteCommonFunctions(std::stringstream& ss);
   void WriteBatchUniformBuffer(std::stringstream& ss);
+  void WriteBatchDithering(std::stringstream& ss);
+  void WriteBatchTextureWindow(std::stringstream& ss);
   void WriteBatchTextureFilter(std::stringstream& ss, GPUTextureFilter texture_filter);
+  void WriteBatchFragmentEntryPoint(std::stringstream& ss, bool textured, bool use_dual_source);
+  void WriteBatchFragmentOutput(std::stringstream& ss);
 
   u32 m_resolution_scale;
   u32 m_multisamples;
@@ -1,6 +1,8 @@
 #include "gpu_hw_vulkan.h"
+#include "common/file_system.h"
 #include "common/log.h"
 #include "common/state_wrapper.h"
+#include "common/string_util.h"
 #include "common/timer.h"
 #include "common/vulkan/builders.h"
 #include "common/vulkan/context.h"
@@ -14,6 +16,8 @@
 #include "../libretro/libretro_host_interface.h"
 #include "system.h"
 #include "vulkan_loader.h"
+#include <algorithm>
+#include <cstring>
 Log_SetChannel(GPU_HW_Vulkan);
 
 class LibretroVulkanHostDisplayTexture : public HostDisplayTexture
@@ -804,6 +808,9 @@ void GPU_HW_Vulkan::UpdateSettings()
 {
   GPU_HW::UpdateSettings();
 
+  // The compile threads read the settings being changed.
+  StopPipelineCompileThreads();
+
   bool framebuffer_changed, shaders_changed;
   UpdateHWSettings(&framebuffer_changed, &shaders_changed);
 
@@ -827,6 +834,10 @@ void GPU_HW_Vulkan::UpdateSettings()
     DestroyPipelines();
     CompilePipelines();
   }
+  else
+  {
+    StartPipelineCompileThreads();
+  }
 
   // this has to be done here, because otherwise we're using destroyed pipelines in the same cmdbuffer
   if (framebuffer_changed)
@@ -1039,6 +1050,7 @@ bool GPU_HW_Vulkan::CreatePipelineLayouts()
 
   Vulkan::PipelineLayoutBuilder plbuilder;
   plbuilder.AddDescriptorSet(m_batch_descriptor_set_layout);
+  plbuilder.AddPushConstants(VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(u32));
   m_batch_pipeline_layout = plbuilder.Create(device);
   if (m_batch_pipeline_layout == VK_NULL_HANDLE)
     return false;
@@ -1427,158 +1439,27 @@ bool GPU_HW_Vulkan::CompilePipelines()
   VkDevice device = g_vulkan_context->GetDevice();
   VkPipelineCache pipeline_cache = g_vulkan_shader_cache->GetPipelineCache();
 
-  GPU_HW_ShaderGen shadergen(m_host_display->GetRenderAPI(), m_resolution_scale, m_multisamples, m_per_sample_shading,
-                             m_true_color, m_scaled_dithering, m_texture_filtering, m_using_uv_limits,
-                             m_pgxp_depth_buffer, m_disable_color_perspective, m_supports_dual_source_blend);
-
-  ShaderCompileProgressTracker progress("Compiling Pipelines", 2 + (4 * 9 * 2 * 2) + (3 * 4 * 5 * 9 * 2 * 2) + 1 + 2 +
-                                                                 (2 * 2) + 2 + 1 + 1 + (2 * 3) + 1);
+  GPU_HW_ShaderGen shadergen = CreateShaderGen();
 
-  // vertex shaders - [textured]
-  // fragment shaders - [render_mode][texture_mode][dithering][interlacing]
-  DimensionalArray<VkShaderModule, 2> batch_vertex_shaders{};
-  DimensionalArray<VkShaderModule, 2, 2, 9, 4> batch_fragment_shaders{};
+  ShaderCompileProgressTracker progress("Compiling Pipelines", 2 + 1 + 2 + (2 * 2) + 2 + 1 + 1 + (2 * 3) + 1);
 
+  // Batch pipelines are only compiled once a game draws with them, see GetBatchPipeline().
   for (u8 textured = 0; textured < 2; textured++)
   {
     const std::string vs = shadergen.GenerateBatchVertexShader(ConvertToBoolUnchecked(textured));
-    VkShaderModule shader = g_vulkan_shader_cache->GetVertexShader(vs);
-    if (shader == VK_NULL_HANDLE)
-    {
-      batch_vertex_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
-      batch_fragment_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
+    m_batch_vertex_shaders[textured] = g_vulkan_shader_cache->GetVertexShader(vs);
+    if (m_batch_vertex_shaders[textured] == VK_NULL_HANDLE)
       return false;
-    }
 
-    batch_vertex_shaders[textured] = shader;
     progress.Increment();
   }
 
-  for (u8 render_mode = 0; render_mode < 4; render_mode++)
-  {
-    for (u8 texture_mode = 0; texture_mode < 9; texture_mode++)
-    {
-      for (u8 dithering = 0; dithering < 2; dithering++)
-      {
-        for (u8 interlacing = 0; interlacing < 2; interlacing++)
-        {
-          const std::string fs = shadergen.GenerateBatchFragmentShader(
-            static_cast<BatchRenderMode>(render_mode), static_cast<GPUTextureMode>(texture_mode),
-            ConvertToBoolUnchecked(dithering), ConvertToBoolUnchecked(interlacing));
-
-          VkShaderModule shader = g_vulkan_shader_cache->GetFragmentShader(fs);
-          if (shader == VK_NULL_HANDLE)
-	  {
-            batch_vertex_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
-            batch_fragment_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
-            return false;
-	  }
-
-          batch_fragment_shaders[render_mode][texture_mode][dithering][interlacing] = shader;
-          progress.Increment();
-        }
-      }
-    }
-  }
+  m_pipeline_cache = pipeline_cache;
+  LoadBatchPipelineList();
+  StartPipelineCompileThreads();
 
   Vulkan::GraphicsPipelineBuilder gpbuilder;
 
-  // [depth_test][render_mode][texture_mode][transparency_mode][dithering][interlacing]
-  for (u8 depth_test = 0; depth_test < 3; depth_test++)
-  {
-    for (u8 render_mode = 0; render_mode < 4; render_mode++)
-    {
-      for (u8 transparency_mode = 0; transparency_mode < 5; transparency_mode++)
-      {
-        for (u8 texture_mode = 0; texture_mode < 9; texture_mode++)
-        {
-          for (u8 dithering = 0; dithering < 2; dithering++)
-          {
-            for (u8 interlacing = 0; interlacing < 2; interlacing++)
-            {
-              static constexpr std::array<VkCompareOp, 3> depth_test_values = {
-                VK_COMPARE_OP_ALWAYS, VK_COMPARE_OP_GREATER_OR_EQUAL, VK_COMPARE_OP_LESS_OR_EQUAL};
-              const bool textured = (static_cast<GPUTextureMode>(texture_mode) != GPUTextureMode::Disabled);
-
-              gpbuilder.SetPipelineLayout(m_batch_pipeline_layout);
-              gpbuilder.SetRenderPass(m_vram_render_pass, 0);
-
-              gpbuilder.AddVertexBuffer(0, sizeof(BatchVertex), VK_VERTEX_INPUT_RATE_VERTEX);
-              gpbuilder.AddVertexAttribute(0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(BatchVertex, x));
-              gpbuilder.AddVertexAttribute(1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(BatchVertex, color));
-              if (textured)
-              {
-                gpbuilder.AddVertexAttribute(2, 0, VK_FORMAT_R32_UINT, offsetof(BatchVertex, u));
-                gpbuilder.AddVertexAttribute(3, 0, VK_FORMAT_R32_UINT, offsetof(BatchVertex, texpage));
-                if (m_using_uv_limits)
-                  gpbuilder.AddVertexAttribute(4, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(BatchVertex, uv_limits));
-              }
-
-              gpbuilder.SetPrimitiveTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
-              gpbuilder.SetVertexShader(batch_vertex_shaders[BoolToUInt8(textured)]);
-              gpbuilder.SetFragmentShader(batch_fragment_shaders[render_mode][texture_mode][dithering][interlacing]);
-
-              gpbuilder.SetRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
-              gpbuilder.SetDepthState(true, true, depth_test_values[depth_test]);
-              gpbuilder.SetNoBlendingState();
-              gpbuilder.SetMultisamples(m_multisamples, m_per_sample_shading);
-
-              if ((static_cast<GPUTransparencyMode>(transparency_mode) != GPUTransparencyMode::Disabled &&
-                   (static_cast<BatchRenderMode>(render_mode) != BatchRenderMode::TransparencyDisabled &&
-                    static_cast<BatchRenderMode>(render_mode) != BatchRenderMode::OnlyOpaque)) ||
-                  m_texture_filtering != GPUTextureFilter::Nearest)
-              {
-                if (m_supports_dual_source_blend)
-                {
-                  gpbuilder.SetBlendAttachment(
-                    0, true, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_SRC1_ALPHA,
-                    (static_cast<GPUTransparencyMode>(transparency_mode) ==
-                       GPUTransparencyMode::BackgroundMinusForeground &&
-                     static_cast<BatchRenderMode>(render_mode) != BatchRenderMode::TransparencyDisabled &&
-                     static_cast<BatchRenderMode>(render_mode) != BatchRenderMode::OnlyOpaque) ?
-                      VK_BLEND_OP_REVERSE_SUBTRACT :
-                      VK_BLEND_OP_ADD,
-                    VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD);
-                }
-                else
-                {
-                  const float factor = (static_cast<GPUTransparencyMode>(transparency_mode) ==
-                                        GPUTransparencyMode::HalfBackgroundPlusHalfForeground) ?
-                                         0.5f :
-                                         1.0f;
-                  gpbuilder.SetBlendAttachment(
-                    0, true, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_CONSTANT_ALPHA,
-                    (static_cast<GPUTransparencyMode>(transparency_mode) ==
-                       GPUTransparencyMode::BackgroundMinusForeground &&
-                     static_cast<BatchRenderMode>(render_mode) != BatchRenderMode::TransparencyDisabled &&
-                     static_cast<BatchRenderMode>(render_mode) != BatchRenderMode::OnlyOpaque) ?
-                      VK_BLEND_OP_REVERSE_SUBTRACT :
-                      VK_BLEND_OP_ADD,
-                    VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD);
-                  gpbuilder.SetBlendConstants(0.0f, 0.0f, 0.0f, factor);
-                }
-              }
-
-              gpbuilder.SetDynamicViewportAndScissorState();
-
-              VkPipeline pipeline = gpbuilder.Create(device, pipeline_cache);
-              if (pipeline == VK_NULL_HANDLE)
-	      {
-                batch_vertex_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
-                batch_fragment_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
-                return false;
-	      }
-
-              m_batch_pipelines[depth_test][render_mode][texture_mode][transparency_mode][dithering][interlacing] =
-                pipeline;
-              progress.Increment();
-            }
-          }
-        }
-      }
-    }
-  }
-
   VkShaderModule fullscreen_quad_vertex_shader =
     g_vulkan_shader_cache->GetVertexShader(shadergen.GenerateScreenQuadVertexShader());
   if (fullscreen_quad_vertex_shader == VK_NULL_HANDLE)
@@ -1925,7 +1806,17 @@ bool GPU_HW_Vulkan::CompilePipelines()
 
 void GPU_HW_Vulkan::DestroyPipelines()
 {
+  StopPipelineCompileThreads();
+  m_pipeline_compile_queue.clear();
+  CollectCompiledBatchPipelines();
+  SaveBatchPipelineList();
+
   m_batch_pipelines.enumerate(Vulkan::Util::SafeDestroyPipeline);
+  m_batch_pipelines_queued.enumerate([](bool& queued) { queued = false; });
+  m_batch_uber_pipelines.enumerate(Vulkan::Util::SafeDestroyPipeline);
+  m_batch_uber_fragment_shaders.enumerate(Vulkan::Util::SafeDestroyShaderModule);
+  for (VkShaderModule& shader : m_batch_vertex_shaders)
+    Vulkan::Util::SafeDestroyShaderModule(shader);
 
   m_vram_fill_pipelines.enumerate(Vulkan::Util::SafeDestroyPipeline);
 
@@ -1946,17 +1837,339 @@ void GPU_HW_Vulkan::DestroyPipelines()
   m_display_pipelines.enumerate(Vulkan::Util::SafeDestroyPipeline);
 }
 
+bool GPU_HW_Vulkan::BatchPipelineKey::IsValid() const
+{
+  return (bits >> 13) == 0 && depth_test < 3 && texture_mode < 9 && transparency_mode < 5;
+}
+
+GPU_HW_ShaderGen GPU_HW_Vulkan::CreateShaderGen() const
+{
+  return GPU_HW_ShaderGen(m_host_display->GetRenderAPI(), m_resolution_scale, m_multisamples, m_per_sample_shading,
+                          m_true_color, m_scaled_dithering, m_texture_filtering, m_using_uv_limits,
+                          m_pgxp_depth_buffer, m_disable_color_perspective, m_supports_dual_source_blend);
+}
+
+VkPipeline GPU_HW_Vulkan::GetBatchPipeline(BatchPipelineKey key, bool* uber)
+{
+  if (m_has_compiled_batch_pipelines.load(std::memory_order_acquire))
+    CollectCompiledBatchPipelines();
+
+  *uber = false;
+  VkPipeline& pipeline = m_batch_pipelines[key.depth_test][key.render_mode][key.texture_mode][key.transparency_mode]
+                                          [BoolToUInt8(key.dithering)][BoolToUInt8(key.interlacing)];
+  if (pipeline != VK_NULL_HANDLE)
+    return pipeline;
+
+  bool& queued = m_batch_pipelines_queued[key.depth_test][key.render_mode][key.texture_mode][key.transparency_mode]
+                                         [BoolToUInt8(key.dithering)][BoolToUInt8(key.interlacing)];
+  if (!queued)
+  {
+    queued = true;
+    QueueBatchPipeline(key);
+    m_batch_pipeline_list.push_back(key.bits);
+    m_batch_pipeline_list_changed = true;
+  }
+
+  VkPipeline uber_pipeline = GetBatchUberPipeline(key);
+  if (uber_pipeline != VK_NULL_HANDLE)
+  {
+    *uber = true;
+    return uber_pipeline;
+  }
+
+  // No uber pipeline to stand in, so the draw has to wait for the real one.
+  GPU_HW_ShaderGen shadergen = CreateShaderGen();
+  pipeline = CompileBatchPipeline(shadergen, key);
+  if (pipeline == VK_NULL_HANDLE)
+    Log_ErrorPrintf("Failed to compile batch pipeline %08X", key.bits);
+
+  return pipeline;
+}
+
+VkPipeline GPU_HW_Vulkan::GetBatchUberPipeline(BatchPipelineKey key)
+{
+  const bool textured = (static_cast<GPUTextureMode>(key.texture_mode.GetValue()) != GPUTextureMode::Disabled);
+  VkPipeline& pipeline =
+    m_batch_uber_pipelines[key.depth_test][key.render_mode][key.transparency_mode][BoolToUInt8(textured)];
+  if (pipeline != VK_NULL_HANDLE)
+    return pipeline;
+
+  VkShaderModule& shader = m_batch_uber_fragment_shaders[key.render_mode][BoolToUInt8(textured)];
+  if (shader == VK_NULL_HANDLE)
+  {
+    GPU_HW_ShaderGen shadergen = CreateShaderGen();
+    const std::string fs =
+      shadergen.GenerateBatchUberFragmentShader(static_cast<BatchRenderMode>(key.render_mode.GetValue()), textured);
+    shader = g_vulkan_shader_cache->GetFragmentShader(fs);
+    if (shader == VK_NULL_HANDLE)
+      return VK_NULL_HANDLE;
+  }
+
+  pipeline = CreateBatchPipeline(shader, key, textured);
+  return pipeline;
+}
+
+VkPipeline GPU_HW_Vulkan::CreateBatchPipeline(VkShaderModule fragment_shader, BatchPipelineKey key,
+                                              bool textured) const
+{
+  static constexpr std::array<VkCompareOp, 3> depth_test_values = {
+    VK_COMPARE_OP_ALWAYS, VK_COMPARE_OP_GREATER_OR_EQUAL, VK_COMPARE_OP_LESS_OR_EQUAL};
+  const BatchRenderMode render_mode = static_cast<BatchRenderMode>(key.render_mode.GetValue());
+  const GPUTransparencyMode transparency_mode = static_cast<GPUTransparencyMode>(key.transparency_mode.GetValue());
+
+  Vulkan::GraphicsPipelineBuilder gpbuilder;
+  gpbuilder.SetPipelineLayout(m_batch_pipeline_layout);
+  gpbuilder.SetRenderPass(m_vram_render_pass, 0);
+
+  gpbuilder.AddVertexBuffer(0, sizeof(BatchVertex), VK_VERTEX_INPUT_RATE_VERTEX);
+  gpbuilder.AddVertexAttribute(0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(BatchVertex, x));
+  gpbuilder.AddVertexAttribute(1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(BatchVertex, color));
+  if (textured)
+  {
+    gpbuilder.AddVertexAttribute(2, 0, VK_FORMAT_R32_UINT, offsetof(BatchVertex, u));
+    gpbuilder.AddVertexAttribute(3, 0, VK_FORMAT_R32_UINT, offsetof(BatchVertex, texpage));
+    if (m_using_uv_limits)
+      gpbuilder.AddVertexAttribute(4, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(BatchVertex, uv_limits));
+  }
+
+  gpbuilder.SetPrimitiveTopology(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST);
+  gpbuilder.SetVertexShader(m_batch_vertex_shaders[BoolToUInt8(textured)]);
+  gpbuilder.SetFragmentShader(fragment_shader);
+
+  gpbuilder.SetRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
+  gpbuilder.SetDepthState(true, true, depth_test_values[key.depth_test]);
+  gpbuilder.SetNoBlendingState();
+  gpbuilder.SetMultisamples(m_multisamples, m_per_sample_shading);
+
+  if ((transparency_mode != GPUTransparencyMode::Disabled &&
+       (render_mode != BatchRenderMode::TransparencyDisabled && render_mode != BatchRenderMode::OnlyOpaque)) ||
+      m_texture_filtering != GPUTextureFilter::Nearest)
+  {
+    const VkBlendOp blend_op = (transparency_mode == GPUTransparencyMode::BackgroundMinusForeground &&
+                                render_mode != BatchRenderMode::TransparencyDisabled &&
+                                render_mode != BatchRenderMode::OnlyOpaque) ?
+                                 VK_BLEND_OP_REVERSE_SUBTRACT :
+                                 VK_BLEND_OP_ADD;
+    if (m_supports_dual_source_blend)
+    {
+      gpbuilder.SetBlendAttachment(0, true, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_SRC1_ALPHA, blend_op,
+                                   VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD);
+    }
+    else
+    {
+      const float factor =
+        (transparency_mode == GPUTransparencyMode::HalfBackgroundPlusHalfForeground) ? 0.5f : 1.0f;
+      gpbuilder.SetBlendAttachment(0, true, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_CONSTANT_ALPHA, blend_op,
+                                   VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD);
+      gpbuilder.SetBlendConstants(0.0f, 0.0f, 0.0f, factor);
+    }
+  }
+
+  gpbuilder.SetDynamicViewportAndScissorState();
+
+  return gpbuilder.Create(g_vulkan_context->GetDevice(), m_pipeline_cache);
+}
+
+VkPipeline GPU_HW_Vulkan::CompileBatchPipeline(GPU_HW_ShaderGen& shadergen, BatchPipelineKey key) const
+{
+  const GPUTextureMode texture_mode = static_cast<GPUTextureMode>(key.texture_mode.GetValue());
+  const std::string fs = shadergen.GenerateBatchFragmentShader(
+    static_cast<BatchRenderMode>(key.render_mode.GetValue()), texture_mode, key.dithering, key.interlacing);
+
+  VkShaderModule shader = g_vulkan_shader_cache->GetFragmentShader(fs);
+  if (shader == VK_NULL_HANDLE)
+    return VK_NULL_HANDLE;
+
+  VkPipeline pipeline = CreateBatchPipeline(shader, key, texture_mode != GPUTextureMode::Disabled);
+  vkDestroyShaderModule(g_vulkan_context->GetDevice(), shader, nullptr);
+  return pipeline;
+}
+
+void GPU_HW_Vulkan::QueueBatchPipeline(BatchPipelineKey key)
+{
+  {
+    std::unique_lock<std::mutex> lock(m_pipeline_compile_mutex);
+    m_pipeline_compile_queue.push_back(key);
+  }
+
+  m_pipeline_compile_cv.notify_one();
+}
+
+void GPU_HW_Vulkan::CollectCompiledBatchPipelines()
+{
+  std::unique_lock<std::mutex> lock(m_pipeline_compile_mutex);
+  m_has_compiled_batch_pipelines.store(false, std::memory_order_relaxed);
+
+  for (const auto& it : m_compiled_batch_pipelines)
+  {
+    // Failed pipelines stay queued, so the uber pipeline keeps being used rather than retrying every draw.
+    const BatchPipelineKey key = it.first;
+    if (it.second == VK_NULL_HANDLE)
+      continue;
+
+    VkPipeline& pipeline = m_batch_pipelines[key.depth_test][key.render_mode][key.texture_mode][key.transparency_mode]
+                                            [BoolToUInt8(key.dithering)][BoolToUInt8(key.interlacing)];
+    if (pipeline != VK_NULL_HANDLE)
+      vkDestroyPipeline(g_vulkan_context->GetDevice(), it.second, nullptr);
+    else
+      pipeline = it.second;
+  }
+
+  m_compiled_batch_pipelines.clear();
+}
+
+void GPU_HW_Vulkan::StartPipelineCompileThreads()
+{
+  const u32 num_threads = std::clamp(std::thread::hardware_concurrency() / 2, 1u, MAX_PIPELINE_COMPILE_THREADS);
+  Log_InfoPrintf("Compiling batch pipelines on %u threads", num_threads);
+
+  m_pipeline_compile_threads_shutdown = false;
+  for (u32 i = 0; i < num_threads; i++)
+    m_pipeline_compile_threads.emplace_back(&GPU_HW_Vulkan::PipelineCompileThreadEntryPoint, this);
+}
+
+void GPU_HW_Vulkan::StopPipelineCompileThreads()
+{
+  if (m_pipeline_compile_threads.empty())
+    return;
+
+  {
+    std::unique_lock<std::mutex> lock(m_pipeline_compile_mutex);
+    m_pipeline_compile_threads_shutdown = true;
+  }
+
+  m_pipeline_compile_cv.notify_all();
+  for (std::thread& thread : m_pipeline_compile_threads)
+    thread.join();
+
+  m_pipeline_compile_threads.clear();
+}
+
+void GPU_HW_Vulkan::PipelineCompileThreadEntryPoint()
+{
+  GPU_HW_ShaderGen shadergen = CreateShaderGen();
+
+  std::unique_lock<std::mutex> lock(m_pipeline_compile_mutex);
+  for (;;)
+  {
+    m_pipeline_compile_cv.wait(
+      lock, [this]() { return m_pipeline_compile_threads_shutdown || !m_pipeline_compile_queue.empty(); });
+    if (m_pipeline_compile_threads_shutdown)
+      break;
+
+    const BatchPipelineKey key = m_pipeline_compile_queue.front();
+    m_pipeline_compile_queue.pop_front();
+    lock.unlock();
+
+    VkPipeline pipeline = CompileBatchPipeline(shadergen, key);
+    if (pipeline == VK_NULL_HANDLE)
+      Log_ErrorPrintf("Failed to compile batch pipeline %08X", key.bits);
+
+    lock.lock();
+    m_compiled_batch_pipelines.emplace_back(key, pipeline);
+    m_has_compiled_batch_pipelines.store(true, std::memory_order_release);
+  }
+}
+
+std::string GPU_HW_Vulkan::GetBatchPipelineListFileName() const
+{
+  const std::string base_path = g_host_interface->GetShaderCacheBasePath();
+  const std::string& code = System::GetRunningCode();
+  if (base_path.empty() || code.empty())
+    return {};
+
+  return StringUtil::StdStringFromFormat("%svulkan_pipelines_%s.bin", base_path.c_str(), code.c_str());
+}
+
+void GPU_HW_Vulkan::LoadBatchPipelineList()
+{
+  m_batch_pipeline_list.clear();
+  m_batch_pipeline_list_changed = false;
+  m_batch_pipeline_list_filename = GetBatchPipelineListFileName();
+  if (m_batch_pipeline_list_filename.empty())
+    return;
+
+  std::optional<std::vector<u8>> data = FileSystem::ReadBinaryFile(m_batch_pipeline_list_filename.c_str());
+  if (!data.has_value())
+    return;
+
+  // magic, version, count, then the keys
+  u32 header[3] = {};
+  if (data->size() >= sizeof(header))
+    std::memcpy(header, data->data(), sizeof(header));
+  if (header[0] != BATCH_PIPELINE_LIST_MAGIC || header[1] != BATCH_PIPELINE_LIST_VERSION ||
+      data->size() != sizeof(header) + header[2] * sizeof(u32))
+  {
+    Log_WarningPrintf("Pipeline list '%s' is invalid, ignoring", m_batch_pipeline_list_filename.c_str());
+    return;
+  }
+
+  for (u32 i = 0; i < header[2]; i++)
+  {
+    BatchPipelineKey key;
+    std::memcpy(&key.bits, data->data() + sizeof(header) + i * sizeof(u32), sizeof(u32));
+    if (!key.IsValid())
+      continue;
+
+    bool& queued = m_batch_pipelines_queued[key.depth_test][key.render_mode][key.texture_mode][key.transparency_mode]
+                                           [BoolToUInt8(key.dithering)][BoolToUInt8(key.interlacing)];
+    if (queued)
+      continue;
+
+    queued = true;
+    m_batch_pipeline_list.push_back(key.bits);
+    m_pipeline_compile_queue.push_back(key);
+  }
+
+  Log_InfoPrintf("Queued %zu batch pipelines from '%s'", m_batch_pipeline_list.size(),
+                 m_batch_pipeline_list_filename.c_str());
+}
+
+void GPU_HW_Vulkan::SaveBatchPipelineList()
+{
+  if (!m_batch_pipeline_list_changed || m_batch_pipeline_list_filename.empty())
+    return;
+
+  m_batch_pipeline_list_changed = false;
+
+  std::vector<u32> data;
+  data.reserve(3 + m_batch_pipeline_list.size());
+  data.push_back(BATCH_PIPELINE_LIST_MAGIC);
+  data.push_back(BATCH_PIPELINE_LIST_VERSION);
+  data.push_back(static_cast<u32>(m_batch_pipeline_list.size()));
+  data.insert(data.end(), m_batch_pipeline_list.begin(), m_batch_pipeline_list.end());
+
+  if (!FileSystem::WriteBinaryFile(m_batch_pipeline_list_filename.c_str(), data.data(), data.size() * sizeof(u32)))
+    Log_ErrorPrintf("Failed to write pipeline list '%s'", m_batch_pipeline_list_filename.c_str());
+}
+
 void GPU_HW_Vulkan::DrawBatchVertices(BatchRenderMode render_mode, u32 base_vertex, u32 num_vertices)
 {
   BeginVRAMRenderPass();
 
   VkCommandBuffer cmdbuf = g_vulkan_context->GetCurrentCommandBuffer();
 
-  // [depth_test][render_mode][texture_mode][transparency_mode][dithering][interlacing]
-  const u8 depth_test = m_batch.use_depth_buffer ? static_cast<u8>(2) : BoolToUInt8(m_batch.check_mask_before_draw);
-  VkPipeline pipeline =
-    m_batch_pipelines[depth_test][static_cast<u8>(render_mode)][static_cast<u8>(m_batch.texture_mode)][static_cast<u8>(
-      m_batch.transparency_mode)][BoolToUInt8(m_batch.dithering)][BoolToUInt8(m_batch.interlacing)];
+  BatchPipelineKey key;
+  key.bits = 0;
+  key.depth_test = m_batch.use_depth_buffer ? static_cast<u8>(2) : BoolToUInt8(m_batch.check_mask_before_draw);
+  key.render_mode = static_cast<u8>(render_mode);
+  key.texture_mode = static_cast<u8>(m_batch.texture_mode);
+  key.transparency_mode = static_cast<u8>(m_batch.transparency_mode);
+  key.dithering = m_batch.dithering;
+  key.interlacing = m_batch.interlacing;
+
+  bool uber;
+  VkPipeline pipeline = GetBatchPipeline(key, &uber);
+  if (pipeline == VK_NULL_HANDLE)
+    return;
+
+  if (uber)
+  {
+    const u32 flags = static_cast<u32>(m_batch.texture_mode) |
+                      (m_batch.dithering ? GPU_HW_ShaderGen::UBER_DITHERING_BIT : 0u) |
+                      (m_batch.interlacing ? GPU_HW_ShaderGen::UBER_INTERLACING_BIT : 0u);
+    vkCmdPushConstants(cmdbuf, m_batch_pipeline_layout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(flags), &flags);
+  }
 
   vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
   vkCmdDraw(cmdbuf, num_vertices, 1, base_vertex, 0);
@@ -7,8 +7,15 @@
 #include "gpu_hw.h"
 #include "texture_replacements.h"
 #include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <tuple>
+#include <utility>
+#include <vector>
 #include <libretro.h>
 
 #define HAVE_VULKAN
@@ -88,6 +95,8 @@ private:
   VkRenderPass m_frame_render_pass = VK_NULL_HANDLE;
 };
 
+class GPU_HW_ShaderGen;
+
 class GPU_HW_Vulkan : public GPU_HW
 {
 public:
@@ -122,6 +131,25 @@ protected:
 
 private:
   static constexpr u32 MAX_PUSH_CONSTANTS_SIZE = 64, TEXTURE_REPLACEMENT_BUFFER_SIZE = 64 * 1024 * 1024;
+  static constexpr u32 MAX_PIPELINE_COMPILE_THREADS = 4;
+  static constexpr u32 BATCH_PIPELINE_LIST_MAGIC = 0x50565353; // SSVP
+  static constexpr u32 BATCH_PIPELINE_LIST_VERSION = 1;
+
+  /// One batch pipeline permutation. The bits are what the per-game pipeline list stores.
+  union BatchPipelineKey
+  {
+    u32 bits;
+
+    BitField<u32, u8, 0, 2> depth_test;
+    BitField<u32, u8, 2, 2> render_mode;
+    BitField<u32, u8, 4, 4> texture_mode;
+    BitField<u32, u8, 8, 3> transparency_mode;
+    BitField<u32, bool, 11, 1> dithering;
+    BitField<u32, bool, 12, 1> interlacing;
+
+    bool IsValid() const;
+  };
+
   void SetCapabilities();
   void DestroyResources();
 
@@ -146,6 +174,26 @@ private:
   bool CompilePipelines();
   void DestroyPipelines();
 
+  GPU_HW_ShaderGen CreateShaderGen() const;
+
+  /// Returns the pipeline for a batch, queueing it for compilation the first time. While it compiles, the uber
+  /// pipeline for the batch is returned instead, with uber set.
+  VkPipeline GetBatchPipeline(BatchPipelineKey key, bool* uber);
+  VkPipeline GetBatchUberPipeline(BatchPipelineKey key);
+  VkPipeline CreateBatchPipeline(VkShaderModule fragment_shader, BatchPipelineKey key, bool textured) const;
+  VkPipeline CompileBatchPipeline(GPU_HW_ShaderGen& shadergen, BatchPipelineKey key) const;
+  void QueueBatchPipeline(BatchPipelineKey key);
+  void CollectCompiledBatchPipelines();
+
+  void StartPipelineCompileThreads();
+  void StopPipelineCompileThreads();
+  void PipelineCompileThreadEntryPoint();
+
+  /// The batch pipelines used by the running game, so they can be compiled as soon as it boots next time.
+  std::string GetBatchPipelineListFileName() const;
+  void LoadBatchPipelineList();
+  void SaveBatchPipelineList();
+
   bool CreateTextureReplacementStreamBuffer();
 
   bool BlitVRAMReplacementTexture(const TextureReplacementTexture* tex, u32 dst_x, u32 dst_y, u32 width, u32 height);
@@ -203,6 +251,31 @@ private:
 
   // [depth_test][render_mode][texture_mode][transparency_mode][dithering][interlacing]
   DimensionalArray<VkPipeline, 2, 2, 5, 9, 4, 3> m_batch_pipelines{};
+  DimensionalArray<bool, 2, 2, 5, 9, 4, 3> m_batch_pipelines_queued{};
+
+  // [depth_test][render_mode][transparency_mode][textured]
+  DimensionalArray<VkPipeline, 2, 5, 4, 3> m_batch_uber_pipelines{};
+
+  // [render_mode][textured]
+  DimensionalArray<VkShaderModule, 2, 4> m_batch_uber_fragment_shaders{};
+
+  // [textured]
+  std::array<VkShaderModule, 2> m_batch_vertex_shaders{};
+
+  VkPipelineCache m_pipeline_cache = VK_NULL_HANDLE;
+
+  // Batch pipelines are compiled on these threads. Everything they read stays constant while they run.
+  std::vector<std::thread> m_pipeline_compile_threads;
+  std::mutex m_pipeline_compile_mutex;
+  std::condition_variable m_pipeline_compile_cv;
+  std::deque<BatchPipelineKey> m_pipeline_compile_queue;
+  std::vector<std::pair<BatchPipelineKey, VkPipeline>> m_compiled_batch_pipelines;
+  std::atomic_bool m_has_compiled_batch_pipelines{false};
+  bool m_pipeline_compile_threads_shutdown = false;
+
+  std::string m_batch_pipeline_list_filename;
+  std::vector<u32> m_batch_pipeline_list;
+  bool m_batch_pipeline_list_changed = false;
 
   // [wrapped][interlaced]
   DimensionalArray<VkPipeline, 2, 2> m_vram_fill_pipelines{};
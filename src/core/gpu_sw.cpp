@@ -74,8 +74,22 @@ bool GPU_SW::Initialize(HostDisplay* host_display)
 
 bool GPU_SW::DoState(StateWrapper& sw, HostDisplayTexture** host_texture, bool update_display)
 {
-  // ignore the host texture for software mode, since we want to save vram here
-  return GPU::DoState(sw, nullptr, update_display);
+  // There's no host texture in software mode. Memory states pass one anyway, and keep VRAM in a snapshot instead,
+  // other states save VRAM here.
+  return GPU::DoState(sw, host_texture, update_display);
+}
+
+void GPU_SW::SaveVRAMSnapshot(PageWriteTracker::Snapshot* snapshot)
+{
+  m_backend.Sync(false);
+  m_vram_writes.SaveSnapshot(reinterpret_cast<const u8*>(m_vram_ptr), snapshot);
+}
+
+bool GPU_SW::RestoreVRAMSnapshot(const PageWriteTracker::Snapshot& snapshot)
+{
+  // DoState() reset the backend, which marked every row for display and threw away the texture page cache
+  m_backend.Sync(false);
+  return m_vram_writes.RestoreSnapshot(reinterpret_cast<u8*>(m_vram_ptr), snapshot);
 }
 
 void GPU_SW::Reset(bool clear_vram)
@@ -91,6 +105,11 @@ void GPU_SW::UpdateSettings()
   m_backend.UpdateSettings();
 }
 
+GPUBackend* GPU_SW::GetBackend()
+{
+  return &m_backend;
+}
+
 template<HostDisplayPixelFormat out_format, typename out_type>
 static void CopyOutRow16(const u16* src_ptr, out_type* dst_ptr, u32 width);
 
@@ -232,7 +251,8 @@ ALWAYS_INLINE void CopyOutRow16<HostDisplayPixelFormat::BGRA8, u32>(const u16* s
 }
 
 template<HostDisplayPixelFormat display_format>
-void GPU_SW::CopyOut15Bit(u32 src_x, u32 src_y, u32 width, u32 height, u32 field, bool interlaced, bool interleaved)
+void GPU_SW::CopyOut15Bit(u32 src_x, u32 src_y, u32 width, u32 height, u32 field, bool interlaced, bool interleaved,
+                          bool dirty_rows_only)
 {
   u8* dst_ptr;
   u32 dst_stride;
@@ -268,7 +288,9 @@ void GPU_SW::CopyOut15Bit(u32 src_x, u32 src_y, u32 width, u32 height, u32 field
     const u32 src_step = VRAM_WIDTH << interleaved_shift;
     for (u32 row = 0; row < rows; row++)
     {
-      CopyOutRow16<display_format>(src_ptr, reinterpret_cast<OutputPixelType*>(dst_ptr), width);
+      if (!dirty_rows_only || m_backend.IsRowDirty(src_y + (row << interleaved_shift)))
+        CopyOutRow16<display_format>(src_ptr, reinterpret_cast<OutputPixelType*>(dst_ptr), width);
+
       src_ptr += src_step;
       dst_ptr += dst_stride;
     }
@@ -284,8 +306,11 @@ void GPU_SW::CopyOut15Bit(u32 src_x, u32 src_y, u32 width, u32 height, u32 field
       const u16* src_row_ptr = &m_vram_ptr[(src_y % VRAM_HEIGHT) * VRAM_WIDTH];
       OutputPixelType* dst_row_ptr = reinterpret_cast<OutputPixelType*>(dst_ptr);
 
-      for (u32 col = src_x; col < end_x; col++)
-        *(dst_row_ptr++) = VRAM16ToOutput<display_format, OutputPixelType>(src_row_ptr[col % VRAM_WIDTH]);
+      if (!dirty_rows_only || m_backend.IsRowDirty(src_y % VRAM_HEIGHT))
+      {
+        for (u32 col = src_x; col < end_x; col++)
+          *(dst_row_ptr++) = VRAM16ToOutput<display_format, OutputPixelType>(src_row_ptr[col % VRAM_WIDTH]);
+      }
 
       src_y += (1 << interleaved_shift);
       dst_ptr += dst_stride;
@@ -303,21 +328,25 @@ void GPU_SW::CopyOut15Bit(u32 src_x, u32 src_y, u32 width, u32 height, u32 field
 }
 
 void GPU_SW::CopyOut15Bit(HostDisplayPixelFormat display_format, u32 src_x, u32 src_y, u32 width, u32 height, u32 field,
-                          bool interlaced, bool interleaved)
+                          bool interlaced, bool interleaved, bool dirty_rows_only)
 {
   switch (display_format)
   {
     case HostDisplayPixelFormat::RGBA5551:
-      CopyOut15Bit<HostDisplayPixelFormat::RGBA5551>(src_x, src_y, width, height, field, interlaced, interleaved);
+      CopyOut15Bit<HostDisplayPixelFormat::RGBA5551>(src_x, src_y, width, height, field, interlaced, interleaved,
+                                                     dirty_rows_only);
       break;
     case HostDisplayPixelFormat::RGB565:
-      CopyOut15Bit<HostDisplayPixelFormat::RGB565>(src_x, src_y, width, height, field, interlaced, interleaved);
+      CopyOut15Bit<HostDisplayPixelFormat::RGB565>(src_x, src_y, width, height, field, interlaced, interleaved,
+                                                   dirty_rows_only);
       break;
     case HostDisplayPixelFormat::RGBA8:
-      CopyOut15Bit<HostDisplayPixelFormat::RGBA8>(src_x, src_y, width, height, field, interlaced, interleaved);
+      CopyOut15Bit<HostDisplayPixelFormat::RGBA8>(src_x, src_y, width, height, field, interlaced, interleaved,
+                                                  dirty_rows_only);
       break;
     case HostDisplayPixelFormat::BGRA8:
-      CopyOut15Bit<HostDisplayPixelFormat::BGRA8>(src_x, src_y, width, height, field, interlaced, interleaved);
+      CopyOut15Bit<HostDisplayPixelFormat::BGRA8>(src_x, src_y, width, height, field, interlaced, interleaved,
+                                                  dirty_rows_only);
       break;
     default:
       break;
@@ -326,7 +355,7 @@ void GPU_SW::CopyOut15Bit(HostDisplayPixelFormat display_format, u32 src_x, u32
 
 template<HostDisplayPixelFormat display_format>
 void GPU_SW::CopyOut24Bit(u32 src_x, u32 src_y, u32 skip_x, u32 width, u32 height, u32 field, bool interlaced,
-                          bool interleaved)
+                          bool interleaved, bool dirty_rows_only)
 {
   u8* dst_ptr;
   u32 dst_stride;
@@ -358,6 +387,13 @@ void GPU_SW::CopyOut24Bit(u32 src_x, u32 src_y, u32 skip_x, u32 width, u32 heigh
     const u32 src_stride = (VRAM_WIDTH << interleaved_shift) * sizeof(u16);
     for (u32 row = 0; row < rows; row++)
     {
+      if (dirty_rows_only && !m_backend.IsRowDirty(src_y + (row << interleaved_shift)))
+      {
+        src_ptr += src_stride;
+        dst_ptr += dst_stride;
+        continue;
+      }
+
       if constexpr (display_format == HostDisplayPixelFormat::RGBA8)
       {
         const u8* src_row_ptr = src_ptr;
@@ -414,6 +450,13 @@ void GPU_SW::CopyOut24Bit(u32 src_x, u32 src_y, u32 skip_x, u32 width, u32 heigh
   {
     for (u32 row = 0; row < rows; row++)
     {
+      if (dirty_rows_only && !m_backend.IsRowDirty(src_y % VRAM_HEIGHT))
+      {
+        src_y += (1 << interleaved_shift);
+        dst_ptr += dst_stride;
+        continue;
+      }
+
       const u16* src_row_ptr = &m_vram_ptr[(src_y % VRAM_HEIGHT) * VRAM_WIDTH];
       OutputPixelType* dst_row_ptr = reinterpret_cast<OutputPixelType*>(dst_ptr);
 
@@ -459,22 +502,25 @@ void GPU_SW::CopyOut24Bit(u32 src_x, u32 src_y, u32 skip_x, u32 width, u32 heigh
 }
 
 void GPU_SW::CopyOut24Bit(HostDisplayPixelFormat display_format, u32 src_x, u32 src_y, u32 skip_x, u32 width,
-                          u32 height, u32 field, bool interlaced, bool interleaved)
+                          u32 height, u32 field, bool interlaced, bool interleaved, bool dirty_rows_only)
 {
   switch (display_format)
   {
     case HostDisplayPixelFormat::RGBA5551:
       CopyOut24Bit<HostDisplayPixelFormat::RGBA5551>(src_x, src_y, skip_x, width, height, field, interlaced,
-                                                     interleaved);
+                                                     interleaved, dirty_rows_only);
       break;
     case HostDisplayPixelFormat::RGB565:
-      CopyOut24Bit<HostDisplayPixelFormat::RGB565>(src_x, src_y, skip_x, width, height, field, interlaced, interleaved);
+      CopyOut24Bit<HostDisplayPixelFormat::RGB565>(src_x, src_y, skip_x, width, height, field, interlaced, interleaved,
+                                                   dirty_rows_only);
       break;
     case HostDisplayPixelFormat::RGBA8:
-      CopyOut24Bit<HostDisplayPixelFormat::RGBA8>(src_x, src_y, skip_x, width, height, field, interlaced, interleaved);
+      CopyOut24Bit<HostDisplayPixelFormat::RGBA8>(src_x, src_y, skip_x, width, height, field, interlaced, interleaved,
+                                                  dirty_rows_only);
       break;
     case HostDisplayPixelFormat::BGRA8:
-      CopyOut24Bit<HostDisplayPixelFormat::BGRA8>(src_x, src_y, skip_x, width, height, field, interlaced, interleaved);
+      CopyOut24Bit<HostDisplayPixelFormat::BGRA8>(src_x, src_y, skip_x, width, height, field, interlaced, interleaved,
+                                                  dirty_rows_only);
       break;
     default:
       break;
@@ -486,6 +532,14 @@ void GPU_SW::ClearDisplay()
   std::memset(m_display_texture_buffer.data(), 0, m_display_texture_buffer.size());
 }
 
+bool GPU_SW::CopyOutArea::operator==(const CopyOutArea& rhs) const
+{
+  return (src_x == rhs.src_x && src_y == rhs.src_y && skip_x == rhs.skip_x && width == rhs.width &&
+          height == rhs.height && display_width == rhs.display_width && display_height == rhs.display_height &&
+          origin_left == rhs.origin_left && origin_top == rhs.origin_top && format == rhs.format &&
+          color_depth_24 == rhs.color_depth_24);
+}
+
 void GPU_SW::UpdateDisplay()
 {
   // fill display texture
@@ -497,9 +551,13 @@ void GPU_SW::UpdateDisplay()
                                          m_crtc_state.display_vram_width, m_crtc_state.display_vram_height,
                                          GetDisplayAspectRatio());
 
+    const bool last_copy_out_valid = m_last_copy_out_valid;
+    m_last_copy_out_valid = false;
+
     if (IsDisplayDisabled())
     {
       m_host_display->ClearDisplayTexture();
+      m_backend.ClearDirtyRows();
       return;
     }
 
@@ -514,28 +572,47 @@ void GPU_SW::UpdateDisplay()
       {
         CopyOut24Bit(m_24bit_display_format, m_crtc_state.regs.X, vram_offset_y + field,
                      m_crtc_state.display_vram_left - m_crtc_state.regs.X, display_width, display_height, field, true,
-                     m_GPUSTAT.vertical_resolution);
+                     m_GPUSTAT.vertical_resolution, false);
       }
       else
       {
         CopyOut15Bit(m_16bit_display_format, m_crtc_state.display_vram_left, vram_offset_y + field, display_width,
-                     display_height, field, true, m_GPUSTAT.vertical_resolution);
+                     display_height, field, true, m_GPUSTAT.vertical_resolution, false);
       }
     }
     else
     {
-      if (m_GPUSTAT.display_area_color_depth_24)
-      {
-        CopyOut24Bit(m_24bit_display_format, m_crtc_state.regs.X, vram_offset_y,
-                     m_crtc_state.display_vram_left - m_crtc_state.regs.X, display_width, display_height, 0, false,
-                     false);
-      }
+      const bool color_depth_24 = m_GPUSTAT.display_area_color_depth_24;
+      CopyOutArea area;
+      area.src_x = color_depth_24 ? m_crtc_state.regs.X : m_crtc_state.display_vram_left;
+      area.src_y = vram_offset_y;
+      area.skip_x = color_depth_24 ? (m_crtc_state.display_vram_left - m_crtc_state.regs.X) : 0;
+      area.width = display_width;
+      area.height = display_height;
+      area.display_width = m_crtc_state.display_width;
+      area.display_height = m_crtc_state.display_height;
+      area.origin_left = m_crtc_state.display_origin_left;
+      area.origin_top = m_crtc_state.display_origin_top;
+      area.format = color_depth_24 ? m_24bit_display_format : m_16bit_display_format;
+      area.color_depth_24 = color_depth_24;
+
+      // If the host display still holds the last frame, only the rows drawn to since then need converting. Static
+      // screens, and games running below the refresh rate, often draw nothing at all between frames.
+      const bool dirty_rows_only =
+        (last_copy_out_valid && area == m_last_copy_out_area && m_host_display->RetainsDisplayPixels());
+      if (dirty_rows_only && !m_backend.AreRowsDirty(area.src_y, area.height))
+        m_host_display->SetDisplayTextureUnchanged();
+      else if (color_depth_24)
+        CopyOut24Bit(area.format, area.src_x, area.src_y, area.skip_x, area.width, area.height, 0, false, false,
+                     dirty_rows_only);
       else
-      {
-        CopyOut15Bit(m_16bit_display_format, m_crtc_state.display_vram_left, vram_offset_y, display_width,
-                     display_height, 0, false, false);
-      }
+        CopyOut15Bit(area.format, area.src_x, area.src_y, area.width, area.height, 0, false, false, dirty_rows_only);
+
+      m_last_copy_out_area = area;
+      m_last_copy_out_valid = true;
     }
+
+    m_backend.ClearDirtyRows();
   }
 }
 
@@ -19,25 +19,42 @@ public:
 
   bool Initialize(HostDisplay* host_display) override;
   bool DoState(StateWrapper& sw, HostDisplayTexture** host_texture, bool update_display) override;
+  void SaveVRAMSnapshot(PageWriteTracker::Snapshot* snapshot) override;
+  bool RestoreVRAMSnapshot(const PageWriteTracker::Snapshot& snapshot) override;
   void Reset(bool clear_vram) override;
   void UpdateSettings() override;
 
+  GPUBackend* GetBackend() override;
+
 protected:
   void ReadVRAM(u32 x, u32 y, u32 width, u32 height) override;
   void FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color) override;
   void UpdateVRAM(u32 x, u32 y, u32 width, u32 height, const void* data, bool set_mask, bool check_mask) override;
   void CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32 height) override;
 
+  /// Where the last progressive frame was copied out from. While it stays the same, the host display still holds the
+  /// rows of VRAM which haven't been drawn to since.
+  struct CopyOutArea
+  {
+    u32 src_x, src_y, skip_x, width, height;
+    u32 display_width, display_height, origin_left, origin_top;
+    HostDisplayPixelFormat format;
+    bool color_depth_24;
+
+    bool operator==(const CopyOutArea& rhs) const;
+  };
+
   template<HostDisplayPixelFormat display_format>
-  void CopyOut15Bit(u32 src_x, u32 src_y, u32 width, u32 height, u32 field, bool interlaced, bool interleaved);
+  void CopyOut15Bit(u32 src_x, u32 src_y, u32 width, u32 height, u32 field, bool interlaced, bool interleaved,
+                    bool dirty_rows_only);
   void CopyOut15Bit(HostDisplayPixelFormat display_format, u32 src_x, u32 src_y, u32 width, u32 height, u32 field,
-                    bool interlaced, bool interleaved);
+                    bool interlaced, bool interleaved, bool dirty_rows_only);
 
   template<HostDisplayPixelFormat display_format>
   void CopyOut24Bit(u32 src_x, u32 src_y, u32 skip_x, u32 width, u32 height, u32 field, bool interlaced,
-                    bool interleaved);
+                    bool interleaved, bool dirty_rows_only);
   void CopyOut24Bit(HostDisplayPixelFormat display_format, u32 src_x, u32 src_y, u32 skip_x, u32 width, u32 height,
-                    u32 field, bool interlaced, bool interleaved);
+                    u32 field, bool interlaced, bool interleaved, bool dirty_rows_only);
 
   void ClearDisplay() override;
   void UpdateDisplay() override;
@@ -51,5 +68,8 @@ protected:
   HostDisplayPixelFormat m_16bit_display_format = HostDisplayPixelFormat::RGB565;
   HostDisplayPixelFormat m_24bit_display_format = HostDisplayPixelFormat::RGBA8;
 
+  CopyOutArea m_last_copy_out_area = {};
+  bool m_last_copy_out_valid = false;
+
   GPU_SW_Backend m_backend;
 };
@@ -1,31 +1,136 @@
 #include "gpu_sw_backend.h"
 #include "gpu_sw_backend.h"
+#include "common/platform.h"
 #include "host_display.h"
+#include "settings.h"
 #include "system.h"
 #include <algorithm>
 
+#if defined(CPU_X64)
+#include <emmintrin.h>
+#define VECTOR_SPANS 1
+#elif defined(CPU_AARCH64) && defined(WITH_NEON_SPANS)
+// opt-in until it has been compared against the scalar path on hardware
+#ifdef _MSC_VER
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif
+#define VECTOR_SPANS 1
+#endif
+
 GPU_SW_Backend::GPU_SW_Backend() : GPUBackend()
 {
   m_vram.fill(0);
   m_vram_ptr = m_vram.data();
+  m_dirty_rows.fill(~UINT64_C(0));
+  InvalidateTexturePageCache();
 }
 
 GPU_SW_Backend::~GPU_SW_Backend() = default;
 
 bool GPU_SW_Backend::Initialize(bool force_thread)
 {
+  StartRasterThreads(g_settings.gpu_sw_rasterizer_threads);
   return GPUBackend::Initialize(force_thread);
 }
 
+void GPU_SW_Backend::UpdateSettings()
+{
+  GPUBackend::UpdateSettings();
+
+  // The sync above drew any pending batch, so the threads are idle.
+  const u32 thread_count = std::clamp<u32>(g_settings.gpu_sw_rasterizer_threads, 1, MAX_RASTER_THREADS);
+  if (thread_count != static_cast<u32>(m_raster_threads.size() + 1))
+  {
+    StopRasterThreads();
+    StartRasterThreads(thread_count);
+  }
+}
+
 void GPU_SW_Backend::Reset(bool clear_vram)
 {
   GPUBackend::Reset(clear_vram);
 
   if (clear_vram)
     m_vram.fill(0);
+
+  m_dirty_rows.fill(~UINT64_C(0));
+  InvalidateTexturePageCache();
+}
+
+void GPU_SW_Backend::Shutdown()
+{
+  GPUBackend::Shutdown();
+  StopRasterThreads();
+  m_batch.clear();
 }
 
 void GPU_SW_Backend::DrawPolygon(const GPUBackendDrawPolygonCommand* cmd)
+{
+  s32 min_y = cmd->vertices[0].y;
+  s32 max_y = cmd->vertices[0].y;
+  for (u32 i = 1; i < cmd->num_vertices; i++)
+  {
+    min_y = std::min(min_y, cmd->vertices[i].y);
+    max_y = std::max(max_y, cmd->vertices[i].y);
+  }
+
+  MarkDrawnRowsDirty(min_y, max_y);
+  InvalidateDrawingAreaTexturePages();
+  if (CanUseTexturePageCache(cmd))
+    PrepareTexturePage(cmd);
+
+  if (IsBinning() && !SamplesDrawingArea(cmd))
+  {
+    QueueDrawCommand(cmd);
+    return;
+  }
+
+  FlushRender();
+  RasterizePolygon(cmd, ALL_ROWS);
+}
+
+void GPU_SW_Backend::DrawRectangle(const GPUBackendDrawRectangleCommand* cmd)
+{
+  MarkDrawnRowsDirty(cmd->y, cmd->y + static_cast<s32>(ZeroExtend32(cmd->height)) - 1);
+  InvalidateDrawingAreaTexturePages();
+  if (CanUseTexturePageCache(cmd))
+    PrepareTexturePage(cmd);
+
+  if (IsBinning() && !SamplesDrawingArea(cmd))
+  {
+    QueueDrawCommand(cmd);
+    return;
+  }
+
+  FlushRender();
+  RasterizeRectangle(cmd, ALL_ROWS);
+}
+
+void GPU_SW_Backend::DrawLine(const GPUBackendDrawLineCommand* cmd)
+{
+  s32 min_y = cmd->vertices[0].y;
+  s32 max_y = cmd->vertices[0].y;
+  for (u32 i = 1; i < cmd->num_vertices; i++)
+  {
+    min_y = std::min(min_y, cmd->vertices[i].y);
+    max_y = std::max(max_y, cmd->vertices[i].y);
+  }
+
+  MarkDrawnRowsDirty(min_y, max_y);
+  InvalidateDrawingAreaTexturePages();
+
+  if (IsBinning())
+  {
+    QueueDrawCommand(cmd);
+    return;
+  }
+
+  RasterizeLine(cmd, ALL_ROWS);
+}
+
+void GPU_SW_Backend::RasterizePolygon(const GPUBackendDrawPolygonCommand* cmd, RasterBand band)
 {
   const GPURenderCommand rc{cmd->rc.bits};
   const bool dithering_enable = rc.IsDitheringEnabled() && cmd->draw_mode.dither_enable;
@@ -33,28 +138,388 @@ void GPU_SW_Backend::DrawPolygon(const GPUBackendDrawPolygonCommand* cmd)
   const DrawTriangleFunction DrawFunction = GetDrawTriangleFunction(
     rc.shading_enable, rc.texture_enable, rc.raw_texture_enable, rc.transparency_enable, dithering_enable);
 
-  (this->*DrawFunction)(cmd, &cmd->vertices[0], &cmd->vertices[1], &cmd->vertices[2]);
+  TextureSampler sampler;
+  if (rc.texture_enable)
+    SetupTextureSampler(cmd, &sampler);
+
+  (this->*DrawFunction)(cmd, &sampler, &cmd->vertices[0], &cmd->vertices[1], &cmd->vertices[2], band);
   if (rc.quad_polygon)
-    (this->*DrawFunction)(cmd, &cmd->vertices[2], &cmd->vertices[1], &cmd->vertices[3]);
+    (this->*DrawFunction)(cmd, &sampler, &cmd->vertices[2], &cmd->vertices[1], &cmd->vertices[3], band);
 }
 
-void GPU_SW_Backend::DrawRectangle(const GPUBackendDrawRectangleCommand* cmd)
+void GPU_SW_Backend::RasterizeRectangle(const GPUBackendDrawRectangleCommand* cmd, RasterBand band)
 {
   const GPURenderCommand rc{cmd->rc.bits};
 
   const DrawRectangleFunction DrawFunction =
     GetDrawRectangleFunction(rc.texture_enable, rc.raw_texture_enable, rc.transparency_enable);
 
-  (this->*DrawFunction)(cmd);
+  TextureSampler sampler;
+  if (rc.texture_enable)
+    SetupTextureSampler(cmd, &sampler);
+
+  (this->*DrawFunction)(cmd, &sampler, band);
 }
 
-void GPU_SW_Backend::DrawLine(const GPUBackendDrawLineCommand* cmd)
+void GPU_SW_Backend::RasterizeLine(const GPUBackendDrawLineCommand* cmd, RasterBand band)
 {
   const DrawLineFunction DrawFunction =
     GetDrawLineFunction(cmd->rc.shading_enable, cmd->rc.transparency_enable, cmd->IsDitheringEnabled());
 
   for (u16 i = 1; i < cmd->num_vertices; i++)
-    (this->*DrawFunction)(cmd, &cmd->vertices[i - 1], &cmd->vertices[i]);
+    (this->*DrawFunction)(cmd, &cmd->vertices[i - 1], &cmd->vertices[i], band);
+}
+
+static bool IntersectsWithWrap(const Common::Rectangle<u32>& rc, const Common::Rectangle<u32>& area)
+{
+  // Texture pages and palettes near the right edge of VRAM wrap around to the left.
+  if (rc.Intersects(area))
+    return true;
+
+  return (rc.right > VRAM_WIDTH &&
+          Common::Rectangle<u32>(0, rc.top, rc.right - VRAM_WIDTH, rc.bottom).Intersects(area));
+}
+
+bool GPU_SW_Backend::SamplesDrawingArea(const GPUBackendDrawCommand* cmd) const
+{
+  if (!cmd->rc.texture_enable)
+    return false;
+
+  const Common::Rectangle<u32> area(m_drawing_area.left, m_drawing_area.top, m_drawing_area.right + 1,
+                                    m_drawing_area.bottom + 1);
+  if (IntersectsWithWrap(cmd->draw_mode.GetTexturePageRectangle(), area))
+    return true;
+
+  if (!cmd->draw_mode.IsUsingPalette())
+    return false;
+
+  const u32 palette_width = (cmd->draw_mode.texture_mode == GPUTextureMode::Palette4Bit) ? 16 : 256;
+  return IntersectsWithWrap(Common::Rectangle<u32>::FromExtents(cmd->palette.GetXBase(), cmd->palette.GetYBase(),
+                                                                palette_width, 1),
+                            area);
+}
+
+static u32 GetVRAMPageRange(u32 start, u32 size, u32 vram_size, u32 page_size, u32 num_pages)
+{
+  const auto range = [](u32 first, u32 last) { return ((2u << last) - 1u) & ~((1u << first) - 1u); };
+  if (size >= vram_size)
+    return range(0, num_pages - 1);
+
+  start %= vram_size;
+  const u32 end = start + size - 1;
+  if (end < vram_size)
+    return range(start / page_size, end / page_size);
+
+  return range(start / page_size, num_pages - 1) | range(0, (end - vram_size) / page_size);
+}
+
+u32 GPU_SW_Backend::GetVRAMPageMask(u32 x, u32 y, u32 width, u32 height)
+{
+  if (width == 0 || height == 0)
+    return 0;
+
+  const u32 columns = GetVRAMPageRange(x, width, VRAM_WIDTH, VRAM_PAGE_WIDTH, VRAM_PAGES_X);
+  const u32 rows = GetVRAMPageRange(y, height, VRAM_HEIGHT, VRAM_PAGE_HEIGHT, VRAM_PAGES_Y);
+
+  u32 mask = 0;
+  for (u32 row = 0; row < VRAM_PAGES_Y; row++)
+  {
+    if (rows & (1u << row))
+      mask |= columns << (row * VRAM_PAGES_X);
+  }
+
+  return mask;
+}
+
+bool GPU_SW_Backend::CanUseTexturePageCache(const GPUBackendDrawCommand* cmd) const
+{
+  // Pages being drawn to have to be sampled texel by texel, since they change while the primitive is drawn.
+  return cmd->rc.texture_enable && cmd->draw_mode.IsUsingPalette() && !SamplesDrawingArea(cmd);
+}
+
+void GPU_SW_Backend::PrepareTexturePage(const GPUBackendDrawCommand* cmd)
+{
+  const u16 key = GetTexturePageKey(cmd);
+
+  // Use the matching entry, otherwise a free one, otherwise the least recently used.
+  TexturePageCacheEntry* replace = nullptr;
+  for (TexturePageCacheEntry& entry : m_texture_page_cache)
+  {
+    if (entry.key == key)
+    {
+      entry.last_used = ++m_texture_page_cache_clock;
+      return;
+    }
+
+    if (!replace || entry.key == INVALID_TEXTURE_PAGE_KEY ||
+        (replace->key != INVALID_TEXTURE_PAGE_KEY && entry.last_used < replace->last_used))
+    {
+      replace = &entry;
+    }
+  }
+
+  // Queued primitives may still be using the entry.
+  if (replace->key != INVALID_TEXTURE_PAGE_KEY)
+    FlushRender();
+
+  DecodeTexturePage(cmd->draw_mode, &m_decoded_texture_pages[replace - m_texture_page_cache.data()]);
+
+  const Common::Rectangle<u32> rc = cmd->draw_mode.GetTexturePageRectangle();
+  replace->vram_pages = GetVRAMPageMask(rc.left, rc.top, rc.GetWidth(), rc.GetHeight());
+  replace->last_used = ++m_texture_page_cache_clock;
+  replace->key = key;
+  m_texture_page_cache_vram_pages |= replace->vram_pages;
+}
+
+void GPU_SW_Backend::InvalidateTexturePages(u32 x, u32 y, u32 width, u32 height)
+{
+  if (m_texture_page_cache_vram_pages == 0)
+    return;
+
+  const u32 vram_pages = GetVRAMPageMask(x, y, width, height);
+  if ((m_texture_page_cache_vram_pages & vram_pages) == 0)
+    return;
+
+  m_texture_page_cache_vram_pages = 0;
+  for (TexturePageCacheEntry& entry : m_texture_page_cache)
+  {
+    if (entry.key == INVALID_TEXTURE_PAGE_KEY)
+      continue;
+
+    if (entry.vram_pages & vram_pages)
+      entry.key = INVALID_TEXTURE_PAGE_KEY;
+    else
+      m_texture_page_cache_vram_pages |= entry.vram_pages;
+  }
+}
+
+void GPU_SW_Backend::InvalidateDrawingAreaTexturePages()
+{
+  InvalidateTexturePages(m_drawing_area.left, m_drawing_area.top, m_drawing_area.GetWidth() + 1,
+                         m_drawing_area.GetHeight() + 1);
+}
+
+void GPU_SW_Backend::InvalidateTexturePageCache()
+{
+  for (TexturePageCacheEntry& entry : m_texture_page_cache)
+    entry = {0, 0, INVALID_TEXTURE_PAGE_KEY};
+
+  m_texture_page_cache_vram_pages = 0;
+}
+
+void GPU_SW_Backend::DecodeTexturePage(GPUDrawModeReg mode, DecodedTexturePage* indices) const
+{
+  const u32 base_x = mode.GetTexturePageBaseX();
+  const u32 base_y = mode.GetTexturePageBaseY();
+  u8* dst = indices->data();
+
+  for (u32 y = 0; y < TEXTURE_PAGE_HEIGHT; y++)
+  {
+    const u16* row = GetPixelPtr(0, base_y + y);
+    if (mode.texture_mode == GPUTextureMode::Palette4Bit)
+    {
+      for (u32 x = 0; x < TEXTURE_PAGE_WIDTH / 4; x++)
+      {
+        const u16 value = row[(base_x + x) % VRAM_WIDTH];
+        *(dst++) = Truncate8(value & 0x0Fu);
+        *(dst++) = Truncate8((value >> 4) & 0x0Fu);
+        *(dst++) = Truncate8((value >> 8) & 0x0Fu);
+        *(dst++) = Truncate8(value >> 12);
+      }
+    }
+    else
+    {
+      for (u32 x = 0; x < TEXTURE_PAGE_WIDTH / 2; x++)
+      {
+        const u16 value = row[(base_x + x) % VRAM_WIDTH];
+        *(dst++) = Truncate8(value);
+        *(dst++) = Truncate8(value >> 8);
+      }
+    }
+  }
+}
+
+void GPU_SW_Backend::SetupTextureSampler(const GPUBackendDrawCommand* cmd, TextureSampler* sampler) const
+{
+  sampler->indices = nullptr;
+  if (!CanUseTexturePageCache(cmd))
+    return;
+
+  const u16 key = GetTexturePageKey(cmd);
+  for (u32 i = 0; i < TEXTURE_PAGE_CACHE_SIZE; i++)
+  {
+    if (m_texture_page_cache[i].key == key)
+    {
+      sampler->indices = m_decoded_texture_pages[i].data();
+      break;
+    }
+  }
+
+  if (!sampler->indices)
+    return;
+
+  const u32 palette_size = (cmd->draw_mode.texture_mode == GPUTextureMode::Palette4Bit) ? 16 : 256;
+  const u32 palette_x = cmd->palette.GetXBase();
+  const u16* palette_row = GetPixelPtr(0, cmd->palette.GetYBase());
+  for (u32 i = 0; i < palette_size; i++)
+    sampler->palette[i] = palette_row[(palette_x + i) % VRAM_WIDTH];
+}
+
+void GPU_SW_Backend::MarkRowsDirty(u32 y, u32 height)
+{
+  height = std::min(height, VRAM_HEIGHT);
+  for (u32 i = 0; i < height; i++)
+  {
+    const u32 row = (y + i) % VRAM_HEIGHT;
+    m_dirty_rows[row / 64] |= UINT64_C(1) << (row % 64);
+  }
+}
+
+void GPU_SW_Backend::MarkDrawnRowsDirty(s32 top, s32 bottom)
+{
+  top = std::max(top, static_cast<s32>(m_drawing_area.top));
+  bottom = std::min(bottom, static_cast<s32>(m_drawing_area.bottom));
+  if (top <= bottom)
+    MarkRowsDirty(static_cast<u32>(top), static_cast<u32>(bottom - top + 1));
+}
+
+bool GPU_SW_Backend::AreRowsDirty(u32 y, u32 height) const
+{
+  height = std::min(height, VRAM_HEIGHT);
+  for (u32 i = 0; i < height; i++)
+  {
+    if (IsRowDirty((y + i) % VRAM_HEIGHT))
+      return true;
+  }
+
+  return false;
+}
+
+void GPU_SW_Backend::ClearDirtyRows()
+{
+  m_dirty_rows.fill(0);
+}
+
+bool GPU_SW_Backend::HasVectorSpans()
+{
+#ifdef VECTOR_SPANS
+  return true;
+#else
+  return false;
+#endif
+}
+
+void GPU_SW_Backend::SetVectorSpansEnabled(bool enabled)
+{
+  // the raster threads read it
+  Sync(true);
+  m_vector_spans_enabled = enabled;
+}
+
+void GPU_SW_Backend::QueueDrawCommand(const GPUBackendDrawCommand* cmd)
+{
+  const u8* cmd_bytes = reinterpret_cast<const u8*>(cmd);
+  m_batch.insert(m_batch.end(), cmd_bytes, cmd_bytes + cmd->size);
+  if (m_batch.size() >= MAX_BATCH_SIZE)
+    FlushRender();
+}
+
+void GPU_SW_Backend::DrawBatch(RasterBand band)
+{
+  for (size_t offset = 0; offset < m_batch.size();)
+  {
+    const GPUBackendCommand* cmd = reinterpret_cast<const GPUBackendCommand*>(&m_batch[offset]);
+    offset += cmd->size;
+
+    switch (cmd->type)
+    {
+      case GPUBackendCommandType::DrawPolygon:
+        RasterizePolygon(static_cast<const GPUBackendDrawPolygonCommand*>(cmd), band);
+        break;
+
+      case GPUBackendCommandType::DrawRectangle:
+        RasterizeRectangle(static_cast<const GPUBackendDrawRectangleCommand*>(cmd), band);
+        break;
+
+      case GPUBackendCommandType::DrawLine:
+        RasterizeLine(static_cast<const GPUBackendDrawLineCommand*>(cmd), band);
+        break;
+
+      default:
+        break;
+    }
+  }
+}
+
+void GPU_SW_Backend::FlushRender()
+{
+  if (m_batch.empty())
+    return;
+
+  {
+    std::unique_lock<std::mutex> lock(m_raster_mutex);
+    m_raster_threads_busy = static_cast<u32>(m_raster_threads.size());
+    m_raster_generation++;
+  }
+  m_raster_start_cv.notify_all();
+
+  // This thread takes the first band.
+  const u32 band_count = static_cast<u32>(m_raster_threads.size() + 1);
+  DrawBatch(RasterBand{0, band_count});
+
+  {
+    std::unique_lock<std::mutex> lock(m_raster_mutex);
+    m_raster_done_cv.wait(lock, [this]() { return m_raster_threads_busy == 0; });
+  }
+
+  m_batch.clear();
+}
+
+void GPU_SW_Backend::StartRasterThreads(u32 count)
+{
+  count = std::clamp<u32>(count, 1, MAX_RASTER_THREADS);
+  m_raster_threads_shutdown = false;
+  for (u32 i = 1; i < count; i++)
+    m_raster_threads.emplace_back(&GPU_SW_Backend::RasterThreadEntryPoint, this, i);
+}
+
+void GPU_SW_Backend::StopRasterThreads()
+{
+  if (m_raster_threads.empty())
+    return;
+
+  {
+    std::unique_lock<std::mutex> lock(m_raster_mutex);
+    m_raster_threads_shutdown = true;
+  }
+  m_raster_start_cv.notify_all();
+
+  for (std::thread& thread : m_raster_threads)
+    thread.join();
+  m_raster_threads.clear();
+}
+
+void GPU_SW_Backend::RasterThreadEntryPoint(u32 index)
+{
+  std::unique_lock<std::mutex> lock(m_raster_mutex);
+  u32 last_generation = m_raster_generation;
+  for (;;)
+  {
+    m_raster_start_cv.wait(
+      lock, [this, last_generation]() { return m_raster_threads_shutdown || m_raster_generation != last_generation; });
+    if (m_raster_threads_shutdown)
+      break;
+
+    last_generation = m_raster_generation;
+    const RasterBand band{index, static_cast<u32>(m_raster_threads.size() + 1)};
+    lock.unlock();
+
+    DrawBatch(band);
+
+    lock.lock();
+    if (--m_raster_threads_busy == 0)
+      m_raster_done_cv.notify_one();
+  }
 }
 
 constexpr GPU_SW_Backend::DitherLUT GPU_SW_Backend::ComputeDitherLUT()
@@ -76,51 +541,54 @@ constexpr GPU_SW_Backend::DitherLUT GPU_SW_Backend::ComputeDitherLUT()
 
 static constexpr GPU_SW_Backend::DitherLUT s_dither_lut = GPU_SW_Backend::ComputeDitherLUT();
 
-template<bool texture_enable, bool raw_texture_enable, bool transparency_enable, bool dithering_enable>
-void ALWAYS_INLINE_RELEASE GPU_SW_Backend::ShadePixel(const GPUBackendDrawCommand* cmd, u32 x, u32 y, u8 color_r,
-                                                      u8 color_g, u8 color_b, u8 texcoord_x, u8 texcoord_y)
+ALWAYS_INLINE_RELEASE u16 GPU_SW_Backend::FetchTexel(const GPUBackendDrawCommand* cmd, const TextureSampler* sampler,
+                                                      u8 texcoord_x, u8 texcoord_y) const
 {
-  VRAMPixel color;
-  if constexpr (texture_enable)
-  {
-    // Apply texture window
-    texcoord_x = (texcoord_x & cmd->window.and_x) | cmd->window.or_x;
-    texcoord_y = (texcoord_y & cmd->window.and_y) | cmd->window.or_y;
+  // Apply texture window
+  texcoord_x = (texcoord_x & cmd->window.and_x) | cmd->window.or_x;
+  texcoord_y = (texcoord_y & cmd->window.and_y) | cmd->window.or_y;
 
-    VRAMPixel texture_color;
-    switch (cmd->draw_mode.texture_mode)
-    {
-      case GPUTextureMode::Palette4Bit:
-      {
-        const u16 palette_value =
-          GetPixel((cmd->draw_mode.GetTexturePageBaseX() + ZeroExtend32(texcoord_x / 4)) % VRAM_WIDTH,
-                   (cmd->draw_mode.GetTexturePageBaseY() + ZeroExtend32(texcoord_y)) % VRAM_HEIGHT);
-        const u16 palette_index = (palette_value >> ((texcoord_x % 4) * 4)) & 0x0Fu;
+  if (sampler->indices)
+    return sampler->palette[sampler->indices[ZeroExtend32(texcoord_y) * TEXTURE_PAGE_WIDTH + texcoord_x]];
 
-        texture_color.bits =
-          GetPixel((cmd->palette.GetXBase() + ZeroExtend32(palette_index)) % VRAM_WIDTH, cmd->palette.GetYBase());
-      }
-      break;
+  switch (cmd->draw_mode.texture_mode)
+  {
+    case GPUTextureMode::Palette4Bit:
+    {
+      const u16 palette_value =
+        GetPixel((cmd->draw_mode.GetTexturePageBaseX() + ZeroExtend32(texcoord_x / 4)) % VRAM_WIDTH,
+                 (cmd->draw_mode.GetTexturePageBaseY() + ZeroExtend32(texcoord_y)) % VRAM_HEIGHT);
+      const u16 palette_index = (palette_value >> ((texcoord_x % 4) * 4)) & 0x0Fu;
 
-      case GPUTextureMode::Palette8Bit:
-      {
-        const u16 palette_value =
-          GetPixel((cmd->draw_mode.GetTexturePageBaseX() + ZeroExtend32(texcoord_x / 2)) % VRAM_WIDTH,
-                   (cmd->draw_mode.GetTexturePageBaseY() + ZeroExtend32(texcoord_y)) % VRAM_HEIGHT);
-        const u16 palette_index = (palette_value >> ((texcoord_x % 2) * 8)) & 0xFFu;
-        texture_color.bits =
-          GetPixel((cmd->palette.GetXBase() + ZeroExtend32(palette_index)) % VRAM_WIDTH, cmd->palette.GetYBase());
-      }
-      break;
+      return GetPixel((cmd->palette.GetXBase() + ZeroExtend32(palette_index)) % VRAM_WIDTH, cmd->palette.GetYBase());
+    }
 
-      default:
-      {
-        texture_color.bits = GetPixel((cmd->draw_mode.GetTexturePageBaseX() + ZeroExtend32(texcoord_x)) % VRAM_WIDTH,
-                                      (cmd->draw_mode.GetTexturePageBaseY() + ZeroExtend32(texcoord_y)) % VRAM_HEIGHT);
-      }
-      break;
+    case GPUTextureMode::Palette8Bit:
+    {
+      const u16 palette_value =
+        GetPixel((cmd->draw_mode.GetTexturePageBaseX() + ZeroExtend32(texcoord_x / 2)) % VRAM_WIDTH,
+                 (cmd->draw_mode.GetTexturePageBaseY() + ZeroExtend32(texcoord_y)) % VRAM_HEIGHT);
+      const u16 palette_index = (palette_value >> ((texcoord_x % 2) * 8)) & 0xFFu;
+      return GetPixel((cmd->palette.GetXBase() + ZeroExtend32(palette_index)) % VRAM_WIDTH, cmd->palette.GetYBase());
     }
 
+    default:
+      return GetPixel((cmd->draw_mode.GetTexturePageBaseX() + ZeroExtend32(texcoord_x)) % VRAM_WIDTH,
+                      (cmd->draw_mode.GetTexturePageBaseY() + ZeroExtend32(texcoord_y)) % VRAM_HEIGHT);
+  }
+}
+
+template<bool texture_enable, bool raw_texture_enable, bool transparency_enable, bool dithering_enable>
+void ALWAYS_INLINE_RELEASE GPU_SW_Backend::ShadePixel(const GPUBackendDrawCommand* cmd, const TextureSampler* sampler,
+                                                      u32 x, u32 y, u8 color_r, u8 color_g, u8 color_b,
+                                                      u8 texcoord_x, u8 texcoord_y)
+{
+  VRAMPixel color;
+  if constexpr (texture_enable)
+  {
+    VRAMPixel texture_color;
+    texture_color.bits = FetchTexel(cmd, sampler, texcoord_x, texcoord_y);
+
     if (texture_color.bits == 0)
       return;
 
@@ -217,7 +685,8 @@ void ALWAYS_INLINE_RELEASE GPU_SW_Backend::ShadePixel(const GPUBackendDrawComman
 }
 
 template<bool texture_enable, bool raw_texture_enable, bool transparency_enable>
-void GPU_SW_Backend::DrawRectangle(const GPUBackendDrawRectangleCommand* cmd)
+void GPU_SW_Backend::DrawRectangle(const GPUBackendDrawRectangleCommand* cmd, const TextureSampler* sampler,
+                                   RasterBand band)
 {
   const s32 origin_x = cmd->x;
   const s32 origin_y = cmd->y;
@@ -228,7 +697,8 @@ void GPU_SW_Backend::DrawRectangle(const GPUBackendDrawRectangleCommand* cmd)
   {
     const s32 y = origin_y + static_cast<s32>(offset_y);
     if (y < static_cast<s32>(m_drawing_area.top) || y > static_cast<s32>(m_drawing_area.bottom) ||
-        (cmd->params.interlaced_rendering && cmd->params.active_line_lsb == (Truncate8(static_cast<u32>(y)) & 1u)))
+        (cmd->params.interlaced_rendering && cmd->params.active_line_lsb == (Truncate8(static_cast<u32>(y)) & 1u)) ||
+        !band.ContainsRow(static_cast<u32>(y)))
     {
       continue;
     }
@@ -244,7 +714,7 @@ void GPU_SW_Backend::DrawRectangle(const GPUBackendDrawRectangleCommand* cmd)
       const u8 texcoord_x = Truncate8(ZeroExtend32(origin_texcoord_x) + offset_x);
 
       ShadePixel<texture_enable, raw_texture_enable, transparency_enable, false>(
-        cmd, static_cast<u32>(x), static_cast<u32>(y), r, g, b, texcoord_x, texcoord_y);
+        cmd, sampler, static_cast<u32>(x), static_cast<u32>(y), r, g, b, texcoord_x, texcoord_y);
     }
   }
 }
@@ -355,10 +825,319 @@ void ALWAYS_INLINE_RELEASE GPU_SW_Backend::AddIDeltas_DY(i_group& ig, const i_de
   }
 }
 
+#ifdef VECTOR_SPANS
+
+//////////////////////////////////////////////////////////////////////////
+// Vector span shading
+//////////////////////////////////////////////////////////////////////////
+
+// Every operation below works on eight pixels, or on four 8.24 fixed-point interpolants. The channel maths is done in
+// 16-bit lanes with each channel unpacked, which gives the same results as the scalar lookup tables and blending.
+
+#if defined(CPU_X64)
+
+using VecU16 = __m128i;
+using VecU32 = __m128i;
+
+static ALWAYS_INLINE VecU32 VecU32Ramp(u32 value, u32 step)
+{
+  return _mm_setr_epi32(static_cast<s32>(value), static_cast<s32>(value + step), static_cast<s32>(value + step * 2),
+                        static_cast<s32>(value + step * 3));
+}
+static ALWAYS_INLINE VecU32 VecU32Splat(u32 value) { return _mm_set1_epi32(static_cast<s32>(value)); }
+static ALWAYS_INLINE VecU32 VecU32Add(VecU32 a, VecU32 b) { return _mm_add_epi32(a, b); }
+static ALWAYS_INLINE VecU16 VecU32IntegerParts(VecU32 lo, VecU32 hi)
+{
+  // Masked to 8 bits like the scalar path's Truncate8(), which also keeps the signed saturating pack from clamping.
+  const __m128i mask = _mm_set1_epi32(0xFF);
+  return _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(lo, COORD_FBS + COORD_POST_PADDING), mask),
+                         _mm_and_si128(_mm_srli_epi32(hi, COORD_FBS + COORD_POST_PADDING), mask));
+}
+
+static ALWAYS_INLINE VecU16 VecU16Splat(u16 value) { return _mm_set1_epi16(static_cast<s16>(value)); }
+static ALWAYS_INLINE VecU16 VecU16Load(const u16* ptr)
+{
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(ptr));
+}
+static ALWAYS_INLINE void VecU16Store(u16* ptr, VecU16 v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(ptr), v); }
+static ALWAYS_INLINE VecU16 VecU16And(VecU16 a, VecU16 b) { return _mm_and_si128(a, b); }
+static ALWAYS_INLINE VecU16 VecU16Or(VecU16 a, VecU16 b) { return _mm_or_si128(a, b); }
+static ALWAYS_INLINE VecU16 VecU16Add(VecU16 a, VecU16 b) { return _mm_add_epi16(a, b); }
+static ALWAYS_INLINE VecU16 VecU16Sub(VecU16 a, VecU16 b) { return _mm_sub_epi16(a, b); }
+static ALWAYS_INLINE VecU16 VecU16Mul(VecU16 a, VecU16 b) { return _mm_mullo_epi16(a, b); }
+static ALWAYS_INLINE VecU16 VecS16Min(VecU16 a, VecU16 b) { return _mm_min_epi16(a, b); }
+static ALWAYS_INLINE VecU16 VecS16Max(VecU16 a, VecU16 b) { return _mm_max_epi16(a, b); }
+static ALWAYS_INLINE VecU16 VecU16Equal(VecU16 a, VecU16 b) { return _mm_cmpeq_epi16(a, b); }
+static ALWAYS_INLINE VecU16 VecU16Select(VecU16 mask, VecU16 a, VecU16 b)
+{
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+template<int n>
+static ALWAYS_INLINE VecU16 VecU16ShiftLeft(VecU16 v)
+{
+  return _mm_slli_epi16(v, n);
+}
+template<int n>
+static ALWAYS_INLINE VecU16 VecU16ShiftRight(VecU16 v)
+{
+  return _mm_srli_epi16(v, n);
+}
+template<int n>
+static ALWAYS_INLINE VecU16 VecS16ShiftRight(VecU16 v)
+{
+  return _mm_srai_epi16(v, n);
+}
+
+#elif defined(CPU_AARCH64)
+
+using VecU16 = uint16x8_t;
+using VecU32 = uint32x4_t;
+
+static ALWAYS_INLINE VecU32 VecU32Ramp(u32 value, u32 step)
+{
+  const u32 values[4] = {value, value + step, value + step * 2, value + step * 3};
+  return vld1q_u32(values);
+}
+static ALWAYS_INLINE VecU32 VecU32Splat(u32 value) { return vdupq_n_u32(value); }
+static ALWAYS_INLINE VecU32 VecU32Add(VecU32 a, VecU32 b) { return vaddq_u32(a, b); }
+static ALWAYS_INLINE VecU16 VecU32IntegerParts(VecU32 lo, VecU32 hi)
+{
+  return vandq_u16(vcombine_u16(vmovn_u32(vshrq_n_u32(lo, COORD_FBS + COORD_POST_PADDING)),
+                                vmovn_u32(vshrq_n_u32(hi, COORD_FBS + COORD_POST_PADDING))),
+                   vdupq_n_u16(0xFF));
+}
+
+static ALWAYS_INLINE VecU16 VecU16Splat(u16 value) { return vdupq_n_u16(value); }
+static ALWAYS_INLINE VecU16 VecU16Load(const u16* ptr) { return vld1q_u16(ptr); }
+static ALWAYS_INLINE void VecU16Store(u16* ptr, VecU16 v) { vst1q_u16(ptr, v); }
+static ALWAYS_INLINE VecU16 VecU16And(VecU16 a, VecU16 b) { return vandq_u16(a, b); }
+static ALWAYS_INLINE VecU16 VecU16Or(VecU16 a, VecU16 b) { return vorrq_u16(a, b); }
+static ALWAYS_INLINE VecU16 VecU16Add(VecU16 a, VecU16 b) { return vaddq_u16(a, b); }
+static ALWAYS_INLINE VecU16 VecU16Sub(VecU16 a, VecU16 b) { return vsubq_u16(a, b); }
+static ALWAYS_INLINE VecU16 VecU16Mul(VecU16 a, VecU16 b) { return vmulq_u16(a, b); }
+static ALWAYS_INLINE VecU16 VecS16Min(VecU16 a, VecU16 b)
+{
+  return vreinterpretq_u16_s16(vminq_s16(vreinterpretq_s16_u16(a), vreinterpretq_s16_u16(b)));
+}
+static ALWAYS_INLINE VecU16 VecS16Max(VecU16 a, VecU16 b)
+{
+  return vreinterpretq_u16_s16(vmaxq_s16(vreinterpretq_s16_u16(a), vreinterpretq_s16_u16(b)));
+}
+static ALWAYS_INLINE VecU16 VecU16Equal(VecU16 a, VecU16 b) { return vceqq_u16(a, b); }
+static ALWAYS_INLINE VecU16 VecU16Select(VecU16 mask, VecU16 a, VecU16 b) { return vbslq_u16(mask, a, b); }
+template<int n>
+static ALWAYS_INLINE VecU16 VecU16ShiftLeft(VecU16 v)
+{
+  return vshlq_n_u16(v, n);
+}
+template<int n>
+static ALWAYS_INLINE VecU16 VecU16ShiftRight(VecU16 v)
+{
+  // the immediate has to be 1-16
+  if constexpr (n == 0)
+    return v;
+  else
+    return vshrq_n_u16(v, n);
+}
+template<int n>
+static ALWAYS_INLINE VecU16 VecS16ShiftRight(VecU16 v)
+{
+  return vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(v), n));
+}
+
+#endif
+
+namespace {
+/// One interpolant for eight consecutive pixels.
+struct VecInterpolant
+{
+  VecU32 lo;
+  VecU32 hi;
+  VecU32 step;
+
+  ALWAYS_INLINE VecInterpolant(u32 value, u32 delta)
+    : lo(VecU32Ramp(value, delta)), hi(VecU32Ramp(value + delta * 4, delta)), step(VecU32Splat(delta * 8))
+  {
+  }
+
+  ALWAYS_INLINE VecU16 Get() const { return VecU32IntegerParts(lo, hi); }
+
+  ALWAYS_INLINE void Advance()
+  {
+    lo = VecU32Add(lo, step);
+    hi = VecU32Add(hi, step);
+  }
+};
+} // namespace
+
+/// Equivalent to indexing the dither LUT: adds the dither offset, drops to 5 bits and clamps.
+static ALWAYS_INLINE VecU16 VecDitherChannel(VecU16 value, VecU16 dither)
+{
+  return VecS16Min(VecS16Max(VecS16ShiftRight<3>(VecU16Add(value, dither)), VecU16Splat(0)), VecU16Splat(31));
+}
+
+template<int shift>
+static ALWAYS_INLINE VecU16 VecGetChannel(VecU16 v)
+{
+  return VecU16And(VecU16ShiftRight<shift>(v), VecU16Splat(0x1F));
+}
+
+template<GPUTransparencyMode mode>
+static ALWAYS_INLINE VecU16 VecBlendChannel(VecU16 fg, VecU16 bg)
+{
+  switch (mode)
+  {
+    case GPUTransparencyMode::HalfBackgroundPlusHalfForeground:
+      return VecU16ShiftRight<1>(VecU16Add(bg, fg));
+
+    case GPUTransparencyMode::BackgroundPlusForeground:
+      return VecS16Min(VecU16Add(bg, fg), VecU16Splat(31));
+
+    case GPUTransparencyMode::BackgroundMinusForeground:
+      return VecS16Max(VecU16Sub(bg, fg), VecU16Splat(0));
+
+    case GPUTransparencyMode::BackgroundPlusQuarterForeground:
+    default:
+      return VecS16Min(VecU16Add(bg, VecU16ShiftRight<2>(fg)), VecU16Splat(31));
+  }
+}
+
+/// Matches the packed blending in ShadePixel, which always leaves bit 15 set, for foreground pixels with bit 15 set.
+template<GPUTransparencyMode mode>
+static ALWAYS_INLINE VecU16 VecBlend(VecU16 fg, VecU16 bg)
+{
+  const VecU16 r = VecBlendChannel<mode>(VecGetChannel<0>(fg), VecGetChannel<0>(bg));
+  const VecU16 g = VecBlendChannel<mode>(VecGetChannel<5>(fg), VecGetChannel<5>(bg));
+  const VecU16 b = VecBlendChannel<mode>(VecGetChannel<10>(fg), VecGetChannel<10>(bg));
+  return VecU16Or(VecU16Or(r, VecU16ShiftLeft<5>(g)), VecU16Or(VecU16ShiftLeft<10>(b), VecU16Splat(0x8000)));
+}
+
+static ALWAYS_INLINE VecU16 VecBlend(GPUTransparencyMode mode, VecU16 fg, VecU16 bg)
+{
+  switch (mode)
+  {
+    case GPUTransparencyMode::HalfBackgroundPlusHalfForeground:
+      return VecBlend<GPUTransparencyMode::HalfBackgroundPlusHalfForeground>(fg, bg);
+
+    case GPUTransparencyMode::BackgroundPlusForeground:
+      return VecBlend<GPUTransparencyMode::BackgroundPlusForeground>(fg, bg);
+
+    case GPUTransparencyMode::BackgroundMinusForeground:
+      return VecBlend<GPUTransparencyMode::BackgroundMinusForeground>(fg, bg);
+
+    case GPUTransparencyMode::BackgroundPlusQuarterForeground:
+    default:
+      return VecBlend<GPUTransparencyMode::BackgroundPlusQuarterForeground>(fg, bg);
+  }
+}
+
+template<bool shading_enable, bool texture_enable, bool raw_texture_enable, bool transparency_enable,
+         bool dithering_enable>
+void GPU_SW_Backend::ShadeSpanVector(const GPUBackendDrawCommand* cmd, const TextureSampler* sampler, u32 x, u32 y,
+                                     u32 count, const i_group& ig, const i_deltas& idl)
+{
+  // The dither pattern repeats every four pixels, so the same offsets apply to every vector in the span.
+  u16 dither_values[SPAN_VECTOR_WIDTH];
+  for (u32 i = 0; i < SPAN_VECTOR_WIDTH; i++)
+  {
+    const u32 dither_y = (dithering_enable) ? (y & 3u) : 2u;
+    const u32 dither_x = (dithering_enable) ? ((x + i) & 3u) : 3u;
+    dither_values[i] = static_cast<u16>(DITHER_MATRIX[dither_y][dither_x]);
+  }
+  const VecU16 dither = VecU16Load(dither_values);
+
+  const VecU16 zero = VecU16Splat(0);
+  const VecU16 mask_and = VecU16Splat(cmd->params.GetMaskAND());
+  const VecU16 mask_or = VecU16Splat(cmd->params.GetMaskOR());
+  const GPUTransparencyMode transparency_mode = cmd->draw_mode.transparency_mode;
+
+  VecInterpolant r(ig.r, shading_enable ? idl.dr_dx : 0);
+  VecInterpolant g(ig.g, shading_enable ? idl.dg_dx : 0);
+  VecInterpolant b(ig.b, shading_enable ? idl.db_dx : 0);
+  VecInterpolant u(texture_enable ? ig.u : 0, texture_enable ? idl.du_dx : 0);
+  VecInterpolant v(texture_enable ? ig.v : 0, texture_enable ? idl.dv_dx : 0);
+
+  u16* row = GetPixelPtr(x, y);
+  for (u32 offset = 0; offset < count; offset += SPAN_VECTOR_WIDTH)
+  {
+    VecU16 color;
+    VecU16 texel = zero;
+    if constexpr (texture_enable)
+    {
+      u16 texcoord_x[SPAN_VECTOR_WIDTH];
+      u16 texcoord_y[SPAN_VECTOR_WIDTH];
+      u16 texels[SPAN_VECTOR_WIDTH];
+      VecU16Store(texcoord_x, u.Get());
+      VecU16Store(texcoord_y, v.Get());
+      for (u32 i = 0; i < SPAN_VECTOR_WIDTH; i++)
+        texels[i] = FetchTexel(cmd, sampler, Truncate8(texcoord_x[i]), Truncate8(texcoord_y[i]));
+      texel = VecU16Load(texels);
+
+      if constexpr (raw_texture_enable)
+      {
+        color = texel;
+      }
+      else
+      {
+        const VecU16 cr = VecDitherChannel(VecU16ShiftRight<4>(VecU16Mul(VecGetChannel<0>(texel), r.Get())), dither);
+        const VecU16 cg = VecDitherChannel(VecU16ShiftRight<4>(VecU16Mul(VecGetChannel<5>(texel), g.Get())), dither);
+        const VecU16 cb = VecDitherChannel(VecU16ShiftRight<4>(VecU16Mul(VecGetChannel<10>(texel), b.Get())), dither);
+        color = VecU16Or(VecU16Or(cr, VecU16ShiftLeft<5>(cg)),
+                         VecU16Or(VecU16ShiftLeft<10>(cb), VecU16And(texel, VecU16Splat(0x8000))));
+      }
+    }
+    else
+    {
+      // Non-textured transparent polygons don't set bit 15, but are treated as transparent.
+      const VecU16 cr = VecDitherChannel(r.Get(), dither);
+      const VecU16 cg = VecDitherChannel(g.Get(), dither);
+      const VecU16 cb = VecDitherChannel(b.Get(), dither);
+      color = VecU16Or(VecU16Or(cr, VecU16ShiftLeft<5>(cg)), VecU16ShiftLeft<10>(cb));
+    }
+
+    const VecU16 bg_color = VecU16Load(row + offset);
+    if constexpr (transparency_enable)
+    {
+      if constexpr (texture_enable)
+      {
+        const VecU16 opaque = VecU16Equal(VecU16And(color, VecU16Splat(0x8000)), zero);
+        color = VecU16Select(opaque, color, VecBlend(transparency_mode, color, bg_color));
+      }
+      else
+      {
+        color = VecU16And(VecBlend(transparency_mode, VecU16Or(color, VecU16Splat(0x8000)), bg_color),
+                          VecU16Splat(0x7FFF));
+      }
+    }
+
+    const VecU16 unmasked = VecU16Equal(VecU16And(bg_color, mask_and), zero);
+    VecU16 result = VecU16Select(unmasked, VecU16Or(color, mask_or), bg_color);
+    if constexpr (texture_enable)
+      result = VecU16Select(VecU16Equal(texel, zero), bg_color, result);
+
+    VecU16Store(row + offset, result);
+
+    if constexpr (shading_enable)
+    {
+      r.Advance();
+      g.Advance();
+      b.Advance();
+    }
+
+    if constexpr (texture_enable)
+    {
+      u.Advance();
+      v.Advance();
+    }
+  }
+}
+
+#endif // VECTOR_SPANS
+
 template<bool shading_enable, bool texture_enable, bool raw_texture_enable, bool transparency_enable,
          bool dithering_enable>
-void GPU_SW_Backend::DrawSpan(const GPUBackendDrawPolygonCommand* cmd, s32 y, s32 x_start, s32 x_bound, i_group ig,
-                              const i_deltas& idl)
+void GPU_SW_Backend::DrawSpan(const GPUBackendDrawPolygonCommand* cmd, const TextureSampler* sampler, s32 y,
+                              s32 x_start, s32 x_bound, i_group ig, const i_deltas& idl)
 {
   if (cmd->params.interlaced_rendering && cmd->params.active_line_lsb == (Truncate8(static_cast<u32>(y)) & 1u))
     return;
@@ -384,6 +1163,21 @@ void GPU_SW_Backend::DrawSpan(const GPUBackendDrawPolygonCommand* cmd, s32 y, s3
   AddIDeltas_DX<shading_enable, texture_enable>(ig, idl, x_ig_adjust);
   AddIDeltas_DY<shading_enable, texture_enable>(ig, idl, y);
 
+#ifdef VECTOR_SPANS
+  if (m_vector_spans_enabled && static_cast<u32>(w) >= SPAN_VECTOR_WIDTH &&
+      (!texture_enable || !SamplesDrawingArea(cmd)))
+  {
+    const u32 vector_count = static_cast<u32>(w) & ~(SPAN_VECTOR_WIDTH - 1);
+    ShadeSpanVector<shading_enable, texture_enable, raw_texture_enable, transparency_enable, dithering_enable>(
+      cmd, sampler, static_cast<u32>(x), static_cast<u32>(y), vector_count, ig, idl);
+    AddIDeltas_DX<shading_enable, texture_enable>(ig, idl, vector_count);
+    x += static_cast<s32>(vector_count);
+    w -= static_cast<s32>(vector_count);
+    if (w == 0)
+      return;
+  }
+#endif
+
   do
   {
     const u32 r = ig.r >> (COORD_FBS + COORD_POST_PADDING);
@@ -393,7 +1187,7 @@ void GPU_SW_Backend::DrawSpan(const GPUBackendDrawPolygonCommand* cmd, s32 y, s3
     const u32 v = ig.v >> (COORD_FBS + COORD_POST_PADDING);
 
     ShadePixel<texture_enable, raw_texture_enable, transparency_enable, dithering_enable>(
-      cmd, static_cast<u32>(x), static_cast<u32>(y), Truncate8(r), Truncate8(g), Truncate8(b), Truncate8(u),
+      cmd, sampler, static_cast<u32>(x), static_cast<u32>(y), Truncate8(r), Truncate8(g), Truncate8(b), Truncate8(u),
       Truncate8(v));
 
     x++;
@@ -403,10 +1197,10 @@ void GPU_SW_Backend::DrawSpan(const GPUBackendDrawPolygonCommand* cmd, s32 y, s3
 
 template<bool shading_enable, bool texture_enable, bool raw_texture_enable, bool transparency_enable,
          bool dithering_enable>
-void GPU_SW_Backend::DrawTriangle(const GPUBackendDrawPolygonCommand* cmd,
+void GPU_SW_Backend::DrawTriangle(const GPUBackendDrawPolygonCommand* cmd, const TextureSampler* sampler,
                                   const GPUBackendDrawPolygonCommand::Vertex* v0,
                                   const GPUBackendDrawPolygonCommand::Vertex* v1,
-                                  const GPUBackendDrawPolygonCommand::Vertex* v2)
+                                  const GPUBackendDrawPolygonCommand::Vertex* v2, RasterBand band)
 {
   u32 core_vertex;
   {
@@ -564,11 +1358,11 @@ void GPU_SW_Backend::DrawTriangle(const GPUBackendDrawPolygonCommand* cmd,
         if (y < static_cast<s32>(m_drawing_area.top))
           break;
 
-        if (y > static_cast<s32>(m_drawing_area.bottom))
+        if (y > static_cast<s32>(m_drawing_area.bottom) || !band.ContainsRow(static_cast<u32>(y)))
           continue;
 
         DrawSpan<shading_enable, texture_enable, raw_texture_enable, transparency_enable, dithering_enable>(
-          cmd, yi, GetPolyXFP_Int(lc), GetPolyXFP_Int(rc), ig, idl);
+          cmd, sampler, yi, GetPolyXFP_Int(lc), GetPolyXFP_Int(rc), ig, idl);
       }
     }
     else
@@ -580,11 +1374,11 @@ void GPU_SW_Backend::DrawTriangle(const GPUBackendDrawPolygonCommand* cmd,
         if (y > static_cast<s32>(m_drawing_area.bottom))
           break;
 
-        if (y >= static_cast<s32>(m_drawing_area.top))
+        if (y >= static_cast<s32>(m_drawing_area.top) && band.ContainsRow(static_cast<u32>(y)))
         {
 
           DrawSpan<shading_enable, texture_enable, raw_texture_enable, transparency_enable, dithering_enable>(
-            cmd, yi, GetPolyXFP_Int(lc), GetPolyXFP_Int(rc), ig, idl);
+            cmd, sampler, yi, GetPolyXFP_Int(lc), GetPolyXFP_Int(rc), ig, idl);
         }
 
         yi++;
@@ -624,7 +1418,7 @@ static ALWAYS_INLINE_RELEASE s64 LineDivide(s64 delta, s32 dk)
 
 template<bool shading_enable, bool transparency_enable, bool dithering_enable>
 void GPU_SW_Backend::DrawLine(const GPUBackendDrawLineCommand* cmd, const GPUBackendDrawLineCommand::Vertex* p0,
-                              const GPUBackendDrawLineCommand::Vertex* p1)
+                              const GPUBackendDrawLineCommand::Vertex* p1, RasterBand band)
 {
   const s32 i_dx = std::abs(p1->x - p0->x);
   const s32 i_dy = std::abs(p1->y - p0->y);
@@ -685,14 +1479,15 @@ void GPU_SW_Backend::DrawLine(const GPUBackendDrawLineCommand* cmd, const GPUBac
 
     if ((!cmd->params.interlaced_rendering || cmd->params.active_line_lsb != (Truncate8(static_cast<u32>(y)) & 1u)) &&
         x >= static_cast<s32>(m_drawing_area.left) && x <= static_cast<s32>(m_drawing_area.right) &&
-        y >= static_cast<s32>(m_drawing_area.top) && y <= static_cast<s32>(m_drawing_area.bottom))
+        y >= static_cast<s32>(m_drawing_area.top) && y <= static_cast<s32>(m_drawing_area.bottom) &&
+        band.ContainsRow(static_cast<u32>(y)))
     {
       const u8 r = shading_enable ? static_cast<u8>(cur_point.r >> Line_RGB_FractBits) : p0->r;
       const u8 g = shading_enable ? static_cast<u8>(cur_point.g >> Line_RGB_FractBits) : p0->g;
       const u8 b = shading_enable ? static_cast<u8>(cur_point.b >> Line_RGB_FractBits) : p0->b;
 
-      ShadePixel<false, false, transparency_enable, dithering_enable>(cmd, static_cast<u32>(x), static_cast<u32>(y), r,
-                                                                      g, b, 0, 0);
+      ShadePixel<false, false, transparency_enable, dithering_enable>(cmd, nullptr, static_cast<u32>(x),
+                                                                      static_cast<u32>(y), r, g, b, 0, 0);
     }
 
     cur_point.x += step.dx_dk;
@@ -709,6 +1504,9 @@ void GPU_SW_Backend::DrawLine(const GPUBackendDrawLineCommand* cmd, const GPUBac
 
 void GPU_SW_Backend::FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color, GPUBackendCommandParameters params)
 {
+  MarkRowsDirty(y, height);
+  InvalidateTexturePages(x, y, width, height);
+
   const u16 color16 = VRAMRGBA8888ToRGBA5551(color);
   if ((x + width) <= VRAM_WIDTH && !params.interlaced_rendering)
   {
@@ -754,6 +1552,9 @@ void GPU_SW_Backend::FillVRAM(u32 x, u32 y, u32 width, u32 height, u32 color, GP
 void GPU_SW_Backend::UpdateVRAM(u32 x, u32 y, u32 width, u32 height, const void* data,
                                 GPUBackendCommandParameters params)
 {
+  MarkRowsDirty(y, height);
+  InvalidateTexturePages(x, y, width, height);
+
   // Fast path when the copy is not oversized.
   if ((x + width) <= VRAM_WIDTH && (y + height) <= VRAM_HEIGHT && !params.IsMaskingEnabled())
   {
@@ -790,6 +1591,9 @@ void GPU_SW_Backend::UpdateVRAM(u32 x, u32 y, u32 width, u32 height, const void*
 void GPU_SW_Backend::CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 width, u32 height,
                               GPUBackendCommandParameters params)
 {
+  MarkRowsDirty(dst_y, height);
+  InvalidateTexturePages(dst_x, dst_y, width, height);
+
   // Break up oversized copies. This behavior has not been verified on console.
   if ((src_x + width) > VRAM_WIDTH || (dst_x + width) > VRAM_WIDTH)
   {
@@ -861,8 +1665,6 @@ void GPU_SW_Backend::CopyVRAM(u32 src_x, u32 src_y, u32 dst_x, u32 dst_y, u32 wi
   }
 }
 
-void GPU_SW_Backend::FlushRender() {}
-
 GPU_SW_Backend::DrawLineFunction GPU_SW_Backend::GetDrawLineFunction(bool shading_enable, bool transparency_enable,
                                                                      bool dithering_enable)
 {
@@ -1,7 +1,10 @@
 #pragma once
 #include "gpu_backend.h"
 #include <array>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 class GPU_SW_Backend final : public GPUBackend
@@ -11,13 +14,26 @@ public:
   ~GPU_SW_Backend() override;
 
   bool Initialize(bool force_thread) override;
+  void UpdateSettings() override;
   void Reset(bool clear_vram) override;
+  void Shutdown() override;
 
   ALWAYS_INLINE_RELEASE u16 GetPixel(const u32 x, const u32 y) const { return m_vram[VRAM_WIDTH * y + x]; }
   ALWAYS_INLINE_RELEASE const u16* GetPixelPtr(const u32 x, const u32 y) const { return &m_vram[VRAM_WIDTH * y + x]; }
   ALWAYS_INLINE_RELEASE u16* GetPixelPtr(const u32 x, const u32 y) { return &m_vram[VRAM_WIDTH * y + x]; }
   ALWAYS_INLINE_RELEASE void SetPixel(const u32 x, const u32 y, const u16 value) { m_vram[VRAM_WIDTH * y + x] = value; }
 
+  /// Returns true if the row was written since the last ClearDirtyRows().
+  ALWAYS_INLINE bool IsRowDirty(u32 y) const { return ((m_dirty_rows[y / 64] >> (y % 64)) & 1) != 0; }
+
+  /// Returns true if any of the rows was written since the last ClearDirtyRows(), wrapping around the bottom of VRAM.
+  bool AreRowsDirty(u32 y, u32 height) const;
+  void ClearDirtyRows();
+
+  /// Switches polygon spans between the vector and scalar shading, so their output can be compared.
+  static bool HasVectorSpans();
+  void SetVectorSpansEnabled(bool enabled);
+
   // this is actually (31 * 255) >> 4) == 494, but to simplify addressing we use the next power of two (512)
   static constexpr u32 DITHER_LUT_SIZE = 512;
   using DitherLUT = std::array<std::array<std::array<u8, 512>, DITHER_MATRIX_SIZE>, DITHER_MATRIX_SIZE>;
@@ -94,17 +110,118 @@ protected:
   void DrawRectangle(const GPUBackendDrawRectangleCommand* cmd) override;
   void FlushRender() override;
 
+  void MarkRowsDirty(u32 y, u32 height);
+
+  /// Marks the rows a primitive spans, from top to bottom inclusive, which are inside the drawing area.
+  void MarkDrawnRowsDirty(s32 top, s32 bottom);
+
+  //////////////////////////////////////////////////////////////////////////
+  // Binned rendering
+  //////////////////////////////////////////////////////////////////////////
+
+  /// VRAM rows are dealt out to the rasterizer threads in interleaved bands of this many rows.
+  static constexpr u32 RASTER_BAND_HEIGHT = 8;
+  static constexpr u32 MAX_RASTER_THREADS = 16;
+
+  /// A batch is drawn once it holds this many bytes of commands, even if nothing else forces it.
+  static constexpr u32 MAX_BATCH_SIZE = 256 * 1024;
+
+  /// The rows of VRAM which one thread draws to. Each row belongs to exactly one band, so every pixel still sees
+  /// the primitives in submission order.
+  struct RasterBand
+  {
+    u32 index;
+    u32 count;
+
+    ALWAYS_INLINE bool ContainsRow(u32 y) const { return ((y / RASTER_BAND_HEIGHT) % count) == index; }
+  };
+  static constexpr RasterBand ALL_ROWS = {0, 1};
+
+  ALWAYS_INLINE bool IsBinning() const { return !m_raster_threads.empty(); }
+
+  /// Returns true if the primitive samples its texture or palette from the drawing area, which earlier primitives in
+  /// the batch, or this one, may be writing to from other bands.
+  bool SamplesDrawingArea(const GPUBackendDrawCommand* cmd) const;
+
+  void QueueDrawCommand(const GPUBackendDrawCommand* cmd);
+  void DrawBatch(RasterBand band);
+
+  void StartRasterThreads(u32 count);
+  void StopRasterThreads();
+  void RasterThreadEntryPoint(u32 index);
+
+  void RasterizePolygon(const GPUBackendDrawPolygonCommand* cmd, RasterBand band);
+  void RasterizeRectangle(const GPUBackendDrawRectangleCommand* cmd, RasterBand band);
+  void RasterizeLine(const GPUBackendDrawLineCommand* cmd, RasterBand band);
+
+  //////////////////////////////////////////////////////////////////////////
+  // Texture page cache
+  //////////////////////////////////////////////////////////////////////////
+
+  /// VRAM writes invalidate cached texture pages with this granularity, which matches texture page base addresses.
+  static constexpr u32 VRAM_PAGE_WIDTH = 64;
+  static constexpr u32 VRAM_PAGE_HEIGHT = 256;
+  static constexpr u32 VRAM_PAGES_X = VRAM_WIDTH / VRAM_PAGE_WIDTH;
+  static constexpr u32 VRAM_PAGES_Y = VRAM_HEIGHT / VRAM_PAGE_HEIGHT;
+
+  static constexpr u32 TEXTURE_PAGE_CACHE_SIZE = 16;
+  static constexpr u16 INVALID_TEXTURE_PAGE_KEY = 0xFFFF;
+
+  /// Palette indices of a 4-bit or 8-bit texture page, one byte per texel.
+  using DecodedTexturePage = std::array<u8, TEXTURE_PAGE_WIDTH * TEXTURE_PAGE_HEIGHT>;
+
+  struct TexturePageCacheEntry
+  {
+    u32 vram_pages;
+    u32 last_used;
+    u16 key;
+  };
+
+  /// Texture state for drawing one primitive. Each rasterizer thread builds its own, so nothing here is shared.
+  struct TextureSampler
+  {
+    /// Indices from the texture page cache, or null when texels have to be read from VRAM.
+    const u8* indices;
+    std::array<u16, 256> palette;
+  };
+
+  /// Returns a bit for each VRAM page the rectangle touches, wrapping around the edges of VRAM.
+  static u32 GetVRAMPageMask(u32 x, u32 y, u32 width, u32 height);
+
+  static ALWAYS_INLINE u16 GetTexturePageKey(const GPUBackendDrawCommand* cmd)
+  {
+    return cmd->draw_mode.bits & (GPUDrawModeReg::TEXTURE_PAGE_MASK | (1u << 7));
+  }
+
+  /// Returns true if the primitive may read its texels from the texture page cache.
+  bool CanUseTexturePageCache(const GPUBackendDrawCommand* cmd) const;
+
+  /// Makes sure the primitive's texture page is decoded. Must be called before the primitive is drawn or queued.
+  void PrepareTexturePage(const GPUBackendDrawCommand* cmd);
+
+  void InvalidateTexturePages(u32 x, u32 y, u32 width, u32 height);
+  void InvalidateDrawingAreaTexturePages();
+  void InvalidateTexturePageCache();
+  void DecodeTexturePage(GPUDrawModeReg mode, DecodedTexturePage* indices) const;
+
+  /// Sets up texel lookups for a primitive, using the texture page cache where possible.
+  void SetupTextureSampler(const GPUBackendDrawCommand* cmd, TextureSampler* sampler) const;
+
   //////////////////////////////////////////////////////////////////////////
   // Rasterization
   //////////////////////////////////////////////////////////////////////////
+  /// Reads the texel at the given coordinates, after applying the texture window and palette.
+  u16 FetchTexel(const GPUBackendDrawCommand* cmd, const TextureSampler* sampler, u8 texcoord_x, u8 texcoord_y) const;
+
   template<bool texture_enable, bool raw_texture_enable, bool transparency_enable, bool dithering_enable>
-  void ShadePixel(const GPUBackendDrawCommand* cmd, u32 x, u32 y, u8 color_r, u8 color_g, u8 color_b, u8 texcoord_x,
-                  u8 texcoord_y);
+  void ShadePixel(const GPUBackendDrawCommand* cmd, const TextureSampler* sampler, u32 x, u32 y, u8 color_r,
+                  u8 color_g, u8 color_b, u8 texcoord_x, u8 texcoord_y);
 
   template<bool texture_enable, bool raw_texture_enable, bool transparency_enable>
-  void DrawRectangle(const GPUBackendDrawRectangleCommand* cmd);
+  void DrawRectangle(const GPUBackendDrawRectangleCommand* cmd, const TextureSampler* sampler, RasterBand band);
 
-  using DrawRectangleFunction = void (GPU_SW_Backend::*)(const GPUBackendDrawRectangleCommand* cmd);
+  using DrawRectangleFunction = void (GPU_SW_Backend::*)(const GPUBackendDrawRectangleCommand* cmd,
+                                                         const TextureSampler* sampler, RasterBand band);
   DrawRectangleFunction GetDrawRectangleFunction(bool texture_enable, bool raw_texture_enable,
                                                  bool transparency_enable);
 
@@ -136,31 +253,67 @@ protected:
   template<bool shading_enable, bool texture_enable>
   void AddIDeltas_DY(i_group& ig, const i_deltas& idl, u32 count = 1);
 
+  /// Number of pixels shaded at once by the vector span kernel.
+  static constexpr u32 SPAN_VECTOR_WIDTH = 8;
+
+  /// Shades count pixels of a span, which must be a multiple of SPAN_VECTOR_WIDTH. Only usable when the primitive
+  /// does not sample the drawing area, since texels are fetched for a whole vector before any pixel is written.
+  template<bool shading_enable, bool texture_enable, bool raw_texture_enable, bool transparency_enable,
+           bool dithering_enable>
+  void ShadeSpanVector(const GPUBackendDrawCommand* cmd, const TextureSampler* sampler, u32 x, u32 y, u32 count,
+                       const i_group& ig, const i_deltas& idl);
+
   template<bool shading_enable, bool texture_enable, bool raw_texture_enable, bool transparency_enable,
            bool dithering_enable>
-  void DrawSpan(const GPUBackendDrawPolygonCommand* cmd, s32 y, s32 x_start, s32 x_bound, i_group ig,
-                const i_deltas& idl);
+  void DrawSpan(const GPUBackendDrawPolygonCommand* cmd, const TextureSampler* sampler, s32 y, s32 x_start,
+                s32 x_bound, i_group ig, const i_deltas& idl);
 
   template<bool shading_enable, bool texture_enable, bool raw_texture_enable, bool transparency_enable,
            bool dithering_enable>
-  void DrawTriangle(const GPUBackendDrawPolygonCommand* cmd, const GPUBackendDrawPolygonCommand::Vertex* v0,
-                    const GPUBackendDrawPolygonCommand::Vertex* v1, const GPUBackendDrawPolygonCommand::Vertex* v2);
+  void DrawTriangle(const GPUBackendDrawPolygonCommand* cmd, const TextureSampler* sampler,
+                    const GPUBackendDrawPolygonCommand::Vertex* v0, const GPUBackendDrawPolygonCommand::Vertex* v1,
+                    const GPUBackendDrawPolygonCommand::Vertex* v2, RasterBand band);
 
   using DrawTriangleFunction = void (GPU_SW_Backend::*)(const GPUBackendDrawPolygonCommand* cmd,
+                                                        const TextureSampler* sampler,
                                                         const GPUBackendDrawPolygonCommand::Vertex* v0,
                                                         const GPUBackendDrawPolygonCommand::Vertex* v1,
-                                                        const GPUBackendDrawPolygonCommand::Vertex* v2);
+                                                        const GPUBackendDrawPolygonCommand::Vertex* v2,
+                                                        RasterBand band);
   DrawTriangleFunction GetDrawTriangleFunction(bool shading_enable, bool texture_enable, bool raw_texture_enable,
                                                bool transparency_enable, bool dithering_enable);
 
   template<bool shading_enable, bool transparency_enable, bool dithering_enable>
   void DrawLine(const GPUBackendDrawLineCommand* cmd, const GPUBackendDrawLineCommand::Vertex* p0,
-                const GPUBackendDrawLineCommand::Vertex* p1);
+                const GPUBackendDrawLineCommand::Vertex* p1, RasterBand band);
 
   using DrawLineFunction = void (GPU_SW_Backend::*)(const GPUBackendDrawLineCommand* cmd,
                                                     const GPUBackendDrawLineCommand::Vertex* p0,
-                                                    const GPUBackendDrawLineCommand::Vertex* p1);
+                                                    const GPUBackendDrawLineCommand::Vertex* p1, RasterBand band);
   DrawLineFunction GetDrawLineFunction(bool shading_enable, bool transparency_enable, bool dithering_enable);
 
   std::array<u16, VRAM_WIDTH * VRAM_HEIGHT> m_vram;
+
+  // One bit for each row of VRAM written since the display was last copied out.
+  std::array<u64, VRAM_HEIGHT / 64> m_dirty_rows;
+
+  bool m_vector_spans_enabled = true;
+
+  // Draw commands recorded since the last barrier, copied out of the command FIFO.
+  std::vector<u8> m_batch;
+
+  std::vector<std::thread> m_raster_threads;
+  std::mutex m_raster_mutex;
+  std::condition_variable m_raster_start_cv;
+  std::condition_variable m_raster_done_cv;
+  u32 m_raster_generation = 0;
+  u32 m_raster_threads_busy = 0;
+  bool m_raster_threads_shutdown = false;
+
+  std::array<TexturePageCacheEntry, TEXTURE_PAGE_CACHE_SIZE> m_texture_page_cache;
+  std::array<DecodedTexturePage, TEXTURE_PAGE_CACHE_SIZE> m_decoded_texture_pages;
+
+  // VRAM pages which at least one valid cache entry was decoded from.
+  u32 m_texture_page_cache_vram_pages = 0;
+  u32 m_texture_page_cache_clock = 0;
 };
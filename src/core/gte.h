@@ -19,4 +19,7 @@ void ExecuteInstruction(u32 inst_bits);
 using InstructionImpl = void (*)(Instruction);
 InstructionImpl GetInstructionImpl(u32 inst_bits, TickCount* ticks);
 
+// reciprocal table for the RTPS/RTPT divider, also read by code the recompiler emits inline
+extern const u8 g_unr_table[257];
+
 } // namespace GTE
@@ -100,6 +100,7 @@ public:
     m_display_texture_view_y = 0;
     m_display_texture_view_width = 0;
     m_display_texture_view_height = 0;
+    m_display_texture_unchanged = false;
     m_display_changed = true;
   }
 
@@ -114,9 +115,13 @@ public:
     m_display_texture_view_y = view_y;
     m_display_texture_view_width = view_width;
     m_display_texture_view_height = view_height;
+    m_display_texture_unchanged = false;
     m_display_changed = true;
   }
 
+  /// Marks the display texture as holding the same image as the last frame, so it doesn't have to be presented again.
+  void SetDisplayTextureUnchanged() { m_display_texture_unchanged = true; }
+
   void SetDisplayParameters(s32 display_width, s32 display_height, s32 active_left, s32 active_top, s32 active_width,
                             s32 active_height, float display_aspect_ratio)
   {
@@ -139,6 +144,10 @@ public:
   virtual void EndSetDisplayPixels() = 0;
   virtual bool SetDisplayPixels(HostDisplayPixelFormat format, u32 width, u32 height, const void* buffer, u32 pitch);
 
+  /// Returns true if the display texture was set by BeginSetDisplayPixels(), and calling it again with the same size
+  /// and display parameters returns the same buffer, still holding the last frame.
+  virtual bool RetainsDisplayPixels() const;
+
   /// Sets the software cursor to the specified texture. Ownership of the texture is transferred.
   void SetSoftwareCursor(std::unique_ptr<HostDisplayTexture> texture, float scale = 1.0f);
 
@@ -192,5 +201,6 @@ protected:
   std::unique_ptr<HostDisplayTexture> m_cursor_texture;
   float m_cursor_texture_scale = 1.0f;
 
+  bool m_display_texture_unchanged = false;
   bool m_display_changed = false;
 };
@@ -25,7 +25,7 @@
 #include <stdlib.h>
 Log_SetChannel(HostInterface);
 
-HostInterface* g_host_interface;
+CONSOLE_LOCAL HostInterface* g_host_interface;
 
 HostInterface::HostInterface()
 {
@@ -346,6 +346,7 @@ void HostInterface::CheckForSettingsChanges(const Settings& old_settings)
     if (g_settings.cpu_execution_mode == CPUExecutionMode::Recompiler &&
         (g_settings.cpu_recompiler_memory_exceptions != old_settings.cpu_recompiler_memory_exceptions ||
          g_settings.cpu_recompiler_block_linking != old_settings.cpu_recompiler_block_linking ||
+         g_settings.cpu_recompiler_tiered_compilation != old_settings.cpu_recompiler_tiered_compilation ||
          g_settings.cpu_recompiler_icache != old_settings.cpu_recompiler_icache))
     {
       // changing memory exceptions can re-enable fastmem
@@ -358,10 +359,21 @@ void HostInterface::CheckForSettingsChanges(const Settings& old_settings)
         CPU::ClearICache();
     }
 
+    // superblocks aren't formed with icache emulation, idle loops are detected at compile time, and RTPS/RTPT are only
+    // inlined without the widescreen hack, so existing blocks have to be rebuilt when any of these change
+    if (g_settings.IsUsingCodeCache() && (g_settings.cpu_code_cache_traces != old_settings.cpu_code_cache_traces ||
+                                          g_settings.cpu_recompiler_icache != old_settings.cpu_recompiler_icache ||
+                                          g_settings.cpu_idle_loop_skipping != old_settings.cpu_idle_loop_skipping ||
+                                          g_settings.gpu_widescreen_hack != old_settings.gpu_widescreen_hack))
+    {
+      CPU::CodeCache::Flush();
+    }
+
     if (g_settings.gpu_resolution_scale != old_settings.gpu_resolution_scale ||
         g_settings.gpu_multisamples != old_settings.gpu_multisamples ||
         g_settings.gpu_per_sample_shading != old_settings.gpu_per_sample_shading ||
         g_settings.gpu_use_thread != old_settings.gpu_use_thread ||
+        g_settings.gpu_sw_rasterizer_threads != old_settings.gpu_sw_rasterizer_threads ||
         g_settings.gpu_use_software_renderer_for_readbacks != old_settings.gpu_use_software_renderer_for_readbacks ||
         g_settings.gpu_fifo_size != old_settings.gpu_fifo_size ||
         g_settings.gpu_max_run_ahead != old_settings.gpu_max_run_ahead ||
@@ -147,4 +147,4 @@ protected:
 
 #define TRANSLATABLE(context, str) str
 
-extern HostInterface* g_host_interface;
+extern CONSOLE_LOCAL HostInterface* g_host_interface;
@@ -2,7 +2,7 @@
 #include "common/state_wrapper.h"
 #include "cpu_core.h"
 
-InterruptController g_interrupt_controller;
+CONSOLE_LOCAL InterruptController g_interrupt_controller;
 
 InterruptController::InterruptController() = default;
 
@@ -52,4 +52,4 @@ private:
   u32 m_interrupt_mask_register = DEFAULT_INTERRUPT_MASK;
 };
 
-extern InterruptController g_interrupt_controller;
\ No newline at end of file
+extern CONSOLE_LOCAL InterruptController g_interrupt_controller;
\ No newline at end of file
@@ -6,7 +6,7 @@
 #include "interrupt_controller.h"
 #include "system.h"
 
-MDEC g_mdec;
+CONSOLE_LOCAL MDEC g_mdec;
 
 MDEC::MDEC() = default;
 
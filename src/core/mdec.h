@@ -149,4 +149,4 @@ private:
   u32 m_total_blocks_decoded = 0;
 };
 
-extern MDEC g_mdec;
+extern CONSOLE_LOCAL MDEC g_mdec;
@@ -7,7 +7,7 @@
 #include "multitap.h"
 #include "system.h"
 
-Pad g_pad;
+CONSOLE_LOCAL Pad g_pad;
 
 Pad::Pad() = default;
 
@@ -137,4 +137,4 @@ private:
   bool m_transmit_buffer_full = false;
 };
 
-extern Pad g_pad;
+extern CONSOLE_LOCAL Pad g_pad;
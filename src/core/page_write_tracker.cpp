@@ -0,0 +1,125 @@
+#include "page_write_tracker.h"
+#include "common/bitutils.h"
+#include <algorithm>
+#include <cstring>
+
+PageWriteTracker::PageWriteTracker(u32 page_size) : m_page_shift(CountTrailingZeros(page_size)) {}
+
+void PageWriteTracker::Resize(u32 size, u32 mirrored_size /* = 0 */)
+{
+  const u32 page_size = GetPageSize();
+  const u32 num_pages = (size + page_size - 1) >> m_page_shift;
+  const u32 num_mirrored_pages = (std::max(size, mirrored_size) + page_size - 1) >> m_page_shift;
+  m_size = size;
+  m_dirty_pages.assign(num_mirrored_pages, 0);
+  m_page_generations.assign(num_pages, 0);
+  MarkAllDirty();
+}
+
+void PageWriteTracker::MarkDirty(u32 offset, u32 size)
+{
+  if (size == 0)
+    return;
+
+  const u32 first_page = offset >> m_page_shift;
+  const u32 last_page = std::min((offset + size - 1) >> m_page_shift, GetPageCount() - 1);
+  for (u32 page = first_page; page <= last_page; page++)
+    m_dirty_pages[page] = 1;
+}
+
+void PageWriteTracker::MarkAllDirty()
+{
+  std::fill_n(m_dirty_pages.begin(), GetPageCount(), static_cast<u8>(1));
+}
+
+u32 PageWriteTracker::Advance()
+{
+  const u32 num_pages = GetPageCount();
+  for (u32 page = num_pages; page < static_cast<u32>(m_dirty_pages.size()); page++)
+  {
+    if (m_dirty_pages[page])
+    {
+      m_dirty_pages[page % num_pages] = 1;
+      m_dirty_pages[page] = 0;
+    }
+  }
+
+  m_generation++;
+  for (u32 page = 0; page < num_pages; page++)
+  {
+    if (m_dirty_pages[page])
+    {
+      m_page_generations[page] = m_generation;
+      m_dirty_pages[page] = 0;
+    }
+  }
+
+  return m_generation;
+}
+
+bool PageWriteTracker::GetRangeWrittenSince(u32 generation, u32* start, u32* end) const
+{
+  const u32 num_pages = GetPageCount();
+  u32 first = 0;
+  while (first < num_pages && !WasWrittenSince(first, generation))
+    first++;
+  if (first == num_pages)
+    return false;
+
+  u32 last = num_pages - 1;
+  while (!WasWrittenSince(last, generation))
+    last--;
+
+  *start = first << m_page_shift;
+  *end = std::min((last + 1) << m_page_shift, m_size);
+  return true;
+}
+
+void PageWriteTracker::SaveSnapshot(const u8* data, Snapshot* snapshot)
+{
+  const u32 generation = Advance();
+  if (snapshot->data.size() != m_size)
+  {
+    snapshot->data.resize(m_size);
+    snapshot->generation = 0;
+  }
+
+  const u32 num_pages = GetPageCount();
+  const u32 page_size = GetPageSize();
+  for (u32 page = 0; page < num_pages; page++)
+  {
+    if (!WasWrittenSince(page, snapshot->generation))
+      continue;
+
+    const u32 offset = page << m_page_shift;
+    std::memcpy(&snapshot->data[offset], &data[offset], std::min(page_size, m_size - offset));
+  }
+
+  snapshot->generation = generation;
+}
+
+bool PageWriteTracker::RestoreSnapshot(u8* data, const Snapshot& snapshot)
+{
+  if (snapshot.data.size() != m_size || snapshot.generation == 0)
+    return false;
+
+  Advance();
+
+  const u32 num_pages = GetPageCount();
+  const u32 page_size = GetPageSize();
+  for (u32 page = 0; page < num_pages; page++)
+  {
+    if (!WasWrittenSince(page, snapshot.generation))
+      continue;
+
+    const u32 offset = page << m_page_shift;
+    const u32 size = std::min(page_size, m_size - offset);
+    if (std::memcmp(&data[offset], &snapshot.data[offset], size) == 0)
+      continue;
+
+    std::memcpy(&data[offset], &snapshot.data[offset], size);
+    m_dirty_pages[page] = 1;
+  }
+
+  return true;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "types.h"
+#include <vector>
+
+/// Tracks which pages of a block of memory were written. A write only sets a byte for its page. Consumers which need
+/// to know what changed since they last looked, like snapshots and hashes, call Advance() and then compare each page
+/// against the generation they got the previous time, so any number of them can share one tracker.
+class PageWriteTracker
+{
+public:
+  /// A copy of the memory which is brought up to date by only copying the pages written since the last update.
+  struct Snapshot
+  {
+    std::vector<u8> data;
+    u32 generation = 0; ///< Zero when data doesn't hold a copy yet.
+  };
+
+  /// The page size must be a power of two.
+  PageWriteTracker(u32 page_size);
+
+  /// Sets the size of the memory. Marks beyond it, up to mirrored_size, are writes through mirrors and are folded onto
+  /// the page they hit on the next Advance(). Every page starts out written.
+  void Resize(u32 size, u32 mirrored_size = 0);
+
+  ALWAYS_INLINE u32 GetSize() const { return m_size; }
+  ALWAYS_INLINE u32 GetPageSize() const { return 1u << m_page_shift; }
+  ALWAYS_INLINE u32 GetPageCount() const { return static_cast<u32>(m_page_generations.size()); }
+
+  /// One byte per page, which is set to non-zero for writes. Stays in place until the next Resize().
+  ALWAYS_INLINE u8* GetDirtyPages() { return m_dirty_pages.data(); }
+
+  ALWAYS_INLINE void MarkPageDirty(u32 page) { m_dirty_pages[page] = 1; }
+  ALWAYS_INLINE void MarkDirty(u32 offset) { m_dirty_pages[offset >> m_page_shift] = 1; }
+  void MarkDirty(u32 offset, u32 size);
+  void MarkAllDirty();
+
+  /// Stamps the pages which were written since the last call with a new generation, and returns it.
+  u32 Advance();
+
+  /// Returns true if the page was written after Advance() returned the specified generation.
+  ALWAYS_INLINE bool WasWrittenSince(u32 page, u32 generation) const
+  {
+    return (generation == 0 || m_page_generations[page] > generation);
+  }
+
+  /// Returns the byte range covering the pages written since the generation, or false if there are none.
+  bool GetRangeWrittenSince(u32 generation, u32* start, u32* end) const;
+
+  /// Copies the pages of data which were written since the snapshot was last saved into it.
+  void SaveSnapshot(const u8* data, Snapshot* snapshot);
+
+  /// Copies the pages which were written since the snapshot was saved back into data, and marks the ones which differ
+  /// as written. Returns false if the snapshot doesn't match the size of the memory.
+  bool RestoreSnapshot(u8* data, const Snapshot& snapshot);
+
+private:
+  u32 m_page_shift;
+  u32 m_size = 0;
+  u32 m_generation = 0;
+  std::vector<u8> m_dirty_pages;
+  std::vector<u32> m_page_generations;
+};
@@ -0,0 +1,29 @@
+#include "paged_hash.h"
+#include "xxhash.h"
+#include <algorithm>
+
+u64 PagedHash::Update(const void* data, PageWriteTracker& tracker)
+{
+  const u32 num_pages = tracker.GetPageCount();
+  if (m_page_hashes.size() != num_pages)
+  {
+    m_page_hashes.assign(num_pages, 0);
+    m_generation = 0;
+  }
+
+  const u8* data_ptr = static_cast<const u8*>(data);
+  const u32 page_size = tracker.GetPageSize();
+  const u32 size = tracker.GetSize();
+  const u32 generation = tracker.Advance();
+  for (u32 page = 0; page < num_pages; page++)
+  {
+    if (!tracker.WasWrittenSince(page, m_generation))
+      continue;
+
+    const u32 offset = page * page_size;
+    m_page_hashes[page] = XXH3_64bits(data_ptr + offset, std::min(page_size, size - offset));
+  }
+
+  m_generation = generation;
+  return XXH3_64bits(m_page_hashes.data(), m_page_hashes.size() * sizeof(u64));
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include "page_write_tracker.h"
+#include "types.h"
+#include <vector>
+
+/// Keeps an XXH3 digest for each page of a block of memory. Only pages which the tracker saw written since the last
+/// update are hashed again, and the page digests are combined into a single digest for the whole block.
+class PagedHash
+{
+public:
+  /// Returns the tracker generation which the page digests are up to date with, or zero if there are none yet.
+  ALWAYS_INLINE u32 GetGeneration() const { return m_generation; }
+
+  /// Rehashes the written pages of data, which must be the size of the tracker, and returns the combined digest.
+  u64 Update(const void* data, PageWriteTracker& tracker);
+
+private:
+  std::vector<u64> m_page_hashes;
+  u32 m_generation = 0;
+};
@@ -96,17 +96,17 @@ static PGXP_value* ReadMem(u32 addr);
 static const PGXP_value PGXP_value_invalid = {0.f, 0.f, 0.f, {0}, 0};
 static const PGXP_value PGXP_value_zero = {0.f, 0.f, 0.f, {VALID_ALL}, 0};
 
-static PGXP_value CPU_reg[34];
-static PGXP_value CP0_reg[32];
+static CONSOLE_LOCAL PGXP_value CPU_reg[34];
+static CONSOLE_LOCAL PGXP_value CP0_reg[32];
 #define CPU_Hi CPU_reg[32]
 #define CPU_Lo CPU_reg[33]
 
 // GTE registers
-static PGXP_value GTE_data_reg[32];
-static PGXP_value GTE_ctrl_reg[32];
+static CONSOLE_LOCAL PGXP_value GTE_data_reg[32];
+static CONSOLE_LOCAL PGXP_value GTE_ctrl_reg[32];
 
-static PGXP_value* Mem = nullptr;
-static PGXP_value* vertexCache = nullptr;
+static CONSOLE_LOCAL PGXP_value* Mem = nullptr;
+static CONSOLE_LOCAL PGXP_value* vertexCache = nullptr;
 
 ALWAYS_INLINE_RELEASE void MakeValid(PGXP_value* pV, u32 psxV)
 {
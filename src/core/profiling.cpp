@@ -0,0 +1,67 @@
+#include "profiling.h"
+#include "common/timer.h"
+#include <array>
+
+namespace Profiling {
+
+CONSOLE_LOCAL bool g_enabled = false;
+
+static constexpr std::array<const char*, static_cast<u32>(Section::Count)> s_section_names = {
+  {"CPU", "CPU::CodeCache::Compile", "TimingEvents::RunEvents", "GPU_SW_Backend", "SPU::Execute"}};
+
+static CONSOLE_LOCAL std::array<Common::Timer::Value, static_cast<u32>(Section::Count)> s_section_times = {};
+static CONSOLE_LOCAL std::array<u64, static_cast<u32>(Section::Count)> s_section_counts = {};
+static CONSOLE_LOCAL Section s_current_section = Section::Count;
+static CONSOLE_LOCAL Common::Timer::Value s_current_section_start = 0;
+
+void SetEnabled(bool enabled)
+{
+  g_enabled = enabled;
+  s_current_section = Section::Count;
+}
+
+void Reset()
+{
+  s_section_times.fill(0);
+  s_section_counts.fill(0);
+}
+
+const char* GetSectionName(Section section)
+{
+  return s_section_names[static_cast<u32>(section)];
+}
+
+double GetSectionTimeSeconds(Section section)
+{
+  return Common::Timer::ConvertValueToSeconds(s_section_times[static_cast<u32>(section)]);
+}
+
+u64 GetSectionCallCount(Section section)
+{
+  return s_section_counts[static_cast<u32>(section)];
+}
+
+Section EnterSection(Section section)
+{
+  const Common::Timer::Value now = Common::Timer::GetValue();
+  const Section parent = s_current_section;
+  if (parent != Section::Count)
+    s_section_times[static_cast<u32>(parent)] += now - s_current_section_start;
+
+  s_section_counts[static_cast<u32>(section)]++;
+  s_current_section = section;
+  s_current_section_start = now;
+  return parent;
+}
+
+void LeaveSection(Section parent)
+{
+  const Common::Timer::Value now = Common::Timer::GetValue();
+  if (s_current_section != Section::Count)
+    s_section_times[static_cast<u32>(s_current_section)] += now - s_current_section_start;
+
+  s_current_section = parent;
+  s_current_section_start = now;
+}
+
+} // namespace Profiling
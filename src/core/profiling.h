@@ -0,0 +1,54 @@
+#pragma once
+#include "types.h"
+
+/// Lightweight wall-clock accounting for the hot subsystems, used by the benchmark runner.
+/// Sections are exclusive: entering a nested section pauses the time of the enclosing one.
+/// Only valid when everything runs on the emulation thread (i.e. no GPU thread).
+namespace Profiling {
+
+enum class Section : u8
+{
+  CPU,
+  CodeCompile,
+  TimingEvents,
+  GPUBackend,
+  SPU,
+  Count
+};
+
+extern CONSOLE_LOCAL bool g_enabled;
+
+void SetEnabled(bool enabled);
+void Reset();
+
+const char* GetSectionName(Section section);
+double GetSectionTimeSeconds(Section section);
+u64 GetSectionCallCount(Section section);
+
+Section EnterSection(Section section);
+void LeaveSection(Section parent);
+
+class ScopedSection
+{
+public:
+  ALWAYS_INLINE ScopedSection(Section section)
+  {
+    if (g_enabled)
+    {
+      m_parent = EnterSection(section);
+      m_active = true;
+    }
+  }
+
+  ALWAYS_INLINE ~ScopedSection()
+  {
+    if (m_active)
+      LeaveSection(m_parent);
+  }
+
+private:
+  Section m_parent = Section::Count;
+  bool m_active = false;
+};
+
+} // namespace Profiling
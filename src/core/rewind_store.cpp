@@ -0,0 +1,371 @@
+#include "rewind_store.h"
+#include "common/log.h"
+#include "host_display.h"
+#include "zlib.h"
+#include <algorithm>
+#include <cstring>
+Log_SetChannel(RewindStore);
+
+RewindStore::RewindStore() = default;
+
+RewindStore::~RewindStore()
+{
+  StopThread();
+}
+
+void RewindStore::StartThread(u32 max_slots, u32 keyframe_interval)
+{
+  StopThread();
+  Clear();
+
+  m_max_slots = std::max(max_slots, 1u);
+  m_keyframe_interval = std::clamp(keyframe_interval, 1u, m_max_slots);
+  m_worker_thread = std::thread(&RewindStore::WorkerThreadEntryPoint, this);
+}
+
+void RewindStore::StopThread()
+{
+  if (!m_worker_thread.joinable())
+    return;
+
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_shutdown_flag = true;
+    m_work_cv.notify_one();
+  }
+
+  m_worker_thread.join();
+  m_shutdown_flag = false;
+  m_jobs.clear();
+}
+
+void RewindStore::Push(const void* state, u32 state_size, std::unique_ptr<HostDisplayTexture> vram_texture)
+{
+  Job job;
+  job.vram_texture = std::move(vram_texture);
+  {
+    // reusing an old buffer saves faulting in a fresh allocation on every save
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_free_states.empty())
+    {
+      job.state = std::move(m_free_states.back());
+      m_free_states.pop_back();
+    }
+  }
+
+  job.state.resize(state_size);
+  std::memcpy(job.state.data(), state, state_size);
+
+  if (!m_worker_thread.joinable())
+  {
+    EncodeJob(std::move(job));
+    return;
+  }
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_jobs.push_back(std::move(job));
+  m_work_cv.notify_one();
+}
+
+std::unique_ptr<HostDisplayTexture> RewindStore::TakeFreeTexture()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (m_free_textures.empty())
+    return {};
+
+  std::unique_ptr<HostDisplayTexture> texture = std::move(m_free_textures.back());
+  m_free_textures.pop_back();
+  return texture;
+}
+
+bool RewindStore::GetNewest(std::vector<u8>* state, HostDisplayTexture** vram_texture)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  WaitForIdle(lock);
+  if (m_slots.empty() || !DecodeSlot(m_slots.size() - 1, state))
+    return false;
+
+  // after popping, the next save can be a delta against this again
+  if (m_newest_state.empty())
+    m_newest_state = *state;
+
+  *vram_texture = m_slots.back().vram_texture.get();
+  return true;
+}
+
+void RewindStore::PopNewest(u32 count)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  WaitForIdle(lock);
+  if (count == 0)
+    return;
+
+  for (; count > 0 && !m_slots.empty(); count--)
+    m_slots.pop_back();
+
+  m_slots_since_keyframe = 0;
+  for (auto it = m_slots.rbegin(); it != m_slots.rend() && !it->keyframe; ++it)
+    m_slots_since_keyframe++;
+
+  m_newest_state.clear();
+}
+
+void RewindStore::Clear()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  WaitForIdle(lock);
+  m_slots.clear();
+  m_free_textures.clear();
+  m_free_states.clear();
+  m_newest_state.clear();
+  m_slots_since_keyframe = 0;
+}
+
+RewindStore::Statistics RewindStore::GetStatistics()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  WaitForIdle(lock);
+
+  Statistics stats = {};
+  stats.slot_count = static_cast<u32>(m_slots.size());
+  for (const Slot& slot : m_slots)
+  {
+    stats.keyframe_count += BoolToUInt32(slot.keyframe);
+    stats.compressed_bytes += slot.data.size();
+    stats.uncompressed_bytes += slot.uncompressed_size;
+  }
+
+  return stats;
+}
+
+void RewindStore::WorkerThreadEntryPoint()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;)
+  {
+    m_work_cv.wait(lock, [this]() { return (m_shutdown_flag || !m_jobs.empty()); });
+    if (m_shutdown_flag)
+      break;
+
+    Job job = std::move(m_jobs.front());
+    m_jobs.pop_front();
+    m_busy = true;
+
+    // the slots are only touched by the other thread while we're idle
+    lock.unlock();
+    EncodeJob(std::move(job));
+    lock.lock();
+
+    m_busy = false;
+    if (m_jobs.empty())
+      m_idle_cv.notify_all();
+  }
+}
+
+void RewindStore::WaitForIdle(std::unique_lock<std::mutex>& lock)
+{
+  m_idle_cv.wait(lock, [this]() { return (m_jobs.empty() && !m_busy) || !m_worker_thread.joinable(); });
+}
+
+static u64 LoadStateWord(const u8* data, size_t size, size_t offset)
+{
+  // bytes past the end of a state read as zero
+  u64 value = 0;
+  if (offset < size)
+    std::memcpy(&value, data + offset, std::min(size - offset, sizeof(value)));
+  return value;
+}
+
+static void AppendU32(std::vector<u8>* out, u32 value)
+{
+  const size_t pos = out->size();
+  out->resize(pos + sizeof(value));
+  std::memcpy(out->data() + pos, &value, sizeof(value));
+}
+
+/// Packs cur ^ prev as runs of [zero word count][changed word count][changed words]. Most of the state doesn't change
+/// between slots, so this is far smaller than the state and much cheaper to produce than running zlib over all of it.
+static void PackDelta(const u8* cur, size_t cur_size, const u8* prev, size_t prev_size, std::vector<u8>* out)
+{
+  out->clear();
+
+  const size_t word_count = (cur_size + sizeof(u64) - 1) / sizeof(u64);
+  const size_t block_size = 64;
+  const size_t block_bytes = std::min(cur_size, prev_size) & ~(block_size - 1);
+  size_t word = 0;
+  while (word < word_count)
+  {
+    // unchanged stretches are usually long, skip them a cache line at a time
+    const size_t zero_start = word;
+    while ((word * sizeof(u64) + block_size) <= block_bytes &&
+           std::memcmp(cur + word * sizeof(u64), prev + word * sizeof(u64), block_size) == 0)
+    {
+      word += block_size / sizeof(u64);
+    }
+    while (word < word_count &&
+           LoadStateWord(cur, cur_size, word * sizeof(u64)) == LoadStateWord(prev, prev_size, word * sizeof(u64)))
+    {
+      word++;
+    }
+    if (word == word_count)
+      break;
+
+    const size_t changed_start = word;
+    while (word < word_count &&
+           LoadStateWord(cur, cur_size, word * sizeof(u64)) != LoadStateWord(prev, prev_size, word * sizeof(u64)))
+    {
+      word++;
+    }
+
+    AppendU32(out, static_cast<u32>(changed_start - zero_start));
+    AppendU32(out, static_cast<u32>(word - changed_start));
+    for (size_t i = changed_start; i < word; i++)
+    {
+      const u64 value =
+        LoadStateWord(cur, cur_size, i * sizeof(u64)) ^ LoadStateWord(prev, prev_size, i * sizeof(u64));
+      const size_t pos = out->size();
+      out->resize(pos + sizeof(value));
+      std::memcpy(out->data() + pos, &value, sizeof(value));
+    }
+  }
+}
+
+/// Turns the previous state in *state into the one a packed delta was made from.
+static bool ApplyDelta(std::vector<u8>* state, u32 state_size, const u8* packed, size_t packed_size)
+{
+  const size_t word_count = (static_cast<size_t>(state_size) + sizeof(u64) - 1) / sizeof(u64);
+  state->resize(word_count * sizeof(u64));
+
+  size_t word = 0;
+  size_t pos = 0;
+  while (pos < packed_size)
+  {
+    u32 zero_words, changed_words;
+    if ((packed_size - pos) < (sizeof(zero_words) + sizeof(changed_words)))
+      return false;
+    std::memcpy(&zero_words, packed + pos, sizeof(zero_words));
+    std::memcpy(&changed_words, packed + pos + sizeof(zero_words), sizeof(changed_words));
+    pos += sizeof(zero_words) + sizeof(changed_words);
+
+    word += zero_words;
+    if ((word + changed_words) > word_count || (packed_size - pos) < (changed_words * sizeof(u64)))
+      return false;
+
+    for (u32 i = 0; i < changed_words; i++, word++, pos += sizeof(u64))
+    {
+      u64 a, b;
+      std::memcpy(&a, state->data() + word * sizeof(u64), sizeof(a));
+      std::memcpy(&b, packed + pos, sizeof(b));
+      a ^= b;
+      std::memcpy(state->data() + word * sizeof(u64), &a, sizeof(a));
+    }
+  }
+
+  state->resize(state_size);
+  return true;
+}
+
+void RewindStore::EncodeJob(Job job)
+{
+  Slot slot;
+  slot.uncompressed_size = static_cast<u32>(job.state.size());
+  slot.vram_texture = std::move(job.vram_texture);
+  slot.keyframe = (m_slots.empty() || m_newest_state.empty() || (m_slots_since_keyframe + 1) >= m_keyframe_interval);
+
+  bool result;
+  if (slot.keyframe)
+  {
+    result = Compress(job.state.data(), job.state.size(), &slot.data);
+  }
+  else
+  {
+    PackDelta(job.state.data(), job.state.size(), m_newest_state.data(), m_newest_state.size(), &m_delta_buffer);
+    result = Compress(m_delta_buffer.data(), m_delta_buffer.size(), &slot.data);
+  }
+  slot.encoded_size = static_cast<u32>(slot.keyframe ? job.state.size() : m_delta_buffer.size());
+
+  if (!result)
+  {
+    Log_ErrorPrintf("Failed to compress %u byte rewind state", slot.uncompressed_size);
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (slot.vram_texture)
+      m_free_textures.push_back(std::move(slot.vram_texture));
+    return;
+  }
+
+  m_slots_since_keyframe = slot.keyframe ? 0 : (m_slots_since_keyframe + 1);
+  m_slots.push_back(std::move(slot));
+  std::swap(m_newest_state, job.state);
+  if (!job.state.empty())
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_free_states.size() < MAX_FREE_STATES)
+      m_free_states.push_back(std::move(job.state));
+  }
+
+  EvictOldest();
+}
+
+void RewindStore::EvictOldest()
+{
+  // Deltas can't outlive the keyframe they're based on, and turning the next one into a keyframe would mean
+  // compressing a whole state again. So the oldest group only goes once there are enough slots without it, which
+  // keeps up to (keyframe interval - 1) slots more than asked for.
+  for (;;)
+  {
+    size_t group_size = 1;
+    while (group_size < m_slots.size() && !m_slots[group_size].keyframe)
+      group_size++;
+    if ((m_slots.size() - group_size) < m_max_slots)
+      break;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (; group_size > 0; group_size--)
+    {
+      if (m_slots.front().vram_texture)
+        m_free_textures.push_back(std::move(m_slots.front().vram_texture));
+      m_slots.pop_front();
+    }
+  }
+}
+
+bool RewindStore::DecodeSlot(size_t index, std::vector<u8>* state)
+{
+  size_t keyframe_index = index;
+  while (!m_slots[keyframe_index].keyframe)
+    keyframe_index--;
+
+  if (!Decompress(m_slots[keyframe_index], state))
+    return false;
+
+  for (size_t i = keyframe_index + 1; i <= index; i++)
+  {
+    if (!Decompress(m_slots[i], &m_delta_buffer) ||
+        !ApplyDelta(state, m_slots[i].uncompressed_size, m_delta_buffer.data(), m_delta_buffer.size()))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool RewindStore::Compress(const u8* data, size_t size, std::vector<u8>* compressed)
+{
+  uLongf compressed_size = compressBound(static_cast<uLong>(size));
+  compressed->resize(compressed_size);
+  if (compress2(compressed->data(), &compressed_size, data, static_cast<uLong>(size), Z_BEST_SPEED) != Z_OK)
+    return false;
+
+  compressed->resize(compressed_size);
+  compressed->shrink_to_fit();
+  return true;
+}
+
+bool RewindStore::Decompress(const Slot& slot, std::vector<u8>* data)
+{
+  data->resize(slot.encoded_size);
+  uLongf size = slot.encoded_size;
+  return (uncompress(data->data(), &size, slot.data.data(), static_cast<uLong>(slot.data.size())) == Z_OK &&
+          size == slot.encoded_size);
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "types.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class HostDisplayTexture;
+
+/// Holds the rewind history as compressed save states. Every few slots is a keyframe, the rest are packed XOR deltas
+/// against the slot before them, which only hold the words that changed. Encoding happens on a worker thread.
+class RewindStore
+{
+public:
+  struct Statistics
+  {
+    u32 slot_count;
+    u32 keyframe_count;
+    u64 compressed_bytes;   ///< Size of all slots, excluding VRAM textures.
+    u64 uncompressed_bytes; ///< Size the slots would be as plain save states.
+  };
+
+  RewindStore();
+  ~RewindStore();
+
+  void StartThread(u32 max_slots, u32 keyframe_interval);
+  void StopThread();
+
+  /// Copies a save state and queues it for encoding. The VRAM texture belongs to the slot from now on.
+  void Push(const void* state, u32 state_size, std::unique_ptr<HostDisplayTexture> vram_texture);
+
+  /// Returns a VRAM texture from an evicted slot to be reused for the next save, if there is one.
+  std::unique_ptr<HostDisplayTexture> TakeFreeTexture();
+
+  /// Decodes the newest slot, waiting for any pending encodes first.
+  bool GetNewest(std::vector<u8>* state, HostDisplayTexture** vram_texture);
+
+  /// Throws away the newest slots.
+  void PopNewest(u32 count);
+
+  void Clear();
+
+  Statistics GetStatistics();
+
+private:
+  static constexpr u32 MAX_FREE_STATES = 2;
+
+  struct Slot
+  {
+    std::vector<u8> data;
+    std::unique_ptr<HostDisplayTexture> vram_texture;
+    u32 uncompressed_size;
+    u32 encoded_size; ///< Size of the data once decompressed, the full state for keyframes or the packed delta.
+    bool keyframe;
+  };
+
+  struct Job
+  {
+    std::vector<u8> state;
+    std::unique_ptr<HostDisplayTexture> vram_texture;
+  };
+
+  void WorkerThreadEntryPoint();
+  void WaitForIdle(std::unique_lock<std::mutex>& lock);
+  void EncodeJob(Job job);
+  void EvictOldest();
+  bool DecodeSlot(size_t index, std::vector<u8>* state);
+
+  static bool Compress(const u8* data, size_t size, std::vector<u8>* compressed);
+  static bool Decompress(const Slot& slot, std::vector<u8>* data);
+
+  std::mutex m_mutex;
+  std::thread m_worker_thread;
+  std::condition_variable m_work_cv;
+  std::condition_variable m_idle_cv;
+  bool m_shutdown_flag = false;
+  bool m_busy = false;
+
+  std::deque<Job> m_jobs;
+  std::deque<Slot> m_slots;
+  std::vector<std::unique_ptr<HostDisplayTexture>> m_free_textures;
+  std::vector<std::vector<u8>> m_free_states;
+
+  // The plain state of the newest slot, which the next one is encoded against. Empty when it's not known.
+  std::vector<u8> m_newest_state;
+  std::vector<u8> m_delta_buffer;
+
+  u32 m_max_slots = 0;
+  u32 m_keyframe_interval = 1;
+  u32 m_slots_since_keyframe = 0;
+};
@@ -2,9 +2,12 @@
 #include "types.h"
 
 static constexpr u32 SAVE_STATE_MAGIC = 0x43435544;
-static constexpr u32 SAVE_STATE_VERSION = 55;
+static constexpr u32 SAVE_STATE_VERSION = 56;
 static constexpr u32 SAVE_STATE_MINIMUM_VERSION = 42;
 
+/// Set in the header flags when the data was written to a flat buffer, without markers.
+static constexpr u32 SAVE_STATE_FLAG_FLAT = (1u << 0);
+
 #pragma pack(push, 4)
 struct SAVE_STATE_HEADER
 {
@@ -18,7 +21,7 @@ struct SAVE_STATE_HEADER
   u32 media_filename_length;
   u32 offset_to_media_filename;
   u32 media_subimage_index;
-  u32 unused_offset_to_playlist_filename; // Unused as of version 51.
+  u32 flags; // offset_to_playlist_filename before version 51, unused until version 56.
 
   u32 screenshot_width;
   u32 screenshot_height;
@@ -8,7 +8,7 @@
 #include <cctype>
 #include <numeric>
 
-Settings g_settings;
+CONSOLE_LOCAL Settings g_settings;
 
 SettingsInterface::~SettingsInterface() = default;
 
@@ -152,15 +152,20 @@ void Settings::Load(SettingsInterface& si)
 
   cpu_recompiler_block_linking = si.GetBoolValue("CPU", "RecompilerBlockLinking", true);
   cpu_recompiler_icache = si.GetBoolValue("CPU", "RecompilerICache", false);
+  cpu_recompiler_tiered_compilation = si.GetBoolValue("CPU", "RecompilerTieredCompilation", true);
+  cpu_code_cache_traces = si.GetBoolValue("CPU", "CodeCacheTraces", true);
+  cpu_idle_loop_skipping = si.GetBoolValue("CPU", "IdleLoopSkipping", true);
   cpu_fastmem_mode = ParseCPUFastmemMode(
                        si.GetStringValue("CPU", "FastmemMode", GetCPUFastmemModeName(DEFAULT_CPU_FASTMEM_MODE)).c_str())
                        .value_or(DEFAULT_CPU_FASTMEM_MODE);
   cpu_fastmem_rewrite = si.GetBoolValue("CPU", "FastmemRewrite", false);
+  cpu_persistent_code_cache = si.GetBoolValue("CPU", "PersistentCodeCache", false);
 
   gpu_renderer = ParseRendererName(si.GetStringValue("GPU", "Renderer", GetRendererName(DEFAULT_GPU_RENDERER)).c_str())
                    .value_or(DEFAULT_GPU_RENDERER);
   gpu_resolution_scale = static_cast<u32>(si.GetIntValue("GPU", "ResolutionScale", 1));
   gpu_use_thread = si.GetBoolValue("GPU", "UseThread", true);
+  gpu_sw_rasterizer_threads = static_cast<u32>(si.GetIntValue("GPU", "SoftwareRasterizerThreads", 1));
   gpu_use_software_renderer_for_readbacks = si.GetBoolValue("GPU", "UseSoftwareRendererForReadbacks", false);
   gpu_true_color = si.GetBoolValue("GPU", "TrueColor", false);
   gpu_scaled_dithering = si.GetBoolValue("GPU", "ScaledDithering", false);
@@ -68,8 +68,12 @@ struct Settings
   bool cpu_recompiler_memory_exceptions = false;
   bool cpu_recompiler_block_linking = true;
   bool cpu_recompiler_icache = false;
+  bool cpu_recompiler_tiered_compilation = true;
+  bool cpu_code_cache_traces = true;
+  bool cpu_idle_loop_skipping = true;
   CPUFastmemMode cpu_fastmem_mode = CPUFastmemMode::Disabled;
   bool cpu_fastmem_rewrite = false;
+  bool cpu_persistent_code_cache = false;
 
   bool apply_game_settings = true;
   bool disable_all_enhancements = false;
@@ -83,6 +87,7 @@ struct Settings
   u32 gpu_resolution_scale = 1;
   u32 gpu_multisamples = 1;
   bool gpu_use_thread = true;
+  u32 gpu_sw_rasterizer_threads = 1;
   bool gpu_use_software_renderer_for_readbacks = false;
   bool gpu_per_sample_shading = false;
   bool gpu_true_color = false;
@@ -309,4 +314,4 @@ struct Settings
 #endif
 };
 
-extern Settings g_settings;
+extern CONSOLE_LOCAL Settings g_settings;
@@ -5,7 +5,7 @@
 #include "interrupt_controller.h"
 #include "memory_card.h"
 
-SIO g_sio;
+CONSOLE_LOCAL SIO g_sio;
 
 SIO::SIO() = default;
 
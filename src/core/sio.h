@@ -78,4 +78,4 @@ private:
   u16 m_SIO_BAUD = 0;
 };
 
-extern SIO g_sio;
\ No newline at end of file
+extern CONSOLE_LOCAL SIO g_sio;
\ No newline at end of file
@@ -5,13 +5,14 @@
 #include "dma.h"
 #include "host_interface.h"
 #include "interrupt_controller.h"
+#include "profiling.h"
 #include "system.h"
 
 #define SPU_TriggerRAMIRQ() \
   m_SPUSTAT.irq9_flag = true; \
   g_interrupt_controller.InterruptRequest(InterruptController::IRQ::SPU)
 
-SPU g_spu;
+CONSOLE_LOCAL SPU g_spu;
 
 SPU::SPU() = default;
 
@@ -30,6 +31,7 @@ void SPU::Initialize()
     [](void* param, TickCount ticks, TickCount ticks_late) { static_cast<SPU*>(param)->ExecuteTransfer(ticks); }, this,
     false);
   m_audio_stream = g_host_interface->GetAudioStream();
+  m_ram_writes.Resize(RAM_SIZE);
 
   Reset();
 }
@@ -53,6 +55,7 @@ void SPU::Shutdown()
 void SPU::Reset()
 {
   m_ticks_carry = 0;
+  m_ram_writes.MarkAllDirty();
 
   m_SPUCNT.bits = 0;
   m_SPUSTAT.bits = 0;
@@ -108,7 +111,7 @@ void SPU::Reset()
   UpdateEventInterval();
 }
 
-bool SPU::DoState(StateWrapper& sw)
+bool SPU::DoState(StateWrapper& sw, bool is_memory_state)
 {
   sw.Do(&m_ticks_carry);
   sw.Do(&m_SPUCNT.bits);
@@ -167,7 +170,14 @@ bool SPU::DoState(StateWrapper& sw)
   }
 
   sw.Do(&m_transfer_fifo);
-  sw.DoBytes(m_ram.data(), RAM_SIZE);
+
+  // memory states keep RAM in a snapshot instead
+  if (!is_memory_state)
+  {
+    sw.DoBytes(m_ram.data(), RAM_SIZE);
+    if (sw.IsReading())
+      m_ram_writes.MarkAllDirty();
+  }
 
   if (sw.IsReading())
   {
@@ -673,6 +683,7 @@ void SPU::WriteToCaptureBuffer(u32 index, s16 value)
 {
   const u32 ram_address = (index * CAPTURE_BUFFER_SIZE_PER_CHANNEL) | ZeroExtend16(m_capture_buffer_position);
   std::memcpy(&m_ram[ram_address], &value, sizeof(value));
+  m_ram_writes.MarkDirty(ram_address);
   if (IsRAMIRQTriggerable() && CheckRAMIRQ(ram_address))
   {
     SPU_TriggerRAMIRQ();
@@ -704,6 +715,7 @@ void ALWAYS_INLINE SPU::ExecuteFIFOWriteToRAM(TickCount& ticks)
 {
   u16 value = m_transfer_fifo.Pop();
   std::memcpy(&m_ram[m_transfer_address], &value, sizeof(u16));
+  m_ram_writes.MarkDirty(m_transfer_address);
   m_transfer_address = (m_transfer_address + sizeof(u16)) & RAM_MASK;
   ticks -= TRANSFER_TICKS_PER_HALFWORD;
 
@@ -1427,6 +1439,7 @@ void SPU::ReverbWrite(u32 address, s16 data)
   // TODO: This should check interrupts.
   const u32 real_address = ReverbMemoryAddress(address << 2);
   std::memcpy(&m_ram[real_address], &data, sizeof(data));
+  m_ram_writes.MarkDirty(real_address);
 }
 
 // Zeroes optimized out; middle removed too(it's 16384)
@@ -1567,6 +1580,8 @@ void SPU::ProcessReverb(s16 left_in, s16 right_in, s32* left_out, s32* right_out
 
 void SPU::Execute(TickCount ticks)
 {
+  Profiling::ScopedSection profile_section(Profiling::Section::SPU);
+
   u32 remaining_frames;
   if (g_settings.cpu_overclock_active)
   {
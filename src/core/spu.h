@@ -1,6 +1,8 @@
 #pragma once
 #include "common/bitfield.h"
 #include "common/fifo_queue.h"
+#include "page_write_tracker.h"
+#include "paged_hash.h"
 #include "system.h"
 #include "types.h"
 #include <array>
@@ -25,7 +27,7 @@ public:
   void CPUClockChanged();
   void Shutdown();
   void Reset();
-  bool DoState(StateWrapper& sw);
+  bool DoState(StateWrapper& sw, bool is_memory_state);
 
   u16 ReadRegister(u32 offset);
   void WriteRegister(u32 offset, u16 value);
@@ -40,6 +42,16 @@ public:
   const std::array<u8, RAM_SIZE>& GetRAM() const { return m_ram; }
   std::array<u8, RAM_SIZE>& GetRAM() { return m_ram; }
 
+  /// Returns a digest of SPU RAM, only rehashing the pages which were written since the last call.
+  u64 GetRAMHash() { return m_ram_hash.Update(m_ram.data(), m_ram_writes); }
+
+  /// Memory states keep SPU RAM in a snapshot, which only copies the pages written since it was last saved.
+  void SaveRAMSnapshot(PageWriteTracker::Snapshot* snapshot) { m_ram_writes.SaveSnapshot(m_ram.data(), snapshot); }
+  bool RestoreRAMSnapshot(const PageWriteTracker::Snapshot& snapshot)
+  {
+    return m_ram_writes.RestoreSnapshot(m_ram.data(), snapshot);
+  }
+
   /// Change output stream - used for runahead.
   ALWAYS_INLINE void SetAudioStream(AudioStream* stream) { m_audio_stream = stream; }
 
@@ -58,6 +70,7 @@ private:
   static constexpr u32 MINIMUM_TICKS_BETWEEN_KEY_ON_OFF = 2;
   static constexpr u32 NUM_REVERB_REGS = 32;
   static constexpr u32 FIFO_SIZE_IN_HALFWORDS = 32;
+  static constexpr u32 RAM_WRITE_PAGE_SIZE = 4096;
   static constexpr TickCount TRANSFER_TICKS_PER_HALFWORD = 16;
 
   enum class RAMTransferMode : u8
@@ -405,6 +418,8 @@ private:
   InlineFIFOQueue<u16, FIFO_SIZE_IN_HALFWORDS> m_transfer_fifo;
 
   std::array<u8, RAM_SIZE> m_ram{};
+  PageWriteTracker m_ram_writes{RAM_WRITE_PAGE_SIZE};
+  PagedHash m_ram_hash;
 };
 
-extern SPU g_spu;
+extern CONSOLE_LOCAL SPU g_spu;
@@ -3,6 +3,7 @@
 #include "bus.h"
 #include "cdrom.h"
 #include "cheats.h"
+#include "common/align.h"
 #include "common/audio_stream.h"
 #include "common/error.h"
 #include "common/file_system.h"
@@ -28,6 +29,7 @@
 #include "multitap.h"
 #include "pad.h"
 #include "pgxp.h"
+#include "profiling.h"
 #include "psf_loader.h"
 #include "save_state_version.h"
 #include "sio.h"
@@ -59,6 +61,12 @@ struct MemorySaveState
 {
   std::unique_ptr<HostDisplayTexture> vram_texture;
   std::unique_ptr<GrowableMemoryByteStream> state_stream;
+
+  // RAM, SPU RAM and software VRAM aren't in the stream. Saving only copies the pages written since the slot was last
+  // saved, and loading only the pages written since the slot was saved.
+  PageWriteTracker::Snapshot ram;
+  PageWriteTracker::Snapshot spu_ram;
+  PageWriteTracker::Snapshot vram;
 };
 
 static bool SaveMemoryState(MemorySaveState* mss);
@@ -72,8 +80,10 @@ static std::unique_ptr<CDImage> OpenCDImage(const char* path, Common::Error* err
 static bool ReadExecutableFromImage(ISOReader& iso, std::string* out_executable_name, std::vector<u8>* out_executable_data);
 static bool ShouldCheckForImagePatches();
 
-static bool DoLoadState(ByteStream* stream, bool force_software_renderer, bool update_display);
-static bool DoState(StateWrapper& sw, HostDisplayTexture** host_texture, bool update_display, bool is_memory_state);
+static bool DoLoadState(ByteStream* stream, bool force_software_renderer, bool update_display,
+                        const u8* flat_state = nullptr);
+static bool DoState(StateWrapper& sw, HostDisplayTexture** host_texture, bool update_display, bool is_memory_state,
+                    bool keep_code_cache = false);
 static void DoRunFrame();
 static bool CreateGPU(GPURenderer renderer);
 
@@ -84,42 +94,52 @@ static void SaveRunaheadState();
 static void DoRunahead();
 
 static void DoMemorySaveStates();
+static void UpdateRAMWriteTracking();
 
 static bool Initialize(bool force_software_renderer);
 
 static void UpdateRunningGame(const char* path, CDImage* image);
 static bool CheckForSBIFile(CDImage* image);
+static std::string GetPersistentCodeCacheFileName(const char* path, CDImage* image, const BIOS::Image& bios);
+
+static CONSOLE_LOCAL State s_state = State::Shutdown;
+static CONSOLE_LOCAL std::atomic_bool s_startup_cancelled{false};
 
-static State s_state = State::Shutdown;
-static std::atomic_bool s_startup_cancelled{false};
+static CONSOLE_LOCAL ConsoleRegion s_region = ConsoleRegion::NTSC_U;
+CONSOLE_LOCAL TickCount g_ticks_per_second = MASTER_CLOCK;
+static CONSOLE_LOCAL TickCount s_max_slice_ticks = MASTER_CLOCK / 10;
+static CONSOLE_LOCAL u32 s_frame_number = 1;
+static CONSOLE_LOCAL u32 s_internal_frame_number = 0;
 
-static ConsoleRegion s_region = ConsoleRegion::NTSC_U;
-TickCount g_ticks_per_second = MASTER_CLOCK;
-static TickCount s_max_slice_ticks = MASTER_CLOCK / 10;
-static u32 s_frame_number = 1;
-static u32 s_internal_frame_number = 0;
+static CONSOLE_LOCAL std::string s_running_game_path;
+static CONSOLE_LOCAL std::string s_running_game_code;
+static CONSOLE_LOCAL std::string s_running_game_title;
 
-static std::string s_running_game_path;
-static std::string s_running_game_code;
-static std::string s_running_game_title;
+static CONSOLE_LOCAL float s_throttle_frequency = 60.0f;
 
-static float s_throttle_frequency = 60.0f;
+static CONSOLE_LOCAL std::unique_ptr<CheatList> s_cheat_list;
 
-static std::unique_ptr<CheatList> s_cheat_list;
+static CONSOLE_LOCAL bool s_memory_saves_enabled = false;
+static CONSOLE_LOCAL bool s_state_hash_tracking = false;
 
-static bool s_memory_saves_enabled = false;
+static CONSOLE_LOCAL std::deque<MemorySaveState> s_rewind_states;
+static CONSOLE_LOCAL s32 s_rewind_load_frequency = -1;
+static CONSOLE_LOCAL s32 s_rewind_load_counter = -1;
+static CONSOLE_LOCAL s32 s_rewind_save_frequency = -1;
+static CONSOLE_LOCAL s32 s_rewind_save_counter = -1;
+static CONSOLE_LOCAL bool s_rewinding_first_save = false;
 
-static std::deque<MemorySaveState> s_rewind_states;
-static s32 s_rewind_load_frequency = -1;
-static s32 s_rewind_load_counter = -1;
-static s32 s_rewind_save_frequency = -1;
-static s32 s_rewind_save_counter = -1;
-static bool s_rewinding_first_save = false;
+static CONSOLE_LOCAL std::deque<MemorySaveState> s_runahead_states;
+static CONSOLE_LOCAL std::vector<MemorySaveState> s_runahead_spare_states;
+static CONSOLE_LOCAL std::unique_ptr<AudioStream> s_runahead_audio_stream;
+static CONSOLE_LOCAL bool s_runahead_replay_pending = false;
+static CONSOLE_LOCAL bool s_runahead_frame_hidden = false;
+static CONSOLE_LOCAL u32 s_runahead_frames = 0;
 
-static std::deque<MemorySaveState> s_runahead_states;
-static std::unique_ptr<AudioStream> s_runahead_audio_stream;
-static bool s_runahead_replay_pending = false;
-static u32 s_runahead_frames = 0;
+// Room for the parts of a flat state which change size over a session: FIFOs, the GPU blit buffer and the media
+// filename. The CD audio FIFO and a full-VRAM blit buffer are the largest at ~350KB and 1MB.
+static constexpr u32 FLAT_STATE_SLACK = 2 * 1024 * 1024;
+static CONSOLE_LOCAL u32 s_flat_state_size = 0;
 
 State GetState()
 {
@@ -178,6 +198,11 @@ void FrameDone()
   CPU::g_state.downcount = 0;
 }
 
+bool IsFrameHidden()
+{
+  return s_runahead_frame_hidden;
+}
+
 const std::string& GetRunningCode()
 {
   return s_running_game_code;
@@ -670,6 +695,11 @@ bool Boot(const SystemBootParameters& params)
   // Notify change of disc.
   UpdateRunningGame(media ? media->GetFileName().c_str() : params.filename.c_str(), media.get());
 
+  // Work out where the code cache lives before the media is handed off to the CD-ROM.
+  std::string code_cache_filename;
+  if (g_settings.cpu_persistent_code_cache && g_settings.IsUsingCodeCache())
+    code_cache_filename = GetPersistentCodeCacheFileName(params.filename.c_str(), media.get(), *bios_image);
+
   // Check for SBI.
   if (!CheckForSBIFile(media.get()))
   {
@@ -727,6 +757,10 @@ bool Boot(const SystemBootParameters& params)
     BIOS::PatchBIOSFastBoot(Bus::g_bios, Bus::BIOS_SIZE, bios_hash);
   }
 
+  // Start loading the code cache in the background, blocks get compiled once the code is in memory.
+  if (!code_cache_filename.empty())
+    CPU::CodeCache::LoadPersistentCache(std::move(code_cache_filename));
+
   // Good to go.
   s_state = State::Running;
   return true;
@@ -804,6 +838,7 @@ void Shutdown()
   g_interrupt_controller.Shutdown();
   g_dma.Shutdown();
   PGXP::Shutdown();
+  CPU::CodeCache::SavePersistentCache();
   CPU::CodeCache::Shutdown();
   Bus::Shutdown();
   CPU::Shutdown();
@@ -811,6 +846,8 @@ void Shutdown()
   s_running_game_path.clear();
   s_running_game_title.clear();
   s_cheat_list.reset();
+  s_flat_state_size = 0;
+  s_state_hash_tracking = false;
   s_state = State::Shutdown;
 
   g_host_interface->OnRunningGameChanged(s_running_game_path, nullptr, s_running_game_code, s_running_game_title);
@@ -862,8 +899,11 @@ bool CreateGPU(GPURenderer renderer)
   return true;
 }
 
-bool DoState(StateWrapper& sw, HostDisplayTexture** host_texture, bool update_display, bool is_memory_state)
+bool DoState(StateWrapper& sw, HostDisplayTexture** host_texture, bool update_display, bool is_memory_state,
+             bool keep_code_cache)
 {
+  keep_code_cache |= is_memory_state;
+
   if (!sw.DoMarker("System"))
     return false;
 
@@ -874,20 +914,16 @@ bool DoState(StateWrapper& sw, HostDisplayTexture** host_texture, bool update_di
   if (!sw.DoMarker("CPU") || !CPU::DoState(sw))
     return false;
 
-  if (sw.IsReading())
-  {
-    if (is_memory_state)
-      CPU::CodeCache::InvalidateAll();
-    else
-      CPU::CodeCache::Flush();
-  }
+  // memory and flat states only invalidate the code in RAM pages which change, when the bus restores them
+  if (sw.IsReading() && !keep_code_cache)
+    CPU::CodeCache::Flush();
 
   // only reset pgxp if we're not runahead-rollbacking. the value checks will save us from broken rendering, and it
   // saves using imprecise values for a frame in 30fps games.
   if (sw.IsReading() && g_settings.gpu_pgxp_enable && !is_memory_state)
     PGXP::Reset();
 
-  if (!sw.DoMarker("Bus") || !Bus::DoState(sw))
+  if (!sw.DoMarker("Bus") || !Bus::DoState(sw, is_memory_state, keep_code_cache))
     return false;
 
   if (!sw.DoMarker("DMA") || !g_dma.DoState(sw))
@@ -911,7 +947,7 @@ bool DoState(StateWrapper& sw, HostDisplayTexture** host_texture, bool update_di
   if (!sw.DoMarker("Timers") || !g_timers.DoState(sw))
     return false;
 
-  if (!sw.DoMarker("SPU") || !g_spu.DoState(sw))
+  if (!sw.DoMarker("SPU") || !g_spu.DoState(sw, is_memory_state))
     return false;
 
   if (!sw.DoMarker("MDEC") || !g_mdec.DoState(sw))
@@ -979,7 +1015,7 @@ bool LoadState(ByteStream* state)
   return DoLoadState(state, false, false);
 }
 
-bool DoLoadState(ByteStream* state, bool force_software_renderer, bool update_display)
+bool DoLoadState(ByteStream* state, bool force_software_renderer, bool update_display, const u8* flat_state)
 {
   SAVE_STATE_HEADER header;
   if (!state->Read2(&header, sizeof(header)))
@@ -1101,12 +1137,41 @@ bool DoLoadState(ByteStream* state, bool force_software_renderer, bool update_di
     return false;
   }
 
-  if (!state->SeekAbsolute(header.offset_to_data))
-    return false;
+  if (header.version >= 56 && (header.flags & SAVE_STATE_FLAG_FLAT))
+  {
+    // read flat states in place when they're already in memory, otherwise pull the data out of the stream first
+    std::vector<u8> data;
+    if (flat_state)
+    {
+      if (header.offset_to_data > state->GetSize() ||
+          header.data_uncompressed_size > (state->GetSize() - header.offset_to_data))
+      {
+        return false;
+      }
+    }
+    else
+    {
+      data.resize(header.data_uncompressed_size);
+      if (!state->SeekAbsolute(header.offset_to_data) || !state->Read2(data.data(), header.data_uncompressed_size))
+        return false;
+    }
 
-  StateWrapper sw(state, StateWrapper::Mode::Read, header.version);
-  if (!DoState(sw, nullptr, update_display, false))
-    return false;
+    StateWrapper sw(flat_state ? const_cast<u8*>(flat_state + header.offset_to_data) : data.data(),
+                    header.data_uncompressed_size, StateWrapper::Mode::Read, header.version);
+
+    // netplay rolls back like runahead does, throwing the code cache away every time would be far too slow
+    if (!DoState(sw, nullptr, update_display, false, true))
+      return false;
+  }
+  else
+  {
+    if (!state->SeekAbsolute(header.offset_to_data))
+      return false;
+
+    StateWrapper sw(state, StateWrapper::Mode::Read, header.version);
+    if (!DoState(sw, nullptr, update_display, false))
+      return false;
+  }
 
   if (s_state == State::Starting)
     s_state = State::Running;
@@ -1170,6 +1235,156 @@ bool SaveState(ByteStream* state)
   return true;
 }
 
+u32 GetFlatStateSize()
+{
+  // libretro treats zero as "can't serialize right now", a guess here would disagree with the size once running
+  if (IsShutdown())
+    return 0;
+
+  if (s_flat_state_size == 0)
+  {
+    // a null buffer only measures the state
+    g_gpu->RestoreGraphicsAPIState();
+    StateWrapper sw(nullptr, 0, StateWrapper::Mode::Write, SAVE_STATE_VERSION);
+    const bool result = DoState(sw, nullptr, false, false);
+    g_gpu->ResetGraphicsAPIState();
+    if (!result)
+    {
+      // nothing is cached, so the next call measures again rather than reporting a size which could change
+      Log_ErrorPrintf("Failed to measure the flat save state size");
+      return 0;
+    }
+
+    // loading a state can switch to 8MB RAM, and the size mustn't change when it does
+    const u32 ram_headroom = Bus::RAM_8MB_SIZE - Bus::g_ram_size;
+    s_flat_state_size = Common::AlignUpPow2(
+      static_cast<u32>(sizeof(SAVE_STATE_HEADER)) + sw.GetBufferPosition() + ram_headroom + FLAT_STATE_SLACK, 4096);
+    Log_InfoPrintf("Flat save state size is %u bytes", s_flat_state_size);
+  }
+
+  return s_flat_state_size;
+}
+
+bool SaveFlatState(void* buffer, u32 size)
+{
+  if (IsShutdown() || size < sizeof(SAVE_STATE_HEADER))
+    return false;
+
+  u8* const data = static_cast<u8*>(buffer);
+  SAVE_STATE_HEADER header = {};
+  header.magic = SAVE_STATE_MAGIC;
+  header.version = SAVE_STATE_VERSION;
+  header.flags = SAVE_STATE_FLAG_FLAT;
+  StringUtil::Strlcpy(header.title, s_running_game_title.c_str(), sizeof(header.title));
+  StringUtil::Strlcpy(header.game_code, s_running_game_code.c_str(), sizeof(header.game_code));
+
+  u32 position = sizeof(header);
+  if (g_cdrom.HasMedia())
+  {
+    const std::string& media_filename = g_cdrom.GetMediaFileName();
+    header.offset_to_media_filename = position;
+    header.media_filename_length = static_cast<u32>(media_filename.length());
+    header.media_subimage_index = g_cdrom.GetMedia()->HasSubImages() ? g_cdrom.GetMedia()->GetCurrentSubImage() : 0;
+    if (header.media_filename_length > (size - position))
+      return false;
+
+    std::memcpy(data + position, media_filename.data(), header.media_filename_length);
+    position += header.media_filename_length;
+  }
+
+  header.offset_to_data = position;
+
+  g_gpu->RestoreGraphicsAPIState();
+  StateWrapper sw(data + position, size - position, StateWrapper::Mode::Write, SAVE_STATE_VERSION);
+  const bool result = DoState(sw, nullptr, false, false);
+  g_gpu->ResetGraphicsAPIState();
+  if (!result)
+  {
+    Log_ErrorPrintf("Failed to save flat state to %u byte buffer", size);
+    return false;
+  }
+
+  header.data_uncompressed_size = sw.GetBufferPosition();
+  std::memcpy(data, &header, sizeof(header));
+
+  // netplay compares whole buffers, so whatever is left over can't be stale
+  position += header.data_uncompressed_size;
+  std::memset(data + position, 0, size - position);
+  return true;
+}
+
+bool LoadFlatState(const void* buffer, u32 size)
+{
+  if (IsShutdown())
+    return false;
+
+  std::unique_ptr<ByteStream> stream = ByteStream_CreateReadOnlyMemoryStream(buffer, size);
+  return DoLoadState(stream.get(), false, false, static_cast<const u8*>(buffer));
+}
+
+StateHash GetStateHash()
+{
+  StateHash hash = {};
+  if (IsShutdown())
+    return hash;
+
+  // fastmem stores only mark the pages they write while RAM write tracking is on, so turn it on the first time, which
+  // throws away the code compiled without it
+  if (!s_state_hash_tracking)
+  {
+    s_state_hash_tracking = true;
+    UpdateRAMWriteTracking();
+  }
+
+  hash.ram = Bus::GetRAMHash();
+
+  g_gpu->RestoreGraphicsAPIState();
+  hash.vram = g_gpu->GetVRAMHash();
+  g_gpu->ResetGraphicsAPIState();
+
+  hash.spu_ram = g_spu.GetRAMHash();
+
+  XXH3_state_t* state = XXH3_createState();
+  XXH3_64bits_reset(state);
+  XXH3_64bits_update(state, CPU::g_state.regs.r, sizeof(CPU::g_state.regs.r));
+  XXH3_64bits_update(state, &CPU::g_state.regs.pc, sizeof(CPU::g_state.regs.pc));
+  XXH3_64bits_update(state, &CPU::g_state.regs.npc, sizeof(CPU::g_state.regs.npc));
+
+  // one field at a time, so padding the compiler might put between the unions never reaches the hash
+  const CPU::Cop0Registers& cop0 = CPU::g_state.cop0_regs;
+  const u32 cop0_values[] = {cop0.BPC,  cop0.BDA,  cop0.TAR,     cop0.BadVaddr,   cop0.BDAM,     cop0.BPCM,
+                             cop0.EPC,  cop0.PRID, cop0.sr.bits, cop0.cause.bits, cop0.dcic.bits};
+  XXH3_64bits_update(state, cop0_values, sizeof(cop0_values));
+
+  XXH3_64bits_update(state, CPU::g_state.gte_regs.r32, sizeof(CPU::g_state.gte_regs.r32));
+  XXH3_64bits_update(state, CPU::g_state.dcache.data(), CPU::g_state.dcache.size());
+  hash.cpu = XXH3_64bits_digest(state);
+  XXH3_freeState(state);
+
+  const u64 parts[] = {hash.ram, hash.vram, hash.spu_ram, hash.cpu};
+  hash.digest = XXH3_64bits(parts, sizeof(parts));
+  return hash;
+}
+
+std::string GetStateHashMismatch(const StateHash& lhs, const StateHash& rhs)
+{
+  std::string ret;
+  const auto check = [&ret](u64 lhs_part, u64 rhs_part, const char* name) {
+    if (lhs_part == rhs_part)
+      return;
+
+    if (!ret.empty())
+      ret.append(", ");
+    ret.append(name);
+  };
+
+  check(lhs.ram, rhs.ram, "RAM");
+  check(lhs.vram, rhs.vram, "VRAM");
+  check(lhs.spu_ram, rhs.spu_ram, "SPU RAM");
+  check(lhs.cpu, rhs.cpu, "CPU");
+  return ret;
+}
+
 void DoRunFrame()
 {
   g_gpu->RestoreGraphicsAPIState();
@@ -1180,6 +1395,7 @@ void DoRunFrame()
   }
   else
   {
+    Profiling::ScopedSection profile_section(Profiling::Section::CPU);
     switch (g_settings.cpu_execution_mode)
     {
       case CPUExecutionMode::Recompiler:
@@ -1201,6 +1417,9 @@ void DoRunFrame()
     }
   }
 
+  // Compile any blocks from the persistent code cache which have been loaded since the last frame.
+  CPU::CodeCache::PrecompilePersistentBlocks();
+
   // Generate any pending samples from the SPU before sleeping, this way we reduce the chances of underruns.
   g_spu.GeneratePendingSamples();
 
@@ -1653,6 +1872,31 @@ void UpdateRunningGame(const char* path, CDImage* image)
   g_host_interface->OnRunningGameChanged(s_running_game_path, image, s_running_game_code, s_running_game_title);
 }
 
+std::string GetPersistentCodeCacheFileName(const char* path, CDImage* image, const BIOS::Image& bios)
+{
+  const std::string base_path(g_host_interface->GetShaderCacheBasePath());
+  if (base_path.empty())
+    return {};
+
+  // Keyed by both the game and the BIOS, since the BIOS code ends up in the cache too.
+  std::string game_hash;
+  if (image)
+  {
+    game_hash = GetGameHashCodeForImage(image);
+  }
+  else
+  {
+    std::optional<std::vector<u8>> data = FileSystem::ReadBinaryFile(path);
+    if (data.has_value())
+      game_hash = StringUtil::StdStringFromFormat("HASH-%" PRIX64, XXH64(data->data(), data->size(), 0));
+  }
+  if (game_hash.empty())
+    return {};
+
+  return StringUtil::StdStringFromFormat("%scodecache_%s_%016" PRIX64 ".bin", base_path.c_str(), game_hash.c_str(),
+                                         XXH64(bios.data(), bios.size(), 0));
+}
+
 bool CheckForSBIFile(CDImage* image)
 {
   if (s_running_game_code.empty() || !LibcryptGameList::IsLibcryptGameCode(s_running_game_code) || !image ||
@@ -1787,6 +2031,7 @@ void ClearMemorySaveStates()
 {
   s_rewind_states.clear();
   s_runahead_states.clear();
+  s_runahead_spare_states.clear();
 }
 
 void UpdateMemorySaveStateSettings()
@@ -1836,6 +2081,8 @@ void UpdateMemorySaveStateSettings()
   {
     s_runahead_audio_stream.reset();
   }
+
+  UpdateRAMWriteTracking();
 }
 
 bool LoadMemoryState(const MemorySaveState& mss)
@@ -1844,7 +2091,10 @@ bool LoadMemoryState(const MemorySaveState& mss)
 
   StateWrapper sw(mss.state_stream.get(), StateWrapper::Mode::Read, SAVE_STATE_VERSION);
   HostDisplayTexture* host_texture = mss.vram_texture.get();
-  if (!DoState(sw, &host_texture, true, true))
+
+  // only runahead loads these, and it'll run a frame before anything is shown
+  if (!DoState(sw, &host_texture, false, true) || !Bus::RestoreRAMSnapshot(mss.ram) ||
+      !g_spu.RestoreRAMSnapshot(mss.spu_ram) || !g_gpu->RestoreVRAMSnapshot(mss.vram))
   {
     g_host_interface->ReportError("Failed to load memory save state, resetting.");
     Reset();
@@ -1871,6 +2121,9 @@ bool SaveMemoryState(MemorySaveState* mss)
   }
 
   mss->vram_texture.reset(host_texture);
+  Bus::SaveRAMSnapshot(&mss->ram);
+  g_spu.SaveRAMSnapshot(&mss->spu_ram);
+  g_gpu->SaveVRAMSnapshot(&mss->vram);
   return true;
 }
 
@@ -1949,13 +2202,18 @@ void DoRewind()
 
 void SaveRunaheadState()
 {
-  // try to reuse the frontmost slot
+  // try to reuse the frontmost slot, or one thrown away by a replay, since their snapshots are mostly up to date
   MemorySaveState mss;
   while (s_runahead_states.size() >= s_runahead_frames)
   {
     mss = std::move(s_runahead_states.front());
     s_runahead_states.pop_front();
   }
+  if (!mss.state_stream && !s_runahead_spare_states.empty())
+  {
+    mss = std::move(s_runahead_spare_states.back());
+    s_runahead_spare_states.pop_back();
+  }
 
   if (!SaveMemoryState(&mss))
   {
@@ -1980,7 +2238,11 @@ void DoRunahead()
 
     // and throw away all the states, forcing us to catch up below
     // TODO: can we leave one frame here and run, avoiding the extra save?
-    s_runahead_states.clear();
+    while (!s_runahead_states.empty())
+    {
+      s_runahead_spare_states.push_back(std::move(s_runahead_states.back()));
+      s_runahead_states.pop_back();
+    }
 
   }
 
@@ -1989,14 +2251,17 @@ void DoRunahead()
   if (frames_to_run > 0)
   {
     g_spu.SetAudioStream(s_runahead_audio_stream.get());
-
     while (frames_to_run > 0)
     {
+      // interlaced output only scans out one field each frame and keeps the other from the frame before, so the last
+      // frame before the one which is shown still has to be scanned out
+      s_runahead_frame_hidden = (frames_to_run > 1 || !g_gpu->IsInterlacedDisplayEnabled());
       DoRunFrame();
       SaveRunaheadState();
       frames_to_run--;
     }
 
+    s_runahead_frame_hidden = false;
     g_spu.SetAudioStream(g_host_interface->GetAudioStream());
 
   }
@@ -2008,6 +2273,11 @@ void DoRunahead()
 
 }
 
+void UpdateRAMWriteTracking()
+{
+  Bus::SetRAMWriteTrackingEnabled(s_memory_saves_enabled || s_runahead_frames > 0 || s_state_hash_tracking);
+}
+
 void DoMemorySaveStates()
 {
   if (s_rewind_save_counter >= 0)
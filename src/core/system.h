@@ -46,7 +46,7 @@ enum class State
   Running
 };
 
-extern TickCount g_ticks_per_second;
+extern CONSOLE_LOCAL TickCount g_ticks_per_second;
 
 /// Returns the preferred console type for a disc.
 ConsoleRegion GetConsoleRegionForDiscRegion(DiscRegion region);
@@ -90,6 +90,9 @@ bool InjectEXEFromBuffer(const void* buffer, u32 buffer_size, bool patch_loader
 u32 GetFrameNumber();
 void FrameDone();
 
+/// Returns true while runahead is emulating frames which will never be displayed.
+bool IsFrameHidden();
+
 const std::string& GetRunningCode();
 float GetThrottleFrequency();
 
@@ -100,6 +103,31 @@ void Shutdown();
 bool LoadState(ByteStream* state);
 bool SaveState(ByteStream* state);
 
+/// Returns the size of a flat save state, which doesn't change until shutdown so netplay can rely on it.
+/// Covers the largest RAM configuration, and is zero while no system is running or the state can't be measured.
+u32 GetFlatStateSize();
+
+/// Flat save states go straight into a preallocated buffer and skip the markers, for frontends saving every frame.
+bool SaveFlatState(void* buffer, u32 size);
+bool LoadFlatState(const void* buffer, u32 size);
+
+struct StateHash
+{
+  u64 digest; ///< Combines all of the below.
+  u64 ram;
+  u64 vram;
+  u64 spu_ram;
+  u64 cpu; ///< CPU, COP0 and GTE registers, and the scratchpad.
+};
+
+/// Hashes the machine state for desync detection. RAM, VRAM and SPU RAM are only hashed again where they were written
+/// since the last call, so this is cheap enough to do every frame. The first call turns on RAM write tracking, which
+/// flushes the code cache.
+StateHash GetStateHash();
+
+/// Returns the names of the parts which differ between two state hashes, e.g. "RAM, VRAM", or an empty string.
+std::string GetStateHashMismatch(const StateHash& lhs, const StateHash& rhs);
+
 /// Recreates the GPU component, saving/loading the state so it is preserved. Call when the GPU renderer changes.
 bool RecreateGPU(GPURenderer renderer, bool update_display = true);
 
@@ -13,7 +13,7 @@
 #include <cinttypes>
 Log_SetChannel(TextureReplacements);
 
-TextureReplacements g_texture_replacements;
+CONSOLE_LOCAL TextureReplacements g_texture_replacements;
 
 static constexpr u32 VRAMRGBA5551ToRGBA8888(u16 color)
 {
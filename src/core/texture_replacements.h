@@ -86,4 +86,4 @@ private:
   VRAMWriteReplacementMap m_vram_write_replacements;
 };
 
-extern TextureReplacements g_texture_replacements;
\ No newline at end of file
+extern CONSOLE_LOCAL TextureReplacements g_texture_replacements;
\ No newline at end of file
@@ -4,7 +4,7 @@
 #include "interrupt_controller.h"
 #include "system.h"
 
-Timers g_timers;
+CONSOLE_LOCAL Timers g_timers;
 
 Timers::Timers() = default;
 
@@ -98,4 +98,4 @@ private:
   u32 m_sysclk_div_8_carry = 0;      // partial ticks for timer 3 with sysclk/8
 };
 
-extern Timers g_timers;
+extern CONSOLE_LOCAL Timers g_timers;
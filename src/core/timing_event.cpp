@@ -2,15 +2,22 @@
 #include "common/state_wrapper.h"
 #include "cpu_core.h"
 #include "cpu_core_private.h"
+#include "profiling.h"
 #include "system.h"
+#include <algorithm>
 
 namespace TimingEvents {
 
-static TimingEvent* s_active_events_head;
-static TimingEvent* s_active_events_tail;
-static TimingEvent* s_current_event = nullptr;
-static u32 s_active_event_count = 0;
-static u32 s_global_tick_counter = 0;
+// Active events, as a binary min-heap on the next run time. The head is the next event to run.
+static CONSOLE_LOCAL std::vector<TimingEvent*> s_active_events;
+static CONSOLE_LOCAL TickCount s_next_event_downcount = 0;
+static CONSOLE_LOCAL u32 s_global_tick_counter = 0;
+
+// Events which run on the same tick are ordered by these. Rescheduling to a later time puts an event in front of the
+// others due then and rescheduling to an earlier time puts it behind them, which is what the sorted list did.
+static constexpr u64 INITIAL_QUEUE_ORDER = UINT64_C(1) << 63;
+static CONSOLE_LOCAL u64 s_front_queue_order = INITIAL_QUEUE_ORDER;
+static CONSOLE_LOCAL u64 s_back_queue_order = INITIAL_QUEUE_ORDER;
 
 u32 GetGlobalTickCounter()
 {
@@ -42,196 +49,143 @@ void UpdateCPUDowncount()
 {
   if (!CPU::g_state.frame_done && (!CPU::HasPendingInterrupt() || CPU::g_using_interpreter))
   {
-    CPU::g_state.downcount = s_active_events_head->GetDowncount();
+    CPU::g_state.downcount = s_next_event_downcount;
   }
 }
 
-TimingEvent** GetHeadEventPtr()
+const TickCount* GetNextEventDowncountPtr()
+{
+  return &s_next_event_downcount;
+}
+
+static void UpdateNextEventDowncount()
+{
+  if (!s_active_events.empty())
+    s_next_event_downcount = s_active_events.front()->GetDowncount();
+}
+
+static bool RunsBefore(const TimingEvent* lhs, const TimingEvent* rhs)
 {
-  return &s_active_events_head;
+  const s32 diff = static_cast<s32>(lhs->m_next_run_time - rhs->m_next_run_time);
+  return (diff < 0 || (diff == 0 && lhs->m_queue_order < rhs->m_queue_order));
 }
 
-static void SortEvent(TimingEvent* event)
+static void SetQueueSlot(u32 index, TimingEvent* event)
 {
-  const TickCount event_downcount = event->m_downcount;
+  s_active_events[index] = event;
+  event->m_queue_index = index;
+}
 
-  if (event->prev && event->prev->m_downcount > event_downcount)
+static void SiftUp(u32 index)
+{
+  TimingEvent* event = s_active_events[index];
+  while (index > 0)
   {
-    // move backwards
-    TimingEvent* current = event->prev;
-    while (current && current->m_downcount > event_downcount)
-      current = current->prev;
-
-    // unlink
-    if (event->prev)
-      event->prev->next = event->next;
-    else
-      s_active_events_head = event->next;
-    if (event->next)
-      event->next->prev = event->prev;
-    else
-      s_active_events_tail = event->prev;
-
-    // insert after current
-    if (current)
-    {
-      event->next = current->next;
-      if (current->next)
-        current->next->prev = event;
-      else
-        s_active_events_tail = event;
-
-      event->prev = current;
-      current->next = event;
-    }
-    else
-    {
-      // insert at front
-      s_active_events_head->prev = event;
-      event->prev = nullptr;
-      event->next = s_active_events_head;
-      s_active_events_head = event;
-      UpdateCPUDowncount();
-    }
+    const u32 parent = (index - 1) / 2;
+    if (!RunsBefore(event, s_active_events[parent]))
+      break;
+
+    SetQueueSlot(index, s_active_events[parent]);
+    index = parent;
   }
-  else if (event->next && event_downcount > event->next->m_downcount)
-  {
-    // move forwards
-    TimingEvent* current = event->next;
-    while (current && event_downcount > current->m_downcount)
-      current = current->next;
-
-    // unlink
-    if (event->prev)
-      event->prev->next = event->next;
-    else
-      s_active_events_head = event->next;
-    if (event->next)
-      event->next->prev = event->prev;
-    else
-      s_active_events_tail = event->prev;
-
-    // insert before current
-    if (current)
-    {
-      event->next = current;
-      event->prev = current->prev;
 
-      if (current->prev)
-        current->prev->next = event;
-      else
-        s_active_events_head = event;
+  SetQueueSlot(index, event);
+}
 
-      current->prev = event;
-    }
-    else
-    {
-      // insert at back
-      s_active_events_tail->next = event;
-      event->next = nullptr;
-      event->prev = s_active_events_tail;
-      s_active_events_tail = event;
-    }
+static void SiftDown(u32 index)
+{
+  const u32 count = static_cast<u32>(s_active_events.size());
+  TimingEvent* event = s_active_events[index];
+  for (;;)
+  {
+    u32 child = index * 2 + 1;
+    if (child >= count)
+      break;
+    if ((child + 1) < count && RunsBefore(s_active_events[child + 1], s_active_events[child]))
+      child++;
+    if (!RunsBefore(s_active_events[child], event))
+      break;
+
+    SetQueueSlot(index, s_active_events[child]);
+    index = child;
   }
+
+  SetQueueSlot(index, event);
 }
 
-static void AddActiveEvent(TimingEvent* event)
+static void SortEvent(TimingEvent* event, u32 old_run_time)
 {
-  s_active_event_count++;
+  const bool was_head = (event->m_queue_index == 0);
+  const bool moved_earlier = (static_cast<s32>(event->m_next_run_time - old_run_time) < 0);
+  event->m_queue_order = moved_earlier ? s_back_queue_order++ : --s_front_queue_order;
 
-  TimingEvent* current = nullptr;
-  TimingEvent* next = s_active_events_head;
-  while (next && event->m_downcount > next->m_downcount)
-  {
-    current = next;
-    next = next->next;
-  }
+  // the order can move it up even when the time moves it down, so try both
+  SiftUp(event->m_queue_index);
+  SiftDown(event->m_queue_index);
 
-  if (!next)
+  if (was_head || event->m_queue_index == 0)
   {
-    // new tail
-    event->prev = s_active_events_tail;
-    if (s_active_events_tail)
-    {
-      s_active_events_tail->next = event;
-      s_active_events_tail = event;
-    }
-    else
-    {
-      // first event
-      s_active_events_tail = event;
-      s_active_events_head = event;
+    UpdateNextEventDowncount();
+    if (event->m_queue_index == 0)
       UpdateCPUDowncount();
-    }
   }
-  else if (!current)
+}
+
+static void AddActiveEvent(TimingEvent* event)
+{
+  event->m_queue_order = --s_front_queue_order;
+  event->m_queue_index = static_cast<u32>(s_active_events.size());
+  s_active_events.push_back(event);
+  SiftUp(event->m_queue_index);
+
+  if (event->m_queue_index == 0)
   {
-    // new head
-    event->next = s_active_events_head;
-    s_active_events_head->prev = event;
-    s_active_events_head = event;
+    UpdateNextEventDowncount();
     UpdateCPUDowncount();
   }
-  else
-  {
-    // inbetween current < event > next
-    event->prev = current;
-    event->next = next;
-    current->next = event;
-    next->prev = event;
-  }
 }
 
 static void RemoveActiveEvent(TimingEvent* event)
 {
-  if (event->next)
-    event->next->prev = event->prev;
-  else
-    s_active_events_tail = event->prev;
-
-  if (event->prev)
+  const u32 index = event->m_queue_index;
+  TimingEvent* last = s_active_events.back();
+  s_active_events.pop_back();
+  if (last != event)
   {
-    event->prev->next = event->next;
+    SetQueueSlot(index, last);
+    SiftUp(index);
+    SiftDown(last->m_queue_index);
   }
-  else
+
+  if (index == 0 && !s_active_events.empty())
   {
-    s_active_events_head = event->next;
-    if (s_active_events_head)
-      UpdateCPUDowncount();
+    UpdateNextEventDowncount();
+    UpdateCPUDowncount();
   }
-
-  event->prev = nullptr;
-  event->next = nullptr;
-
-  s_active_event_count--;
 }
 
 static void SortEvents()
 {
-  std::vector<TimingEvent*> events;
-  events.reserve(s_active_event_count);
-
-  TimingEvent* next = s_active_events_head;
-  while (next)
-  {
-    TimingEvent* current = next;
-    events.push_back(current);
-    next = current->next;
-    current->prev = nullptr;
-    current->next = nullptr;
-  }
-
-  s_active_events_head = nullptr;
-  s_active_events_tail = nullptr;
-  s_active_event_count = 0;
+  // re-adding in the current order gives the same result as building the old list did
+  std::vector<TimingEvent*> events = std::move(s_active_events);
+  s_active_events.clear();
+  s_front_queue_order = INITIAL_QUEUE_ORDER;
+  s_back_queue_order = INITIAL_QUEUE_ORDER;
 
   for (TimingEvent* event : events)
     AddActiveEvent(event);
 }
 
+static std::vector<TimingEvent*> GetSortedActiveEvents()
+{
+  std::vector<TimingEvent*> events(s_active_events);
+  std::sort(events.begin(), events.end(), RunsBefore);
+  return events;
+}
+
 static TimingEvent* FindActiveEvent(const char* name)
 {
-  for (TimingEvent* event = s_active_events_head; event; event = event->next)
+  for (TimingEvent* event : s_active_events)
   {
     if (event->GetName().compare(name) == 0)
       return event;
@@ -242,43 +196,38 @@ static TimingEvent* FindActiveEvent(const char* name)
 
 void RunEvents()
 {
+  Profiling::ScopedSection profile_section(Profiling::Section::TimingEvents);
+
   TickCount pending_ticks = CPU::GetPendingTicks();
   CPU::ResetPendingTicks();
   while (pending_ticks > 0)
   {
-    const TickCount time = std::min(pending_ticks, s_active_events_head->GetDowncount());
+    const TickCount time = std::min(pending_ticks, s_next_event_downcount);
     s_global_tick_counter += static_cast<u32>(time);
     pending_ticks -= time;
 
-    // Apply downcount to all events.
-    // This will result in a negative downcount for those events which are late.
-    for (TimingEvent* event = s_active_events_head; event; event = event->next)
-    {
-      event->m_downcount -= time;
-      event->m_time_since_last_run += time;
-    }
-
-    // Now we can actually run the callbacks.
-    while (s_active_events_head->m_downcount <= 0)
+    // Events which are late have a run time before the global tick counter.
+    TimingEvent* event = s_active_events.front();
+    while (static_cast<s32>(event->m_next_run_time - s_global_tick_counter) <= 0)
     {
-      // move it to the end, since that'll likely be its new position
-      TimingEvent* event = s_active_events_head;
-      s_current_event = event;
-
       // Factor late time into the time for the next invocation.
-      const TickCount ticks_late = -event->m_downcount;
-      const TickCount ticks_to_execute = event->m_time_since_last_run;
-      event->m_downcount += event->m_interval;
-      event->m_time_since_last_run = 0;
+      const TickCount ticks_late = static_cast<TickCount>(s_global_tick_counter - event->m_next_run_time);
+      const TickCount ticks_to_execute = static_cast<TickCount>(s_global_tick_counter - event->m_last_run_time);
+      const u32 old_run_time = event->m_next_run_time;
+      event->m_next_run_time += static_cast<u32>(event->m_interval);
+      event->m_last_run_time = s_global_tick_counter;
+
+      // Requeue before the callback, so anything it schedules sees a valid queue.
+      SortEvent(event, old_run_time);
 
       // The cycles_late is only an indicator, it doesn't modify the cycles to execute.
       event->m_callback(event->m_callback_param, ticks_to_execute, ticks_late);
-      if (event->m_active)
-        SortEvent(event);
+      event = s_active_events.front();
     }
+
+    UpdateNextEventDowncount();
   }
 
-  s_current_event = nullptr;
   UpdateCPUDowncount();
 }
 
@@ -293,6 +242,9 @@ bool DoState(StateWrapper& sw)
     u32 event_count = 0;
     sw.Do(&event_count);
 
+    // Ties are broken by the order the events were in before loading, as when the list was re-sorted.
+    std::vector<TimingEvent*> events = GetSortedActiveEvents();
+
     for (u32 i = 0; i < event_count; i++)
     {
       std::string event_name;
@@ -309,9 +261,8 @@ bool DoState(StateWrapper& sw)
       if (!event)
         continue;
 
-      // Using reschedule is safe here since we call sort afterwards.
-      event->m_downcount = downcount;
-      event->m_time_since_last_run = time_since_last_run;
+      event->m_next_run_time = s_global_tick_counter + static_cast<u32>(downcount);
+      event->m_last_run_time = s_global_tick_counter - static_cast<u32>(time_since_last_run);
       event->m_period = period;
       event->m_interval = interval;
     }
@@ -322,18 +273,23 @@ bool DoState(StateWrapper& sw)
       sw.Do(&last_event_run_time);
     }
 
+    s_active_events = std::move(events);
     SortEvents();
   }
   else
   {
+    // written in run order, the same layout as the sorted list produced
+    const std::vector<TimingEvent*> events = GetSortedActiveEvents();
+    u32 event_count = static_cast<u32>(events.size());
+    sw.Do(&event_count);
 
-    sw.Do(&s_active_event_count);
-
-    for (TimingEvent* event = s_active_events_head; event; event = event->next)
+    for (TimingEvent* event : events)
     {
+      TickCount downcount = event->GetDowncount();
+      TickCount time_since_last_run = static_cast<TickCount>(s_global_tick_counter - event->m_last_run_time);
       sw.Do(&event->m_name);
-      sw.Do(&event->m_downcount);
-      sw.Do(&event->m_time_since_last_run);
+      sw.Do(&downcount);
+      sw.Do(&time_since_last_run);
       sw.Do(&event->m_period);
       sw.Do(&event->m_interval);
     }
@@ -357,14 +313,25 @@ TimingEvent::~TimingEvent()
     TimingEvents::RemoveActiveEvent(this);
 }
 
+TickCount TimingEvent::GetDowncount() const
+{
+  if (!m_active)
+    return m_downcount;
+
+  return static_cast<TickCount>(m_next_run_time - TimingEvents::s_global_tick_counter);
+}
+
 TickCount TimingEvent::GetTicksSinceLastExecution() const
 {
-  return CPU::GetPendingTicks() + m_time_since_last_run;
+  if (!m_active)
+    return CPU::GetPendingTicks() + m_time_since_last_run;
+
+  return CPU::GetPendingTicks() + static_cast<TickCount>(TimingEvents::s_global_tick_counter - m_last_run_time);
 }
 
 TickCount TimingEvent::GetTicksUntilNextExecution() const
 {
-  return std::max(m_downcount - CPU::GetPendingTicks(), static_cast<TickCount>(0));
+  return std::max(GetDowncount() - CPU::GetPendingTicks(), static_cast<TickCount>(0));
 }
 
 void TimingEvent::Delay(TickCount ticks)
@@ -372,19 +339,21 @@ void TimingEvent::Delay(TickCount ticks)
   if (!m_active)
     return;
 
-  m_downcount += ticks;
-  TimingEvents::SortEvent(this);
+  const u32 old_run_time = m_next_run_time;
+  m_next_run_time += static_cast<u32>(ticks);
+  TimingEvents::SortEvent(this, old_run_time);
 }
 
 void TimingEvent::Schedule(TickCount ticks)
 {
   const TickCount pending_ticks = CPU::GetPendingTicks();
-  m_downcount = pending_ticks + ticks;
+  const u32 old_run_time = m_next_run_time;
+  m_next_run_time = TimingEvents::s_global_tick_counter + static_cast<u32>(pending_ticks + ticks);
 
   if (!m_active)
   {
     // Event is going active, so we want it to only execute ticks from the current timestamp.
-    m_time_since_last_run = -pending_ticks;
+    m_last_run_time = TimingEvents::s_global_tick_counter + static_cast<u32>(pending_ticks);
     m_active = true;
     TimingEvents::AddActiveEvent(this);
   }
@@ -392,8 +361,7 @@ void TimingEvent::Schedule(TickCount ticks)
   {
     // Event is already active, so we leave the time since last run alone, and just modify the downcount.
     // If this is a call from an IO handler for example, re-sort the event queue.
-    if (TimingEvents::s_current_event != this)
-      TimingEvents::SortEvent(this);
+    TimingEvents::SortEvent(this, old_run_time);
   }
 }
 
@@ -415,10 +383,10 @@ void TimingEvent::Reset()
   if (!m_active)
     return;
 
-  m_downcount = m_interval;
-  m_time_since_last_run = 0;
-  if (TimingEvents::s_current_event != this)
-    TimingEvents::SortEvent(this);
+  const u32 old_run_time = m_next_run_time;
+  m_next_run_time = TimingEvents::s_global_tick_counter + static_cast<u32>(m_interval);
+  m_last_run_time = TimingEvents::s_global_tick_counter;
+  TimingEvents::SortEvent(this, old_run_time);
 }
 
 void TimingEvent::InvokeEarly(bool force /* = false */)
@@ -427,16 +395,18 @@ void TimingEvent::InvokeEarly(bool force /* = false */)
     return;
 
   const TickCount pending_ticks = CPU::GetPendingTicks();
-  const TickCount ticks_to_execute = m_time_since_last_run + pending_ticks;
+  const TickCount ticks_to_execute = GetTicksSinceLastExecution();
   if ((!force && ticks_to_execute < m_period) || ticks_to_execute <= 0)
     return;
 
-  m_downcount = pending_ticks + m_interval;
-  m_time_since_last_run -= ticks_to_execute;
-  m_callback(m_callback_param, ticks_to_execute, 0);
+  const u32 old_run_time = m_next_run_time;
+  m_next_run_time = TimingEvents::s_global_tick_counter + static_cast<u32>(pending_ticks + m_interval);
+  m_last_run_time = TimingEvents::s_global_tick_counter + static_cast<u32>(pending_ticks);
 
   // Since we've changed the downcount, we need to re-sort the events.
-  TimingEvents::SortEvent(this);
+  TimingEvents::SortEvent(this, old_run_time);
+
+  m_callback(m_callback_param, ticks_to_execute, 0);
 }
 
 void TimingEvent::Activate()
@@ -446,8 +416,8 @@ void TimingEvent::Activate()
 
   // leave the downcount intact
   const TickCount pending_ticks = CPU::GetPendingTicks();
-  m_downcount += pending_ticks;
-  m_time_since_last_run -= pending_ticks;
+  m_next_run_time = TimingEvents::s_global_tick_counter + static_cast<u32>(m_downcount + pending_ticks);
+  m_last_run_time = TimingEvents::s_global_tick_counter - static_cast<u32>(m_time_since_last_run - pending_ticks);
 
   m_active = true;
   TimingEvents::AddActiveEvent(this);
@@ -459,8 +429,8 @@ void TimingEvent::Deactivate()
     return;
 
   const TickCount pending_ticks = CPU::GetPendingTicks();
-  m_downcount -= pending_ticks;
-  m_time_since_last_run += pending_ticks;
+  m_downcount = GetDowncount() - pending_ticks;
+  m_time_since_last_run = static_cast<TickCount>(TimingEvents::s_global_tick_counter - m_last_run_time) + pending_ticks;
 
   m_active = false;
   TimingEvents::RemoveActiveEvent(this);
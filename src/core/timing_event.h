@@ -23,7 +23,9 @@ public:
 
   // Returns the number of ticks between each event.
   ALWAYS_INLINE TickCount GetInterval() const { return m_interval; }
-  ALWAYS_INLINE TickCount GetDowncount() const { return m_downcount; }
+
+  // Ticks until the event runs, from the global tick counter. Excludes pending time.
+  TickCount GetDowncount() const;
 
   // Includes pending time.
   TickCount GetTicksSinceLastExecution() const;
@@ -59,14 +61,21 @@ public:
   void SetInterval(TickCount interval) { m_interval = interval; }
   void SetPeriod(TickCount period) { m_period = period; }
 
-  TimingEvent* prev = nullptr;
-  TimingEvent* next = nullptr;
-
   TimingEventCallback m_callback;
   void* m_callback_param;
 
+  // Absolute times against the global tick counter, while the event is active.
+  u32 m_next_run_time = 0;
+  u32 m_last_run_time = 0;
+
+  // Position in the event queue, and tie-breaker for events which run on the same tick.
+  u32 m_queue_index = 0;
+  u64 m_queue_order = 0;
+
+  // Relative times, kept while the event is inactive so it picks up where it left off.
   TickCount m_downcount;
   TickCount m_time_since_last_run;
+
   TickCount m_period;
   TickCount m_interval;
   bool m_active = false;
@@ -92,6 +101,7 @@ void RunEvents();
 
 void UpdateCPUDowncount();
 
-TimingEvent** GetHeadEventPtr();
+/// Ticks until the next event runs, from the global tick counter. Read directly by the recompiler dispatcher.
+const TickCount* GetNextEventDowncountPtr();
 
 } // namespace TimingEvents
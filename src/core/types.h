@@ -1,6 +1,14 @@
 #pragma once
 #include "common/types.h"
 
+// Per-console mutable state. Multi-instance builds give every thread its own console, so one process can run several
+// sessions side by side; single-instance builds keep plain globals.
+#ifdef WITH_MULTI_INSTANCE
+#define CONSOLE_LOCAL thread_local
+#else
+#define CONSOLE_LOCAL
+#endif
+
 // Physical memory addresses are 32-bits wide
 using PhysicalMemoryAddress = u32;
 using VirtualMemoryAddress = u32;
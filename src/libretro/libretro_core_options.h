@@ -332,6 +332,23 @@ struct retro_core_option_v2_definition option_defs_us[] = {
      {NULL, NULL},
    },
    "true"},
+  {"swanstation_GPU_SoftwareRasterizerThreads",
+   "Rasterizer Threads (Software)",
+   NULL,
+   "Splits drawing between this many threads, each taking interleaved bands of rows. Helps on systems with many "
+   "slow cores. Transfers and effects which read back what is being drawn still run on one thread.",
+   NULL,
+   "enhancement",
+   {
+     {"1", "1 (Disabled)"},
+     {"2", "2"},
+     {"3", "3"},
+     {"4", "4"},
+     {"6", "6"},
+     {"8", "8"},
+     {NULL, NULL},
+   },
+   "1"},
   {"swanstation_GPU_UseSoftwareRendererForReadbacks",
    "Use Software Renderer For Readbacks (Restart)",
    NULL,
@@ -1909,6 +1926,34 @@ struct retro_core_option_v2_definition option_defs_us[] = {
      {NULL, NULL},
    },
    "false"},
+  {"swanstation_CPU_CodeCacheTraces",
+   "CPU Superblocks",
+   NULL,
+   "Follows unconditional jumps when building code blocks, so that straight-line code split by jumps is compiled as "
+   "a single block. When tiered compilation is enabled, the recompiler also follows conditional branches which nearly "
+   "always go the same way, otherwise only unconditional jumps are followed. Reduces dispatch overhead in the cached "
+   "interpreter and recompiler. Not used when the instruction cache is simulated.",
+   NULL,
+   "advanced",
+   {
+     {"true", "Enabled"},
+     {"false", "Disabled"},
+     {NULL, NULL},
+   },
+   "true"},
+  {"swanstation_CPU_IdleLoopSkipping",
+   "CPU Idle Loop Skipping",
+   NULL,
+   "Detects loops which only poll memory or the interrupt controller waiting for something to happen, and skips "
+   "ahead to the next hardware event instead of running them. Saves host CPU time with no effect on emulation.",
+   NULL,
+   "advanced",
+   {
+     {"true", "Enabled"},
+     {"false", "Disabled"},
+     {NULL, NULL},
+   },
+   "true"},
   {"swanstation_CPU_RecompilerBlockLinking",
    "CPU Recompiler Block Linking",
    NULL,
@@ -1922,6 +1967,20 @@ struct retro_core_option_v2_definition option_defs_us[] = {
      {NULL, NULL},
    },
    "true"},
+  {"swanstation_CPU_RecompilerTieredCompilation",
+   "CPU Recompiler Tiered Compilation",
+   NULL,
+   "Runs newly-seen code in the cached interpreter, and only recompiles it once it has been executed several times. "
+   "Reduces stutter from compiling code which only runs once, e.g. during loading screens. Also records which way "
+   "branches go while code is interpreted, which CPU Superblocks needs to follow conditional branches.",
+   NULL,
+   "advanced",
+   {
+     {"true", "Enabled"},
+     {"false", "Disabled"},
+     {NULL, NULL},
+   },
+   "true"},
   {"swanstation_CPU_FastmemMode",
    "CPU Recompiler Fast Memory Access",
    NULL,
@@ -1956,6 +2015,20 @@ struct retro_core_option_v2_definition option_defs_us[] = {
      {NULL, NULL},
    },
    "false"},
+  {"swanstation_CPU_PersistentCodeCache",
+   "CPU Persistent Code Cache (Restart)",
+   NULL,
+   "Remembers which code blocks each game executed, and compiles them ahead of time on the next boot. Reduces "
+   "stutter when code is first run, at the cost of a small file per game in the cache directory (the system "
+   "directory, or the core assets directory if no system directory is set).",
+   NULL,
+   "advanced",
+   {
+     {"true", "Enabled"},
+     {"false", "Disabled"},
+     {NULL, NULL},
+   },
+   "false"},
   {"swanstation_TextureReplacements_EnableVRAMWriteReplacements",
    "Enable VRAM Write Texture Replacement",
    NULL,
@@ -29,6 +29,9 @@ LibretroHostDisplay::LibretroHostDisplay()
   retro_pixel_format pf = RETRO_PIXEL_FORMAT_RGB565;
   if (g_retro_environment_callback(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &pf))
     m_current_pixel_format = pf;
+
+  if (!g_retro_environment_callback(RETRO_ENVIRONMENT_GET_CAN_DUPE, &m_can_dupe))
+    m_can_dupe = false;
 }
 
 LibretroHostDisplay::~LibretroHostDisplay() = default;
@@ -196,12 +199,20 @@ void LibretroHostDisplay::EndSetDisplayPixels()
   // noop
 }
 
+bool LibretroHostDisplay::RetainsDisplayPixels() const
+{
+  // frontend framebuffers are handed back after each frame
+  return (HasDisplayTexture() && m_display_texture_handle == m_frame_buffer.data());
+}
+
 bool LibretroHostDisplay::Render()
 {
   if (HasDisplayTexture())
   {
-    g_retro_video_refresh_callback(m_display_texture_handle, m_display_texture_view_width,
-                                   m_display_texture_view_height, m_frame_buffer_pitch);
+    // a null frame tells the frontend to show the last one again
+    const void* data = (m_display_texture_unchanged && m_can_dupe) ? nullptr : m_display_texture_handle;
+    g_retro_video_refresh_callback(data, m_display_texture_view_width, m_display_texture_view_height,
+                                   m_frame_buffer_pitch);
 
     if (m_display_texture_handle == m_software_fb.data)
       ClearDisplayTexture();
@@ -34,6 +34,7 @@ public:
   bool BeginSetDisplayPixels(HostDisplayPixelFormat format, u32 width, u32 height, void** out_buffer,
                              u32* out_pitch) override;
   void EndSetDisplayPixels() override;
+  bool RetainsDisplayPixels() const override;
 
 private:
   bool CheckPixelFormat(retro_pixel_format new_format);
@@ -42,4 +43,5 @@ private:
   u32 m_frame_buffer_pitch = 0;
   retro_framebuffer m_software_fb = {};
   retro_pixel_format m_current_pixel_format = RETRO_PIXEL_FORMAT_UNKNOWN;
+  bool m_can_dupe = false;
 };
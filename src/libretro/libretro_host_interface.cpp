@@ -176,7 +176,7 @@ RETRO_API void retro_set_input_state(retro_input_state_t f)
   g_retro_input_state_callback = f;
 }
 
-LibretroHostInterface g_libretro_host_interface;
+CONSOLE_LOCAL LibretroHostInterface g_libretro_host_interface;
 #define P_THIS (&g_libretro_host_interface)
 
 #define RETRO_DEVICE_PS_CONTROLLER RETRO_DEVICE_SUBCLASS(RETRO_DEVICE_JOYPAD, 0)
@@ -186,21 +186,21 @@ LibretroHostInterface g_libretro_host_interface;
 #define RETRO_DEVICE_PS_GUNCON RETRO_DEVICE_SUBCLASS(RETRO_DEVICE_LIGHTGUN, 0)
 #define RETRO_DEVICE_PS_MOUSE RETRO_DEVICE_SUBCLASS(RETRO_DEVICE_MOUSE, 0)
 
-retro_environment_t g_retro_environment_callback;
-retro_video_refresh_t g_retro_video_refresh_callback;
-retro_audio_sample_t g_retro_audio_sample_callback;
-retro_audio_sample_batch_t g_retro_audio_sample_batch_callback;
-retro_input_poll_t g_retro_input_poll_callback;
-retro_input_state_t g_retro_input_state_callback;
-
-static retro_log_callback s_libretro_log_callback = {};
-static bool s_libretro_log_callback_valid = false;
-static bool s_libretro_log_callback_registered = false;
-static bool libretro_supports_option_categories = false;
-static bool analog_pressed = false;
-static bool port_allowed = false;
-static unsigned libretro_msg_interface_version = 0;
-static int analog_index = -1;
+CONSOLE_LOCAL retro_environment_t g_retro_environment_callback;
+CONSOLE_LOCAL retro_video_refresh_t g_retro_video_refresh_callback;
+CONSOLE_LOCAL retro_audio_sample_t g_retro_audio_sample_callback;
+CONSOLE_LOCAL retro_audio_sample_batch_t g_retro_audio_sample_batch_callback;
+CONSOLE_LOCAL retro_input_poll_t g_retro_input_poll_callback;
+CONSOLE_LOCAL retro_input_state_t g_retro_input_state_callback;
+
+static CONSOLE_LOCAL retro_log_callback s_libretro_log_callback = {};
+static CONSOLE_LOCAL bool s_libretro_log_callback_valid = false;
+static CONSOLE_LOCAL bool s_libretro_log_callback_registered = false;
+static CONSOLE_LOCAL bool libretro_supports_option_categories = false;
+static CONSOLE_LOCAL bool analog_pressed = false;
+static CONSOLE_LOCAL bool port_allowed = false;
+static CONSOLE_LOCAL unsigned libretro_msg_interface_version = 0;
+static CONSOLE_LOCAL int analog_index = -1;
 
 static void LibretroLogCallback(void* pUserParam, const char* channelName, const char* functionName, LogLevel level,
                                 const char* message)
@@ -209,8 +209,13 @@ static void LibretroLogCallback(void* pUserParam, const char* channelName, const
     {RETRO_LOG_ERROR, RETRO_LOG_ERROR, RETRO_LOG_WARN, RETRO_LOG_INFO, RETRO_LOG_INFO, RETRO_LOG_INFO, RETRO_LOG_INFO,
      RETRO_LOG_DEBUG, RETRO_LOG_DEBUG, RETRO_LOG_DEBUG}};
 
-  s_libretro_log_callback.log(levels[static_cast<std::size_t>(level)], "[%s] %s\n",
-                              (level <= LogLevel::Perf) ? functionName : channelName, message);
+  // Every console in the process registers its own callback, so only forward messages from our own thread.
+  const retro_log_callback* callback = static_cast<const retro_log_callback*>(pUserParam);
+  if (callback != &s_libretro_log_callback)
+    return;
+
+  callback->log(levels[static_cast<std::size_t>(level)], "[%s] %s\n",
+                (level <= LogLevel::Perf) ? functionName : channelName, message);
 }
 
 LibretroHostInterface::LibretroHostInterface() = default;
@@ -306,7 +311,7 @@ void LibretroHostInterface::InitLogging()
 
   if (s_libretro_log_callback_valid)
   {
-    Log::RegisterCallback(LibretroLogCallback, nullptr);
+    Log::RegisterCallback(LibretroLogCallback, &s_libretro_log_callback);
     s_libretro_log_callback_registered = true;
   }
 }
@@ -701,7 +706,8 @@ void LibretroHostInterface::retro_run_frame()
   if (g_settings.audio_fast_hook)
   {
     auto* const audio_stream = dynamic_cast<LibretroAudioStream*>(m_audio_stream.get());
-    audio_stream->UploadToFrontend();
+    if (audio_stream)
+      audio_stream->UploadToFrontend();
   }
 }
 
@@ -712,19 +718,18 @@ unsigned LibretroHostInterface::retro_get_region()
 
 size_t LibretroHostInterface::retro_serialize_size()
 {
-  return System::MAX_SAVE_STATE_SIZE;
+  return System::GetFlatStateSize();
 }
 
 bool LibretroHostInterface::retro_serialize(void* data, size_t size)
 {
-  std::unique_ptr<ByteStream> stream = ByteStream_CreateMemoryStream(data, static_cast<u32>(size));
-  return System::SaveState(stream.get());
+  return System::SaveFlatState(data, static_cast<u32>(size));
 }
 
 bool LibretroHostInterface::retro_unserialize(const void* data, size_t size)
 {
-  std::unique_ptr<ByteStream> stream = ByteStream_CreateReadOnlyMemoryStream(data, static_cast<u32>(size));
-  return System::LoadState(stream.get());
+  // states from older versions were written through a stream with markers, LoadFlatState() handles both
+  return System::LoadFlatState(data, static_cast<u32>(size));
 }
 
 void* LibretroHostInterface::retro_get_memory_data(unsigned id)
@@ -824,6 +829,10 @@ void LibretroHostInterface::ReleaseHostDisplay()
 
 std::unique_ptr<AudioStream> LibretroHostInterface::CreateAudioStream()
 {
+  // Headless frontends (e.g. the benchmark runner) don't consume audio.
+  if (!g_retro_audio_sample_batch_callback)
+    return AudioStream::CreateNullAudioStream();
+
   return std::make_unique<LibretroAudioStream>();
 }
 void LibretroHostInterface::OnControllerTypeChanged(u32 slot) {}
@@ -834,16 +843,16 @@ bool LibretroHostInterface::UpdateCoreOptionsDisplay(bool controller)
 {
   LibretroSettingsInterface si;
 
-  static CPUExecutionMode cpu_execution_mode_prev;
-  static CPUFastmemMode cpu_fastmem_mode_prev;
-  static bool hardware_renderer_prev;
-  static bool pgxp_enable_prev;
-  static bool support_perspective_prev;
-  static MultitapMode multitap_mode_prev;
-  static bool vram_rewrite_replacements_prev;
-  static bool cdrom_preload_enable_prev;
-  static DisplayAspectRatio aspect_ratio_prev;
-  static bool pgxp_depth_buffer_enable_prev;
+  static CONSOLE_LOCAL CPUExecutionMode cpu_execution_mode_prev;
+  static CONSOLE_LOCAL CPUFastmemMode cpu_fastmem_mode_prev;
+  static CONSOLE_LOCAL bool hardware_renderer_prev;
+  static CONSOLE_LOCAL bool pgxp_enable_prev;
+  static CONSOLE_LOCAL bool support_perspective_prev;
+  static CONSOLE_LOCAL MultitapMode multitap_mode_prev;
+  static CONSOLE_LOCAL bool vram_rewrite_replacements_prev;
+  static CONSOLE_LOCAL bool cdrom_preload_enable_prev;
+  static CONSOLE_LOCAL DisplayAspectRatio aspect_ratio_prev;
+  static CONSOLE_LOCAL bool pgxp_depth_buffer_enable_prev;
 
   const CPUExecutionMode cpu_execution_mode =
     Settings::ParseCPUExecutionMode(
@@ -909,6 +918,8 @@ bool LibretroHostInterface::UpdateCoreOptionsDisplay(bool controller)
   g_retro_environment_callback(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
   option_display.key = "swanstation_CPU_RecompilerBlockLinking";
   g_retro_environment_callback(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+  option_display.key = "swanstation_CPU_RecompilerTieredCompilation";
+  g_retro_environment_callback(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
   option_display.key = "swanstation_CPU_FastmemMode";
   g_retro_environment_callback(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
 
@@ -916,6 +927,14 @@ bool LibretroHostInterface::UpdateCoreOptionsDisplay(bool controller)
   option_display.key = "swanstation_CPU_FastmemRewrite";
   g_retro_environment_callback(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
 
+  option_display.visible = (cpu_execution_mode != CPUExecutionMode::Interpreter);
+  option_display.key = "swanstation_CPU_CodeCacheTraces";
+  g_retro_environment_callback(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+  option_display.key = "swanstation_CPU_IdleLoopSkipping";
+  g_retro_environment_callback(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+  option_display.key = "swanstation_CPU_PersistentCodeCache";
+  g_retro_environment_callback(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+
   option_display.visible = hardware_renderer;
   option_display.key = "swanstation_GPU_UseSoftwareRendererForReadbacks";
   g_retro_environment_callback(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
@@ -941,6 +960,8 @@ bool LibretroHostInterface::UpdateCoreOptionsDisplay(bool controller)
   option_display.visible = !hardware_renderer;
   option_display.key = "swanstation_GPU_UseThread";
   g_retro_environment_callback(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
+  option_display.key = "swanstation_GPU_SoftwareRasterizerThreads";
+  g_retro_environment_callback(RETRO_ENVIRONMENT_SET_CORE_OPTIONS_DISPLAY, &option_display);
 
   option_display.visible = pgxp_enable;
   option_display.key = "swanstation_GPU_PGXPCulling";
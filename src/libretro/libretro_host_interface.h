@@ -144,12 +144,12 @@ private:
   DiskControlInfo m_disk_control_info = {};
 };
 
-extern LibretroHostInterface g_libretro_host_interface;
+extern CONSOLE_LOCAL LibretroHostInterface g_libretro_host_interface;
 
 // libretro callbacks
-extern retro_environment_t g_retro_environment_callback;
-extern retro_video_refresh_t g_retro_video_refresh_callback;
-extern retro_audio_sample_t g_retro_audio_sample_callback;
-extern retro_audio_sample_batch_t g_retro_audio_sample_batch_callback;
-extern retro_input_poll_t g_retro_input_poll_callback;
-extern retro_input_state_t g_retro_input_state_callback;
+extern CONSOLE_LOCAL retro_environment_t g_retro_environment_callback;
+extern CONSOLE_LOCAL retro_video_refresh_t g_retro_video_refresh_callback;
+extern CONSOLE_LOCAL retro_audio_sample_t g_retro_audio_sample_callback;
+extern CONSOLE_LOCAL retro_audio_sample_batch_t g_retro_audio_sample_batch_callback;
+extern CONSOLE_LOCAL retro_input_poll_t g_retro_input_poll_callback;
+extern CONSOLE_LOCAL retro_input_state_t g_retro_input_state_callback;